@@ -114,6 +114,105 @@ freecm(
     }
 }
 
+/*
+ - cmsize - estimate the memory allocated for a colormap
+ * Only counts the blocks of the tree for the two-level trees of 16-bit chrs.
+ ^ static size_t cmsize(struct colormap *);
+ */
+static size_t
+cmsize(
+    struct colormap *cm)
+{
+    size_t i, size = 0;
+    union tree *t;
+
+    for (i=1 ; i<=cm->max ; i++) {	/* skip WHITE */
+	if (!UNUSEDCOLOR(&cm->cd[i]) && cm->cd[i].block != NULL) {
+	    size += sizeof(struct colors);
+	}
+    }
+    if (cm->cd != cm->cdspace) {
+	size += cm->ncds * sizeof(struct colordesc);
+    }
+    if (NBYTS == 2) {
+	for (i=0 ; i<BYTTAB ; i++) {
+	    t = cm->tree->tptr[i];
+	    if (t != &cm->tree[1] && t != cm->cd[t->tcolor[0]].block) {
+		size += sizeof(struct colors);
+	    }
+	}
+    }
+    return size;
+}
+
+/*
+ - colorchrs - find the chrs of the colors that have few of them
+ * For each color, counts its chrs in counts[co], up to max+1, and stores the
+ * first max of them in chrs[co*max] onwards.
+ ^ static void colorchrs(struct colormap *, int, int *, chr *);
+ */
+static void
+colorchrs(
+    struct colormap *cm,
+    int max,
+    int *counts,		/* cm->max+1 of them */
+    chr *chrs)			/* (cm->max+1)*max of them */
+{
+    size_t co;
+
+    for (co = 0; co <= cm->max; co++) {
+	counts[co] = 0;
+    }
+    subcolorchrs(cm, cm->tree, 0, 0, max, counts, chrs);
+}
+
+/*
+ - subcolorchrs - find the chrs of the colors in one block of the tree
+ ^ static void subcolorchrs(struct colormap *, union tree *, int, uchr, int,
+ ^	int *, chr *);
+ */
+static void
+subcolorchrs(
+    struct colormap *cm,
+    union tree *tree,
+    int level,			/* level number (top == 0) of this block */
+    uchr base,			/* high bits of the chrs in this block */
+    int max,
+    int *counts,
+    chr *chrs)
+{
+    int i;
+    color co;
+    union tree *t;
+
+    if (level == NBYTS-1) {
+	co = tree->tcolor[0];
+	if (tree == cm->cd[co].block) {	/* solid block */
+	    counts[co] = max+1;
+	    return;
+	}
+	for (i=0 ; i<BYTTAB ; i++) {
+	    co = tree->tcolor[i];
+	    if (counts[co] < max) {
+		chrs[co*max + counts[co]] = (chr) ((base<<BYTBITS) | i);
+	    }
+	    if (counts[co] <= max) {
+		counts[co]++;
+	    }
+	}
+	return;
+    }
+    for (i=0 ; i<BYTTAB ; i++) {
+	t = tree->tptr[i];
+	if (t == &cm->tree[level+1]) {	/* fill block, all WHITE */
+	    counts[WHITE] = max+1;
+	} else {
+	    subcolorchrs(cm, t, level+1, (base<<BYTBITS) | i, max, counts,
+		    chrs);
+	}
+    }
+}
+
 /*
  - cmtreefree - free a non-terminal part of a colormap tree
  ^ static void cmtreefree(struct colormap *, union tree *, int);
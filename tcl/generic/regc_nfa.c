@@ -1591,6 +1591,35 @@ freecnfa(
     FREE(cnfa->arcs);
 }
 
+/*
+ - cnfasize - estimate the memory used by a compacted NFA
+ * The arc lists of all states share one area, ending with the list that
+ * starts last.
+ ^ static size_t cnfasize(struct cnfa *);
+ */
+static size_t
+cnfasize(
+    struct cnfa *cnfa)
+{
+    struct carc *ca, *last;
+    int i;
+
+    if (NULLCNFA(*cnfa)) {
+	return 0;
+    }
+    last = cnfa->states[0];
+    for (i = 1; i < cnfa->nstates; i++) {
+	if (cnfa->states[i] > last) {
+	    last = cnfa->states[i];
+	}
+    }
+    for (ca = last+1; ca->co != COLORLESS; ca++) {
+	/* skip to the endmarker */
+    }
+    return cnfa->nstates * sizeof(struct carc *)
+	    + (ca + 1 - cnfa->arcs) * sizeof(struct carc);
+}
+
 /*
  - dumpnfa - dump an NFA in human-readable form
  ^ static void dumpnfa(struct nfa *, FILE *);
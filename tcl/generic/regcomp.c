@@ -58,6 +58,7 @@ static void dovec(struct vars *, struct cvec *, struct state *, struct state *);
 static void wordchrs(struct vars *);
 static struct subre *subre(struct vars *, int, int, struct state *, struct state *);
 static void freesubre(struct vars *, struct subre *);
+static size_t subresize(struct subre *);
 static void freesrnode(struct vars *, struct subre *);
 static void optst(struct vars *, struct subre *);
 static int numst(struct subre *, int);
@@ -65,6 +66,8 @@ static void markst(struct subre *);
 static void cleanst(struct vars *);
 static long nfatree(struct vars *, struct subre *, FILE *);
 static long nfanode(struct vars *, struct subre *, FILE *);
+static void findmust(struct cnfa *, struct guts *);
+static int mustreach(struct cnfa *, int, char *, int *);
 static int newlacon(struct vars *, struct state *, struct state *, int);
 static void freelacons(struct subre *, int);
 static void rfree(regex_t *);
@@ -91,6 +94,9 @@ static chr chrnamed(struct vars *, const chr *, const chr *, pchr);
 static void initcm(struct vars *, struct colormap *);
 static void freecm(struct colormap *);
 static void cmtreefree(struct colormap *, union tree *, int);
+static size_t cmsize(struct colormap *);
+static void colorchrs(struct colormap *, int, int *, chr *);
+static void subcolorchrs(struct colormap *, union tree *, int, uchr, int, int *, chr *);
 static color setcolor(struct colormap *, pchr, pcolor);
 static color maxcolor(struct colormap *);
 static color newcolor(struct colormap *);
@@ -152,6 +158,7 @@ static long analyze(struct nfa *);
 static void compact(struct nfa *, struct cnfa *);
 static void carcsort(struct carc *, struct carc *);
 static void freecnfa(struct cnfa *);
+static size_t cnfasize(struct cnfa *);
 static void dumpnfa(struct nfa *, FILE *);
 #ifdef REG_DEBUG
 static void dumpstate(struct state *, FILE *);
@@ -325,6 +332,7 @@ compile(
     re->re_csize = sizeof(chr);
     re->re_guts = NULL;
     re->re_fns = VS(&functions);
+    re->re_cache = NULL;
 
     /*
      * More complex setup, malloced things.
@@ -336,6 +344,9 @@ compile(
     }
     g = (struct guts *) re->re_guts;
     g->tree = NULL;
+    g->must = NULL;
+    g->nmust = 0;
+    g->mustfold = 0;
     initcm(v, &g->cmap);
     v->cm = &g->cmap;
     g->lacons = NULL;
@@ -424,6 +435,15 @@ compile(
     compact(v->nfa, &g->search);
     CNOERR();
 
+    /*
+     * Find a string that every match contains, so exec can skip strings
+     * without it. Partial matches needn't contain it.
+     */
+
+    if (!(v->cflags&REG_EXPECT)) {
+	findmust(&v->tree->cnfa, g);
+    }
+
     /*
      * Looks okay, package it up.
      */
@@ -1746,6 +1766,21 @@ freesubre(
     freesrnode(v, sr);
 }
 
+/*
+ - subresize - estimate the memory used by a subRE tree
+ ^ static size_t subresize(struct subre *);
+ */
+static size_t
+subresize(
+    struct subre *sr)
+{
+    if (sr == NULL) {
+	return 0;
+    }
+    return sizeof(struct subre) + cnfasize(&sr->cnfa)
+	    + subresize(sr->left) + subresize(sr->right);
+}
+
 /*
  - freesrnode - free one node in a subRE subtree
  ^ static void freesrnode(struct vars *, struct subre *);
@@ -1912,6 +1947,170 @@ nfanode(
     return ret;
 }
 
+/*
+ - findmust - find the longest string that every match contains
+ * A state that every path from the pre state to the post state goes through
+ * and that has just one outarc, for a color of just one chr (or of the two
+ * cases of an ASCII letter), is where such a string starts; it goes on for as
+ * long as the states reached likewise have just one such outarc. Arcs from
+ * the pre state and to the post state are for the chrs around the match, so
+ * they are not part of the string. Running out of memory just means that no
+ * string is found.
+ ^ static void findmust(struct cnfa *, struct guts *);
+ */
+static void
+findmust(
+    struct cnfa *cnfa,
+    struct guts *g)
+{
+#define	MAXMUSTSTATES	500	/* don't bother with bigger NFAs */
+#define	ISLETTER(c)	(((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+    int n = cnfa->nstates;
+    int ncolors = g->cmap.max + 1;
+    int *counts, *lits, *queue;
+    chr *chrs;
+    char *seen;
+    struct carc *ca;
+    int s, t, best, bestlen, len, fold;
+    color co;
+
+    if (n > MAXMUSTSTATES) {
+	return;
+    }
+    counts = (int *) MALLOC(ncolors * sizeof(int));
+    chrs = (chr *) MALLOC(ncolors * 2 * sizeof(chr));
+    lits = (int *) MALLOC(n * sizeof(int));
+    queue = (int *) MALLOC(n * sizeof(int));
+    seen = (char *) MALLOC(n);
+    if (counts == NULL || chrs == NULL || lits == NULL || queue == NULL
+	    || seen == NULL) {
+	goto done;
+    }
+
+    /*
+     * Find the states with one outarc for a literal chr; lits[s] is the
+     * color of that outarc, or COLORLESS.
+     */
+
+    colorchrs(&g->cmap, 2, counts, chrs);
+    for (s = 0; s < n; s++) {
+	lits[s] = COLORLESS;
+	ca = cnfa->states[s] + 1;
+	if (s == cnfa->pre || ca->co == COLORLESS || ca[1].co != COLORLESS
+		|| ca->co >= cnfa->ncolors || ca->to == cnfa->post) {
+	    continue;
+	}
+	co = ca->co;
+	if (counts[co] == 1 || (counts[co] == 2
+		&& ISLETTER(chrs[co*2]) && ISLETTER(chrs[co*2+1])
+		&& chrs[co*2] != chrs[co*2+1]
+		&& (chrs[co*2] | 0x20) == (chrs[co*2+1] | 0x20))) {
+	    lits[s] = co;
+	}
+    }
+
+    /*
+     * Follow the strings from the states that all paths go through, and keep
+     * the longest.
+     */
+
+    best = -1;
+    bestlen = 0;
+    for (s = 0; s < n; s++) {
+	if (lits[s] == COLORLESS || mustreach(cnfa, s, seen, queue)) {
+	    continue;
+	}
+	len = 0;
+	for (t = s; len < n && lits[t] != COLORLESS; len++) {
+	    t = cnfa->states[t][1].to;
+	}
+	if (len > bestlen) {
+	    best = s;
+	    bestlen = len;
+	}
+    }
+    if (best < 0) {
+	goto done;
+    }
+
+    g->must = (chr *) MALLOC(bestlen * sizeof(chr));
+    if (g->must == NULL) {
+	goto done;
+    }
+    fold = 0;
+    for (t = best, len = 0; len < bestlen; len++) {
+	co = lits[t];
+	g->must[len] = chrs[co*2];
+	if (counts[co] == 2) {
+	    fold = 1;
+	}
+	t = cnfa->states[t][1].to;
+    }
+    if (fold) {
+	for (len = 0; len < bestlen; len++) {
+	    if (g->must[len] >= 'A' && g->must[len] <= 'Z') {
+		g->must[len] |= 0x20;
+	    }
+	}
+    }
+    g->nmust = bestlen;
+    g->mustfold = fold;
+
+  done:
+    if (counts != NULL) {
+	FREE(counts);
+    }
+    if (chrs != NULL) {
+	FREE(chrs);
+    }
+    if (lits != NULL) {
+	FREE(lits);
+    }
+    if (queue != NULL) {
+	FREE(queue);
+    }
+    if (seen != NULL) {
+	FREE(seen);
+    }
+}
+
+/*
+ - mustreach - can the post state be reached without going through a state?
+ ^ static int mustreach(struct cnfa *, int, char *, int *);
+ */
+static int
+mustreach(
+    struct cnfa *cnfa,
+    int avoid,			/* number of the state to avoid */
+    char *seen,			/* work area, nstates of them */
+    int *queue)			/* work area, nstates of them */
+{
+    struct carc *ca;
+    int i, head, tail;
+
+    for (i = 0; i < cnfa->nstates; i++) {
+	seen[i] = 0;
+    }
+    seen[avoid] = 1;
+    seen[cnfa->pre] = 1;
+    queue[0] = cnfa->pre;
+    head = 0;
+    tail = 1;
+    while (head < tail) {
+	for (ca = cnfa->states[queue[head++]] + 1; ca->co != COLORLESS;
+		ca++) {
+	    if (ca->to == cnfa->post) {
+		return 1;
+	    }
+	    if (!seen[ca->to]) {
+		seen[ca->to] = 1;
+		queue[tail++] = ca->to;
+	    }
+	}
+    }
+    return 0;
+}
+
 /*
  - newlacon - allocate a lookahead-constraint subRE
  ^ static int newlacon(struct vars *, struct state *, struct state *, int);
@@ -1984,6 +2183,7 @@ rfree(
 	return;
     }
 
+    regfreecache(re);
     re->re_magic = 0;	/* invalidate RE */
     g = (struct guts *) re->re_guts;
     re->re_guts = NULL;
@@ -1999,8 +2199,65 @@ rfree(
     if (!NULLCNFA(g->search)) {
 	freecnfa(&g->search);
     }
+    if (g->must != NULL) {
+	FREE(g->must);
+    }
     FREE(g);
 }
+
+/*
+ - regsize - estimate the memory used by a compiled RE
+ * Used by Tcl to bound the size of its cache of compiled REs.
+ ^ size_t regsize(regex_t *);
+ */
+size_t
+regsize(
+    regex_t *re)
+{
+    struct guts *g;
+    size_t size;
+    int i;
+
+    if (re == NULL || re->re_magic != REMAGIC) {
+	return 0;
+    }
+
+    g = (struct guts *) re->re_guts;
+    size = sizeof(struct guts) + cmsize(&g->cmap) + subresize(g->tree)
+	    + cnfasize(&g->search);
+    if (g->lacons != NULL) {
+	size += g->nlacons * sizeof(struct subre);
+	for (i=1 ; i<g->nlacons ; i++) {	/* no 0th */
+	    size += cnfasize(&g->lacons[i].cnfa);
+	}
+    }
+    return size + g->nmust * sizeof(chr);
+}
+
+/*
+ - regmust - find a string that every match of an RE contains
+ * Returns its length, 0 if there is none, storing its chrs in *mustp and
+ * whether it is lowercase and to be compared ignoring the case of ASCII
+ * letters in *foldp.
+ ^ size_t regmust(regex_t *, const chr **, int *);
+ */
+size_t
+regmust(
+    regex_t *re,
+    const chr **mustp,
+    int *foldp)
+{
+    struct guts *g;
+
+    if (re == NULL || re->re_magic != REMAGIC) {
+	return 0;
+    }
+
+    g = (struct guts *) re->re_guts;
+    *mustp = g->must;
+    *foldp = g->mustfold;
+    return g->nmust;
+}
 
 /*
  - dump - dump an RE in human-readable form
@@ -84,6 +84,9 @@
 #define	__REG_NOCHAR		/* Or the char versions */
 #define	regfree		TclReFree
 #define	regerror	TclReError
+#define	regsize		TclReSize
+#define	regmust		TclReMust
+#define	regfreecache	TclReFreeCache
 /* --- end --- */
 
 /*
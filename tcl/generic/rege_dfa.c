@@ -306,7 +306,7 @@ lastCold(
 }
 
 /*
- - newDFA - set up a fresh DFA
+ - newDFA - set up a fresh DFA, or reuse the one kept for the cnfa
  ^ static struct dfa *newDFA(struct vars *, struct cnfa *,
  ^ 	struct colormap *, struct smalldfa *);
  */
@@ -320,10 +320,46 @@ newDFA(
     struct dfa *d;
     size_t nss = cnfa->nstates * 2;
     int wordsper = (cnfa->nstates + UBITS - 1) / UBITS;
-    struct smalldfa *smallwas = sml;
+    struct smalldfa *smallwas;
+    struct dfacache *dc = v->dfacache;
+    size_t size;
+    int i;
 
     assert(cnfa != NULL && cnfa->nstates != 0);
 
+    /*
+     * Reuse the kept DFA if it isn't in use already, else keep the new one if
+     * there is room for it.
+     */
+
+    if (nss <= FEWSTATES && cnfa->ncolors <= FEWCOLORS) {
+	size = sizeof(struct smalldfa);
+    } else {
+	size = sizeof(struct dfa) + nss * (sizeof(struct sset)
+		+ cnfa->ncolors * (sizeof(struct sset *)+sizeof(struct arcp)))
+		+ (nss+WORK) * wordsper * sizeof(unsigned);
+    }
+    if (dc != NULL) {
+	for (i = 0; i < dc->ndfas; i++) {
+	    if (dc->dfas[i]->cnfa == cnfa) {
+		break;
+	    }
+	}
+	if (i < dc->ndfas) {
+	    d = dc->dfas[i];
+	    if (!d->busy) {
+		d->busy = 1;
+		return d;
+	    }
+	    dc = NULL;
+	} else if (dc->ndfas == NKEPTDFAS || dc->size + size > KEPTDFASIZE) {
+	    dc = NULL;
+	} else {
+	    sml = DOMALLOC;
+	}
+    }
+    smallwas = sml;
+
     if (nss <= FEWSTATES && cnfa->ncolors <= FEWCOLORS) {
 	assert(wordsper == 1);
 	if (sml == NULL) {
@@ -357,6 +393,7 @@ newDFA(
 		MALLOC(nss * cnfa->ncolors * sizeof(struct arcp));
 	d->cptsmalloced = 1;
 	d->mallocarea = (char *)d;
+	d->kept = 0;
 	if (d->ssets == NULL || d->statesarea == NULL ||
 		d->outsarea == NULL || d->incarea == NULL) {
 	    freeDFA(d);
@@ -375,6 +412,14 @@ newDFA(
     d->lastpost = NULL;
     d->lastnopr = NULL;
     d->search = d->ssets;
+    d->kept = 0;
+    d->busy = 0;
+    if (dc != NULL) {
+	d->kept = 1;
+	d->busy = 1;
+	dc->dfas[dc->ndfas++] = d;
+	dc->size += size;
+    }
 
     /*
      * Initialization of sset fields is done as needed.
@@ -384,13 +429,17 @@ newDFA(
 }
 
 /*
- - freeDFA - free a DFA
+ - freeDFA - free a DFA, or just give it back if it is kept
  ^ static void freeDFA(struct dfa *);
  */
 static void
 freeDFA(
     struct dfa *const d)
 {
+    if (d->kept) {
+	d->busy = 0;
+	return;
+    }
     if (d->cptsmalloced) {
 	if (d->ssets != NULL) {
 	    FREE(d->ssets);
@@ -116,6 +116,9 @@ extern "C" {
 #define	__REG_NOCHAR		/* or the char versions */
 #define	regfree		TclReFree
 #define	regerror	TclReError
+#define	regsize		TclReSize
+#define	regmust		TclReMust
+#define	regfreecache	TclReFreeCache
 /* --- end --- */
 
 /*
@@ -181,6 +184,8 @@ typedef struct {
     /* the rest is opaque pointers to hidden innards */
     char *re_guts;		/* `char *' is more portable than `void *' */
     char *re_fns;
+    char *re_cache;		/* DFAs kept between matches; belongs to this
+				 * regex_t alone, see regfreecache() */
 } regex_t;
 
 /* result reporting (may acquire more fields later) */
@@ -249,6 +254,7 @@ typedef struct {
 /*
  * misc generics (may be more functions here eventually)
  ^ re_void regfree(regex_t *);
+ ^ re_void regfreecache(regex_t *);
  */
 
 /*
@@ -311,6 +317,9 @@ MODULE_SCOPE int __REG_WIDE_EXEC(regex_t *, __REG_CONST __REG_WIDE_T *, size_t,
 #endif
 MODULE_SCOPE re_void regfree(regex_t *);
 MODULE_SCOPE size_t regerror(int, __REG_CONST regex_t *, char *, size_t);
+MODULE_SCOPE size_t regsize(regex_t *);
+MODULE_SCOPE size_t regmust(regex_t *, __REG_CONST __REG_WIDE_T **, int *);
+MODULE_SCOPE re_void regfreecache(regex_t *);
 /* automatically gathered by fwd; do not hand-edit */
 /* =====^!^===== end forwards =====^!^===== */
 
@@ -74,6 +74,8 @@ struct dfa {
     struct sset *search;	/* replacement-search-pointer memory */
     int cptsmalloced;		/* were the areas individually malloced? */
     char *mallocarea;		/* self, or master malloced area, or NULL */
+    int kept;			/* kept in a dfacache between matches? */
+    int busy;			/* if kept, is it in use by this match? */
 };
 
 #define	WORK	1		/* number of work bitvectors needed */
@@ -93,6 +95,21 @@ struct smalldfa {
 };
 #define	DOMALLOC	((struct smalldfa *)NULL)	/* force malloc */
 
+/*
+ * The state sets of a DFA only depend on its cnfa, so a regex_t keeps the
+ * DFAs of its matches in a dfacache, hung from its re_cache, for the next
+ * match to start with the state sets found so far. There is a limit on their
+ * number and total size; other DFAs are made afresh for each match.
+ */
+
+#define	NKEPTDFAS	8		/* at most this many DFAs kept */
+#define	KEPTDFASIZE	(256*1024)	/* whose total size is at most this */
+struct dfacache {
+    int ndfas;			/* number of DFAs kept */
+    size_t size;		/* their total size */
+    struct dfa *dfas[NKEPTDFAS];
+};
+
 /*
  * Internal variables, bundled for easy passing around.
  */
@@ -108,6 +125,7 @@ struct vars {
     chr *stop;			/* just past end of string */
     int err;			/* error code if any (0 none) */
     regoff_t *mem;		/* memory vector for backtracking */
+    struct dfacache *dfacache;	/* DFAs kept between matches, or NULL */
     struct smalldfa dfa1;
     struct smalldfa dfa2;
 };
@@ -126,6 +144,7 @@ struct vars {
 /* automatically gathered by fwd; do not hand-edit */
 /* === regexec.c === */
 int exec(regex_t *, const chr *, size_t, rm_detail_t *, size_t, regmatch_t [], int);
+static int hasMust(struct guts *const, const chr *, const chr *const);
 static int simpleFind(struct vars *const, struct cnfa *const, struct colormap *const);
 static int complicatedFind(struct vars *const, struct cnfa *const, struct colormap *const);
 static int complicatedFindLoop(struct vars *const, struct cnfa *const, struct colormap *const, struct dfa *const, struct dfa *const, chr **const);
@@ -147,6 +166,7 @@ static chr *shortest(struct vars *const, struct dfa *const, chr *const, chr *con
 static chr *lastCold(struct vars *const, struct dfa *const);
 static struct dfa *newDFA(struct vars *const, struct cnfa *const, struct colormap *const, struct smalldfa *);
 static void freeDFA(struct dfa *const);
+re_void regfreecache(regex_t *);
 static unsigned hash(unsigned *const, const int);
 static struct sset *initialize(struct vars *const, struct dfa *const, chr *const);
 static struct sset *miss(struct vars *const, struct dfa *const, struct sset *const, const pcolor, chr *const, chr *const);
@@ -206,6 +226,10 @@ exec(
 	FreeVars(v);
 	return REG_NOMATCH;
     }
+    if (v->g->nmust > 0 && !hasMust(v->g, string, string + len)) {
+	FreeVars(v);
+	return REG_NOMATCH;
+    }
     backref = (v->g->info&REG_UBACKREF) ? 1 : 0;
     v->eflags = flags;
     if (v->g->cflags&REG_NOSUB) {
@@ -235,6 +259,14 @@ exec(
     v->start = (chr *)string;
     v->stop = (chr *)string + len;
     v->err = 0;
+    if (re->re_cache == NULL && !(flags&REG_SMALL)) {
+	re->re_cache = (char *) MALLOC(sizeof(struct dfacache));
+	if (re->re_cache != NULL) {
+	    ((struct dfacache *) re->re_cache)->ndfas = 0;
+	    ((struct dfacache *) re->re_cache)->size = 0;
+	}
+    }
+    v->dfacache = (flags&REG_SMALL) ? NULL : (struct dfacache *) re->re_cache;
     if (backref) {
 	/*
 	 * Need retry memory.
@@ -280,7 +312,8 @@ exec(
     }
 
     /*
-     * Clean up.
+     * Clean up. Kept DFAs are normally given back already, but not on all
+     * error paths.
      */
 
     if (v->pmatch != pmatch && v->pmatch != mat) {
@@ -289,9 +322,88 @@ exec(
     if (v->mem != NULL && v->mem != mem) {
 	FREE(v->mem);
     }
+    if (v->dfacache != NULL) {
+	for (n = 0; n < (size_t) v->dfacache->ndfas; n++) {
+	    v->dfacache->dfas[n]->busy = 0;
+	}
+    }
     FreeVars(v);
     return st;
 }
+
+/*
+ - regfreecache - free the DFAs that a regex_t keeps between matches
+ * The rest of the RE is untouched, for the benefit of regex_t's that share
+ * their guts with another one.
+ ^ re_void regfreecache(regex_t *);
+ */
+re_void
+regfreecache(
+    regex_t *re)
+{
+    struct dfacache *dc = (struct dfacache *) re->re_cache;
+    int i;
+
+    if (dc == NULL) {
+	return;
+    }
+    re->re_cache = NULL;
+    for (i = 0; i < dc->ndfas; i++) {
+	dc->dfas[i]->kept = 0;
+	freeDFA(dc->dfas[i]);
+    }
+    FREE(dc);
+}
+
+/*
+ - hasMust - does a string contain the string every match contains?
+ * This is a quick way to reject most strings that can't match.
+ ^ static int hasMust(struct guts *, const chr *, const chr *);
+ */
+static int
+hasMust(
+    struct guts *const g,
+    const chr *p,		/* start of string */
+    const chr *const stop)	/* just past end of string */
+{
+    const chr *must = g->must;
+    size_t i, n = g->nmust;
+    const chr *last;
+    chr c;
+
+    if ((size_t) (stop - p) < n) {
+	return 0;
+    }
+    last = stop - n;
+    if (!g->mustfold) {
+	for (; p <= last; p++) {
+	    if (*p == must[0]) {
+		for (i = 1; i < n && p[i] == must[i]; i++) {
+		    /* keep comparing */
+		}
+		if (i == n) {
+		    return 1;
+		}
+	    }
+	}
+	return 0;
+    }
+    for (; p <= last; p++) {
+	for (i = 0; i < n; i++) {
+	    c = p[i];
+	    if (c >= 'A' && c <= 'Z') {
+		c |= 0x20;
+	    }
+	    if (c != must[i]) {
+		break;
+	    }
+	}
+	if (i == n) {
+	    return 1;
+	}
+    }
+    return 0;
+}
 
 /*
  - simpleFind - find a match for the main NFA (no-complications case)
@@ -386,6 +386,10 @@ struct guts {
     int FUNCPTR(compare, (const chr *, const chr *, size_t));
     struct subre *lacons;	/* lookahead-constraint vector */
     int nlacons;		/* size of lacons */
+    chr *must;			/* string every match contains, or NULL */
+    size_t nmust;		/* length of must */
+    int mustfold;		/* must is lowercase, compare ASCII letters
+				 * ignoring case */
 };
 
 /*
@@ -1188,10 +1188,17 @@ struct Tcl_HashEntry {
  * TCL_HASH_KEY_SYSTEM_HASH -	If this flag is set then all memory internally
  *                              allocated for the hash table that is not for an
  *                              entry will use the system heap.
+ * TCL_HASH_KEY_OPEN_ADDRESSING -
+ *				If this flag is set then the table keeps its
+ *				entries in a single open-addressed slot array
+ *				rather than in bucket chains. Only honoured
+ *				for TCL_CUSTOM_TYPE_KEYS and
+ *				TCL_CUSTOM_PTR_KEYS tables.
  */
 
 #define TCL_HASH_KEY_RANDOMIZE_HASH 0x1
 #define TCL_HASH_KEY_SYSTEM_HASH    0x2
+#define TCL_HASH_KEY_OPEN_ADDRESSING 0x4
 
 /*
  * Structure definition for the methods associated with a hash table key type.
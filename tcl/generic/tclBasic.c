@@ -232,6 +232,7 @@ static const CmdInfo builtInCmds[] = {
     {"linsert",		Tcl_LinsertObjCmd,	NULL,			NULL,	1},
     {"list",		Tcl_ListObjCmd,		TclCompileListCmd,	NULL,	1},
     {"llength",		Tcl_LlengthObjCmd,	TclCompileLlengthCmd,	NULL,	1},
+    {"lmap",		Tcl_LmapObjCmd,		NULL,			TclNRLmapCmd,	1},
     {"lrange",		Tcl_LrangeObjCmd,	NULL,			NULL,	1},
     {"lrepeat",		Tcl_LrepeatObjCmd,	NULL,			NULL,	1},
     {"lreplace",	Tcl_LreplaceObjCmd,	NULL,			NULL,	1},
@@ -559,6 +560,11 @@ Tcl_CreateInterp(void)
     iPtr->returnLevel = 1;
     iPtr->returnCode = TCL_OK;
 
+    iPtr->cmdCacheTablePtr = NULL;
+    iPtr->numCmdCacheEntries = 0;
+    iPtr->numCmdCacheHits = 0;
+    iPtr->numCmdCacheMisses = 0;
+
     iPtr->rootFramePtr = NULL;	/* Initialise as soon as :: is available */
     iPtr->lookupNsPtr = NULL;
 
@@ -704,6 +710,10 @@ Tcl_CreateInterp(void)
     statsPtr->totalLitStringBytes = 0.0;
     statsPtr->currentLitStringBytes = 0.0;
     memset(statsPtr->literalCount, 0, sizeof(statsPtr->literalCount));
+
+    statsPtr->numTypeFeedbackHits = 0;
+    statsPtr->numTypeFeedbackMisses = 0;
+    statsPtr->numTypeFeedbackGeneric = 0;
 #endif /* TCL_COMPILE_STATS */
 
     /*
@@ -825,6 +835,8 @@ Tcl_CreateInterp(void)
 	    Tcl_DisassembleObjCmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, "::tcl::unsupported::representation",
 	    Tcl_RepresentationCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::regexpcache",
+	    TclRegexpCacheObjCmd, NULL, NULL);
 
     Tcl_NRCreateCommand(interp, "::tcl::unsupported::yieldTo", NULL,
 	    TclNRYieldToObjCmd, NULL, NULL);
@@ -1486,6 +1498,7 @@ DeleteInterpProc(
     ckfree((char *) iPtr->rootFramePtr);
     iPtr->rootFramePtr = NULL;
     Tcl_DeleteNamespace((Tcl_Namespace *) iPtr->globalNsPtr);
+    TclFreeCmdCache(iPtr);
 
     /*
      * Free up the result *after* deleting variables, since variable deletion
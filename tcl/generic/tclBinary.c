@@ -52,6 +52,30 @@
 
 #define BINARY_SCAN_MAX_CACHE	260
 
+/*
+ * The format string of [binary format] and [binary scan] is parsed once into
+ * an array of fields, which is kept as the internal representation of the
+ * format object. Parsing stops at the first field specifier that is not
+ * known; it is recorded as a last field with a cmd of '\0', and the error is
+ * raised only when that field is reached, as the commands did when they
+ * parsed the format as they went.
+ */
+
+typedef struct FormatField {
+    char cmd;			/* Field specifier character, or '\0' for an
+				 * unknown field specifier. */
+    char flags;			/* Format field flags. */
+    int count;			/* Count of the field, BINARY_ALL or
+				 * BINARY_NOCOUNT. For an unknown field
+				 * specifier, the specifier character. */
+} FormatField;
+
+typedef struct BinaryFormat {
+    int refCount;		/* Number of objects and callers using it. */
+    int numFields;		/* Number of fields. */
+    FormatField fields[1];	/* The fields; actually numFields long. */
+} BinaryFormat;
+
 /*
  * Prototypes for local procedures defined in this file:
  */
@@ -61,10 +85,22 @@ static void		DupByteArrayInternalRep(Tcl_Obj *srcPtr,
 static int		FormatNumber(Tcl_Interp *interp, int type,
 			    Tcl_Obj *src, unsigned char **cursorPtr);
 static void		FreeByteArrayInternalRep(Tcl_Obj *objPtr);
+static void		DupBinaryFormatInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FreeBinaryFormat(BinaryFormat *fmtPtr);
+static void		FreeBinaryFormatInternalRep(Tcl_Obj *objPtr);
+static BinaryFormat *	GetBinaryFormat(Tcl_Obj *formatObj);
 static int		GetFormatSpec(const char **formatPtr, char *cmdPtr,
 			    int *countPtr, int *flagsPtr);
 static Tcl_Obj *	ScanNumber(unsigned char *buffer, int type,
 			    int flags, Tcl_HashTable **numberCachePtr);
+static Tcl_Obj *	ScanNumberList(unsigned char *buffer, int count,
+			    int size, int type, int flags,
+			    Tcl_HashTable **numberCachePtr);
+static int		SetScanVar(Tcl_Interp *interp,
+			    Tcl_Obj *const varNameObjs[],
+			    const int *varIndices, int index,
+			    Tcl_Obj *valuePtr);
 static int		SetByteArrayFromAny(Tcl_Interp *interp,
 			    Tcl_Obj *objPtr);
 static void		UpdateStringOfByteArray(Tcl_Obj *listPtr);
@@ -185,6 +221,18 @@ typedef struct ByteArray {
 		((ByteArray *) (objPtr)->internalRep.otherValuePtr)
 #define SET_BYTEARRAY(objPtr, baPtr) \
 		(objPtr)->internalRep.otherValuePtr = (void *) (baPtr)
+
+/*
+ * The type of format objects holding a parsed format, a BinaryFormat.
+ */
+
+static const Tcl_ObjType binaryFormatType = {
+    "binaryformat",
+    FreeBinaryFormatInternalRep,
+    DupBinaryFormatInternalRep,
+    NULL,
+    NULL
+};
 
 /*
  *----------------------------------------------------------------------
@@ -693,7 +741,7 @@ TclAppendBytesToByteArray(
 
 static const EnsembleImplMap binaryMap[] = {
 { "format", BinaryFormatCmd, NULL, NULL, NULL, 0 },
-{ "scan",   BinaryScanCmd, NULL, NULL, NULL, 0 },
+{ "scan",   BinaryScanCmd, TclCompileBinaryScanCmd, NULL, NULL, 0 },
 { "encode", NULL, NULL, NULL, NULL, 0 },
 { "decode", NULL, NULL, NULL, NULL, 0 },
 { NULL, NULL, NULL, NULL, NULL, 0 }
@@ -752,9 +800,9 @@ BinaryFormatCmd(
     char cmd;			/* Current format character. */
     int count;			/* Count associated with current format
 				 * character. */
-    int flags;			/* Format field flags */
-    const char *format;	/* Pointer to current position in format
-				 * string. */
+    BinaryFormat *fmtPtr;	/* The parsed format string. */
+    FormatField *fieldPtr;	/* Current field of the format. */
+    FormatField *lastPtr;	/* End of the fields of the format. */
     Tcl_Obj *resultPtr = NULL;	/* Object holding result buffer. */
     unsigned char *buffer;	/* Start of result buffer. */
     unsigned char *cursor;	/* Current position within result buffer. */
@@ -769,22 +817,27 @@ BinaryFormatCmd(
 	return TCL_ERROR;
     }
 
+    /*
+     * The parsed format is held on to, as converting the arguments can
+     * change the type of the format object when it is one of them.
+     */
+
+    fmtPtr = GetBinaryFormat(objv[1]);
+    fmtPtr->refCount++;
+    lastPtr = fmtPtr->fields + fmtPtr->numFields;
+
     /*
      * To avoid copying the data, we format the string in two passes. The
      * first pass computes the size of the output buffer. The second pass
      * places the formatted data into the buffer.
      */
 
-    format = TclGetString(objv[1]);
     arg = 2;
     offset = 0;
     length = 0;
-    while (*format != '\0') {
-	str = format;
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    break;
-	}
+    for (fieldPtr = fmtPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
 	switch (cmd) {
 	case 'a':
 	case 'A':
@@ -867,17 +920,16 @@ BinaryFormatCmd(
 
 		if (TclListObjGetElements(interp, objv[arg], &listc,
 			&listv) != TCL_OK) {
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 		arg++;
 
 		if (count == BINARY_ALL) {
 		    count = listc;
 		} else if (count > listc) {
-		    Tcl_AppendResult(interp,
-			    "number of elements in list does not match count",
-			    NULL);
-		    return TCL_ERROR;
+		    errorString =
+			    "number of elements in list does not match count";
+		    goto error;
 		}
 	    }
 	    offset += count*size;
@@ -885,10 +937,8 @@ BinaryFormatCmd(
 
 	case 'x':
 	    if (count == BINARY_ALL) {
-		Tcl_AppendResult(interp,
-			"cannot use \"*\" in format string with \"x\"",
-			NULL);
-		return TCL_ERROR;
+		errorString = "cannot use \"*\" in format string with \"x\"";
+		goto error;
 	    } else if (count == BINARY_NOCOUNT) {
 		count = 1;
 	    }
@@ -919,7 +969,6 @@ BinaryFormatCmd(
 	    }
 	    break;
 	default:
-	    errorString = str;
 	    goto badField;
 	}
     }
@@ -927,6 +976,7 @@ BinaryFormatCmd(
 	length = offset;
     }
     if (length == 0) {
+	FreeBinaryFormat(fmtPtr);
 	return TCL_OK;
     }
 
@@ -946,14 +996,11 @@ BinaryFormatCmd(
      */
 
     arg = 2;
-    format = TclGetString(objv[1]);
     cursor = buffer;
     maxPos = cursor;
-    while (*format != 0) {
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    break;
-	}
+    for (fieldPtr = fmtPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
 	if ((count == 0) && (cmd != '@')) {
 	    if (cmd != 'x') {
 		arg++;
@@ -1157,7 +1204,7 @@ BinaryFormatCmd(
 	    for (i = 0; i < count; i++) {
 		if (FormatNumber(interp, cmd, listv[i], &cursor)!=TCL_OK) {
 		    Tcl_DecrRefCount(resultPtr);
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 	    }
 	    break;
@@ -1195,13 +1242,14 @@ BinaryFormatCmd(
 	}
     }
     Tcl_SetObjResult(interp, resultPtr);
+    FreeBinaryFormat(fmtPtr);
     return TCL_OK;
 
  badValue:
     Tcl_ResetResult(interp);
     Tcl_AppendResult(interp, "expected ", errorString,
 	" string but got \"", errorValue, "\" instead", NULL);
-    return TCL_ERROR;
+    goto cleanup;
 
  badCount:
     errorString = "missing count for \"@\" field specifier";
@@ -1213,17 +1261,18 @@ BinaryFormatCmd(
 
  badField:
     {
-	Tcl_UniChar ch;
 	char buf[TCL_UTF_MAX + 1];
 
-	Tcl_UtfToUniChar(errorString, &ch);
-	buf[Tcl_UniCharToUtf(ch, buf)] = '\0';
+	buf[Tcl_UniCharToUtf(count, buf)] = '\0';
 	Tcl_AppendResult(interp, "bad field specifier \"", buf, "\"", NULL);
-	return TCL_ERROR;
+	goto cleanup;
     }
 
  error:
     Tcl_AppendResult(interp, errorString, NULL);
+
+ cleanup:
+    FreeBinaryFormat(fmtPtr);
     return TCL_ERROR;
 }
 
@@ -1250,50 +1299,97 @@ BinaryScanCmd(
     int objc,			/* Number of arguments. */
     Tcl_Obj *const objv[])	/* Argument objects. */
 {
-    int arg;			/* Index of next argument to consume. */
+    int numScanned;
+
+    if (objc < 3) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"value formatString ?varName ...?");
+	return TCL_ERROR;
+    }
+    if (TclBinaryScan(interp, objv[1], objv[2], objc - 3, objv + 3, NULL,
+	    &numScanned) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewLongObj(numScanned));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclBinaryScan --
+ *
+ *	This procedure does the work of the "binary scan" Tcl command, both
+ *	for the command and for the bytecode instruction it is compiled to.
+ *	The variables are given either by name, or (when varNameObjs is NULL)
+ *	by their indices among the compiled locals of the current frame.
+ *
+ * Results:
+ *	A standard Tcl result. The number of variables that were set is put
+ *	in *numScannedPtr.
+ *
+ * Side effects:
+ *	Sets variables.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclBinaryScan(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Obj *dataObj,		/* Value to scan. */
+    Tcl_Obj *formatObj,		/* Format string. */
+    int numVars,		/* Number of variables. */
+    Tcl_Obj *const varNameObjs[],
+				/* Names of the variables, or NULL. */
+    const int *varIndices,	/* Compiled local indices of the variables,
+				 * used when varNameObjs is NULL. */
+    int *numScannedPtr)		/* Where to put the number of variables
+				 * set. */
+{
+    int arg;			/* Index of next variable to set. */
     int value = 0;		/* Current integer value to be packed.
 				 * Initialized to avoid compiler warning. */
     char cmd;			/* Current format character. */
     int count;			/* Count associated with current format
 				 * character. */
     int flags;			/* Format field flags */
-    const char *format;	/* Pointer to current position in format
-				 * string. */
-    Tcl_Obj *resultPtr = NULL;	/* Object holding result buffer. */
+    BinaryFormat *fmtPtr;	/* The parsed format string. */
+    FormatField *fieldPtr;	/* Current field of the format. */
+    FormatField *lastPtr;	/* End of the fields of the format. */
     unsigned char *buffer;	/* Start of result buffer. */
     const char *errorString;
-    const char *str;
     int offset, size, length;
 
     int i;
-    Tcl_Obj *valuePtr, *elementPtr;
+    Tcl_Obj *valuePtr;
     Tcl_HashTable numberCacheHash;
     Tcl_HashTable *numberCachePtr;
 
-    if (objc < 3) {
-	Tcl_WrongNumArgs(interp, 1, objv,
-		"value formatString ?varName ...?");
-	return TCL_ERROR;
-    }
+    /*
+     * The parsed format is held on to, as variable traces could change the
+     * type of the format object. It is got before the bytes of the value,
+     * which it would free when the value and the format are the same object.
+     */
+
+    fmtPtr = GetBinaryFormat(formatObj);
+    fmtPtr->refCount++;
     numberCachePtr = &numberCacheHash;
     Tcl_InitHashTable(numberCachePtr, TCL_ONE_WORD_KEYS);
-    buffer = Tcl_GetByteArrayFromObj(objv[1], &length);
-    format = TclGetString(objv[2]);
-    arg = 3;
+    buffer = Tcl_GetByteArrayFromObj(dataObj, &length);
+    lastPtr = fmtPtr->fields + fmtPtr->numFields;
+    arg = 0;
     offset = 0;
-    while (*format != '\0') {
-	str = format;
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    goto done;
-	}
+    for (fieldPtr = fmtPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
+	flags = fieldPtr->flags;
 	switch (cmd) {
 	case 'a':
 	case 'A': {
 	    unsigned char *src;
 
-	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
+	    if (arg >= numVars) {
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1336,12 +1432,9 @@ BinaryScanCmd(
 	    valuePtr = Tcl_NewByteArrayObj(src, size);
 #endif /* TCL_MEM_DEBUG */
 
-	    resultPtr = Tcl_ObjSetVar2(interp, objv[arg], NULL, valuePtr,
-		    TCL_LEAVE_ERR_MSG);
-	    arg++;
-	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+	    if (SetScanVar(interp, varNameObjs, varIndices, arg++,
+		    valuePtr) != TCL_OK) {
+		goto cleanup;
 	    }
 	    offset += count;
 	    break;
@@ -1351,8 +1444,7 @@ BinaryScanCmd(
 	    unsigned char *src;
 	    char *dest;
 
-	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
+	    if (arg >= numVars) {
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1390,12 +1482,9 @@ BinaryScanCmd(
 		}
 	    }
 
-	    resultPtr = Tcl_ObjSetVar2(interp, objv[arg], NULL, valuePtr,
-		    TCL_LEAVE_ERR_MSG);
-	    arg++;
-	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+	    if (SetScanVar(interp, varNameObjs, varIndices, arg++,
+		    valuePtr) != TCL_OK) {
+		goto cleanup;
 	    }
 	    offset += (count + 7) / 8;
 	    break;
@@ -1406,8 +1495,7 @@ BinaryScanCmd(
 	    unsigned char *src;
 	    static const char hexdigit[] = "0123456789abcdef";
 
-	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
+	    if (arg >= numVars) {
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1445,12 +1533,9 @@ BinaryScanCmd(
 		}
 	    }
 
-	    resultPtr = Tcl_ObjSetVar2(interp, objv[arg], NULL, valuePtr,
-		    TCL_LEAVE_ERR_MSG);
-	    arg++;
-	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+	    if (SetScanVar(interp, varNameObjs, varIndices, arg++,
+		    valuePtr) != TCL_OK) {
+		goto cleanup;
 	    }
 	    offset += (count + 1) / 2;
 	    break;
@@ -1480,15 +1565,12 @@ BinaryScanCmd(
 	    goto scanNumber;
 	case 'q':
 	case 'Q':
-	case 'd': {
-	    unsigned char *src;
-
+	case 'd':
 	    size = sizeof(double);
 	    /* fall through */
 
 	scanNumber:
-	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
+	    if (arg >= numVars) {
 		goto badIndex;
 	    }
 	    if (count == BINARY_NOCOUNT) {
@@ -1505,25 +1587,16 @@ BinaryScanCmd(
 		if ((length - offset) < (count * size)) {
 		    goto done;
 		}
-		valuePtr = Tcl_NewObj();
-		src = buffer + offset;
-		for (i = 0; i < count; i++) {
-		    elementPtr = ScanNumber(src, cmd, flags, &numberCachePtr);
-		    src += size;
-		    Tcl_ListObjAppendElement(NULL, valuePtr, elementPtr);
-		}
+		valuePtr = ScanNumberList(buffer+offset, count, size, cmd,
+			flags, &numberCachePtr);
 		offset += count * size;
 	    }
 
-	    resultPtr = Tcl_ObjSetVar2(interp, objv[arg], NULL, valuePtr,
-		    TCL_LEAVE_ERR_MSG);
-	    arg++;
-	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+	    if (SetScanVar(interp, varNameObjs, varIndices, arg++,
+		    valuePtr) != TCL_OK) {
+		goto cleanup;
 	    }
 	    break;
-	}
 	case 'x':
 	    if (count == BINARY_NOCOUNT) {
 		count = 1;
@@ -1546,7 +1619,6 @@ BinaryScanCmd(
 	    break;
 	case '@':
 	    if (count == BINARY_NOCOUNT) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badCount;
 	    }
 	    if ((count == BINARY_ALL) || (count > length)) {
@@ -1556,20 +1628,18 @@ BinaryScanCmd(
 	    }
 	    break;
 	default:
-	    DeleteScanNumberCache(numberCachePtr);
-	    errorString = str;
 	    goto badField;
 	}
     }
 
     /*
-     * Set the result to the last position of the cursor.
+     * Return the number of variables set.
      */
 
  done:
-    Tcl_SetObjResult(interp, Tcl_NewLongObj(arg - 3));
+    *numScannedPtr = arg;
     DeleteScanNumberCache(numberCachePtr);
-
+    FreeBinaryFormat(fmtPtr);
     return TCL_OK;
 
  badCount:
@@ -1582,20 +1652,191 @@ BinaryScanCmd(
 
  badField:
     {
-	Tcl_UniChar ch;
 	char buf[TCL_UTF_MAX + 1];
 
-	Tcl_UtfToUniChar(errorString, &ch);
-	buf[Tcl_UniCharToUtf(ch, buf)] = '\0';
+	buf[Tcl_UniCharToUtf(count, buf)] = '\0';
 	Tcl_AppendResult(interp, "bad field specifier \"", buf, "\"", NULL);
-	return TCL_ERROR;
+	goto cleanup;
     }
 
  error:
     Tcl_AppendResult(interp, errorString, NULL);
+
+ cleanup:
+    DeleteScanNumberCache(numberCachePtr);
+    FreeBinaryFormat(fmtPtr);
     return TCL_ERROR;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetScanVar --
+ *
+ *	Sets a variable of "binary scan", given by name or by compiled local
+ *	index as described for TclBinaryScan.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Sets the variable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SetScanVar(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Obj *const varNameObjs[],
+				/* Names of the variables, or NULL. */
+    const int *varIndices,	/* Compiled local indices of the variables. */
+    int index,			/* Which variable to set. */
+    Tcl_Obj *valuePtr)		/* Value to set it to. */
+{
+    Var *varPtr;
+
+    if (varNameObjs != NULL) {
+	if (Tcl_ObjSetVar2(interp, varNameObjs[index], NULL, valuePtr,
+		TCL_LEAVE_ERR_MSG) == NULL) {
+	    return TCL_ERROR;
+	}
+	return TCL_OK;
+    }
+
+    varPtr = &((Interp *) interp)->varFramePtr->compiledLocals[
+	    varIndices[index]];
+    while (TclIsVarLink(varPtr)) {
+	varPtr = varPtr->value.linkPtr;
+    }
+    if (TclPtrSetVar(interp, varPtr, NULL, NULL, NULL, valuePtr,
+	    TCL_LEAVE_ERR_MSG, varIndices[index]) == NULL) {
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetBinaryFormat --
+ *
+ *	Gets the parsed form of a format string of "binary format" or "binary
+ *	scan", parsing it and keeping the result in the format object if it
+ *	does not have it already.
+ *
+ * Results:
+ *	The parsed format, which belongs to the format object; callers that
+ *	may change the type of the object must take a reference.
+ *
+ * Side effects:
+ *	May change the internal representation of the format object.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static BinaryFormat *
+GetBinaryFormat(
+    Tcl_Obj *formatObj)		/* Format string. */
+{
+    BinaryFormat *fmtPtr;
+    FormatField *fieldPtr;
+    const char *format, *str;
+    char cmd;
+    int count, flags, numFields;
+
+    if (formatObj->typePtr == &binaryFormatType) {
+	return formatObj->internalRep.otherValuePtr;
+    }
+
+    /*
+     * Count the fields, then parse them into the array.
+     */
+
+    format = TclGetString(formatObj);
+    numFields = 0;
+    flags = 0;
+    while (GetFormatSpec(&format, &cmd, &count, &flags)) {
+	numFields++;
+	if (strchr("aAbBhHcsStiInwWmrRfqQdxX@", cmd) == NULL) {
+	    break;
+	}
+    }
+    fmtPtr = (BinaryFormat *) ckalloc(sizeof(BinaryFormat)
+	    + (numFields - 1) * sizeof(FormatField));
+    fmtPtr->refCount = 1;
+    fmtPtr->numFields = numFields;
+
+    format = formatObj->bytes;
+    for (fieldPtr = fmtPtr->fields; numFields > 0; fieldPtr++, numFields--) {
+	flags = 0;
+	str = format;
+	GetFormatSpec(&format, &cmd, &count, &flags);
+	fieldPtr->cmd = cmd;
+	fieldPtr->flags = (char) flags;
+	fieldPtr->count = count;
+	if (strchr("aAbBhHcsStiInwWmrRfqQdxX@", cmd) == NULL) {
+	    Tcl_UniChar ch;
+
+	    Tcl_UtfToUniChar(str, &ch);
+	    fieldPtr->cmd = '\0';
+	    fieldPtr->count = ch;
+	}
+    }
+
+    TclFreeIntRep(formatObj);
+    formatObj->internalRep.otherValuePtr = fmtPtr;
+    formatObj->typePtr = &binaryFormatType;
+    return fmtPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeBinaryFormat, FreeBinaryFormatInternalRep,
+ * DupBinaryFormatInternalRep --
+ *
+ *	FreeBinaryFormat releases a reference to a parsed format, and the
+ *	others manage the parsed form kept in a format object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A parsed format is freed when its last reference goes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeBinaryFormat(
+    BinaryFormat *fmtPtr)	/* The parsed format */
+{
+    if (--fmtPtr->refCount <= 0) {
+	ckfree((char *) fmtPtr);
+    }
+}
+
+static void
+FreeBinaryFormatInternalRep(
+    Tcl_Obj *objPtr)		/* Format object */
+{
+    FreeBinaryFormat(objPtr->internalRep.otherValuePtr);
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupBinaryFormatInternalRep(
+    Tcl_Obj *srcPtr,		/* Format object to copy */
+    Tcl_Obj *copyPtr)		/* The copy */
+{
+    BinaryFormat *fmtPtr = srcPtr->internalRep.otherValuePtr;
+
+    fmtPtr->refCount++;
+    copyPtr->internalRep.otherValuePtr = fmtPtr;
+    copyPtr->typePtr = &binaryFormatType;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2222,6 +2463,105 @@ ScanNumber(
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanNumberList --
+ *
+ *	This routine is called by "binary scan" to scan a numeric field with
+ *	a count into a list of numbers. The list is allocated at its final
+ *	size, and the numbers that are never cached are decoded by loops that
+ *	test the type and byte order once for the whole field.
+ *
+ * Results:
+ *	A list object with a reference count of zero.
+ *
+ * Side effects:
+ *	As for ScanNumber.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+ScanNumberList(
+    unsigned char *buffer,	/* Buffer to scan numbers from. */
+    int count,			/* Number of numbers to scan. */
+    int size,			/* Size of each number in the buffer. */
+    int type,			/* Format character from "binary scan" */
+    int flags,			/* Format field flags */
+    Tcl_HashTable **numberCachePtrPtr)
+				/* Place to look for cache of scanned
+				 * value objects, as for ScanNumber. */
+{
+    Tcl_Obj *listPtr, **elemPtrs;
+    List *listRepPtr;
+    unsigned long uvalue;
+    double dvalue;
+    int i;
+
+    listPtr = Tcl_NewListObj(count, NULL);
+    if (count == 0) {
+	return listPtr;
+    }
+    listRepPtr = listPtr->internalRep.twoPtrValue.ptr1;
+    listRepPtr->elemCount = count;
+    elemPtrs = &listRepPtr->elements;
+
+    switch (type) {
+    case 'd':
+    case 'q':
+    case 'Q':
+	if (NeedReversing(type)) {
+	    break;
+	}
+
+	/*
+	 * Doubles in the native byte order; memcpy takes care of alignment.
+	 */
+
+	for (i = 0; i < count; i++, buffer += sizeof(double)) {
+	    memcpy(&dvalue, buffer, sizeof(double));
+	    TclNewDoubleObj(elemPtrs[i], dvalue);
+	    Tcl_IncrRefCount(elemPtrs[i]);
+	}
+	return listPtr;
+
+    case 'i':
+    case 'I':
+    case 'n':
+	if (!(flags & BINARY_UNSIGNED)) {
+	    break;
+	}
+
+	/*
+	 * Unsigned 32-bit integers, which are not cached.
+	 */
+
+	if (NeedReversing(type)) {
+	    for (i = 0; i < count; i++, buffer += 4) {
+		uvalue = buffer[0] + (buffer[1] << 8) + (buffer[2] << 16)
+			+ (((unsigned long) buffer[3]) << 24);
+		elemPtrs[i] = Tcl_NewWideIntObj((Tcl_WideInt) uvalue);
+		Tcl_IncrRefCount(elemPtrs[i]);
+	    }
+	} else {
+	    for (i = 0; i < count; i++, buffer += 4) {
+		uvalue = buffer[3] + (buffer[2] << 8) + (buffer[1] << 16)
+			+ (((unsigned long) buffer[0]) << 24);
+		elemPtrs[i] = Tcl_NewWideIntObj((Tcl_WideInt) uvalue);
+		Tcl_IncrRefCount(elemPtrs[i]);
+	    }
+	}
+	return listPtr;
+    }
+
+    for (i = 0; i < count; i++, buffer += size) {
+	elemPtrs[i] = ScanNumber(buffer, type, flags, numberCachePtrPtr);
+	Tcl_IncrRefCount(elemPtrs[i]);
+    }
+    return listPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
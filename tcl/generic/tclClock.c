@@ -39,6 +39,7 @@
 #define ONE_CENTURY_GREGORIAN		36524	/* days */
 #define FOUR_YEARS			1461	/* days */
 #define ONE_YEAR			365	/* days */
+#define JDAY_MAX_SCAN			5373484	/* 31 December 9999 */
 
 /*
  * Table of the days in each month, leap and common years
@@ -71,6 +72,9 @@ typedef enum ClockLiteral {
     LIT_MONTH,
     LIT_SECONDS,	LIT_TZNAME,		LIT_TZOFFSET,
     LIT_YEAR,
+    LIT_ADD,		LIT_CLOCKLIBRARY,	LIT_GETFORMATLOCALEDATA,
+    LIT_GETSYSTEMTIMEZONE,	LIT_LEGACYTIMEZONE,	LIT_OLDSCAN,
+    LIT_SETUPTIMEZONE,	LIT_TZDATA,
     LIT__END
 } ClockLiteral;
 static const char *const literals[] = {
@@ -86,7 +90,13 @@ static const char *const literals[] = {
     "julianDay",	"localSeconds",
     "month",
     "seconds",		"tzName",		"tzOffset",
-    "year"
+    "year",
+    "::tcl::clock::add",
+    "source -encoding utf-8 [file join $::tcl::clock::TclLibDir clock.tcl]",
+    "::tcl::clock::GetFormatLocaleData",
+    "::tcl::clock::GetSystemTimeZone",	"::tcl::clock::LegacyTimeZone",
+    "::tcl::clock::Oldscan",		"::tcl::clock::SetupTimeZone",
+    "::tcl::clock::TZData"
 };
 
 /*
@@ -96,6 +106,20 @@ static const char *const literals[] = {
 typedef struct ClockClientData {
     int refCount;		/* Number of live references. */
     Tcl_Obj **literals;		/* Pool of object literals. */
+    int generation;		/* Generation of the caches below and of the
+				 * compiled formats; a new one is taken when
+				 * [clock]'s caches are cleared. */
+    Tcl_Obj *systemTZ;		/* Last result of GetSystemTimeZone, or
+				 * NULL. */
+    char *systemTZEnv[2];	/* Values of env(TCL_TZ) and env(TZ) that
+				 * gave systemTZ (NULL if unset). */
+    int systemTZGeneration;	/* Generation that gave systemTZ. */
+    Tcl_Obj *lastTZData;	/* Time zone data of the last conversion from
+				 * UTC using a table, or NULL. */
+    Tcl_WideInt lastRange[2];	/* Times from which and until which the
+				 * offset below applies in that zone. */
+    int lastTZOffset;		/* The offset found. */
+    Tcl_Obj *lastTZName;	/* Name of the zone at that time. */
 } ClockClientData;
 
 /*
@@ -123,6 +147,244 @@ typedef struct TclDateFields {
 } TclDateFields;
 static const char *const eras[] = { "CE", "BCE", NULL };
 
+/*
+ * A [clock format] format string, compiled for a locale, is kept as the
+ * internal representation of the format object. It is a sequence of tokens,
+ * each either literal text or a format group; format groups following %E and
+ * %O are marked with FMT_E and FMT_O.
+ */
+
+typedef struct ClockFormatToken {
+    int group;			/* Letter of the format group, or zero for
+				 * literal text. */
+    int start;			/* Offset of the literal text in the text of
+				 * the format. */
+    int length;			/* Length of the literal text in bytes. */
+} ClockFormatToken;
+
+#define FMT_E	0x100
+#define FMT_O	0x200
+
+/*
+ * Elements of the list of locale strings made by GetFormatLocaleData.
+ */
+
+enum ClockLocaleItem {
+    LOC_FORMAT,		LOC_DAYS_OF_WEEK_ABBREV,	LOC_DAYS_OF_WEEK_FULL,
+    LOC_MONTHS_ABBREV,	LOC_MONTHS_FULL,		LOC_AM_UPPER,
+    LOC_PM_UPPER,	LOC_AM,		LOC_PM,		LOC_BCE,	LOC_CE,
+    LOC_LOCALE_NUMERALS,			LOC_LOCALE_ERAS,
+    LOC_GREGORIAN_CHANGE_DATE,
+    LOC__END
+};
+
+typedef struct ClockFormat {
+    int refCount;		/* Number of objects and callers using it. */
+    int generation;		/* Generation of the client data it was
+				 * compiled for. */
+    char *locale;		/* Name of the locale, in lower case. */
+    Tcl_Obj *localeData;	/* List of the strings of the locale. */
+    Tcl_Obj **localeItems;	/* The elements of that list. */
+    int changeover;		/* Julian Day of the adoption of the
+				 * Gregorian calendar in the locale. */
+    int needEra;		/* Whether the format has %EC or %Ey. */
+    char *text;			/* Literal text of the format. */
+    int numTokens;		/* Number of tokens. */
+    ClockFormatToken tokens[1];	/* The tokens; actually numTokens long. */
+} ClockFormat;
+
+static void		DupClockFormatInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FreeClockFormatInternalRep(Tcl_Obj *objPtr);
+
+static const Tcl_ObjType clockFormatType = {
+    "clockFormat",			/* name */
+    FreeClockFormatInternalRep,		/* freeIntRepProc */
+    DupClockFormatInternalRep,		/* dupIntRepProc */
+    NULL,				/* updateStringProc */
+    NULL				/* setFromAnyProc */
+};
+
+/*
+ * A [clock scan] format string, compiled for a locale, is likewise kept as
+ * the internal representation of the format object. Its tokens are matched
+ * against the input string in turn, backtracking where a token can match
+ * text of several lengths. Each token that yields a value stores it in one
+ * of the fields below; the fields present in the format decide how the date
+ * and the time of day are put together.
+ */
+
+enum ClockScanField {
+    SF_CENTURY,		SF_YEAROFCENTURY,	SF_ISO8601CENTURY,
+    SF_ISO8601YEAROFCENTURY,			SF_ISO8601WEEK,
+    SF_ERA,		SF_MONTH,		SF_DAYOFMONTH,
+    SF_DAYOFYEAR,	SF_DAYOFWEEK,		SF_JULIANDAY,
+    SF_HOUR,		SF_HOURAMPM,		SF_MINUTE,
+    SF_SECOND,		SF_AMPM,		SF_SECONDS,
+    SF_TZNAME,
+    SF__END
+};
+
+enum ClockScanTokenType {
+    SCAN_LITERAL,		/* A character, in either case. */
+    SCAN_SPACE,			/* A run of white space. */
+    SCAN_DIGITS,		/* Optional white space, then a number. */
+    SCAN_SIGNED,		/* Optional white space, then a number with an
+				 * optional sign. */
+    SCAN_STARDATE,		/* A StarDate. */
+    SCAN_NAME,			/* A name, or a prefix of only one name. */
+    SCAN_NUMERAL,		/* A numeral of the locale. */
+    SCAN_TZ			/* A numeric or a legacy time zone. */
+};
+
+typedef struct ClockScanName {
+    Tcl_UniChar *chars;		/* The name, in lower case if prefixes of
+				 * it match. */
+    int length;			/* Length of the name in characters. */
+    int value;			/* Value that it stands for. */
+} ClockScanName;
+
+typedef struct ClockScanTable {
+    int prefixes;		/* Whether prefixes of the names match. */
+    int maxLength;		/* Length of the longest name. */
+    int numNames;		/* Number of names. */
+    ClockScanName names[1];	/* The names; actually numNames long. */
+} ClockScanTable;
+
+typedef struct ClockScanToken {
+    int type;			/* Type of the token, SCAN_*. */
+    int field;			/* Field that takes the value, or -1. */
+    int field2;			/* Field that takes the last two of four
+				 * digits, or -1. */
+    int min, max;		/* Bounds of the number of digits, or of
+				 * white space characters; for a literal, the
+				 * character itself. */
+    ClockScanTable *tablePtr;	/* The names or numerals, or NULL. */
+} ClockScanToken;
+
+typedef struct ClockScan {
+    int refCount;		/* Number of objects and callers using it. */
+    int generation;		/* Generation of the client data it was
+				 * compiled for. */
+    char *locale;		/* Name of the locale, in lower case. */
+    int changeover;		/* Julian Day of the adoption of the
+				 * Gregorian calendar in the locale. */
+    int fieldPos[SF__END];	/* Position of the last token setting each
+				 * field, counting from 1, or 0 if none. */
+    int dateAction;		/* How to find the date, DATE_*. */
+    int timeAction;		/* How to find the time of day, TIME_*. */
+    int numTokens;		/* Number of tokens. */
+    ClockScanToken tokens[1];	/* The tokens; actually numTokens long. */
+} ClockScan;
+
+/*
+ * The sets of fields from which [clock scan] can find the date and the time
+ * of day, best first. Of the complete sets of the best priority, the one
+ * whose fields come later in the format is used.
+ */
+
+enum ClockDateAction {
+    DATE_SECONDS,		DATE_JULIANDAY,
+    DATE_ERA_CENTURY_MONTH_DAY,	DATE_ERA_CENTURY_DAY,
+    DATE_CENTURY_MONTH_DAY,	DATE_CENTURY_DAY,
+    DATE_ISO8601_CENTURY_WEEK_DAY,
+    DATE_YEAR_MONTH_DAY,	DATE_YEAR_DAY,
+    DATE_ISO8601_YEAR_WEEK_DAY,
+    DATE_MONTH_DAY,		DATE_DAY_OF_YEAR,	DATE_WEEK_DAY,
+    DATE_DAY_OF_MONTH,		DATE_DAY_OF_WEEK,	DATE_BASE
+};
+
+enum ClockTimeAction {
+    TIME_SECONDS,	TIME_HMS_AMPM,	TIME_HMS,	TIME_HM_AMPM,
+    TIME_HM,		TIME_H_AMPM,	TIME_H,		TIME_MIDNIGHT
+};
+
+typedef struct ClockParseAction {
+    int priority;		/* Priority of the set; smaller is better. */
+    int fields[6];		/* The fields of the set, ending with -1. */
+    int action;			/* What to do with them. */
+} ClockParseAction;
+
+static const ClockParseAction dateParseActions[] = {
+    {0, {SF_SECONDS, -1},				DATE_SECONDS},
+    {1, {SF_JULIANDAY, -1},				DATE_JULIANDAY},
+    {2, {SF_ERA, SF_CENTURY, SF_YEAROFCENTURY, SF_MONTH, SF_DAYOFMONTH, -1},
+	    DATE_ERA_CENTURY_MONTH_DAY},
+    {2, {SF_ERA, SF_CENTURY, SF_YEAROFCENTURY, SF_DAYOFYEAR, -1},
+	    DATE_ERA_CENTURY_DAY},
+    {3, {SF_CENTURY, SF_YEAROFCENTURY, SF_MONTH, SF_DAYOFMONTH, -1},
+	    DATE_CENTURY_MONTH_DAY},
+    {3, {SF_CENTURY, SF_YEAROFCENTURY, SF_DAYOFYEAR, -1},
+	    DATE_CENTURY_DAY},
+    {3, {SF_ISO8601CENTURY, SF_ISO8601YEAROFCENTURY, SF_ISO8601WEEK,
+	    SF_DAYOFWEEK, -1},
+	    DATE_ISO8601_CENTURY_WEEK_DAY},
+    {4, {SF_YEAROFCENTURY, SF_MONTH, SF_DAYOFMONTH, -1},
+	    DATE_YEAR_MONTH_DAY},
+    {4, {SF_YEAROFCENTURY, SF_DAYOFYEAR, -1},		DATE_YEAR_DAY},
+    {4, {SF_ISO8601YEAROFCENTURY, SF_ISO8601WEEK, SF_DAYOFWEEK, -1},
+	    DATE_ISO8601_YEAR_WEEK_DAY},
+    {5, {SF_MONTH, SF_DAYOFMONTH, -1},			DATE_MONTH_DAY},
+    {5, {SF_DAYOFYEAR, -1},				DATE_DAY_OF_YEAR},
+    {5, {SF_ISO8601WEEK, SF_DAYOFWEEK, -1},		DATE_WEEK_DAY},
+    {6, {SF_DAYOFMONTH, -1},				DATE_DAY_OF_MONTH},
+    {7, {SF_DAYOFWEEK, -1},				DATE_DAY_OF_WEEK},
+    {8, {-1},						DATE_BASE},
+    {-1, {-1},						-1}
+};
+
+static const ClockParseAction timeParseActions[] = {
+    {1, {SF_SECONDS, -1},				TIME_SECONDS},
+    {2, {SF_HOURAMPM, SF_MINUTE, SF_SECOND, SF_AMPM, -1},	TIME_HMS_AMPM},
+    {2, {SF_HOUR, SF_MINUTE, SF_SECOND, -1},		TIME_HMS},
+    {3, {SF_HOURAMPM, SF_MINUTE, SF_AMPM, -1},		TIME_HM_AMPM},
+    {3, {SF_HOUR, SF_MINUTE, -1},			TIME_HM},
+    {4, {SF_HOURAMPM, SF_AMPM, -1},			TIME_H_AMPM},
+    {4, {SF_HOUR, -1},					TIME_H},
+    {5, {-1},						TIME_MIDNIGHT},
+    {-1, {-1},						-1}
+};
+
+/*
+ * What each token of a [clock scan] format matched in the input string.
+ */
+
+typedef struct ClockScanMatch {
+    const Tcl_UniChar *start;	/* Start of the text, after any white space
+				 * that precedes a number. */
+    int length;			/* Length of the text in characters. */
+    int value;			/* Value of a name or numeral. */
+} ClockScanMatch;
+
+typedef struct ClockScanMatcher {
+    ClockScanToken *tokens;	/* The tokens of the format. */
+    int numTokens;		/* Number of tokens. */
+    const Tcl_UniChar *string;	/* The string. */
+    const Tcl_UniChar *end;	/* End of the string. */
+    ClockScanMatch *matches;	/* What each token matched. */
+    char *failed;		/* For each token and each position in the
+				 * string, whether the tokens from that one on
+				 * were found not to match from there. */
+} ClockScanMatcher;
+
+static void		DupClockScanInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FreeClockScanInternalRep(Tcl_Obj *objPtr);
+
+static const Tcl_ObjType clockScanType = {
+    "clockScan",			/* name */
+    FreeClockScanInternalRep,		/* freeIntRepProc */
+    DupClockScanInternalRep,		/* dupIntRepProc */
+    NULL,				/* updateStringProc */
+    NULL				/* setFromAnyProc */
+};
+
+/*
+ * Source of the generations of ClockClientData, guarded by clockMutex.
+ */
+
+static int clockGeneration = 0;
+
 /*
  * Thread specific data block holding a 'struct tm' for the 'gmtime' and
  * 'localtime' library calls.
@@ -141,10 +403,11 @@ TCL_DECLARE_MUTEX(clockMutex)
  * Function prototypes for local procedures in this file:
  */
 
-static int		ConvertUTCToLocal(Tcl_Interp *,
+static int		ConvertUTCToLocal(ClockClientData *, Tcl_Interp *,
 			    TclDateFields *, Tcl_Obj *, int);
 static int		ConvertUTCToLocalUsingTable(Tcl_Interp *,
-			    TclDateFields *, int, Tcl_Obj *const[]);
+			    TclDateFields *, int, Tcl_Obj *const[],
+			    Tcl_WideInt *);
 static int		ConvertUTCToLocalUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
 static int		ConvertLocalToUTC(Tcl_Interp *,
@@ -154,20 +417,75 @@ static int		ConvertLocalToUTCUsingTable(Tcl_Interp *,
 static int		ConvertLocalToUTCUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
 static Tcl_Obj *	LookupLastTransition(Tcl_Interp *, Tcl_WideInt,
-			    int, Tcl_Obj *const *);
+			    int, Tcl_Obj *const *, Tcl_WideInt *);
 static void		GetYearWeekDay(TclDateFields *, int);
 static void		GetGregorianEraYearDay(TclDateFields *, int);
 static void		GetMonthDay(TclDateFields *);
 static void		GetJulianDayFromEraYearWeekDay(TclDateFields *, int);
 static void		GetJulianDayFromEraYearMonthDay(TclDateFields *, int);
+static void		GetJulianDayFromEraYearDay(TclDateFields *, int);
 static int		IsGregorianLeapYear(TclDateFields *);
 static int		WeekdayOnOrBefore(int, int);
+static void		AppendFormatGroup(ClockFormat *, int,
+			    TclDateFields *, Tcl_Obj *, int, Tcl_DString *);
+static void		AppendListElement(Tcl_Obj *, int, Tcl_DString *);
+static void		FormatNumericTimeZone(int, char *);
+static ClockFormat *	CompileClockFormat(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *, Tcl_Obj *);
+static Tcl_Obj *	GetLocaleData(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *, Tcl_Obj *, Tcl_Obj ***, int *);
+static ClockScan *	CompileClockScan(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *, Tcl_Obj *);
+static void		FreeClockScan(ClockScan *);
+static ClockScanTable *	NewScanTable(int, int);
+static void		AddScanName(ClockScanTable *, const char *, int,
+			    int);
+static int		AddDayOrMonthNames(Tcl_Interp *, ClockScanToken *,
+			    Tcl_Obj *, Tcl_Obj *, int);
+static int		LookupScanName(ClockScanTable *,
+			    const Tcl_UniChar *, int, int *);
+static int		SelectParseAction(const ClockParseAction *,
+			    const int *);
+static int		MatchScanTokens(ClockScanMatcher *, int,
+			    const Tcl_UniChar *);
+static int		ScanFormatted(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *, Tcl_Obj *, Tcl_Obj *, Tcl_Obj *,
+			    Tcl_WideInt, Tcl_Obj *);
+static int		FreeScan(ClockClientData *, Tcl_Interp *, Tcl_Obj *,
+			    Tcl_Obj *, Tcl_WideInt, Tcl_Obj *);
+static int		GetBaseFields(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *, Tcl_WideInt, Tcl_Obj *, int,
+			    TclDateFields *);
+static int		AddRelativeTime(ClockClientData *, Tcl_Interp *,
+			    Tcl_WideInt *, int, const int *,
+			    const char *const *, Tcl_Obj *);
+static int		ScanWideInt(ClockClientData *, Tcl_Interp *,
+			    const Tcl_UniChar *, int, Tcl_WideInt *);
+static int		ScanStarDate(ClockClientData *, Tcl_Interp *,
+			    const Tcl_UniChar *, int, Tcl_WideInt *);
+static int		EnsureClockLibrary(ClockClientData *, Tcl_Interp *);
+static void		FreeClockFormat(ClockFormat *);
+static int		GetLocaleEra(Tcl_Interp *, ClockFormat *,
+			    TclDateFields *, Tcl_Obj **, int *);
+static int		NewClockGeneration(void);
+static int		ParseFormatArgs(ClockClientData *, Tcl_Interp *,
+			    int, Tcl_Obj *const[], Tcl_WideInt *,
+			    Tcl_Obj **, Tcl_Obj **, Tcl_Obj **);
+static Tcl_Obj *	GetSystemTimeZone(ClockClientData *, Tcl_Interp *);
+static Tcl_Obj *	GetTimeZoneData(ClockClientData *, Tcl_Interp *,
+			    Tcl_Obj *);
+static int		ClockClearnativecachesObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockClicksObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
 static int		ClockConvertlocaltoutcObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
+static int		ClockFormatObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockGetdatefieldsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
@@ -189,6 +507,9 @@ static int		ClockMillisecondsObjCmd(
 static int		ClockParseformatargsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
+static int		ClockScanObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockSecondsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
@@ -211,9 +532,11 @@ struct ClockCommand {
 
 static const struct ClockCommand clockCommands[] = {
     { "clicks",			ClockClicksObjCmd },
+    { "format",			ClockFormatObjCmd },
     { "getenv",			ClockGetenvObjCmd },
     { "microseconds",		ClockMicrosecondsObjCmd },
     { "milliseconds",		ClockMillisecondsObjCmd },
+    { "scan",			ClockScanObjCmd },
     { "seconds",		ClockSecondsObjCmd },
     { "Oldscan",		TclClockOldscanObjCmd },
     { "ConvertLocalToUTC",	ClockConvertlocaltoutcObjCmd },
@@ -223,6 +546,7 @@ static const struct ClockCommand clockCommands[] = {
     { "GetJulianDayFromEraYearWeekDay",
 		ClockGetjuliandayfromerayearweekdayObjCmd },
     { "ParseFormatArgs",	ClockParseformatargsObjCmd },
+    { "ClearNativeCaches",	ClockClearnativecachesObjCmd },
     { NULL, NULL }
 };
 
@@ -275,6 +599,12 @@ TclClockInit(
 	data->literals[i] = Tcl_NewStringObj(literals[i], -1);
 	Tcl_IncrRefCount(data->literals[i]);
     }
+    data->generation = NewClockGeneration();
+    data->systemTZ = NULL;
+    data->systemTZEnv[0] = data->systemTZEnv[1] = NULL;
+    data->systemTZGeneration = 0;
+    data->lastTZData = NULL;
+    data->lastTZName = NULL;
 
     /*
      * Install the commands.
@@ -449,7 +779,8 @@ ClockGetdatefieldsObjCmd(
      * Convert UTC time to local.
      */
 
-    if (ConvertUTCToLocal(interp, &fields, objv[2], changeover) != TCL_OK) {
+    if (ConvertUTCToLocal(data, interp, &fields, objv[2],
+	    changeover) != TCL_OK) {
 	return TCL_ERROR;
     }
 
@@ -777,7 +1108,8 @@ ConvertLocalToUTCUsingTable(
     fields->tzOffset = 0;
     fields->seconds = fields->localSeconds;
     while (!found) {
-	row = LookupLastTransition(interp, fields->seconds, rowc, rowv);
+	row = LookupLastTransition(interp, fields->seconds, rowc, rowv,
+		NULL);
 	if ((row == NULL)
 		|| TclListObjGetElements(interp, row, &cellc,
 		    &cellv) != TCL_OK
@@ -898,13 +1230,17 @@ ConvertLocalToUTCUsingC(
  *	Returns a standard Tcl result.
  *
  * Side effects:
- *	Populates the 'tzName' and 'tzOffset' fields.
+ *	Populates the 'tzName' and 'tzOffset' fields. Remembers the offset
+ *	found in a table of transitions, and the period over which it
+ *	applies, in the client data, so that converting another time in that
+ *	period needs no search.
  *
  *----------------------------------------------------------------------
  */
 
 static int
 ConvertUTCToLocal(
+    ClockClientData *dataPtr,	/* Client data of [clock] */
     Tcl_Interp *interp,		/* Tcl interpreter */
     TclDateFields *fields,	/* Fields of the time */
     Tcl_Obj *tzdata,		/* Time zone data */
@@ -912,6 +1248,17 @@ ConvertUTCToLocal(
 {
     int rowc;			/* Number of rows in tzdata */
     Tcl_Obj **rowv;		/* Pointers to the rows */
+    Tcl_WideInt range[2];	/* Period of the offset found */
+
+    if ((tzdata == dataPtr->lastTZData)
+	    && (fields->seconds >= dataPtr->lastRange[0])
+	    && (fields->seconds < dataPtr->lastRange[1])) {
+	fields->tzOffset = dataPtr->lastTZOffset;
+	fields->tzName = dataPtr->lastTZName;
+	Tcl_IncrRefCount(fields->tzName);
+	fields->localSeconds = fields->seconds + fields->tzOffset;
+	return TCL_OK;
+    }
 
     /*
      * Unpack the tz data.
@@ -928,9 +1275,24 @@ ConvertUTCToLocal(
 
     if (rowc == 0) {
 	return ConvertUTCToLocalUsingC(interp, fields, changeover);
-    } else {
-	return ConvertUTCToLocalUsingTable(interp, fields, rowc, rowv);
     }
+    if (ConvertUTCToLocalUsingTable(interp, fields, rowc, rowv,
+	    range) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    Tcl_IncrRefCount(tzdata);
+    Tcl_IncrRefCount(fields->tzName);
+    if (dataPtr->lastTZData != NULL) {
+	Tcl_DecrRefCount(dataPtr->lastTZData);
+	Tcl_DecrRefCount(dataPtr->lastTZName);
+    }
+    dataPtr->lastTZData = tzdata;
+    dataPtr->lastTZName = fields->tzName;
+    dataPtr->lastTZOffset = fields->tzOffset;
+    dataPtr->lastRange[0] = range[0];
+    dataPtr->lastRange[1] = range[1];
+    return TCL_OK;
 }
 
 /*
@@ -945,8 +1307,9 @@ ConvertUTCToLocal(
  *
  * Side effects:
  *	On success, fills fields->tzName, fields->tzOffset and
- *	fields->localSeconds. On failure, places an error message in the
- *	interpreter result.
+ *	fields->localSeconds, and stores in range the period over which the
+ *	offset applies. On failure, places an error message in the interpreter
+ *	result.
  *
  *----------------------------------------------------------------------
  */
@@ -957,7 +1320,10 @@ ConvertUTCToLocalUsingTable(
     TclDateFields *fields,	/* Fields of the date */
     int rowc,			/* Number of rows in the conversion table
 				 * (>= 1) */
-    Tcl_Obj *const rowv[])	/* Rows of the conversion table */
+    Tcl_Obj *const rowv[],	/* Rows of the conversion table */
+    Tcl_WideInt *range)		/* Where to store the first time at which the
+				 * offset applies and the first at which it
+				 * no longer does. */
 {
     Tcl_Obj *row;		/* Row containing the current information */
     int cellc;			/* Count of cells in the row (must be 4) */
@@ -967,7 +1333,7 @@ ConvertUTCToLocalUsingTable(
      * Look up the nearest transition time.
      */
 
-    row = LookupLastTransition(interp, fields->seconds, rowc, rowv);
+    row = LookupLastTransition(interp, fields->seconds, rowc, rowv, range);
     if (row == NULL ||
 	    TclListObjGetElements(interp, row, &cellc, &cellv) != TCL_OK ||
 	    TclGetIntFromObj(interp, cellv[1], &fields->tzOffset) != TCL_OK) {
@@ -1086,7 +1452,9 @@ ConvertUTCToLocalUsingC(
  *	or before the given time.
  *
  * Results:
- *	Returns a pointer to the row, or NULL if an error occurs.
+ *	Returns a pointer to the row, or NULL if an error occurs. If rangesVal
+ *	is not NULL, stores there the time of the transition and that of the
+ *	next one, which bound the period the row applies to.
  *
  *----------------------------------------------------------------------
  */
@@ -1096,12 +1464,14 @@ LookupLastTransition(
     Tcl_Interp *interp,		/* Interpreter for error messages */
     Tcl_WideInt tick,		/* Time from the epoch */
     int rowc,			/* Number of rows of tzdata */
-    Tcl_Obj *const *rowv)	/* Rows in tzdata */
+    Tcl_Obj *const *rowv,	/* Rows in tzdata */
+    Tcl_WideInt *rangesVal)	/* Where to store the bounds of the period, or
+				 * NULL */
 {
     int l;
     int u;
     Tcl_Obj *compObj;
-    Tcl_WideInt compVal;
+    Tcl_WideInt compVal, fromVal;
 
     /*
      * Examine the first row to make sure we're in bounds.
@@ -1118,6 +1488,10 @@ LookupLastTransition(
      */
 
     if (tick < compVal) {
+	if (rangesVal != NULL) {
+	    rangesVal[0] = LLONG_MIN;
+	    rangesVal[1] = compVal;
+	}
 	return rowv[0];
     }
 
@@ -1127,6 +1501,7 @@ LookupLastTransition(
 
     l = 0;
     u = rowc-1;
+    fromVal = compVal;
     while (l < u) {
 	int m = (l + u + 1) / 2;
 
@@ -1136,10 +1511,23 @@ LookupLastTransition(
 	}
 	if (tick >= compVal) {
 	    l = m;
+	    fromVal = compVal;
 	} else {
 	    u = m-1;
 	}
     }
+
+    if (rangesVal != NULL) {
+	rangesVal[0] = fromVal;
+	rangesVal[1] = LLONG_MAX;
+	if (l + 1 < rowc) {
+	    if (Tcl_ListObjIndex(interp, rowv[l+1], 0, &compObj) != TCL_OK ||
+		    Tcl_GetWideIntFromObj(interp, compObj,
+			&rangesVal[1]) != TCL_OK) {
+		return NULL;
+	    }
+	}
+    }
     return rowv[l];
 }
 
@@ -1507,6 +1895,70 @@ GetJulianDayFromEraYearMonthDay(
 		+ ym1o4;
     }
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetJulianDayFromEraYearDay --
+ *
+ *	Given era, year, and dayOfYear (in TclDateFields), and the Gregorian
+ *	transition date, computes the Julian Day Number.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores day number in 'julianDay'
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GetJulianDayFromEraYearDay(
+    TclDateFields *fields,	/* Date to convert */
+    int changeover)		/* Gregorian transition date as a Julian Day */
+{
+    int year, ym1, ym1o4, ym1o100, ym1o400;
+
+    if (fields->era == BCE) {
+	year = 1 - fields->year;
+    } else {
+	year = fields->year;
+    }
+    ym1 = year - 1;
+    ym1o4 = ym1 / 4;
+    if (ym1 % 4 < 0) {
+	ym1o4--;
+    }
+    ym1o100 = ym1 / 100;
+    if (ym1 % 100 < 0) {
+	ym1o100--;
+    }
+    ym1o400 = ym1 / 400;
+    if (ym1 % 400 < 0) {
+	ym1o400--;
+    }
+
+    /*
+     * Try the Gregorian calendar first; if the date is before the Gregorian
+     * changeover, use the Julian calendar.
+     */
+
+    fields->gregorian = 1;
+    fields->julianDay = JDAY_1_JAN_1_CE_GREGORIAN - 1
+	    + fields->dayOfYear
+	    + (ONE_YEAR * ym1)
+	    + ym1o4
+	    - ym1o100
+	    + ym1o400;
+    if (fields->julianDay < changeover) {
+	fields->gregorian = 0;
+	fields->julianDay = JDAY_1_JAN_1_CE_JULIAN - 1
+		+ fields->dayOfYear
+		+ (ONE_YEAR * ym1)
+		+ ym1o4;
+    }
+}
 
 /*
  *----------------------------------------------------------------------
@@ -1830,12 +2282,50 @@ ClockParseformatargsObjCmd(
     int objc,			/* Parameter count */
     Tcl_Obj *const objv[])	/* Parameter vector */
 {
-    ClockClientData *dataPtr = clientData;
-    Tcl_Obj **litPtr = dataPtr->literals;
     Tcl_Obj *results[3];	/* Format, locale and timezone */
-#define formatObj results[0]
-#define localeObj results[1]
-#define timezoneObj results[2]
+    Tcl_WideInt clockVal;	/* Clock value - just used to parse. */
+
+    if (ParseFormatArgs(clientData, interp, objc, objv, &clockVal,
+	    &results[0], &results[1], &results[2]) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    /*
+     * Return options as a list.
+     */
+
+    Tcl_SetObjResult(interp, Tcl_NewListObj(3, results));
+    return TCL_OK;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ParseFormatArgs --
+ *
+ *	Parses the arguments for [clock format], which are a time followed by
+ *	keyword-value pairs.
+ *
+ * Results:
+ *	Returns a standard Tcl result, and on success stores the time, the
+ *	format, the locale and the time zone (empty if not given).
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+ParseFormatArgs(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[],	/* Parameter vector */
+    Tcl_WideInt *clockValPtr,	/* Where to store the time */
+    Tcl_Obj **formatObjPtr,	/* Where to store the format */
+    Tcl_Obj **localeObjPtr,	/* Where to store the locale */
+    Tcl_Obj **timezoneObjPtr)	/* Where to store the time zone */
+{
+    Tcl_Obj **litPtr = dataPtr->literals;
+    Tcl_Obj *formatObj, *localeObj, *timezoneObj;
     int gmtFlag = 0;
     static const char *const options[] = { /* Command line options expected */
 	"-format",	"-gmt",		"-locale",
@@ -1846,7 +2336,6 @@ ClockParseformatargsObjCmd(
     };
     int optionIndex;		/* Index of an option. */
     int saw = 0;		/* Flag == 1 if option was seen already. */
-    Tcl_WideInt clockVal;	/* Clock value - just used to parse. */
     int i;
 
     /*
@@ -1898,7 +2387,7 @@ ClockParseformatargsObjCmd(
      * Check options.
      */
 
-    if (Tcl_GetWideIntFromObj(interp, objv[1], &clockVal) != TCL_OK) {
+    if (Tcl_GetWideIntFromObj(interp, objv[1], clockValPtr) != TCL_OK) {
 	return TCL_ERROR;
     }
     if ((saw & (1 << CLOCK_FORMAT_GMT))
@@ -1911,106 +2400,2886 @@ ClockParseformatargsObjCmd(
 	timezoneObj = litPtr[LIT_GMT];
     }
 
-    /*
-     * Return options as a list.
-     */
-
-    Tcl_SetObjResult(interp, Tcl_NewListObj(3, results));
+    *formatObjPtr = formatObj;
+    *localeObjPtr = localeObj;
+    *timezoneObjPtr = timezoneObj;
     return TCL_OK;
-
-#undef timezoneObj
-#undef localeObj
-#undef formatObj
 }
-
-/*----------------------------------------------------------------------
+
+/*
+ *----------------------------------------------------------------------
  *
- * ClockSecondsObjCmd -
+ * ClockFormatObjCmd --
  *
- *	Returns a count of microseconds since the epoch.
+ *	Formats a count of seconds since the Posix Epoch as a time of day.
  *
  * Results:
  *	Returns a standard Tcl result.
  *
  * Side effects:
- *	None.
+ *	Compiles the format into the internal representation of the format
+ *	object. May load the [clock] library, and set up the time zone.
  *
- * This function implements the 'clock seconds' Tcl command. Refer to the user
+ * This function implements the 'clock format' Tcl command. Refer to the user
  * documentation for details on what it does.
  *
  *----------------------------------------------------------------------
  */
 
-int
-ClockSecondsObjCmd(
-    ClientData clientData,	/* Client data is unused */
+static int
+ClockFormatObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
     Tcl_Interp *interp,		/* Tcl interpreter */
     int objc,			/* Parameter count */
-    Tcl_Obj *const *objv)	/* Parameter values */
+    Tcl_Obj *const objv[])	/* Parameter vector */
 {
-    Tcl_Time now;
+    ClockClientData *dataPtr = clientData;
+    Tcl_Obj *formatObj, *localeObj, *timezoneObj, *tzdata;
+    Tcl_Obj *eraObj = NULL;
+    ClockFormat *fmtPtr;
+    ClockFormatToken *tokenPtr;
+    TclDateFields fields;
+    Tcl_DString ds;
+    int localeYear = 0, i, result = TCL_ERROR;
 
-    if (objc != 1) {
-	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+    if (ParseFormatArgs(dataPtr, interp, objc, objv, &fields.seconds,
+	    &formatObj, &localeObj, &timezoneObj) != TCL_OK) {
 	return TCL_ERROR;
     }
-    Tcl_GetTime(&now);
-    Tcl_SetObjResult(interp, Tcl_NewWideIntObj((Tcl_WideInt) now.sec));
-    return TCL_OK;
+
+    /*
+     * Get the data for time changes in the given zone, and the compiled
+     * format.
+     */
+
+    if (TclGetString(timezoneObj)[0] == '\0') {
+	timezoneObj = GetSystemTimeZone(dataPtr, interp);
+	if (timezoneObj == NULL) {
+	    return TCL_ERROR;
+	}
+    }
+    tzdata = GetTimeZoneData(dataPtr, interp, timezoneObj);
+    if (tzdata == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_IncrRefCount(tzdata);
+    fmtPtr = CompileClockFormat(dataPtr, interp, formatObj, localeObj);
+    if (fmtPtr == NULL) {
+	Tcl_DecrRefCount(tzdata);
+	return TCL_ERROR;
+    }
+    fmtPtr->refCount++;
+
+    /*
+     * fields.seconds could be an unsigned number that overflowed. Make sure
+     * that it isn't.
+     */
+
+    if (objv[1]->typePtr == &tclBignumType) {
+	Tcl_SetObjResult(interp,
+		dataPtr->literals[LIT_INTEGER_VALUE_TOO_LARGE]);
+	goto done;
+    }
+
+    /*
+     * Convert UTC time to local, and take it apart.
+     */
+
+    if (ConvertUTCToLocal(dataPtr, interp, &fields, tzdata,
+	    fmtPtr->changeover) != TCL_OK) {
+	goto done;
+    }
+    fields.julianDay = (int) ((fields.localSeconds + JULIAN_SEC_POSIX_EPOCH)
+	    / SECONDS_PER_DAY);
+    GetGregorianEraYearDay(&fields, fmtPtr->changeover);
+    GetMonthDay(&fields);
+    GetYearWeekDay(&fields, fmtPtr->changeover);
+    if (fmtPtr->needEra && GetLocaleEra(interp, fmtPtr, &fields, &eraObj,
+	    &localeYear) != TCL_OK) {
+	Tcl_DecrRefCount(fields.tzName);
+	goto done;
+    }
+
+    /*
+     * Put the result together.
+     */
+
+    Tcl_DStringInit(&ds);
+    for (i = 0, tokenPtr = fmtPtr->tokens; i < fmtPtr->numTokens;
+	    i++, tokenPtr++) {
+	if (tokenPtr->group == 0) {
+	    Tcl_DStringAppend(&ds, fmtPtr->text + tokenPtr->start,
+		    tokenPtr->length);
+	} else {
+	    AppendFormatGroup(fmtPtr, tokenPtr->group, &fields, eraObj,
+		    localeYear, &ds);
+	}
+    }
+    Tcl_DStringResult(interp, &ds);
+    Tcl_DecrRefCount(fields.tzName);
+    if (eraObj != NULL) {
+	Tcl_DecrRefCount(eraObj);
+    }
+    result = TCL_OK;
+
+  done:
+    FreeClockFormat(fmtPtr);
+    Tcl_DecrRefCount(tzdata);
+    return result;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * TzsetIfNecessary --
+ * AppendFormatGroup, AppendListElement --
  *
- *	Calls the tzset() library function if the contents of the TZ
- *	environment variable has changed.
+ *	AppendFormatGroup appends the text of one format group of [clock
+ *	format] for a time to a string. AppendListElement appends an element
+ *	of a list of locale strings, or nothing if there is no such element.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Calls tzset.
+ *	Appends to the string.
  *
  *----------------------------------------------------------------------
  */
 
+#define RODDENBERRY	1946	/* Origin of StarDates (%Q). */
+
 static void
-TzsetIfNecessary(void)
+AppendFormatGroup(
+    ClockFormat *fmtPtr,	/* The compiled format */
+    int group,			/* The format group */
+    TclDateFields *fields,	/* The time, taken apart */
+    Tcl_Obj *eraObj,		/* Locale era, if the format needs it */
+    int localeYear,		/* Year in the locale era */
+    Tcl_DString *dsPtr)		/* String to append to */
 {
-    static char *tzWas = NULL;	/* Previous value of TZ, protected by
-				 * clockMutex. */
-    const char *tzIsNow;	/* Current value of TZ */
+    Tcl_Obj **items = fmtPtr->localeItems;
+    int secondOfDay, hour, hour12, n;
+    char buf[TCL_INTEGER_SPACE + 16];
 
-    Tcl_MutexLock(&clockMutex);
-    tzIsNow = getenv("TZ");
-    if (tzIsNow != NULL && (tzWas == NULL || strcmp(tzIsNow, tzWas) != 0)) {
-	tzset();
-	if (tzWas != NULL) {
-	    ckfree(tzWas);
-	}
-	tzWas = ckalloc(strlen(tzIsNow) + 1);
-	strcpy(tzWas, tzIsNow);
-    } else if (tzIsNow == NULL && tzWas != NULL) {
-	tzset();
-	ckfree(tzWas);
-	tzWas = NULL;
+    secondOfDay = (int) (fields->localSeconds % SECONDS_PER_DAY);
+    if (secondOfDay < 0) {
+	secondOfDay += SECONDS_PER_DAY;
     }
-    Tcl_MutexUnlock(&clockMutex);
-}
-
-/*
- *----------------------------------------------------------------------
- *
- * ClockDeleteCmdProc --
- *
- *	Remove a reference to the clock client data, and clean up memory
- *	when it's all gone.
- *
- * Results:
- *	None.
- *
+    hour = secondOfDay / 3600;
+    hour12 = (hour + 11) % 12 + 1;
+
+    switch (group) {
+    case 'a':			/* Day of week, abbreviated */
+	AppendListElement(items[LOC_DAYS_OF_WEEK_ABBREV],
+		fields->dayOfWeek % 7, dsPtr);
+	return;
+    case 'A':			/* Day of week, spelt out */
+	AppendListElement(items[LOC_DAYS_OF_WEEK_FULL],
+		fields->dayOfWeek % 7, dsPtr);
+	return;
+    case 'b': case 'h':		/* Name of month, abbreviated */
+	AppendListElement(items[LOC_MONTHS_ABBREV], fields->month - 1, dsPtr);
+	return;
+    case 'B':			/* Name of month, spelt out */
+	AppendListElement(items[LOC_MONTHS_FULL], fields->month - 1, dsPtr);
+	return;
+    case 'C':			/* Century number */
+	sprintf(buf, "%02d", fields->year / 100);
+	break;
+    case 'd':			/* Day of month, with leading zero */
+	sprintf(buf, "%02d", fields->dayOfMonth);
+	break;
+    case 'e':			/* Day of month, without leading zero */
+	sprintf(buf, "%2d", fields->dayOfMonth);
+	break;
+    case 'g':			/* Two-digit ISO8601 week-based year */
+	n = fields->iso8601Year % 100;
+	sprintf(buf, "%02d", (n < 0) ? n + 100 : n);
+	break;
+    case 'G':			/* Four-digit ISO8601 week-based year */
+	sprintf(buf, "%02d", fields->iso8601Year);
+	break;
+    case 'H':			/* Hour in the 24-hour day, leading zero */
+	sprintf(buf, "%02d", hour);
+	break;
+    case 'I':			/* Hour AM/PM, with leading zero */
+	sprintf(buf, "%02d", hour12);
+	break;
+    case 'j':			/* Day of year (001-366) */
+	sprintf(buf, "%03d", fields->dayOfYear);
+	break;
+    case 'J':			/* Julian Day Number */
+	sprintf(buf, "%07d", fields->julianDay);
+	break;
+    case 'k':			/* Hour (0-23), no leading zero */
+	sprintf(buf, "%2d", hour);
+	break;
+    case 'l':			/* Hour (12-11), no leading zero */
+	sprintf(buf, "%2d", hour12);
+	break;
+    case 'm':			/* Month number, leading zero */
+	sprintf(buf, "%02d", fields->month);
+	break;
+    case 'M':			/* Minute of the hour, leading zero */
+	sprintf(buf, "%02d", secondOfDay / 60 % 60);
+	break;
+    case 'N':			/* Month number, no leading zero */
+	sprintf(buf, "%2d", fields->month);
+	break;
+    case 'p':			/* Localized 'AM' or 'PM' in upper case */
+	Tcl_DStringAppend(dsPtr, TclGetString(items[(secondOfDay < 43200)
+		? LOC_AM_UPPER : LOC_PM_UPPER]), -1);
+	return;
+    case 'P':			/* Localized 'AM' or 'PM' indicator */
+	Tcl_DStringAppend(dsPtr, TclGetString(items[(secondOfDay < 43200)
+		? LOC_AM : LOC_PM]), -1);
+	return;
+    case 'Q':			/* StarDate */
+	n = 1000 * (fields->dayOfYear - 1)
+		/ (IsGregorianLeapYear(fields) ? 366 : 365);
+	sprintf(buf, "Stardate %02d%03d.%1d", fields->year - RODDENBERRY, n,
+		secondOfDay / (SECONDS_PER_DAY / 10));
+	break;
+    case 's': {			/* Seconds from the Posix Epoch */
+	Tcl_Obj *secondsObj = Tcl_NewWideIntObj(fields->seconds);
+
+	Tcl_DStringAppend(dsPtr, TclGetString(secondsObj), -1);
+	Tcl_DecrRefCount(secondsObj);
+	return;
+    }
+    case 'S':			/* Second of the minute, leading zero */
+	sprintf(buf, "%02d", secondOfDay % 60);
+	break;
+    case 'u':			/* Day of the week (1-Monday, 7-Sunday) */
+	sprintf(buf, "%1d", fields->dayOfWeek);
+	break;
+    case 'U':			/* Week of the year (00-53), from Sunday */
+	sprintf(buf, "%02d",
+		(fields->dayOfYear - fields->dayOfWeek % 7 - 1 + 7) / 7);
+	break;
+    case 'V':			/* The ISO8601 week number */
+	sprintf(buf, "%02d", fields->iso8601Week);
+	break;
+    case 'w':			/* Day of the week (0-Sunday, 6-Saturday) */
+	sprintf(buf, "%1d", fields->dayOfWeek % 7);
+	break;
+    case 'W':			/* Week of the year (00-53), from Monday */
+	sprintf(buf, "%02d", (fields->dayOfYear - fields->dayOfWeek + 7) / 7);
+	break;
+    case 'y':			/* The two-digit year of the century */
+	sprintf(buf, "%02d", fields->year % 100);
+	break;
+    case 'Y':			/* The four-digit year */
+	sprintf(buf, "%04d", fields->year);
+	break;
+    case 'z':			/* The time zone as hours and minutes east
+				 * (+) or west (-) of Greenwich */
+	FormatNumericTimeZone(fields->tzOffset, buf);
+	break;
+    case 'Z':			/* The name of the time zone */
+	Tcl_DStringAppend(dsPtr, TclGetString(fields->tzName), -1);
+	return;
+
+    case FMT_E|'E':		/* Era, BCE or CE */
+	Tcl_DStringAppend(dsPtr, TclGetString(
+		items[(fields->era == BCE) ? LOC_BCE : LOC_CE]), -1);
+	return;
+    case FMT_E|'C':		/* Locale-dependent era */
+	Tcl_DStringAppend(dsPtr, TclGetString(eraObj), -1);
+	return;
+    case FMT_E|'y':		/* Locale-dependent year of the era */
+	if ((localeYear >= 0) && (localeYear < 100)) {
+	    AppendListElement(items[LOC_LOCALE_NUMERALS], localeYear, dsPtr);
+	    return;
+	}
+	sprintf(buf, "%d", localeYear);
+	break;
+
+    default:			/* The rest are %O groups, in the locale's
+				 * alternative numerals */
+	switch (group & ~FMT_O) {
+	case 'd': case 'e':
+	    n = fields->dayOfMonth;
+	    break;
+	case 'H': case 'k':
+	    n = hour;
+	    break;
+	case 'I': case 'l':
+	    n = hour12;
+	    break;
+	case 'm':
+	    n = fields->month;
+	    break;
+	case 'M':
+	    n = secondOfDay / 60 % 60;
+	    break;
+	case 'S':
+	    n = secondOfDay % 60;
+	    break;
+	case 'u':
+	    n = fields->dayOfWeek;
+	    break;
+	case 'w':
+	    n = fields->dayOfWeek % 7;
+	    break;
+	default:		/* 'y' */
+	    n = fields->year % 100;
+	    break;
+	}
+	AppendListElement(items[LOC_LOCALE_NUMERALS], n, dsPtr);
+	return;
+    }
+    Tcl_DStringAppend(dsPtr, buf, -1);
+}
+
+static void
+AppendListElement(
+    Tcl_Obj *listObj,		/* List of locale strings */
+    int index,			/* Index of the element to append */
+    Tcl_DString *dsPtr)		/* String to append to */
+{
+    Tcl_Obj *elemObj;
+
+    if ((Tcl_ListObjIndex(NULL, listObj, index, &elemObj) == TCL_OK)
+	    && (elemObj != NULL)) {
+	Tcl_DStringAppend(dsPtr, TclGetString(elemObj), -1);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatNumericTimeZone --
+ *
+ *	Formats a time zone offset as hours, minutes and, if there are any,
+ *	seconds east (+) or west (-) of Greenwich: +hhmm or +hhmmss.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores the text in the buffer, which must hold TCL_INTEGER_SPACE
+ *	characters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FormatNumericTimeZone(
+    int z,			/* Offset in seconds east of Greenwich */
+    char *buf)			/* Where to store the text */
+{
+    if (z < 0) {
+	*buf++ = '-';
+	z = -z;
+    } else {
+	*buf++ = '+';
+    }
+    buf += sprintf(buf, "%02d%02d", z / 3600, z % 3600 / 60);
+    if (z % 60 != 0) {
+	sprintf(buf, "%02d", z % 60);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetLocaleEra --
+ *
+ *	Given a local time, determines the era and year within the era in the
+ *	alternative eras of the locale of a compiled format (its LOCALE_ERAS).
+ *
+ * Results:
+ *	Returns a standard Tcl result. On success, stores the era, with its
+ *	reference count incremented, and the year.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetLocaleEra(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockFormat *fmtPtr,	/* The compiled format */
+    TclDateFields *fields,	/* The time, taken apart */
+    Tcl_Obj **eraObjPtr,	/* Where to store the era */
+    int *yearPtr)		/* Where to store the year of the era */
+{
+    Tcl_Obj **rowv, *compObj, *eraObj;
+    Tcl_WideInt compVal;
+    int rowc, l, u, offset;
+    char buf[TCL_INTEGER_SPACE];
+
+    if (TclListObjGetElements(interp, fmtPtr->localeItems[LOC_LOCALE_ERAS],
+	    &rowc, &rowv) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    /*
+     * Binary-search for the last era that began at or before the time.
+     */
+
+    l = -1;
+    if (rowc > 0) {
+	if (Tcl_ListObjIndex(interp, rowv[0], 0, &compObj) != TCL_OK
+		|| compObj == NULL
+		|| Tcl_GetWideIntFromObj(interp, compObj, &compVal) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (fields->localSeconds >= compVal) {
+	    l = 0;
+	    u = rowc - 1;
+	    while (l < u) {
+		int m = (l + u + 1) / 2;
+
+		if (Tcl_ListObjIndex(interp, rowv[m], 0, &compObj) != TCL_OK
+			|| compObj == NULL
+			|| Tcl_GetWideIntFromObj(interp, compObj,
+			    &compVal) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		if (fields->localSeconds >= compVal) {
+		    l = m;
+		} else {
+		    u = m - 1;
+		}
+	    }
+	}
+    }
+
+    if (l < 0) {
+	sprintf(buf, "%02d", fields->year / 100);
+	eraObj = Tcl_NewStringObj(buf, -1);
+	*yearPtr = fields->year % 100;
+    } else {
+	if (Tcl_ListObjIndex(interp, rowv[l], 2, &compObj) != TCL_OK
+		|| compObj == NULL
+		|| TclGetIntFromObj(interp, compObj, &offset) != TCL_OK
+		|| Tcl_ListObjIndex(interp, rowv[l], 1, &eraObj) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (eraObj == NULL) {
+	    TclNewObj(eraObj);
+	}
+	*yearPtr = fields->year - offset;
+    }
+    Tcl_IncrRefCount(eraObj);
+    *eraObjPtr = eraObj;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileClockFormat --
+ *
+ *	Gets the compiled form of a [clock format] format in a locale, from
+ *	the internal representation of the format object if it was compiled
+ *	for that locale since [clock]'s caches were last cleared, or else by
+ *	compiling it with the strings of the locale from GetLocaleData.
+ *
+ * Results:
+ *	Returns the compiled format, or NULL with an error message in the
+ *	interpreter if the strings of the locale could not be obtained.
+ *
+ * Side effects:
+ *	Changes the internal representation of the format object.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClockFormat *
+CompileClockFormat(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *formatObj,		/* The format */
+    Tcl_Obj *localeObj)		/* The locale */
+{
+    ClockFormat *fmtPtr;
+    ClockFormatToken *tokenPtr;
+    Tcl_Obj *lowerObj, *dataObj, **itemv;
+    Tcl_DString text;
+    const char *p, *end, *groups;
+    int length, state, n, changeover, i;
+    Tcl_UniChar ch;
+
+    if (formatObj->typePtr == &clockFormatType) {
+	fmtPtr = formatObj->internalRep.twoPtrValue.ptr1;
+	if ((fmtPtr->generation == dataPtr->generation)
+		&& (strcmp(fmtPtr->locale, TclGetString(localeObj)) == 0)) {
+	    return fmtPtr;
+	}
+    }
+
+    /*
+     * The locale is not case sensitive.
+     */
+
+    p = TclGetStringFromObj(localeObj, &length);
+    lowerObj = Tcl_NewStringObj(p, length);
+    lowerObj->length = Tcl_UtfToLower(lowerObj->bytes);
+    Tcl_IncrRefCount(lowerObj);
+    if (formatObj->typePtr == &clockFormatType) {
+	fmtPtr = formatObj->internalRep.twoPtrValue.ptr1;
+	if ((fmtPtr->generation == dataPtr->generation)
+		&& (strcmp(fmtPtr->locale, lowerObj->bytes) == 0)) {
+	    Tcl_DecrRefCount(lowerObj);
+	    return fmtPtr;
+	}
+    }
+
+    Tcl_IncrRefCount(formatObj);
+    dataObj = GetLocaleData(dataPtr, interp, formatObj, lowerObj, &itemv,
+	    &changeover);
+    if (dataObj == NULL) {
+	Tcl_DecrRefCount(formatObj);
+	Tcl_DecrRefCount(lowerObj);
+	return NULL;
+    }
+
+    /*
+     * Split the localized format into literal text and format groups. There
+     * are at most as many tokens as there are bytes in the format, plus one.
+     */
+
+    p = TclGetStringFromObj(itemv[LOC_FORMAT], &length);
+    end = p + length;
+    fmtPtr = (ClockFormat *) ckalloc(sizeof(ClockFormat)
+	    + length * sizeof(ClockFormatToken));
+    fmtPtr->numTokens = 0;
+    fmtPtr->needEra = 0;
+    tokenPtr = NULL;
+    Tcl_DStringInit(&text);
+
+#define APPEND_LITERAL(bytes, numBytes) \
+    if ((tokenPtr == NULL) || (tokenPtr->group != 0)) {			\
+	tokenPtr = fmtPtr->tokens + fmtPtr->numTokens++;		\
+	tokenPtr->group = 0;						\
+	tokenPtr->start = Tcl_DStringLength(&text);			\
+	tokenPtr->length = 0;						\
+    }									\
+    Tcl_DStringAppend(&text, (bytes), (numBytes));			\
+    tokenPtr->length += (numBytes)
+#define APPEND_GROUP(g) \
+    tokenPtr = fmtPtr->tokens + fmtPtr->numTokens++;			\
+    tokenPtr->group = (g);						\
+    tokenPtr->start = tokenPtr->length = 0
+
+    state = 0;
+    for (; p < end; p += n) {
+	n = TclUtfToUniChar(p, &ch);
+	switch (state) {
+	case 0:
+	    if (ch == '%') {
+		state = '%';
+	    } else {
+		APPEND_LITERAL(p, n);
+	    }
+	    continue;
+	case '%':
+	    groups = "aAbBCdeghGHIjJklmMNpPQsSuUVwWyYzZ";
+	    break;
+	case 'E':
+	    groups = "ECy";
+	    break;
+	default:		/* 'O' */
+	    groups = "deHIklmMSuwy";
+	    break;
+	}
+
+	/*
+	 * The character following a %, %E or %O.
+	 */
+
+	if ((ch < 0x80) && (ch != '\0') && (strchr(groups, (int) ch) != NULL)) {
+	    if (state == '%') {
+		APPEND_GROUP(ch);
+	    } else if (state == 'E') {
+		APPEND_GROUP(FMT_E | ch);
+		if (ch != 'E') {
+		    fmtPtr->needEra = 1;
+		}
+	    } else {
+		APPEND_GROUP(FMT_O | ch);
+	    }
+	    state = 0;
+	} else if ((state == '%') && ((ch == 'E') || (ch == 'O'))) {
+	    state = ch;
+	} else if ((state == '%') && (ch == '%')) {
+	    APPEND_LITERAL("%", 1);
+	    state = 0;
+	} else if ((state == '%') && (ch == 'n')) {
+	    APPEND_LITERAL("\n", 1);
+	    state = 0;
+	} else if ((state == '%') && (ch == 't')) {
+	    APPEND_LITERAL("\t", 1);
+	    state = 0;
+	} else {
+	    /*
+	     * An unknown format group is copied.
+	     */
+
+	    if (state == '%') {
+		APPEND_LITERAL("%", 1);
+	    } else if (state == 'E') {
+		APPEND_LITERAL("%E", 2);
+	    } else {
+		APPEND_LITERAL("%O", 2);
+	    }
+	    APPEND_LITERAL(p, n);
+	    state = 0;
+	}
+    }
+
+    /*
+     * A trailing % is kept; a trailing %E or %O is dropped.
+     */
+
+    if (state == '%') {
+	APPEND_LITERAL("%", 1);
+    }
+#undef APPEND_LITERAL
+#undef APPEND_GROUP
+
+    fmtPtr->refCount = 1;
+    fmtPtr->generation = dataPtr->generation;
+    fmtPtr->locale = ckalloc(lowerObj->length + 1);
+    memcpy(fmtPtr->locale, lowerObj->bytes, lowerObj->length + 1);
+    fmtPtr->localeItems = (Tcl_Obj **) ckalloc(LOC__END * sizeof(Tcl_Obj *));
+    for (i = 0; i < LOC__END; i++) {
+	fmtPtr->localeItems[i] = itemv[i];
+	Tcl_IncrRefCount(itemv[i]);
+    }
+    fmtPtr->changeover = changeover;
+    fmtPtr->text = ckalloc(Tcl_DStringLength(&text) + 1);
+    memcpy(fmtPtr->text, Tcl_DStringValue(&text),
+	    Tcl_DStringLength(&text) + 1);
+    Tcl_DStringFree(&text);
+    Tcl_DecrRefCount(dataObj);
+    Tcl_DecrRefCount(lowerObj);
+
+    /*
+     * Keep it in the format object.
+     */
+
+    TclGetString(formatObj);
+    TclFreeIntRep(formatObj);
+    formatObj->internalRep.twoPtrValue.ptr1 = fmtPtr;
+    formatObj->typePtr = &clockFormatType;
+    Tcl_DecrRefCount(formatObj);
+    return fmtPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetLocaleData --
+ *
+ *	Gets the strings of a locale that [clock format] and [clock scan]
+ *	need, from the Tcl procedure ::tcl::clock::GetFormatLocaleData, which
+ *	also replaces the locale-dependent composite format groups of a
+ *	format.
+ *
+ * Results:
+ *	Returns the list of the strings, with a reference that the caller must
+ *	release, and stores its elements and the Julian Day of the adoption of
+ *	the Gregorian calendar; or returns NULL with an error message in the
+ *	interpreter.
+ *
+ * Side effects:
+ *	May load the [clock] library and the locale.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetLocaleData(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *formatObj,		/* The format */
+    Tcl_Obj *localeObj,		/* The locale, in lower case */
+    Tcl_Obj ***itemvPtr,	/* Where to store the strings */
+    int *changeoverPtr)		/* Where to store the Julian Day */
+{
+    Tcl_Obj *dataObj, *cmd[3];
+    int itemc;
+
+    if (EnsureClockLibrary(dataPtr, interp) != TCL_OK) {
+	return NULL;
+    }
+    cmd[0] = dataPtr->literals[LIT_GETFORMATLOCALEDATA];
+    cmd[1] = formatObj;
+    cmd[2] = localeObj;
+    if (Tcl_EvalObjv(interp, 3, cmd, TCL_EVAL_GLOBAL) != TCL_OK) {
+	return NULL;
+    }
+    dataObj = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(dataObj);
+    Tcl_ResetResult(interp);
+    if (TclListObjGetElements(interp, dataObj, &itemc, itemvPtr) != TCL_OK) {
+	Tcl_DecrRefCount(dataObj);
+	return NULL;
+    }
+    if (itemc != LOC__END) {
+	Tcl_SetResult(interp, "malformed locale data for [clock]",
+		TCL_STATIC);
+	Tcl_DecrRefCount(dataObj);
+	return NULL;
+    }
+    if (TclGetIntFromObj(interp, (*itemvPtr)[LOC_GREGORIAN_CHANGE_DATE],
+	    changeoverPtr) != TCL_OK) {
+	Tcl_DecrRefCount(dataObj);
+	return NULL;
+    }
+    return dataObj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeClockFormat, FreeClockFormatInternalRep, DupClockFormatInternalRep --
+ *
+ *	FreeClockFormat releases a reference to a compiled format, and the
+ *	others manage the compiled form kept in a format object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A compiled format is freed when its last reference goes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeClockFormat(
+    ClockFormat *fmtPtr)	/* The compiled format */
+{
+    int i;
+
+    if (--fmtPtr->refCount > 0) {
+	return;
+    }
+    for (i = 0; i < LOC__END; i++) {
+	Tcl_DecrRefCount(fmtPtr->localeItems[i]);
+    }
+    ckfree((char *) fmtPtr->localeItems);
+    ckfree(fmtPtr->locale);
+    ckfree(fmtPtr->text);
+    ckfree((char *) fmtPtr);
+}
+
+static void
+FreeClockFormatInternalRep(
+    Tcl_Obj *objPtr)		/* Format object */
+{
+    FreeClockFormat(objPtr->internalRep.twoPtrValue.ptr1);
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupClockFormatInternalRep(
+    Tcl_Obj *srcPtr,		/* Format object to copy */
+    Tcl_Obj *copyPtr)		/* The copy */
+{
+    ClockFormat *fmtPtr = srcPtr->internalRep.twoPtrValue.ptr1;
+
+    fmtPtr->refCount++;
+    copyPtr->internalRep.twoPtrValue.ptr1 = fmtPtr;
+    copyPtr->typePtr = &clockFormatType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockScanObjCmd --
+ *
+ *	Scans a time given as a string, either in a given format or in free
+ *	form, and converts it to a count of seconds since the Posix Epoch.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Compiles the format into the internal representation of the format
+ *	object. May load the [clock] library, and set up time zones.
+ *
+ * This function implements the 'clock scan' Tcl command. Refer to the user
+ * documentation for details on what it does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockScanObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    ClockClientData *dataPtr = clientData;
+    Tcl_Obj **litPtr = dataPtr->literals;
+    Tcl_Obj *baseObj = NULL, *formatObj = NULL, *gmtObj = NULL;
+    Tcl_Obj *localeObj, *timezoneObj = NULL;
+    Tcl_WideInt base;
+    Tcl_Time now;
+    int gmtFlag = 0, result;
+    static const char *const options[] = { /* Command line options expected */
+	"-base",	"-format",	"-gmt",		"-locale",
+	"-timezone",	NULL };
+    enum optionInd {
+	CLOCK_SCAN_BASE,	CLOCK_SCAN_FORMAT,	CLOCK_SCAN_GMT,
+	CLOCK_SCAN_LOCALE,	CLOCK_SCAN_TIMEZONE
+    };
+    int optionIndex;		/* Index of an option. */
+    int saw = 0;		/* Flag == 1 if option was seen already. */
+    int i;
+
+    /*
+     * Args consist of a string followed by keyword-value pairs.
+     */
+
+    if (objc < 2 || (objc % 2) != 0) {
+	Tcl_WrongNumArgs(interp, 0, objv,
+		"clock scan string ?-base seconds? ?-format string? "
+		"?-gmt boolean? ?-locale LOCALE? ?-timezone ZONE?");
+	Tcl_SetErrorCode(interp, "CLOCK", "wrongNumArgs", NULL);
+	return TCL_ERROR;
+    }
+
+    /*
+     * Extract values for the keywords.
+     */
+
+    localeObj = litPtr[LIT_C];
+    for (i = 2; i < objc; i+=2) {
+	if (Tcl_GetIndexFromObj(NULL, objv[i], options, "switch", 0,
+		&optionIndex) != TCL_OK) {
+	    Tcl_AppendResult(interp, "bad switch \"", TclGetString(objv[i]),
+		    "\", must be -base, -format, -gmt, -locale or -timezone",
+		    NULL);
+	    Tcl_SetErrorCode(interp, "CLOCK", "badSwitch",
+		    Tcl_GetString(objv[i]), NULL);
+	    return TCL_ERROR;
+	}
+	switch (optionIndex) {
+	case CLOCK_SCAN_BASE:
+	    baseObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_FORMAT:
+	    formatObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_GMT:
+	    gmtObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_LOCALE:
+	    localeObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_TIMEZONE:
+	    timezoneObj = objv[i+1];
+	    break;
+	}
+	saw |= 1 << optionIndex;
+    }
+
+    /*
+     * Check options.
+     */
+
+    if ((saw & (1 << CLOCK_SCAN_GMT))
+	    && (saw & (1 << CLOCK_SCAN_TIMEZONE))) {
+	Tcl_SetObjResult(interp, litPtr[LIT_CANNOT_USE_GMT_AND_TIMEZONE]);
+	Tcl_SetErrorCode(interp, "CLOCK", "gmtWithTimezone", NULL);
+	return TCL_ERROR;
+    }
+    if (baseObj == NULL) {
+	Tcl_GetTime(&now);
+	base = (Tcl_WideInt) now.sec;
+    } else if (Tcl_GetWideIntFromObj(NULL, baseObj, &base) != TCL_OK) {
+	Tcl_AppendResult(interp, "expected integer but got \"",
+		TclGetString(baseObj), "\"", NULL);
+	return TCL_ERROR;
+    }
+    if ((gmtObj != NULL)
+	    && (Tcl_GetBooleanFromObj(interp, gmtObj, &gmtFlag) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if (gmtFlag) {
+	timezoneObj = litPtr[LIT_GMT];
+    } else if (timezoneObj == NULL) {
+	timezoneObj = GetSystemTimeZone(dataPtr, interp);
+	if (timezoneObj == NULL) {
+	    return TCL_ERROR;
+	}
+    }
+
+    Tcl_IncrRefCount(timezoneObj);
+    if (formatObj != NULL) {
+	result = ScanFormatted(dataPtr, interp, objv[1], formatObj,
+		localeObj, baseObj, base, timezoneObj);
+    } else if (saw & (1 << CLOCK_SCAN_LOCALE)) {
+	/*
+	 * Perhaps someday the free form scanner will be localized.
+	 */
+
+	Tcl_SetResult(interp, "legacy [clock scan] does not support -locale",
+		TCL_STATIC);
+	Tcl_SetErrorCode(interp, "CLOCK", "flagWithLegacyFormat", NULL);
+	result = TCL_ERROR;
+    } else {
+	result = FreeScan(dataPtr, interp, objv[1], baseObj, base,
+		timezoneObj);
+    }
+    Tcl_DecrRefCount(timezoneObj);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanFormatted --
+ *
+ *	Scans a time in a given format for [clock scan -format]. The fields
+ *	that the format lacks are taken from the base time, as far as the
+ *	fields that it has require.
+ *
+ * Results:
+ *	Returns a standard Tcl result, with the count of seconds in the
+ *	interpreter result.
+ *
+ * Side effects:
+ *	Compiles the format into the internal representation of the format
+ *	object. May set up time zones.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ScanFormatted(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *stringObj,		/* String to scan */
+    Tcl_Obj *formatObj,		/* The format */
+    Tcl_Obj *localeObj,		/* The locale */
+    Tcl_Obj *baseObj,		/* The base time as given, or NULL */
+    Tcl_WideInt base,		/* The base time */
+    Tcl_Obj *timezoneObj)	/* The time zone */
+{
+    Tcl_Obj **litPtr = dataPtr->literals;
+    Tcl_Obj *tzNameObj = NULL, *tzdata = NULL, *zonesObj, *keyObj;
+    ClockScan *scanPtr;
+    ClockScanToken *tokenPtr;
+    ClockScanMatch *matchPtr;
+    ClockScanMatcher matcher;
+    TclDateFields fields, baseFields;
+    Tcl_DString string, name;
+    const char *bytes;
+    const Tcl_UniChar *chars, *p;
+    Tcl_WideInt seconds = 0;
+    int values[SF__END], length, value, hour, secondOfDay, i;
+    int result = TCL_ERROR;
+
+    scanPtr = CompileClockScan(dataPtr, interp, formatObj, localeObj);
+    if (scanPtr == NULL) {
+	return TCL_ERROR;
+    }
+    scanPtr->refCount++;
+
+    /*
+     * Match the tokens of the format against the string.
+     */
+
+    bytes = TclGetStringFromObj(stringObj, &length);
+    Tcl_DStringInit(&string);
+    chars = Tcl_UtfToUniCharDString(bytes, length, &string);
+    length = Tcl_DStringLength(&string) / sizeof(Tcl_UniChar);
+    matcher.tokens = scanPtr->tokens;
+    matcher.numTokens = scanPtr->numTokens;
+    matcher.string = chars;
+    matcher.end = chars + length;
+    matcher.matches = (ClockScanMatch *)
+	    ckalloc(scanPtr->numTokens * sizeof(ClockScanMatch));
+    matcher.failed = ckalloc(scanPtr->numTokens * (length + 1));
+    memset(matcher.failed, 0, scanPtr->numTokens * (length + 1));
+    if (!MatchScanTokens(&matcher, 0, chars)) {
+	Tcl_SetResult(interp, "input string does not match supplied format",
+		TCL_STATIC);
+	Tcl_SetErrorCode(interp, "CLOCK", "badInputString", NULL);
+	goto done;
+    }
+
+    /*
+     * Get the values of the fields from what the tokens matched. A field
+     * given twice takes the later value.
+     */
+
+    for (i = 0, tokenPtr = scanPtr->tokens, matchPtr = matcher.matches;
+	    i < scanPtr->numTokens; i++, tokenPtr++, matchPtr++) {
+	p = matchPtr->start;
+	switch (tokenPtr->type) {
+	case SCAN_DIGITS:
+	    if (tokenPtr->field < 0) {
+		continue;
+	    }
+	    if (tokenPtr->field2 >= 0) {
+		values[tokenPtr->field] = 10 * (p[0] - '0') + (p[1] - '0');
+		values[tokenPtr->field2] = 10 * (p[2] - '0') + (p[3] - '0');
+		continue;
+	    }
+	    for (value = 0; p < matchPtr->start + matchPtr->length; p++) {
+		value = (value > (INT_MAX - 9) / 10)
+			? INT_MAX : (10 * value + (*p - '0'));
+	    }
+	    break;
+	case SCAN_NAME:
+	case SCAN_NUMERAL:
+	    if (tokenPtr->field < 0) {
+		continue;
+	    }
+	    value = matchPtr->value;
+	    break;
+	case SCAN_SIGNED:
+	    if (ScanWideInt(dataPtr, interp, p, matchPtr->length,
+		    &seconds) != TCL_OK) {
+		goto done;
+	    }
+	    continue;
+	case SCAN_STARDATE:
+	    if (ScanStarDate(dataPtr, interp, p, matchPtr->length,
+		    &seconds) != TCL_OK) {
+		goto done;
+	    }
+	    continue;
+	case SCAN_TZ:
+	    if (tzNameObj != NULL) {
+		Tcl_DecrRefCount(tzNameObj);
+		tzNameObj = NULL;
+	    }
+	    if ((*p == '+') || (*p == '-')) {
+		tzNameObj = Tcl_NewUnicodeObj(p, matchPtr->length);
+		Tcl_IncrRefCount(tzNameObj);
+		continue;
+	    }
+
+	    /*
+	     * A legacy time zone name, such as EST.
+	     */
+
+	    Tcl_DStringInit(&name);
+	    Tcl_UniCharToUtfDString(p, matchPtr->length, &name);
+	    Tcl_UtfToLower(Tcl_DStringValue(&name));
+	    keyObj = Tcl_NewStringObj(Tcl_DStringValue(&name), -1);
+	    Tcl_DStringFree(&name);
+	    Tcl_IncrRefCount(keyObj);
+	    zonesObj = Tcl_ObjGetVar2(interp, litPtr[LIT_LEGACYTIMEZONE],
+		    NULL, TCL_GLOBAL_ONLY|TCL_LEAVE_ERR_MSG);
+	    if ((zonesObj == NULL) || (Tcl_DictObjGet(interp, zonesObj,
+		    keyObj, &tzNameObj) != TCL_OK)) {
+		tzNameObj = NULL;
+		Tcl_DecrRefCount(keyObj);
+		goto done;
+	    }
+	    if (tzNameObj == NULL) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"time zone \"%s\" not found", TclGetString(keyObj)));
+		Tcl_SetErrorCode(interp, "CLOCK", "badTZName",
+			TclGetString(keyObj), NULL);
+		Tcl_DecrRefCount(keyObj);
+		goto done;
+	    }
+	    Tcl_IncrRefCount(tzNameObj);
+	    Tcl_DecrRefCount(keyObj);
+	    continue;
+	default:
+	    continue;
+	}
+	if (tokenPtr->field == SF_DAYOFWEEK) {
+	    if (value == 0) {
+		value = 7;
+	    } else if (value > 7) {
+		Tcl_SetResult(interp, "day of week is greater than 7",
+			TCL_STATIC);
+		Tcl_SetErrorCode(interp, "CLOCK", "badDayOfWeek", NULL);
+		goto done;
+	    }
+	}
+	values[tokenPtr->field] = value;
+    }
+
+    /*
+     * A count of seconds, or a StarDate, is the result.
+     */
+
+    if (scanPtr->dateAction == DATE_SECONDS) {
+	Tcl_SetObjResult(interp, Tcl_NewWideIntObj(seconds));
+	result = TCL_OK;
+	goto done;
+    }
+
+    /*
+     * Get the data for time changes in the zone that the string gave, or
+     * else in the given zone, and the base time if the date needs it.
+     */
+
+    tzdata = GetTimeZoneData(dataPtr, interp,
+	    (tzNameObj != NULL) ? tzNameObj : timezoneObj);
+    if (tzdata == NULL) {
+	goto done;
+    }
+    Tcl_IncrRefCount(tzdata);
+    if ((scanPtr->dateAction >= DATE_MONTH_DAY)
+	    && (GetBaseFields(dataPtr, interp, baseObj, base, tzdata,
+		scanPtr->changeover, &baseFields) != TCL_OK)) {
+	goto done;
+    }
+
+    /*
+     * Find the year, and the era, that the date is in...
+     */
+
+    switch (scanPtr->dateAction) {
+    case DATE_JULIANDAY:
+	fields.julianDay = values[SF_JULIANDAY];
+	break;
+    case DATE_ERA_CENTURY_MONTH_DAY:
+    case DATE_ERA_CENTURY_DAY:
+	fields.era = values[SF_ERA] ? BCE : CE;
+	fields.year = 100 * values[SF_CENTURY] + values[SF_YEAROFCENTURY];
+	break;
+    case DATE_CENTURY_MONTH_DAY:
+    case DATE_CENTURY_DAY:
+	fields.era = CE;
+	fields.year = 100 * values[SF_CENTURY] + values[SF_YEAROFCENTURY];
+	break;
+    case DATE_ISO8601_CENTURY_WEEK_DAY:
+	fields.era = CE;
+	fields.iso8601Year = 100 * values[SF_ISO8601CENTURY]
+		+ values[SF_ISO8601YEAROFCENTURY];
+	break;
+    case DATE_YEAR_MONTH_DAY:
+    case DATE_YEAR_DAY:
+	fields.era = CE;
+	fields.year = values[SF_YEAROFCENTURY]
+		+ ((values[SF_YEAROFCENTURY] <= 37) ? 2000 : 1900);
+	break;
+    case DATE_ISO8601_YEAR_WEEK_DAY:
+	fields.era = CE;
+	fields.iso8601Year = values[SF_ISO8601YEAROFCENTURY]
+		+ ((values[SF_ISO8601YEAROFCENTURY] <= 37) ? 2000 : 1900);
+	break;
+    case DATE_MONTH_DAY:
+    case DATE_DAY_OF_YEAR:
+	fields.era = baseFields.era;
+	fields.year = baseFields.year;
+	break;
+    case DATE_WEEK_DAY:
+	fields.era = CE;
+	fields.iso8601Year = baseFields.iso8601Year;
+	break;
+    case DATE_DAY_OF_MONTH:
+	fields.era = baseFields.era;
+	fields.year = baseFields.year;
+	values[SF_MONTH] = baseFields.month;
+	break;
+    case DATE_DAY_OF_WEEK:
+	fields.era = CE;
+	fields.iso8601Year = baseFields.iso8601Year;
+	values[SF_ISO8601WEEK] = baseFields.iso8601Week;
+	break;
+    default:			/* DATE_BASE */
+	fields.julianDay = baseFields.julianDay;
+	break;
+    }
+
+    /*
+     * ... and the day within it.
+     */
+
+    switch (scanPtr->dateAction) {
+    case DATE_ERA_CENTURY_MONTH_DAY:
+    case DATE_CENTURY_MONTH_DAY:
+    case DATE_YEAR_MONTH_DAY:
+    case DATE_MONTH_DAY:
+    case DATE_DAY_OF_MONTH:
+	fields.month = values[SF_MONTH];
+	fields.dayOfMonth = values[SF_DAYOFMONTH];
+	GetJulianDayFromEraYearMonthDay(&fields, scanPtr->changeover);
+	break;
+    case DATE_ERA_CENTURY_DAY:
+    case DATE_CENTURY_DAY:
+    case DATE_YEAR_DAY:
+    case DATE_DAY_OF_YEAR:
+	fields.dayOfYear = values[SF_DAYOFYEAR];
+	GetJulianDayFromEraYearDay(&fields, scanPtr->changeover);
+	break;
+    case DATE_ISO8601_CENTURY_WEEK_DAY:
+    case DATE_ISO8601_YEAR_WEEK_DAY:
+    case DATE_WEEK_DAY:
+    case DATE_DAY_OF_WEEK:
+	fields.iso8601Week = values[SF_ISO8601WEEK];
+	fields.dayOfWeek = values[SF_DAYOFWEEK];
+	GetJulianDayFromEraYearWeekDay(&fields, scanPtr->changeover);
+	break;
+    }
+
+    /*
+     * Find the time of day. On a 12-hour clock, 12 is the first hour.
+     */
+
+    hour = 0;
+    switch (scanPtr->timeAction) {
+    case TIME_HMS_AMPM:
+    case TIME_HM_AMPM:
+    case TIME_H_AMPM:
+	hour = values[SF_HOURAMPM];
+	if (hour == 12) {
+	    hour = 0;
+	}
+	if (values[SF_AMPM]) {
+	    hour += 12;
+	}
+	break;
+    case TIME_HMS:
+    case TIME_HM:
+    case TIME_H:
+	hour = values[SF_HOUR];
+	break;
+    }
+    secondOfDay = 0;
+    switch (scanPtr->timeAction) {
+    case TIME_HMS_AMPM:
+    case TIME_HMS:
+	secondOfDay = values[SF_SECOND];
+	/* FALLTHRU */
+    case TIME_HM_AMPM:
+    case TIME_HM:
+	secondOfDay += 60 * values[SF_MINUTE];
+	/* FALLTHRU */
+    case TIME_H_AMPM:
+    case TIME_H:
+	secondOfDay += 3600 * hour;
+	break;
+    }
+
+    /*
+     * Convert the local time to UTC.
+     */
+
+    if (fields.julianDay > JDAY_MAX_SCAN) {
+	Tcl_SetResult(interp, "requested date too large to represent",
+		TCL_STATIC);
+	Tcl_SetErrorCode(interp, "CLOCK", "dateTooLarge", NULL);
+	goto done;
+    }
+    fields.localSeconds = (Tcl_WideInt) fields.julianDay * SECONDS_PER_DAY
+	    - JULIAN_SEC_POSIX_EPOCH + secondOfDay;
+    if (ConvertLocalToUTC(interp, &fields, tzdata,
+	    scanPtr->changeover) != TCL_OK) {
+	goto done;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(fields.seconds));
+    result = TCL_OK;
+
+  done:
+    ckfree((char *) matcher.matches);
+    ckfree(matcher.failed);
+    Tcl_DStringFree(&string);
+    if (tzNameObj != NULL) {
+	Tcl_DecrRefCount(tzNameObj);
+    }
+    if (tzdata != NULL) {
+	Tcl_DecrRefCount(tzdata);
+    }
+    FreeClockScan(scanPtr);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeScan --
+ *
+ *	Scans a time in free form, for [clock scan] without -format, with the
+ *	parser in tclDate.c (::tcl::clock::Oldscan).
+ *
+ * Results:
+ *	Returns a standard Tcl result, with the count of seconds in the
+ *	interpreter result.
+ *
+ * Side effects:
+ *	May set up time zones.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define FREESCAN_CHANGEOVER	2361222	/* Gregorian changeover of the free
+					 * form scanner: 14 September 1752 */
+
+static int
+FreeScan(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *stringObj,		/* String to scan */
+    Tcl_Obj *baseObj,		/* The base time as given, or NULL */
+    Tcl_WideInt base,		/* The base time */
+    Tcl_Obj *timezoneObj)	/* The time zone */
+{
+    static const char *const relUnits[] = {"months", "days", "seconds"};
+    static const char *const ordinalUnits[] = {"years", "months"};
+    Tcl_Obj **litPtr = dataPtr->literals;
+    Tcl_Obj *tzdata, *cmd[5], **partv, **elemv;
+    TclDateFields fields, date2;
+    Tcl_WideInt seconds;
+    char buf[TCL_INTEGER_SPACE];
+    int partc, elemc, counts[6], parsed[6][3], secondOfDay, year;
+    int monthDiff, i, j, result = TCL_ERROR;
+    enum {
+	PARSE_DATE,	PARSE_TIME,	PARSE_ZONE,	PARSE_REL,
+	PARSE_WEEKDAY,	PARSE_ORDINALMONTH
+    };
+
+    /*
+     * Take the base time apart, for the parser to use as defaults.
+     */
+
+    tzdata = GetTimeZoneData(dataPtr, interp, timezoneObj);
+    if (tzdata == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_IncrRefCount(tzdata);
+    Tcl_IncrRefCount(timezoneObj);
+    if (GetBaseFields(dataPtr, interp, baseObj, base, tzdata,
+	    FREESCAN_CHANGEOVER, &fields) != TCL_OK) {
+	goto done;
+    }
+    secondOfDay = (int) (fields.localSeconds % SECONDS_PER_DAY);
+    if (secondOfDay < 0) {
+	secondOfDay += SECONDS_PER_DAY;
+    }
+
+    /*
+     * Parse the string into a list of the date, the time, the time zone, the
+     * relative months, days and seconds, the relative weekday and the
+     * ordinal month, each of them empty if the string lacks it.
+     */
+
+    cmd[0] = litPtr[LIT_OLDSCAN];
+    cmd[1] = stringObj;
+    cmd[2] = Tcl_NewIntObj(fields.year);
+    cmd[3] = Tcl_NewIntObj(fields.month);
+    cmd[4] = Tcl_NewIntObj(fields.dayOfMonth);
+    for (i = 0; i < 5; i++) {
+	Tcl_IncrRefCount(cmd[i]);
+    }
+    result = TclClockOldscanObjCmd(NULL, interp, 5, cmd);
+    for (i = 0; i < 5; i++) {
+	Tcl_DecrRefCount(cmd[i]);
+    }
+    if (result != TCL_OK) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"unable to convert date-time string \"%s\": %s",
+		TclGetString(stringObj),
+		TclGetString(Tcl_GetObjResult(interp))));
+	goto done;
+    }
+    result = TCL_ERROR;
+    if ((TclListObjGetElements(interp, Tcl_GetObjResult(interp), &partc,
+	    &partv) != TCL_OK) || (partc != 6)) {
+	goto done;
+    }
+    for (i = 0; i < 6; i++) {
+	if (TclListObjGetElements(interp, partv[i], &elemc,
+		&elemv) != TCL_OK) {
+	    goto done;
+	}
+	counts[i] = elemc;
+	for (j = 0; (j < elemc) && (j < 3); j++) {
+	    if (TclGetIntFromObj(interp, elemv[j], &parsed[i][j]) != TCL_OK) {
+		goto done;
+	    }
+	}
+    }
+
+    /*
+     * A date given in the string is at midnight unless a time is given too.
+     */
+
+    if (counts[PARSE_DATE] > 0) {
+	year = parsed[PARSE_DATE][0];
+	if (year < 100) {
+	    year += (year >= 39) ? 1900 : 2000;
+	}
+	fields.era = CE;
+	fields.year = year;
+	fields.month = parsed[PARSE_DATE][1];
+	fields.dayOfMonth = parsed[PARSE_DATE][2];
+	if (counts[PARSE_TIME] == 0) {
+	    counts[PARSE_TIME] = 1;
+	    parsed[PARSE_TIME][0] = 0;
+	}
+    }
+
+    /*
+     * A time zone given in the string is minutes east of Greenwich and a
+     * Daylight Saving Time flag; it becomes a zone of +hhmm.
+     */
+
+    if (counts[PARSE_ZONE] > 0) {
+	FormatNumericTimeZone(60 * parsed[PARSE_ZONE][0]
+		+ 3600 * parsed[PARSE_ZONE][1], buf);
+	Tcl_DecrRefCount(timezoneObj);
+	timezoneObj = Tcl_NewStringObj(buf, -1);
+	Tcl_IncrRefCount(timezoneObj);
+	Tcl_DecrRefCount(tzdata);
+	tzdata = GetTimeZoneData(dataPtr, interp, timezoneObj);
+	if (tzdata == NULL) {
+	    goto done;
+	}
+	Tcl_IncrRefCount(tzdata);
+    }
+
+    /*
+     * Assemble the date, the time and the zone into seconds from the epoch.
+     */
+
+    GetJulianDayFromEraYearMonthDay(&fields, FREESCAN_CHANGEOVER);
+    if (counts[PARSE_TIME] > 0) {
+	secondOfDay = parsed[PARSE_TIME][0];
+    } else if ((counts[PARSE_WEEKDAY] > 0)
+	    || (counts[PARSE_ORDINALMONTH] > 0)
+	    || ((counts[PARSE_REL] > 0) && ((parsed[PARSE_REL][0] != 0)
+		|| (parsed[PARSE_REL][1] != 0)))) {
+	secondOfDay = 0;
+    }
+    fields.localSeconds = (Tcl_WideInt) fields.julianDay * SECONDS_PER_DAY
+	    - JULIAN_SEC_POSIX_EPOCH + secondOfDay;
+    if (ConvertLocalToUTC(interp, &fields, tzdata,
+	    FREESCAN_CHANGEOVER) != TCL_OK) {
+	goto done;
+    }
+    seconds = fields.seconds;
+
+    /*
+     * Relative time.
+     */
+
+    if ((counts[PARSE_REL] > 0) && (AddRelativeTime(dataPtr, interp,
+	    &seconds, 3, parsed[PARSE_REL], relUnits,
+	    timezoneObj) != TCL_OK)) {
+	goto done;
+    }
+
+    /*
+     * Relative weekday: the nth such weekday after the date, or before it
+     * if n is negative, at the same time of day.
+     */
+
+    if (counts[PARSE_WEEKDAY] > 0) {
+	if (GetBaseFields(dataPtr, interp, NULL, seconds, tzdata,
+		FREESCAN_CHANGEOVER, &date2) != TCL_OK) {
+	    goto done;
+	}
+	date2.julianDay = WeekdayOnOrBefore(parsed[PARSE_WEEKDAY][1],
+		date2.julianDay + 6) + 7 * parsed[PARSE_WEEKDAY][0];
+	if (parsed[PARSE_WEEKDAY][0] > 0) {
+	    date2.julianDay -= 7;
+	}
+	date2.localSeconds = (Tcl_WideInt) date2.julianDay * SECONDS_PER_DAY
+		- JULIAN_SEC_POSIX_EPOCH + secondOfDay;
+	if (ConvertLocalToUTC(interp, &date2, tzdata,
+		FREESCAN_CHANGEOVER) != TCL_OK) {
+	    goto done;
+	}
+	seconds = date2.seconds;
+    }
+
+    /*
+     * Ordinal month: the nth such month after the date, or before it if n is
+     * negative.
+     */
+
+    if (counts[PARSE_ORDINALMONTH] > 0) {
+	int ordinal[2];
+
+	ordinal[0] = parsed[PARSE_ORDINALMONTH][0];
+	if (ordinal[0] > 0) {
+	    monthDiff = parsed[PARSE_ORDINALMONTH][1] - fields.month;
+	    if (monthDiff <= 0) {
+		monthDiff += 12;
+	    }
+	    ordinal[0]--;
+	} else {
+	    monthDiff = fields.month - parsed[PARSE_ORDINALMONTH][1];
+	    if (monthDiff >= 0) {
+		monthDiff -= 12;
+	    }
+	    ordinal[0]++;
+	}
+	ordinal[1] = monthDiff;
+	if (AddRelativeTime(dataPtr, interp, &seconds, 2, ordinal,
+		ordinalUnits, timezoneObj) != TCL_OK) {
+	    goto done;
+	}
+    }
+
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(seconds));
+    result = TCL_OK;
+
+  done:
+    Tcl_DecrRefCount(timezoneObj);
+    if (tzdata != NULL) {
+	Tcl_DecrRefCount(tzdata);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetBaseFields --
+ *
+ *	Takes apart a time, the base time of [clock scan], in a time zone.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Stores the fields of the local time, except for the name of the zone.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetBaseFields(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *baseObj,		/* The time as given, or NULL */
+    Tcl_WideInt base,		/* The time */
+    Tcl_Obj *tzdata,		/* Time zone data */
+    int changeover,		/* Julian Day of the Gregorian transition */
+    TclDateFields *fields)	/* Where to store the fields */
+{
+    /*
+     * The time could be an unsigned number that overflowed.
+     */
+
+    if ((baseObj != NULL) && (baseObj->typePtr == &tclBignumType)) {
+	Tcl_SetObjResult(interp,
+		dataPtr->literals[LIT_INTEGER_VALUE_TOO_LARGE]);
+	return TCL_ERROR;
+    }
+    fields->seconds = base;
+    if (ConvertUTCToLocal(dataPtr, interp, fields, tzdata,
+	    changeover) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    Tcl_DecrRefCount(fields->tzName);
+    fields->tzName = NULL;
+    fields->julianDay = (int) ((fields->localSeconds + JULIAN_SEC_POSIX_EPOCH)
+	    / SECONDS_PER_DAY);
+    GetGregorianEraYearDay(fields, changeover);
+    GetMonthDay(fields);
+    GetYearWeekDay(fields, changeover);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddRelativeTime --
+ *
+ *	Adds counts of units of time to a time with [clock add], in a time
+ *	zone, for the free form scanner.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Stores the new time.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AddRelativeTime(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_WideInt *secondsPtr,	/* The time, and where to store the sum */
+    int numUnits,		/* Number of units */
+    const int *counts,		/* Count of each unit to add */
+    const char *const *units,	/* Name of each unit */
+    Tcl_Obj *timezoneObj)	/* The time zone */
+{
+    Tcl_Obj *cmd[12];
+    int objc = 0, i, result;
+
+    cmd[objc++] = dataPtr->literals[LIT_ADD];
+    cmd[objc++] = Tcl_NewWideIntObj(*secondsPtr);
+    for (i = 0; i < numUnits; i++) {
+	cmd[objc++] = Tcl_NewIntObj(counts[i]);
+	cmd[objc++] = Tcl_NewStringObj(units[i], -1);
+    }
+    cmd[objc++] = Tcl_NewStringObj("-timezone", -1);
+    cmd[objc++] = timezoneObj;
+    cmd[objc++] = Tcl_NewStringObj("-locale", -1);
+    cmd[objc++] = dataPtr->literals[LIT_C];
+    for (i = 0; i < objc; i++) {
+	Tcl_IncrRefCount(cmd[i]);
+    }
+    result = Tcl_EvalObjv(interp, objc, cmd, TCL_EVAL_GLOBAL);
+    for (i = 0; i < objc; i++) {
+	Tcl_DecrRefCount(cmd[i]);
+    }
+    if (result != TCL_OK) {
+	return TCL_ERROR;
+    }
+    return Tcl_GetWideIntFromObj(interp, Tcl_GetObjResult(interp),
+	    secondsPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanWideInt, ScanStarDate --
+ *
+ *	ScanWideInt converts the text of a signed count of seconds (%s) to an
+ *	integer. ScanStarDate converts the text of a StarDate (%Q), its sign,
+ *	digits, point and last digit, to a count of seconds.
+ *
+ * Results:
+ *	Return a standard Tcl result; an error if the value is too large.
+ *
+ * Side effects:
+ *	Store the value.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ScanWideInt(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    const Tcl_UniChar *p,	/* The text */
+    int length,			/* Its length in characters */
+    Tcl_WideInt *valuePtr)	/* Where to store the value */
+{
+    const Tcl_UniChar *end = p + length;
+    Tcl_WideUInt value = 0, limit = (Tcl_WideUInt) 1 << 63;
+    int negative = (*p == '-'), digit;
+
+    if ((*p == '-') || (*p == '+')) {
+	p++;
+    }
+    if (!negative) {
+	limit--;
+    }
+    for (; p < end; p++) {
+	digit = *p - '0';
+	if (value > (limit - digit) / 10) {
+	    Tcl_SetObjResult(interp,
+		    dataPtr->literals[LIT_INTEGER_VALUE_TOO_LARGE]);
+	    Tcl_SetErrorCode(interp, "CLOCK", "integervalueTooLarge", NULL);
+	    return TCL_ERROR;
+	}
+	value = 10 * value + digit;
+    }
+    if (negative) {
+	value = ~value + 1;
+    }
+    *valuePtr = (Tcl_WideInt) value;
+    return TCL_OK;
+}
+
+#define STARDATE_MAX_YEARS	5000000	/* Bound on the years of scanned
+					 * StarDates, so that their Julian
+					 * Days fit in an int. */
+
+static int
+ScanStarDate(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    const Tcl_UniChar *p,	/* The text */
+    int length,			/* Its length in characters */
+    Tcl_WideInt *secondsPtr)	/* Where to store the time */
+{
+    TclDateFields fields;
+    Tcl_WideInt year;
+    int fractYear, fractDay;
+
+    /*
+     * The last three digits before the point are the thousandths of the
+     * year, and the digit after it is the tenths of the day.
+     */
+
+    if (ScanWideInt(dataPtr, interp, p, length - 5, &year) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    p += length - 5;
+    fractYear = 100 * (p[0] - '0') + 10 * (p[1] - '0') + (p[2] - '0');
+    fractDay = p[4] - '0';
+
+    /*
+     * Keep the Julian Day within the range of an int.
+     */
+
+    if ((year < -STARDATE_MAX_YEARS) || (year > STARDATE_MAX_YEARS)) {
+	Tcl_SetResult(interp, "requested date too large to represent",
+		TCL_STATIC);
+	Tcl_SetErrorCode(interp, "CLOCK", "dateTooLarge", NULL);
+	return TCL_ERROR;
+    }
+    fields.era = CE;
+    fields.year = (int) year + RODDENBERRY;
+    fields.gregorian = 1;
+    fields.dayOfYear = fractYear
+	    * (IsGregorianLeapYear(&fields) ? 366 : 365) / 1000 + 1;
+    GetJulianDayFromEraYearDay(&fields, INT_MIN);
+    *secondsPtr = (Tcl_WideInt) fields.julianDay * SECONDS_PER_DAY
+	    - JULIAN_SEC_POSIX_EPOCH + fractDay * (SECONDS_PER_DAY / 10);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileClockScan --
+ *
+ *	Gets the compiled form of a [clock scan] format in a locale, from the
+ *	internal representation of the format object if it was compiled for
+ *	that locale since [clock]'s caches were last cleared, or else by
+ *	compiling it with the strings of the locale from GetLocaleData.
+ *
+ * Results:
+ *	Returns the compiled format, or NULL with an error message in the
+ *	interpreter if the strings of the locale could not be obtained.
+ *
+ * Side effects:
+ *	Changes the internal representation of the format object.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClockScan *
+CompileClockScan(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *formatObj,		/* The format */
+    Tcl_Obj *localeObj)		/* The locale */
+{
+    static const char *const eraNames[] = {
+	"b.c.e.", "c.e.", "b.c.", "a.d."
+    };
+    ClockScan *scanPtr;
+    ClockScanToken *tokenPtr;
+    ClockScanTable *tablePtr;
+    Tcl_Obj *lowerObj, *dataObj, **itemv, **listv, *symbolObj;
+    const char *p, *end, *name;
+    int length, listc, state, n, m, changeover, fieldCount, i;
+    Tcl_UniChar ch, next;
+
+    if (formatObj->typePtr == &clockScanType) {
+	scanPtr = formatObj->internalRep.twoPtrValue.ptr1;
+	if ((scanPtr->generation == dataPtr->generation)
+		&& (strcmp(scanPtr->locale, TclGetString(localeObj)) == 0)) {
+	    return scanPtr;
+	}
+    }
+
+    /*
+     * The locale is not case sensitive.
+     */
+
+    p = TclGetStringFromObj(localeObj, &length);
+    lowerObj = Tcl_NewStringObj(p, length);
+    lowerObj->length = Tcl_UtfToLower(lowerObj->bytes);
+    Tcl_IncrRefCount(lowerObj);
+    if (formatObj->typePtr == &clockScanType) {
+	scanPtr = formatObj->internalRep.twoPtrValue.ptr1;
+	if ((scanPtr->generation == dataPtr->generation)
+		&& (strcmp(scanPtr->locale, lowerObj->bytes) == 0)) {
+	    Tcl_DecrRefCount(lowerObj);
+	    return scanPtr;
+	}
+    }
+
+    Tcl_IncrRefCount(formatObj);
+    dataObj = GetLocaleData(dataPtr, interp, formatObj, lowerObj, &itemv,
+	    &changeover);
+    if (dataObj == NULL) {
+	Tcl_DecrRefCount(formatObj);
+	Tcl_DecrRefCount(lowerObj);
+	return NULL;
+    }
+
+    /*
+     * Split the localized format into tokens. There are at most as many
+     * tokens as there are bytes in the format, plus the white space that may
+     * lead and trail the string.
+     */
+
+    p = TclGetStringFromObj(itemv[LOC_FORMAT], &length);
+    end = p + length;
+    scanPtr = (ClockScan *) ckalloc(sizeof(ClockScan)
+	    + (length + 1) * sizeof(ClockScanToken));
+    scanPtr->refCount = 1;
+    scanPtr->locale = NULL;
+    scanPtr->numTokens = 0;
+    memset(scanPtr->fieldPos, 0, sizeof(scanPtr->fieldPos));
+    fieldCount = 0;
+
+#define ADD_TOKEN(t, lo, hi) \
+    tokenPtr = scanPtr->tokens + scanPtr->numTokens++;			\
+    tokenPtr->type = (t);						\
+    tokenPtr->field = tokenPtr->field2 = -1;				\
+    tokenPtr->min = (lo);						\
+    tokenPtr->max = (hi);						\
+    tokenPtr->tablePtr = NULL
+#define SET_FIELD(f) \
+    tokenPtr->field = (f);						\
+    scanPtr->fieldPos[f] = ++fieldCount
+#define ADD_NUMBER(lo, hi, f) \
+    ADD_TOKEN(SCAN_DIGITS, (lo), (hi));					\
+    SET_FIELD(f)
+
+    ADD_TOKEN(SCAN_SPACE, 0, 0);
+    state = 0;
+    for (; p < end; p += n) {
+	n = TclUtfToUniChar(p, &ch);
+
+	/*
+	 * A run of white space in the format is the same as one space.
+	 */
+
+	if (Tcl_UniCharIsSpace(ch)) {
+	    while (p + n < end) {
+		m = TclUtfToUniChar(p + n, &next);
+		if (!Tcl_UniCharIsSpace(next)) {
+		    break;
+		}
+		n += m;
+	    }
+	    ch = ' ';
+	}
+
+	switch (state) {
+	case 0:
+	    if (ch == '%') {
+		state = '%';
+	    } else if (ch == ' ') {
+		ADD_TOKEN(SCAN_SPACE, 1, 0);
+	    } else {
+		ADD_TOKEN(SCAN_LITERAL, ch, ch);
+	    }
+	    continue;
+
+	case '%':
+	    state = 0;
+	    switch (ch) {
+	    case ' ':			/* Optional white space */
+		ADD_TOKEN(SCAN_SPACE, 0, 0);
+		break;
+	    case 'a':
+	    case 'A':			/* Day of week, in words */
+		ADD_TOKEN(SCAN_NAME, 0, 0);
+		SET_FIELD(SF_DAYOFWEEK);
+		if (AddDayOrMonthNames(interp, tokenPtr,
+			itemv[LOC_DAYS_OF_WEEK_ABBREV],
+			itemv[LOC_DAYS_OF_WEEK_FULL], 1) != TCL_OK) {
+		    goto error;
+		}
+		break;
+	    case 'b':
+	    case 'B':
+	    case 'h':			/* Month, in words */
+		ADD_TOKEN(SCAN_NAME, 0, 0);
+		SET_FIELD(SF_MONTH);
+		if (AddDayOrMonthNames(interp, tokenPtr,
+			itemv[LOC_MONTHS_ABBREV], itemv[LOC_MONTHS_FULL],
+			0) != TCL_OK) {
+		    goto error;
+		}
+		break;
+	    case 'C':			/* Century */
+		ADD_NUMBER(1, 2, SF_CENTURY);
+		break;
+	    case 'd':
+	    case 'e':			/* Day of month */
+		ADD_NUMBER(1, 2, SF_DAYOFMONTH);
+		break;
+	    case 'g':			/* Two-digit ISO8601 year */
+		ADD_NUMBER(2, 2, SF_ISO8601YEAROFCENTURY);
+		break;
+	    case 'G':			/* Four-digit ISO8601 year */
+		ADD_NUMBER(4, 4, SF_ISO8601CENTURY);
+		tokenPtr->field2 = SF_ISO8601YEAROFCENTURY;
+		scanPtr->fieldPos[SF_ISO8601YEAROFCENTURY] = ++fieldCount;
+		break;
+	    case 'H':
+	    case 'k':			/* Hour of the day (0-23) */
+		ADD_NUMBER(1, 2, SF_HOUR);
+		break;
+	    case 'I':
+	    case 'l':			/* Hour (1-12) */
+		ADD_NUMBER(1, 2, SF_HOURAMPM);
+		break;
+	    case 'j':			/* Day of the year */
+		ADD_NUMBER(1, 3, SF_DAYOFYEAR);
+		break;
+	    case 'J':			/* Julian Day Number */
+		ADD_NUMBER(1, INT_MAX, SF_JULIANDAY);
+		break;
+	    case 'm':
+	    case 'N':			/* Month number */
+		ADD_NUMBER(1, 2, SF_MONTH);
+		break;
+	    case 'M':			/* Minute of the hour */
+		ADD_NUMBER(1, 2, SF_MINUTE);
+		break;
+	    case 'n':
+		ADD_TOKEN(SCAN_LITERAL, '\n', '\n');
+		break;
+	    case 'p':
+	    case 'P':			/* AM or PM */
+		ADD_TOKEN(SCAN_NAME, 0, 0);
+		SET_FIELD(SF_AMPM);
+		tokenPtr->tablePtr = tablePtr = NewScanTable(1, 2);
+		name = TclGetStringFromObj(itemv[LOC_AM], &m);
+		AddScanName(tablePtr, name, m, 0);
+		name = TclGetStringFromObj(itemv[LOC_PM], &m);
+		AddScanName(tablePtr, name, m, 1);
+		break;
+	    case 'Q':			/* StarDate */
+		ADD_TOKEN(SCAN_STARDATE, 0, 0);
+		SET_FIELD(SF_SECONDS);
+		break;
+	    case 's':			/* Seconds from the Posix Epoch */
+		ADD_TOKEN(SCAN_SIGNED, 1, INT_MAX);
+		SET_FIELD(SF_SECONDS);
+		break;
+	    case 'S':			/* Second of the minute */
+		ADD_NUMBER(1, 2, SF_SECOND);
+		break;
+	    case 't':
+		ADD_TOKEN(SCAN_LITERAL, '\t', '\t');
+		break;
+	    case 'u':
+	    case 'w':			/* Day of the week */
+		ADD_NUMBER(1, 1, SF_DAYOFWEEK);
+		break;
+	    case 'U':
+	    case 'W':			/* Week of the year, which is ignored */
+		ADD_TOKEN(SCAN_DIGITS, 1, 2);
+		break;
+	    case 'V':			/* ISO8601 week */
+		ADD_NUMBER(1, 2, SF_ISO8601WEEK);
+		break;
+	    case 'y':			/* Two-digit year */
+		ADD_NUMBER(1, 2, SF_YEAROFCENTURY);
+		break;
+	    case 'Y':			/* Four-digit year */
+		ADD_NUMBER(4, 4, SF_CENTURY);
+		tokenPtr->field2 = SF_YEAROFCENTURY;
+		scanPtr->fieldPos[SF_YEAROFCENTURY] = ++fieldCount;
+		break;
+	    case 'z':
+	    case 'Z':			/* Time zone */
+		ADD_TOKEN(SCAN_TZ, 0, 0);
+		SET_FIELD(SF_TZNAME);
+		break;
+	    case '%':
+		ADD_TOKEN(SCAN_LITERAL, '%', '%');
+		break;
+	    case 'E':
+	    case 'O':
+		state = ch;
+		break;
+	    default:			/* An unknown group matches itself */
+		ADD_TOKEN(SCAN_LITERAL, '%', '%');
+		ADD_TOKEN(SCAN_LITERAL, ch, ch);
+		break;
+	    }
+	    continue;
+
+	case 'E':
+	    state = 0;
+	    switch (ch) {
+	    case 'C':			/* Locale-dependent era, ignored */
+		if (TclListObjGetElements(interp, itemv[LOC_LOCALE_ERAS],
+			&listc, &listv) != TCL_OK) {
+		    goto error;
+		}
+		ADD_TOKEN(SCAN_NAME, 0, 0);
+		tokenPtr->tablePtr = tablePtr = NewScanTable(1, listc);
+		for (i = 0; i < listc; i++) {
+		    if (Tcl_ListObjIndex(interp, listv[i], 1,
+			    &symbolObj) != TCL_OK) {
+			goto error;
+		    }
+		    name = "";
+		    m = 0;
+		    if (symbolObj != NULL) {
+			name = TclGetStringFromObj(symbolObj, &m);
+		    }
+		    AddScanName(tablePtr, name, m, 0);
+		}
+		break;
+	    case 'E':			/* Era, BCE or CE */
+		ADD_TOKEN(SCAN_NAME, 0, 0);
+		SET_FIELD(SF_ERA);
+		tokenPtr->tablePtr = tablePtr = NewScanTable(1, 6);
+		name = TclGetStringFromObj(itemv[LOC_BCE], &m);
+		AddScanName(tablePtr, name, m, BCE);
+		name = TclGetStringFromObj(itemv[LOC_CE], &m);
+		AddScanName(tablePtr, name, m, CE);
+		for (i = 0; i < 4; i++) {
+		    AddScanName(tablePtr, eraNames[i], -1, (i % 2) ? CE : BCE);
+		}
+		break;
+	    case 'y':			/* Locale-dependent year, ignored */
+		if (TclListObjGetElements(interp, itemv[LOC_LOCALE_NUMERALS],
+			&listc, &listv) != TCL_OK) {
+		    goto error;
+		}
+		ADD_TOKEN(SCAN_NUMERAL, 0, 0);
+		tokenPtr->tablePtr = NewScanTable(0, listc);
+		for (i = 0; i < listc; i++) {
+		    name = TclGetStringFromObj(listv[i], &m);
+		    AddScanName(tokenPtr->tablePtr, name, m, i);
+		}
+		break;
+	    default:
+		ADD_TOKEN(SCAN_LITERAL, '%', '%');
+		ADD_TOKEN(SCAN_LITERAL, 'E', 'E');
+		ADD_TOKEN(SCAN_LITERAL, ch, ch);
+		break;
+	    }
+	    continue;
+
+	default:		/* 'O' */
+	    state = 0;
+	    switch (ch) {
+	    case 'd':
+	    case 'e':
+		i = SF_DAYOFMONTH;
+		break;
+	    case 'H':
+	    case 'k':
+		i = SF_HOUR;
+		break;
+	    case 'I':
+	    case 'l':
+		i = SF_HOURAMPM;
+		break;
+	    case 'm':
+		i = SF_MONTH;
+		break;
+	    case 'M':
+		i = SF_MINUTE;
+		break;
+	    case 'S':
+		i = SF_SECOND;
+		break;
+	    case 'u':
+	    case 'w':
+		i = SF_DAYOFWEEK;
+		break;
+	    case 'y':
+		i = SF_YEAROFCENTURY;
+		break;
+	    default:
+		ADD_TOKEN(SCAN_LITERAL, '%', '%');
+		ADD_TOKEN(SCAN_LITERAL, 'O', 'O');
+		ADD_TOKEN(SCAN_LITERAL, ch, ch);
+		continue;
+	    }
+
+	    /*
+	     * A number in the alternative numerals of the locale.
+	     */
+
+	    if (TclListObjGetElements(interp, itemv[LOC_LOCALE_NUMERALS],
+		    &listc, &listv) != TCL_OK) {
+		goto error;
+	    }
+	    ADD_TOKEN(SCAN_NUMERAL, 0, 0);
+	    SET_FIELD(i);
+	    tokenPtr->tablePtr = NewScanTable(0, listc);
+	    for (i = 0; i < listc; i++) {
+		name = TclGetStringFromObj(listv[i], &m);
+		AddScanName(tokenPtr->tablePtr, name, m, i);
+	    }
+	    continue;
+	}
+    }
+
+    /*
+     * A trailing %, %E or %O matches itself.
+     */
+
+    if (state != 0) {
+	ADD_TOKEN(SCAN_LITERAL, '%', '%');
+	if (state != '%') {
+	    ADD_TOKEN(SCAN_LITERAL, state, state);
+	}
+    }
+    ADD_TOKEN(SCAN_SPACE, 0, 0);
+#undef ADD_TOKEN
+#undef SET_FIELD
+#undef ADD_NUMBER
+
+    scanPtr->generation = dataPtr->generation;
+    scanPtr->locale = ckalloc(lowerObj->length + 1);
+    memcpy(scanPtr->locale, lowerObj->bytes, lowerObj->length + 1);
+    scanPtr->changeover = changeover;
+    scanPtr->dateAction = SelectParseAction(dateParseActions,
+	    scanPtr->fieldPos);
+    scanPtr->timeAction = SelectParseAction(timeParseActions,
+	    scanPtr->fieldPos);
+    Tcl_DecrRefCount(dataObj);
+    Tcl_DecrRefCount(lowerObj);
+
+    /*
+     * Keep it in the format object.
+     */
+
+    TclGetString(formatObj);
+    TclFreeIntRep(formatObj);
+    formatObj->internalRep.twoPtrValue.ptr1 = scanPtr;
+    formatObj->typePtr = &clockScanType;
+    Tcl_DecrRefCount(formatObj);
+    return scanPtr;
+
+  error:
+    FreeClockScan(scanPtr);
+    Tcl_DecrRefCount(dataObj);
+    Tcl_DecrRefCount(formatObj);
+    Tcl_DecrRefCount(lowerObj);
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeClockScan, FreeClockScanInternalRep, DupClockScanInternalRep --
+ *
+ *	FreeClockScan releases a reference to a compiled [clock scan] format,
+ *	and the others manage the compiled form kept in a format object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A compiled format is freed when its last reference goes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeClockScan(
+    ClockScan *scanPtr)		/* The compiled format */
+{
+    ClockScanTable *tablePtr;
+    int i, j;
+
+    if (--scanPtr->refCount > 0) {
+	return;
+    }
+    for (i = 0; i < scanPtr->numTokens; i++) {
+	tablePtr = scanPtr->tokens[i].tablePtr;
+	if (tablePtr != NULL) {
+	    for (j = 0; j < tablePtr->numNames; j++) {
+		ckfree((char *) tablePtr->names[j].chars);
+	    }
+	    ckfree((char *) tablePtr);
+	}
+    }
+    if (scanPtr->locale != NULL) {
+	ckfree(scanPtr->locale);
+    }
+    ckfree((char *) scanPtr);
+}
+
+static void
+FreeClockScanInternalRep(
+    Tcl_Obj *objPtr)		/* Format object */
+{
+    FreeClockScan(objPtr->internalRep.twoPtrValue.ptr1);
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupClockScanInternalRep(
+    Tcl_Obj *srcPtr,		/* Format object to copy */
+    Tcl_Obj *copyPtr)		/* The copy */
+{
+    ClockScan *scanPtr = srcPtr->internalRep.twoPtrValue.ptr1;
+
+    scanPtr->refCount++;
+    copyPtr->internalRep.twoPtrValue.ptr1 = scanPtr;
+    copyPtr->typePtr = &clockScanType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewScanTable, AddScanName, AddDayOrMonthNames --
+ *
+ *	NewScanTable makes an empty table of names, or of numerals, for a
+ *	token of a [clock scan] format. AddScanName adds a name to it, with
+ *	the value that it stands for; a name given again takes the new value.
+ *	AddDayOrMonthNames makes the table of the abbreviated and the full
+ *	names of the days of the week (from Sunday) or of the months.
+ *
+ * Results:
+ *	NewScanTable returns the table, which holds at most the given number
+ *	of names. AddDayOrMonthNames returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Allocate memory, which FreeClockScan releases.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClockScanTable *
+NewScanTable(
+    int prefixes,		/* Whether prefixes of the names match */
+    int size)			/* Number of names it can hold */
+{
+    ClockScanTable *tablePtr = (ClockScanTable *)
+	    ckalloc(sizeof(ClockScanTable) + size * sizeof(ClockScanName));
+
+    tablePtr->prefixes = prefixes;
+    tablePtr->maxLength = 0;
+    tablePtr->numNames = 0;
+    return tablePtr;
+}
+
+static void
+AddScanName(
+    ClockScanTable *tablePtr,	/* The table */
+    const char *name,		/* The name, in UTF-8 */
+    int length,			/* Its length in bytes, or -1 */
+    int value)			/* The value it stands for */
+{
+    ClockScanName *namePtr;
+    Tcl_DString lower, chars;
+    int numChars, i;
+
+    Tcl_DStringInit(&lower);
+    if (tablePtr->prefixes) {
+	Tcl_DStringAppend(&lower, name, length);
+	length = Tcl_UtfToLower(Tcl_DStringValue(&lower));
+	name = Tcl_DStringValue(&lower);
+    }
+    Tcl_DStringInit(&chars);
+    Tcl_UtfToUniCharDString(name, length, &chars);
+    numChars = Tcl_DStringLength(&chars) / sizeof(Tcl_UniChar);
+
+    for (i = 0, namePtr = tablePtr->names; i < tablePtr->numNames;
+	    i++, namePtr++) {
+	if ((namePtr->length == numChars) && (memcmp(namePtr->chars,
+		Tcl_DStringValue(&chars),
+		numChars * sizeof(Tcl_UniChar)) == 0)) {
+	    break;
+	}
+    }
+    if (i == tablePtr->numNames) {
+	namePtr->chars = (Tcl_UniChar *)
+		ckalloc((numChars + 1) * sizeof(Tcl_UniChar));
+	memcpy(namePtr->chars, Tcl_DStringValue(&chars),
+		(numChars + 1) * sizeof(Tcl_UniChar));
+	namePtr->length = numChars;
+	if (numChars > tablePtr->maxLength) {
+	    tablePtr->maxLength = numChars;
+	}
+	tablePtr->numNames++;
+    }
+    namePtr->value = value;
+    Tcl_DStringFree(&chars);
+    Tcl_DStringFree(&lower);
+}
+
+static int
+AddDayOrMonthNames(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockScanToken *tokenPtr,	/* Token to make the table for */
+    Tcl_Obj *abbrevObj,		/* List of the abbreviated names */
+    Tcl_Obj *fullObj,		/* List of the full names */
+    int days)			/* Whether the names are of days */
+{
+    Tcl_Obj **listv[2];
+    const char *name;
+    int listc[2], i, j, length;
+
+    if ((TclListObjGetElements(interp, abbrevObj, &listc[0],
+	    &listv[0]) != TCL_OK)
+	    || (TclListObjGetElements(interp, fullObj, &listc[1],
+		&listv[1]) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    tokenPtr->tablePtr = NewScanTable(1, listc[0] + listc[1]);
+    for (i = 0; (i < listc[0]) || (i < listc[1]); i++) {
+	for (j = 0; j < 2; j++) {
+	    if (i < listc[j]) {
+		name = TclGetStringFromObj(listv[j][i], &length);
+		AddScanName(tokenPtr->tablePtr, name, length,
+			days ? ((i + 6) % 7 + 1) : (i + 1));
+	    }
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupScanName --
+ *
+ *	Looks up text in a table of names: the text matches a name that it is
+ *	in full, ignoring case if the table allows prefixes, or else that it
+ *	is a prefix of, if it is a prefix of no other name in the table.
+ *
+ * Results:
+ *	Returns 1 and stores the value of the name if the text matches one,
+ *	and 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LookupScanName(
+    ClockScanTable *tablePtr,	/* The table */
+    const Tcl_UniChar *p,	/* The text */
+    int length,			/* Its length in characters */
+    int *valuePtr)		/* Where to store the value */
+{
+    ClockScanName *namePtr;
+    int numPrefixes = 0, value = 0, i, j;
+
+    for (i = 0, namePtr = tablePtr->names; i < tablePtr->numNames;
+	    i++, namePtr++) {
+	if (namePtr->length < length) {
+	    continue;
+	}
+	if (tablePtr->prefixes) {
+	    for (j = 0; (j < length)
+		    && (Tcl_UniCharToLower(p[j]) == namePtr->chars[j]); j++) {
+		/* Empty body */
+	    }
+	} else {
+	    for (j = 0; (j < length) && (p[j] == namePtr->chars[j]); j++) {
+		/* Empty body */
+	    }
+	}
+	if (j < length) {
+	    continue;
+	}
+	if (namePtr->length == length) {
+	    *valuePtr = namePtr->value;
+	    return 1;
+	}
+	numPrefixes++;
+	value = namePtr->value;
+    }
+    if (tablePtr->prefixes && (length > 0) && (numPrefixes == 1)) {
+	*valuePtr = value;
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SelectParseAction --
+ *
+ *	Chooses how [clock scan] finds the date, or the time of day, from the
+ *	fields of a format: with the best set of fields that the format has
+ *	all of, and among sets of the same priority, with the one whose last
+ *	field comes later in the format, then the one whose last but one field
+ *	does, and so on.
+ *
+ * Results:
+ *	Returns the action of the chosen set.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SelectParseAction(
+    const ClockParseAction *actionPtr,
+				/* The sets of fields, best first */
+    const int *fieldPos)	/* Positions of the fields in the format */
+{
+    int best = -1, bestPriority = -1, bestPos[6], numBest = 0;
+    int pos[6], n, i, j;
+
+    for (; actionPtr->priority >= 0; actionPtr++) {
+	if ((best >= 0) && (actionPtr->priority > bestPriority)) {
+	    break;
+	}
+
+	/*
+	 * Sort the positions of the fields of the set, last first.
+	 */
+
+	for (n = 0; actionPtr->fields[n] >= 0; n++) {
+	    i = fieldPos[actionPtr->fields[n]];
+	    if (i == 0) {
+		break;
+	    }
+	    for (j = n; (j > 0) && (pos[j - 1] < i); j--) {
+		pos[j] = pos[j - 1];
+	    }
+	    pos[j] = i;
+	}
+	if (actionPtr->fields[n] >= 0) {
+	    continue;
+	}
+
+	if (best >= 0) {
+	    for (i = 0; (i < n) && (i < numBest) && (pos[i] == bestPos[i]);
+		    i++) {
+		/* Empty body */
+	    }
+	    if ((i < numBest) && ((i == n) || (pos[i] < bestPos[i]))) {
+		continue;
+	    }
+	}
+	best = actionPtr->action;
+	bestPriority = actionPtr->priority;
+	memcpy(bestPos, pos, n * sizeof(int));
+	numBest = n;
+    }
+    return best;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchScanTokens --
+ *
+ *	Matches the tokens of a [clock scan] format, from a given one on,
+ *	against the string from a given position on. A token that can match
+ *	text of several lengths tries the longest first, and the shorter ones
+ *	when the rest of the tokens do not match after it. Positions where
+ *	the rest of the tokens were found not to match are remembered, which
+ *	keeps the time linear in the length of the string for each token.
+ *
+ * Results:
+ *	Returns 1 if the tokens match the rest of the string, and 0 otherwise.
+ *
+ * Side effects:
+ *	Stores what each token matched.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define IS_DIGIT(c)	(((c) >= '0') && ((c) <= '9'))
+
+static int
+MatchScanTokens(
+    ClockScanMatcher *mPtr,	/* The tokens and the string */
+    int index,			/* Index of the first token to match */
+    const Tcl_UniChar *p)	/* Where to match it */
+{
+    ClockScanToken *tokenPtr = mPtr->tokens + index;
+    ClockScanMatch *matchPtr = mPtr->matches + index;
+    const Tcl_UniChar *end = mPtr->end;
+    char *failedPtr;
+    int lengths[3], numLengths, n;
+
+    if (index == mPtr->numTokens) {
+	return (p == end);
+    }
+    failedPtr = mPtr->failed + index * (end - mPtr->string + 1)
+	    + (p - mPtr->string);
+    if (*failedPtr) {
+	return 0;
+    }
+    *failedPtr = 1;
+
+#define TRY_LENGTH(len) \
+    matchPtr->length = (len);						\
+    if (MatchScanTokens(mPtr, index + 1, matchPtr->start + (len))) {	\
+	*failedPtr = 0;							\
+	return 1;							\
+    }
+
+    matchPtr->start = p;
+    switch (tokenPtr->type) {
+    case SCAN_LITERAL:
+	if ((p < end) && ((*p == tokenPtr->min) || (Tcl_UniCharToLower(*p)
+		== Tcl_UniCharToLower(tokenPtr->min)))) {
+	    TRY_LENGTH(1);
+	}
+	return 0;
+
+    case SCAN_SPACE:
+	for (n = 0; (p + n < end) && Tcl_UniCharIsSpace(p[n]); n++) {
+	    /* Empty body */
+	}
+	for (; n >= tokenPtr->min; n--) {
+	    TRY_LENGTH(n);
+	}
+	return 0;
+
+    case SCAN_DIGITS:
+    case SCAN_SIGNED:
+	while ((p < end) && Tcl_UniCharIsSpace(*p)) {
+	    p++;
+	}
+	matchPtr->start = p;
+	if ((tokenPtr->type == SCAN_SIGNED) && (p < end)
+		&& ((*p == '+') || (*p == '-'))) {
+	    p++;
+	}
+	for (n = 0; (n < tokenPtr->max) && (p + n < end) && IS_DIGIT(p[n]);
+		n++) {
+	    /* Empty body */
+	}
+	for (; n >= tokenPtr->min; n--) {
+	    TRY_LENGTH((int) (p - matchPtr->start) + n);
+	}
+	return 0;
+
+    case SCAN_STARDATE:
+	/*
+	 * "Stardate", white space, a signed number of four digits or more, a
+	 * point and a digit.
+	 */
+
+	for (n = 0; n < 8; n++) {
+	    if ((p + n == end)
+		    || (Tcl_UniCharToLower(p[n]) != "stardate"[n])) {
+		return 0;
+	    }
+	}
+	p += n;
+	if ((p == end) || !Tcl_UniCharIsSpace(*p)) {
+	    return 0;
+	}
+	while ((p < end) && Tcl_UniCharIsSpace(*p)) {
+	    p++;
+	}
+	matchPtr->start = p;
+	if ((p < end) && ((*p == '+') || (*p == '-'))) {
+	    p++;
+	}
+	for (n = 0; (p + n < end) && IS_DIGIT(p[n]); n++) {
+	    /* Empty body */
+	}
+	if ((n < 4) || (p + n + 2 > end) || (p[n] != '.')
+		|| !IS_DIGIT(p[n + 1])) {
+	    return 0;
+	}
+	TRY_LENGTH((int) (p + n + 2 - matchPtr->start));
+	return 0;
+
+    case SCAN_NAME:
+    case SCAN_NUMERAL:
+	for (n = tokenPtr->tablePtr->maxLength; n >= 0; n--) {
+	    if ((p + n <= end) && LookupScanName(tokenPtr->tablePtr, p, n,
+		    &matchPtr->value)) {
+		TRY_LENGTH(n);
+	    }
+	}
+	return 0;
+
+    case SCAN_TZ:
+	/*
+	 * A numeric zone, +hh, +hhmm or +hhmmss with optional colons, or else
+	 * up to four letters and digits.
+	 */
+
+	if ((p < end) && ((*p == '+') || (*p == '-'))) {
+	    numLengths = 0;
+	    n = 1;
+	    while ((numLengths < 3) && (p + n + 2 <= end)) {
+		if ((numLengths > 0) && (p[n] == ':') && (p + n + 3 <= end)
+			&& IS_DIGIT(p[n + 1]) && IS_DIGIT(p[n + 2])) {
+		    n += 3;
+		} else if (IS_DIGIT(p[n]) && IS_DIGIT(p[n + 1])) {
+		    n += 2;
+		} else {
+		    break;
+		}
+		lengths[numLengths++] = n;
+	    }
+	    while (numLengths > 0) {
+		numLengths--;
+		TRY_LENGTH(lengths[numLengths]);
+	    }
+	    return 0;
+	}
+	for (n = 0; (n < 4) && (p + n < end) && Tcl_UniCharIsAlnum(p[n]);
+		n++) {
+	    /* Empty body */
+	}
+	for (; n > 0; n--) {
+	    TRY_LENGTH(n);
+	}
+	return 0;
+    }
+#undef TRY_LENGTH
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetSystemTimeZone, GetTimeZoneData, EnsureClockLibrary --
+ *
+ *	GetSystemTimeZone gets the name of the system time zone from the Tcl
+ *	procedure of that name, reusing its last result while the TCL_TZ and
+ *	TZ environment variables and [clock]'s caches are unchanged.
+ *	GetTimeZoneData gets the time zone data of a zone, setting the zone
+ *	up if need be. EnsureClockLibrary loads the Tcl part of [clock] if it
+ *	is not loaded yet.
+ *
+ * Results:
+ *	GetSystemTimeZone and GetTimeZoneData return the name and the data, or
+ *	NULL with an error message in the interpreter. EnsureClockLibrary
+ *	returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Evaluates Tcl code.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetSystemTimeZone(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp)		/* Tcl interpreter */
+{
+    const char *env[2];
+    int i;
+
+    env[0] = getenv("TCL_TZ");
+    env[1] = getenv("TZ");
+    for (i = 0; i < 2; i++) {
+	if (env[i] == NULL) {
+	    env[i] = "";
+	}
+    }
+    if ((dataPtr->systemTZ != NULL)
+	    && (dataPtr->systemTZGeneration == dataPtr->generation)
+	    && (strcmp(env[0], dataPtr->systemTZEnv[0]) == 0)
+	    && (strcmp(env[1], dataPtr->systemTZEnv[1]) == 0)) {
+	return dataPtr->systemTZ;
+    }
+
+    if ((EnsureClockLibrary(dataPtr, interp) != TCL_OK)
+	    || (Tcl_EvalObjv(interp, 1,
+		&dataPtr->literals[LIT_GETSYSTEMTIMEZONE],
+		TCL_EVAL_GLOBAL) != TCL_OK)) {
+	return NULL;
+    }
+    if (dataPtr->systemTZ != NULL) {
+	Tcl_DecrRefCount(dataPtr->systemTZ);
+	ckfree(dataPtr->systemTZEnv[0]);
+	ckfree(dataPtr->systemTZEnv[1]);
+    }
+    dataPtr->systemTZ = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(dataPtr->systemTZ);
+    Tcl_ResetResult(interp);
+    for (i = 0; i < 2; i++) {
+	dataPtr->systemTZEnv[i] = ckalloc(strlen(env[i]) + 1);
+	strcpy(dataPtr->systemTZEnv[i], env[i]);
+    }
+    dataPtr->systemTZGeneration = dataPtr->generation;
+    return dataPtr->systemTZ;
+}
+
+static Tcl_Obj *
+GetTimeZoneData(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *timezoneObj)	/* Name of the time zone */
+{
+    Tcl_Obj *tzdata, *cmd[2];
+
+    tzdata = Tcl_ObjGetVar2(interp, dataPtr->literals[LIT_TZDATA],
+	    timezoneObj, TCL_GLOBAL_ONLY);
+    if (tzdata != NULL) {
+	return tzdata;
+    }
+
+    cmd[0] = dataPtr->literals[LIT_SETUPTIMEZONE];
+    cmd[1] = timezoneObj;
+    Tcl_IncrRefCount(timezoneObj);
+    if ((EnsureClockLibrary(dataPtr, interp) != TCL_OK)
+	    || (Tcl_EvalObjv(interp, 2, cmd, TCL_EVAL_GLOBAL) != TCL_OK)) {
+	Tcl_DecrRefCount(timezoneObj);
+	return NULL;
+    }
+    Tcl_ResetResult(interp);
+    tzdata = Tcl_ObjGetVar2(interp, dataPtr->literals[LIT_TZDATA],
+	    timezoneObj, TCL_GLOBAL_ONLY|TCL_LEAVE_ERR_MSG);
+    Tcl_DecrRefCount(timezoneObj);
+    return tzdata;
+}
+
+static int
+EnsureClockLibrary(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp)		/* Tcl interpreter */
+{
+    if (Tcl_FindCommand(interp, "::tcl::clock::SetupTimeZone", NULL,
+	    TCL_GLOBAL_ONLY) != NULL) {
+	return TCL_OK;
+    }
+    return Tcl_EvalObjEx(interp, dataPtr->literals[LIT_CLOCKLIBRARY],
+	    TCL_EVAL_GLOBAL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockClearnativecachesObjCmd, NewClockGeneration --
+ *
+ *	ClockClearnativecachesObjCmd is called by ::tcl::clock::ClearCaches
+ *	to forget the compiled formats, the system time zone and the last time
+ *	zone offset found, by taking a new generation for the client data.
+ *	NewClockGeneration makes generation numbers that are unique in the
+ *	process, as compiled formats may be seen by several interpreters.
+ *
+ * Results:
+ *	A standard Tcl result, and a new generation number.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockClearnativecachesObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    ClockClientData *dataPtr = clientData;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    dataPtr->generation = NewClockGeneration();
+    if (dataPtr->lastTZData != NULL) {
+	Tcl_DecrRefCount(dataPtr->lastTZData);
+	Tcl_DecrRefCount(dataPtr->lastTZName);
+	dataPtr->lastTZData = NULL;
+    }
+    return TCL_OK;
+}
+
+static int
+NewClockGeneration(void)
+{
+    int generation;
+
+    Tcl_MutexLock(&clockMutex);
+    generation = ++clockGeneration;
+    Tcl_MutexUnlock(&clockMutex);
+    return generation;
+}
+
+/*----------------------------------------------------------------------
+ *
+ * ClockSecondsObjCmd -
+ *
+ *	Returns a count of microseconds since the epoch.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ * This function implements the 'clock seconds' Tcl command. Refer to the user
+ * documentation for details on what it does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+ClockSecondsObjCmd(
+    ClientData clientData,	/* Client data is unused */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const *objv)	/* Parameter values */
+{
+    Tcl_Time now;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    Tcl_GetTime(&now);
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj((Tcl_WideInt) now.sec));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzsetIfNecessary --
+ *
+ *	Calls the tzset() library function if the contents of the TZ
+ *	environment variable has changed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Calls tzset.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TzsetIfNecessary(void)
+{
+    static char *tzWas = NULL;	/* Previous value of TZ, protected by
+				 * clockMutex. */
+    const char *tzIsNow;	/* Current value of TZ */
+
+    Tcl_MutexLock(&clockMutex);
+    tzIsNow = getenv("TZ");
+    if (tzIsNow != NULL && (tzWas == NULL || strcmp(tzIsNow, tzWas) != 0)) {
+	tzset();
+	if (tzWas != NULL) {
+	    ckfree(tzWas);
+	}
+	tzWas = ckalloc(strlen(tzIsNow) + 1);
+	strcpy(tzWas, tzIsNow);
+    } else if (tzIsNow == NULL && tzWas != NULL) {
+	tzset();
+	ckfree(tzWas);
+	tzWas = NULL;
+    }
+    Tcl_MutexUnlock(&clockMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockDeleteCmdProc --
+ *
+ *	Remove a reference to the clock client data, and clean up memory
+ *	when it's all gone.
+ *
+ * Results:
+ *	None.
+ *
  *----------------------------------------------------------------------
  */
 
@@ -2026,6 +5295,15 @@ ClockDeleteCmdProc(
 	for (i = 0; i < LIT__END; ++i) {
 	    Tcl_DecrRefCount(data->literals[i]);
 	}
+	if (data->systemTZ != NULL) {
+	    Tcl_DecrRefCount(data->systemTZ);
+	    ckfree(data->systemTZEnv[0]);
+	    ckfree(data->systemTZEnv[1]);
+	}
+	if (data->lastTZData != NULL) {
+	    Tcl_DecrRefCount(data->lastTZData);
+	    Tcl_DecrRefCount(data->lastTZName);
+	}
 	ckfree((char *) data->literals);
 	ckfree((char *) data);
     }
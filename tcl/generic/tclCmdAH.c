@@ -17,9 +17,9 @@
 #include <locale.h>
 
 /*
- * The state structure used by [foreach]. Note that the actual structure has
- * all its working arrays appended afterwards so they can be allocated and
- * freed in a single step.
+ * The state structure used by [foreach] and [lmap]. Note that the actual
+ * structure has all its working arrays appended afterwards so they can be
+ * allocated and freed in a single step.
  */
 
 struct ForeachState {
@@ -34,14 +34,146 @@ struct ForeachState {
     int *argcList;		/* Array of value list sizes. */
     Tcl_Obj ***argvList;	/* Array of value lists. */
     Tcl_Obj **aCopyList;	/* Copies of value list arguments. */
+    Tcl_Obj *resultList;	/* List of result values from the loop body,
+				 * or NULL if we're not collecting them
+				 * ([lmap] vs [foreach]). */
 };
 
+/*
+ * [lmap -parallel] evaluates its body as a lambda term in safe interpreters
+ * of its own, one per thread, spread over a pool of worker threads. A Tcl_Obj
+ * belongs to the thread that made it, so the values handed between threads
+ * are carried as LmapValues, from which the receiving thread makes its own
+ * Tcl_Objs. Integers, doubles and lists keep their internal representation
+ * on the way; there is no need to generate and reparse their strings.
+ */
+
+typedef struct LmapValue {
+    int type;			/* One of the LMAP_VALUE_* values below. */
+    char *bytes;		/* String representation, or NULL if the
+				 * value has none. */
+    int length;			/* Number of bytes in bytes. */
+    int ownBytes;		/* Whether bytes was allocated for this value,
+				 * rather than borrowed from a Tcl_Obj. */
+    union {
+	long longValue;
+	Tcl_WideInt wideValue;
+	double doubleValue;
+	struct {
+	    struct LmapValue *elements;
+	    int numElements;
+	} list;
+    } internalRep;
+} LmapValue;
+
+#define LMAP_VALUE_NONE		0	/* No value; the body continued. */
+#define LMAP_VALUE_STRING	1
+#define LMAP_VALUE_INT		2
+#define LMAP_VALUE_WIDE		3
+#define LMAP_VALUE_DOUBLE	4
+#define LMAP_VALUE_LIST		5
+
+/*
+ * Lists nested more deeply than this are carried as strings.
+ */
+
+#define LMAP_MAX_DEPTH		8
+
+/*
+ * Each thread taking part in a run aims to claim about this many chunks of
+ * iterations, so that a thread finishing early can help with the rest.
+ */
+
+#define LMAP_CHUNKS_PER_THREAD	4
+
+/*
+ * A run of [lmap -parallel]. The threads taking part claim chunks of
+ * consecutive iterations until there are none left, and store the result of
+ * each iteration in its slot of results.
+ */
+
+typedef struct LmapJob {
+    const char *lambda;		/* The lambda term evaluated by every
+				 * iteration. */
+    int lambdaLength;		/* Number of bytes in lambda. */
+    int numParams;		/* Number of parameters of the lambda. */
+    int *paramList;		/* For each parameter, the value list it takes
+				 * its values from, */
+    int *paramVar;		/* ... and the index of its variable in that
+				 * list's varList. */
+    int numLists;		/* Count of value lists. */
+    int *varcList;		/* # loop variables per list. */
+    int *argcList;		/* Array of value list sizes. */
+    LmapValue **argvList;	/* Array of value lists. */
+    int numIterations;		/* Number of loop iterations. */
+    int chunkSize;		/* Number of iterations claimed at a time. */
+    int nextChunk;		/* First iteration not claimed yet. */
+    int active;			/* Number of pool threads working on the
+				 * job. */
+    Tcl_Condition doneCond;	/* Notified when active drops to zero. */
+    LmapValue *results;		/* Result of each iteration. */
+    int stopIndex;		/* First iteration that ended with a code
+				 * other than TCL_OK or TCL_CONTINUE, or
+				 * numIterations if none did. Later
+				 * iterations are not started. */
+    int stopCode;		/* The code it ended with. */
+    char *stopResult;		/* Its result and return options, unless the */
+    char *stopOptions;		/* code is TCL_BREAK. Both ckalloc'd. */
+} LmapJob;
+
+/*
+ * The pool of worker threads shared by all [lmap -parallel] runs in the
+ * process. It is started by the first run and serves one job at a time;
+ * runs that find it busy, such as nested ones, do all their iterations in
+ * the calling thread. The number of workers is one less than the number of
+ * processors, unless the TCL_LMAP_THREADS environment variable says
+ * otherwise.
+ */
+
+#ifdef TCL_THREADS
+static struct {
+    int initialized;		/* Set once the workers are started. */
+    int shutdown;		/* Set to make the workers exit. */
+    int numWorkers;		/* Number of worker threads. */
+    Tcl_ThreadId *workers;	/* Their ids. */
+    LmapJob *jobPtr;		/* Job being worked on, or NULL. */
+    int generation;		/* Number of jobs posted so far. */
+    Tcl_Condition workCond;	/* Notified when a job is posted or the pool
+				 * shuts down. */
+} lmapPool;
+
+static Tcl_ThreadCreateProc LmapWorkerThread;
+#endif /* TCL_THREADS */
+
+TCL_DECLARE_MUTEX(lmapPoolMutex)
+
+/*
+ * The interpreter in which each thread evaluates [lmap -parallel] bodies.
+ */
+
+typedef struct ThreadSpecificData {
+    Tcl_Interp *interp;		/* Safe interpreter private to the thread, or
+				 * NULL if not made yet. */
+    Tcl_Obj *applyPtr;		/* The word "apply". */
+    Tcl_Obj *lambdaPtr;		/* Lambda term of the last job, kept so that
+				 * a body run repeatedly is compiled once. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Prototypes for local procedures defined in this file:
  */
 
 static int		CheckAccess(Tcl_Interp *interp, Tcl_Obj *pathPtr,
 			    int mode);
+static void		CaptureLmapValue(Tcl_Obj *objPtr,
+			    LmapValue *valuePtr, int copy, int depth);
+static int		ClaimLmapChunk(LmapJob *jobPtr, int *firstPtr,
+			    int *lastPtr);
+static void		DeleteLmapThreadData(ClientData clientData);
+static int		EachloopCmd(Tcl_Interp *interp, int collect,
+			    int objc, Tcl_Obj *const objv[]);
 static int		EncodingDirsObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -49,9 +181,18 @@ static inline int	ForeachAssignments(Tcl_Interp *interp,
 			    struct ForeachState *statePtr);
 static inline void	ForeachCleanup(Tcl_Interp *interp,
 			    struct ForeachState *statePtr);
+static void		FreeLmapValue(LmapValue *valuePtr);
+static ThreadSpecificData *GetLmapThreadData(void);
 static int		GetStatBuf(Tcl_Interp *interp, Tcl_Obj *pathPtr,
 			    Tcl_FSStatProc *statProc, Tcl_StatBuf *statPtr);
 static const char *	GetTypeFromMode(int mode);
+static Tcl_Obj *	NewLmapValueObj(const LmapValue *valuePtr);
+static int		ParallelLmapCmd(Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
+static void		RunLmapChunks(LmapJob *jobPtr);
+static void		RunLmapJob(LmapJob *jobPtr);
+static void		StopLmapJob(LmapJob *jobPtr, Tcl_Interp *interp,
+			    int index, int code);
 static int		StoreStatData(Tcl_Interp *interp, Tcl_Obj *varName,
 			    Tcl_StatBuf *statPtr);
 static Tcl_NRPostProc	CatchObjCmdCallback;
@@ -2505,10 +2646,12 @@ ForPostNextCallback(
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_ForeachObjCmd, TclNRForeachCmd --
+ * Tcl_ForeachObjCmd, TclNRForeachCmd, EachloopCmd --
  *
  *	This object-based procedure is invoked to process the "foreach" Tcl
  *	command. See the user documentation for details on what it does.
+ *	EachloopCmd is the implementation shared with "lmap"; it collects the
+ *	results of the body when its collect argument is non-zero.
  *
  * Results:
  *	A standard Tcl object result.
@@ -2536,6 +2679,17 @@ TclNRForeachCmd(
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *const objv[])
+{
+    return EachloopCmd(interp, 0, objc, objv);
+}
+
+static int
+EachloopCmd(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int collect,		/* Whether to collect the body results, as
+				 * [lmap] does. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
 {
     int numLists = (objc-2) / 2;
     register struct ForeachState *statePtr;
@@ -2579,6 +2733,10 @@ TclNRForeachCmd(
     statePtr->numLists = numLists;
     statePtr->bodyPtr = objv[objc - 1];
     statePtr->bodyIdx = objc - 1;
+    if (collect) {
+	TclNewObj(statePtr->resultList);
+	Tcl_IncrRefCount(statePtr->resultList);
+    }
 
     /*
      * Break up the value lists and variable lists into elements.
@@ -2593,7 +2751,8 @@ TclNRForeachCmd(
 	TclListObjGetElements(NULL, statePtr->vCopyList[i],
 		&statePtr->varcList[i], &statePtr->varvList[i]);
 	if (statePtr->varcList[i] < 1) {
-	    Tcl_AppendResult(interp, "foreach varlist is empty", NULL);
+	    Tcl_AppendResult(interp, (collect ? "lmap" : "foreach"),
+		    " varlist is empty", NULL);
 	    result = TCL_ERROR;
 	    goto done;
 	}
@@ -2637,6 +2796,9 @@ TclNRForeachCmd(
      */
 
     result = TCL_OK;
+    if (collect) {
+	Tcl_SetObjResult(interp, statePtr->resultList);
+    }
   done:
     ForeachCleanup(interp, statePtr);
     return result;
@@ -2662,14 +2824,21 @@ ForeachLoopStep(
     switch (result) {
     case TCL_CONTINUE:
 	result = TCL_OK;
+	break;
     case TCL_OK:
+	if (statePtr->resultList != NULL) {
+	    Tcl_ListObjAppendElement(interp, statePtr->resultList,
+		    Tcl_GetObjResult(interp));
+	}
 	break;
     case TCL_BREAK:
 	result = TCL_OK;
-	goto done;
+	goto finish;
     case TCL_ERROR:
 	Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
-		"\n    (\"foreach\" body line %d)", Tcl_GetErrorLine(interp)));
+		"\n    (\"%s\" body line %d)",
+		(statePtr->resultList != NULL ? "lmap" : "foreach"),
+		Tcl_GetErrorLine(interp)));
     default:
 	goto done;
     }
@@ -2694,7 +2863,12 @@ ForeachLoopStep(
      * We're done. Tidy up our work space and finish off.
      */
 
-    Tcl_ResetResult(interp);
+  finish:
+    if (statePtr->resultList != NULL) {
+	Tcl_SetObjResult(interp, statePtr->resultList);
+    } else {
+	Tcl_ResetResult(interp);
+    }
   done:
     ForeachCleanup(interp, statePtr);
     return result;
@@ -2756,8 +2930,831 @@ ForeachCleanup(
 	    TclDecrRefCount(statePtr->aCopyList[i]);
 	}
     }
+    if (statePtr->resultList != NULL) {
+	TclDecrRefCount(statePtr->resultList);
+    }
     TclStackFree(interp, statePtr);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_LmapObjCmd, TclNRLmapCmd --
+ *
+ *	This object-based procedure is invoked to process the "lmap" Tcl
+ *	command. See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl object result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_LmapObjCmd(
+    ClientData dummy,		/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    return Tcl_NRCallObjProc(interp, TclNRLmapCmd, dummy, objc, objv);
+}
+
+int
+TclNRLmapCmd(
+    ClientData dummy,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    /*
+     * The plain form always has an even number of words, so an odd number
+     * starting with -parallel is unambiguous.
+     */
+
+    if ((objc%2 != 0) && (objc > 1)
+	    && (strcmp(TclGetString(objv[1]), "-parallel") == 0)) {
+	return ParallelLmapCmd(interp, objc, objv);
+    }
+    return EachloopCmd(interp, 1, objc, objv);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelLmapCmd --
+ *
+ *	Implements "lmap -parallel". The body becomes a lambda term whose
+ *	parameters are the loop variables, and each iteration applies it to
+ *	its values in the safe interpreter of whichever thread runs it.
+ *
+ * Results:
+ *	A standard Tcl result. On success the result is the list of body
+ *	results, in the order of the iterations.
+ *
+ * Side effects:
+ *	May start the worker thread pool and the safe interpreter of the
+ *	calling thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelLmapCmd(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    int numLists = (objc-3) / 2;
+    LmapJob job;
+    Tcl_Obj **vCopyList, **aCopyList, **varv, **argv, *paramsPtr;
+    Tcl_Obj *lambdaPtr = NULL, *resultPtr;
+    int i, j, p, v, varc, result = TCL_ERROR;
+
+    if (objc < 5) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"-parallel varList list ?varList list ...? command");
+	return TCL_ERROR;
+    }
+
+    memset(&job, 0, sizeof(LmapJob));
+    job.numLists = numLists;
+    vCopyList = (Tcl_Obj **) ckalloc(2 * numLists * sizeof(Tcl_Obj *));
+    aCopyList = vCopyList + numLists;
+    memset(vCopyList, 0, 2 * numLists * sizeof(Tcl_Obj *));
+    job.varcList = (int *) ckalloc(2 * numLists * sizeof(int));
+    job.argcList = job.varcList + numLists;
+    job.argvList = (LmapValue **) ckalloc(numLists * sizeof(LmapValue *));
+    memset(job.argvList, 0, numLists * sizeof(LmapValue *));
+    TclNewObj(paramsPtr);
+    Tcl_IncrRefCount(paramsPtr);
+
+    /*
+     * Break up the variable lists, and make each distinct variable a
+     * parameter of the lambda. A variable named more than once takes its
+     * value from the last place it is named, as in [foreach].
+     */
+
+    for (i=0 ; i<numLists ; i++) {
+	vCopyList[i] = TclListObjCopy(interp, objv[2+i*2]);
+	if (vCopyList[i] == NULL) {
+	    goto done;
+	}
+	TclListObjGetElements(NULL, vCopyList[i], &varc, &varv);
+	if (varc < 1) {
+	    Tcl_AppendResult(interp, "lmap varlist is empty", NULL);
+	    goto done;
+	}
+	job.varcList[i] = varc;
+	job.numParams += varc;
+    }
+    job.paramList = (int *) ckalloc(2 * job.numParams * sizeof(int));
+    job.paramVar = job.paramList + job.numParams;
+    job.numParams = 0;
+    for (i=0 ; i<numLists ; i++) {
+	TclListObjGetElements(NULL, vCopyList[i], &varc, &varv);
+	for (v=0 ; v<varc ; v++) {
+	    const char *name = TclGetString(varv[v]);
+	    Tcl_Obj *namePtr;
+
+	    if (strcmp(name, "args") == 0) {
+		Tcl_AppendResult(interp, "lmap -parallel cannot use \"args\""
+			" as a loop variable", NULL);
+		goto done;
+	    }
+	    for (p=0 ; p<job.numParams ; p++) {
+		Tcl_ListObjIndex(NULL, vCopyList[job.paramList[p]],
+			job.paramVar[p], &namePtr);
+		if (strcmp(name, TclGetString(namePtr)) == 0) {
+		    break;
+		}
+	    }
+	    if (p == job.numParams) {
+		/*
+		 * A one-element list, so that a name with spaces in it is not
+		 * taken for a name and a default value.
+		 */
+
+		Tcl_ListObjAppendElement(NULL, paramsPtr,
+			Tcl_NewListObj(1, &varv[v]));
+		job.numParams++;
+	    }
+	    job.paramList[p] = i;
+	    job.paramVar[p] = v;
+	}
+    }
+
+    /*
+     * Capture the values. They are only read while the job runs, so they can
+     * borrow the strings of the list elements.
+     */
+
+    for (i=0 ; i<numLists ; i++) {
+	aCopyList[i] = TclListObjCopy(interp, objv[3+i*2]);
+	if (aCopyList[i] == NULL) {
+	    goto done;
+	}
+	TclListObjGetElements(NULL, aCopyList[i], &job.argcList[i], &argv);
+	job.argvList[i] = (LmapValue *)
+		ckalloc(job.argcList[i] * sizeof(LmapValue));
+	for (j=0 ; j<job.argcList[i] ; j++) {
+	    CaptureLmapValue(argv[j], &job.argvList[i][j], 0, 0);
+	}
+
+	j = job.argcList[i] / job.varcList[i];
+	if ((job.argcList[i] % job.varcList[i]) != 0) {
+	    j++;
+	}
+	if (j > job.numIterations) {
+	    job.numIterations = j;
+	}
+    }
+
+    if (job.numIterations == 0) {
+	result = TCL_OK;
+	goto done;
+    }
+
+    lambdaPtr = Tcl_NewListObj(1, &paramsPtr);
+    Tcl_ListObjAppendElement(NULL, lambdaPtr, objv[objc-1]);
+    Tcl_IncrRefCount(lambdaPtr);
+    job.lambda = TclGetStringFromObj(lambdaPtr, &job.lambdaLength);
+
+    job.results = (LmapValue *)
+	    ckalloc(job.numIterations * sizeof(LmapValue));
+    memset(job.results, 0, job.numIterations * sizeof(LmapValue));
+    job.stopIndex = job.numIterations;
+    job.stopCode = TCL_OK;
+
+    RunLmapJob(&job);
+
+    if ((job.stopCode == TCL_OK) || (job.stopCode == TCL_BREAK)) {
+	TclNewObj(resultPtr);
+	for (j=0 ; j<job.stopIndex ; j++) {
+	    if (job.results[j].type != LMAP_VALUE_NONE) {
+		Tcl_ListObjAppendElement(NULL, resultPtr,
+			NewLmapValueObj(&job.results[j]));
+	    }
+	}
+	Tcl_SetObjResult(interp, resultPtr);
+	result = TCL_OK;
+    } else {
+	Tcl_Obj *optionsPtr = Tcl_NewStringObj(job.stopOptions, -1);
+
+	Tcl_IncrRefCount(optionsPtr);
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(job.stopResult, -1));
+	result = Tcl_SetReturnOptions(interp, optionsPtr);
+	TclDecrRefCount(optionsPtr);
+	if (result == TCL_ERROR) {
+	    Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+		    "\n    (\"lmap\" body line %d)", Tcl_GetErrorLine(interp)));
+	}
+    }
+
+  done:
+    for (j=0 ; j<job.numIterations ; j++) {
+	FreeLmapValue(&job.results[j]);
+    }
+    if (job.results != NULL) {
+	ckfree((char *) job.results);
+    }
+    if (job.stopResult != NULL) {
+	ckfree(job.stopResult);
+	ckfree(job.stopOptions);
+    }
+    for (i=0 ; i<numLists ; i++) {
+	if (job.argvList[i] != NULL) {
+	    for (j=0 ; j<job.argcList[i] ; j++) {
+		FreeLmapValue(&job.argvList[i][j]);
+	    }
+	    ckfree((char *) job.argvList[i]);
+	}
+	if (vCopyList[i] != NULL) {
+	    TclDecrRefCount(vCopyList[i]);
+	}
+	if (aCopyList[i] != NULL) {
+	    TclDecrRefCount(aCopyList[i]);
+	}
+    }
+    if (lambdaPtr != NULL) {
+	TclDecrRefCount(lambdaPtr);
+    }
+    TclDecrRefCount(paramsPtr);
+    if (job.paramList != NULL) {
+	ckfree((char *) job.paramList);
+    }
+    ckfree((char *) job.argvList);
+    ckfree((char *) job.varcList);
+    ckfree((char *) vCopyList);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunLmapJob --
+ *
+ *	Runs all the iterations of an [lmap -parallel] job, with the help of
+ *	the worker pool if it is free, and waits until they are finished.
+ *
+ * Results:
+ *	None; the outcome is left in the job.
+ *
+ * Side effects:
+ *	Starts the worker pool the first time it is called.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RunLmapJob(
+    LmapJob *jobPtr)		/* Job to run. */
+{
+#ifdef TCL_THREADS
+    int numThreads = 1, posted = 0;
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    if (!lmapPool.initialized) {
+	Tcl_DString ds;
+	const char *threads = TclGetEnv("TCL_LMAP_THREADS", &ds);
+	int i;
+
+	lmapPool.numWorkers = TclpNumProcessors() - 1;
+	if (threads != NULL) {
+	    lmapPool.numWorkers = atoi(threads);
+	    Tcl_DStringFree(&ds);
+	}
+	if (lmapPool.numWorkers > 0) {
+	    lmapPool.workers = (Tcl_ThreadId *)
+		    ckalloc(lmapPool.numWorkers * sizeof(Tcl_ThreadId));
+	}
+	for (i=0 ; i<lmapPool.numWorkers ; i++) {
+	    if (TclpThreadCreate(&lmapPool.workers[i], LmapWorkerThread, NULL,
+		    TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+		break;
+	    }
+	}
+	lmapPool.numWorkers = i;
+	lmapPool.generation = 0;
+	lmapPool.initialized = 1;
+    }
+    if ((lmapPool.jobPtr == NULL) && (lmapPool.numWorkers > 0)
+	    && (jobPtr->numIterations > 1) && !lmapPool.shutdown) {
+	numThreads += lmapPool.numWorkers;
+	posted = 1;
+    }
+    jobPtr->chunkSize = jobPtr->numIterations
+	    / (numThreads * LMAP_CHUNKS_PER_THREAD) + 1;
+    if (posted) {
+	lmapPool.jobPtr = jobPtr;
+	lmapPool.generation++;
+	Tcl_ConditionNotify(&lmapPool.workCond);
+    }
+    Tcl_MutexUnlock(&lmapPoolMutex);
+
+    RunLmapChunks(jobPtr);
+
+    if (posted) {
+	Tcl_MutexLock(&lmapPoolMutex);
+	while (jobPtr->active > 0) {
+	    Tcl_ConditionWait(&jobPtr->doneCond, &lmapPoolMutex, NULL);
+	}
+	lmapPool.jobPtr = NULL;
+	Tcl_MutexUnlock(&lmapPoolMutex);
+	Tcl_ConditionFinalize(&jobPtr->doneCond);
+    }
+#else
+    jobPtr->chunkSize = jobPtr->numIterations;
+    RunLmapChunks(jobPtr);
+#endif /* TCL_THREADS */
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * LmapWorkerThread --
+ *
+ *	The main function of the worker threads of the [lmap -parallel] pool.
+ *	Helps with each job posted until the pool shuts down.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Evaluates lambda terms in the thread's safe interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+LmapWorkerThread(
+    ClientData clientData)	/* Not used. */
+{
+    LmapJob *jobPtr;
+    int generation = 0;
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    while (1) {
+	while (!lmapPool.shutdown && ((lmapPool.jobPtr == NULL)
+		|| (lmapPool.generation == generation))) {
+	    Tcl_ConditionWait(&lmapPool.workCond, &lmapPoolMutex, NULL);
+	}
+	if (lmapPool.shutdown) {
+	    break;
+	}
+	jobPtr = lmapPool.jobPtr;
+	generation = lmapPool.generation;
+	jobPtr->active++;
+	Tcl_MutexUnlock(&lmapPoolMutex);
+
+	RunLmapChunks(jobPtr);
+
+	Tcl_MutexLock(&lmapPoolMutex);
+	if (--jobPtr->active == 0) {
+	    Tcl_ConditionNotify(&jobPtr->doneCond);
+	}
+    }
+    Tcl_MutexUnlock(&lmapPoolMutex);
+
+    Tcl_FinalizeThread();
+    TclpThreadExit(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeLmapPool --
+ *
+ *	Stops the worker threads of the [lmap -parallel] pool, if it was
+ *	started. Called by Tcl_Finalize.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Waits for the workers to finish any job they are helping with and to
+ *	exit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeLmapPool(void)
+{
+#ifdef TCL_THREADS
+    int i;
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    if (!lmapPool.initialized) {
+	Tcl_MutexUnlock(&lmapPoolMutex);
+	return;
+    }
+    lmapPool.shutdown = 1;
+    Tcl_ConditionNotify(&lmapPool.workCond);
+    Tcl_MutexUnlock(&lmapPoolMutex);
+
+    for (i=0 ; i<lmapPool.numWorkers ; i++) {
+	Tcl_JoinThread(lmapPool.workers[i], NULL);
+    }
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    if (lmapPool.workers != NULL) {
+	ckfree((char *) lmapPool.workers);
+	lmapPool.workers = NULL;
+    }
+    lmapPool.numWorkers = 0;
+    lmapPool.initialized = 0;
+    lmapPool.shutdown = 0;
+    Tcl_ConditionFinalize(&lmapPool.workCond);
+    Tcl_MutexUnlock(&lmapPoolMutex);
+#endif /* TCL_THREADS */
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunLmapChunks --
+ *
+ *	Claims chunks of iterations of an [lmap -parallel] job until there are
+ *	none left, and runs them in the calling thread's safe interpreter.
+ *
+ * Results:
+ *	None; the outcome of each iteration is left in the job.
+ *
+ * Side effects:
+ *	Whatever the lambda term does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RunLmapChunks(
+    LmapJob *jobPtr)		/* Job to help with. */
+{
+    ThreadSpecificData *tsdPtr = GetLmapThreadData();
+    Tcl_Interp *interp = tsdPtr->interp;
+    Tcl_Obj *lambdaPtr = tsdPtr->lambdaPtr, **objv;
+    const char *bytes;
+    int first, last, i, j, k, p, length, code;
+
+    /*
+     * Reuse the lambda term of the last job if it is the same one, as it
+     * holds the compiled body.
+     */
+
+    if (lambdaPtr != NULL) {
+	bytes = TclGetStringFromObj(lambdaPtr, &length);
+	if ((length != jobPtr->lambdaLength)
+		|| (memcmp(bytes, jobPtr->lambda, (size_t) length) != 0)) {
+	    TclDecrRefCount(lambdaPtr);
+	    lambdaPtr = NULL;
+	}
+    }
+    if (lambdaPtr == NULL) {
+	lambdaPtr = Tcl_NewStringObj(jobPtr->lambda, jobPtr->lambdaLength);
+	Tcl_IncrRefCount(lambdaPtr);
+	tsdPtr->lambdaPtr = lambdaPtr;
+    }
+
+    /*
+     * Hold our own reference: a nested [lmap -parallel] in the body may
+     * replace the thread's lambda term.
+     */
+
+    Tcl_IncrRefCount(lambdaPtr);
+    objv = (Tcl_Obj **) ckalloc((jobPtr->numParams + 2) * sizeof(Tcl_Obj *));
+    objv[0] = tsdPtr->applyPtr;
+    objv[1] = lambdaPtr;
+
+    while (ClaimLmapChunk(jobPtr, &first, &last)) {
+	for (j=first ; j<last ; j++) {
+	    for (p=0 ; p<jobPtr->numParams ; p++) {
+		i = jobPtr->paramList[p];
+		k = j * jobPtr->varcList[i] + jobPtr->paramVar[p];
+		if (k < jobPtr->argcList[i]) {
+		    objv[p+2] = NewLmapValueObj(&jobPtr->argvList[i][k]);
+		} else {
+		    TclNewObj(objv[p+2]);	/* Empty string */
+		}
+		Tcl_IncrRefCount(objv[p+2]);
+	    }
+
+	    code = Tcl_ApplyObjCmd(NULL, interp, jobPtr->numParams + 2, objv);
+
+	    for (p=0 ; p<jobPtr->numParams ; p++) {
+		TclDecrRefCount(objv[p+2]);
+	    }
+	    if (code == TCL_OK) {
+		CaptureLmapValue(Tcl_GetObjResult(interp),
+			&jobPtr->results[j], 1, 0);
+	    } else if (code != TCL_CONTINUE) {
+		StopLmapJob(jobPtr, interp, j, code);
+		break;
+	    }
+	}
+    }
+
+    Tcl_ResetResult(interp);
+    ckfree((char *) objv);
+    TclDecrRefCount(lambdaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClaimLmapChunk --
+ *
+ *	Claims the next chunk of iterations of an [lmap -parallel] job.
+ *
+ * Results:
+ *	1 and the range of iterations claimed in *firstPtr and *lastPtr
+ *	(exclusive), or 0 if there are no iterations left to run.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClaimLmapChunk(
+    LmapJob *jobPtr,		/* Job to claim iterations of. */
+    int *firstPtr,		/* Where to store the first iteration. */
+    int *lastPtr)		/* Where to store the end of the chunk. */
+{
+    int claimed = 0;
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    if (jobPtr->nextChunk < jobPtr->stopIndex) {
+	*firstPtr = jobPtr->nextChunk;
+	jobPtr->nextChunk += jobPtr->chunkSize;
+	if (jobPtr->nextChunk > jobPtr->numIterations) {
+	    jobPtr->nextChunk = jobPtr->numIterations;
+	}
+	*lastPtr = jobPtr->nextChunk;
+	claimed = 1;
+    }
+    Tcl_MutexUnlock(&lmapPoolMutex);
+    return claimed;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StopLmapJob --
+ *
+ *	Records that an iteration of an [lmap -parallel] job ended with a code
+ *	that stops the loop. Only the first such iteration in loop order
+ *	counts, just as if the iterations had been run one after the other.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Iterations after the stopping one are no longer started.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StopLmapJob(
+    LmapJob *jobPtr,		/* Job to stop. */
+    Tcl_Interp *interp,		/* Interpreter holding the result and return
+				 * options of the iteration. */
+    int index,			/* Number of the iteration. */
+    int code)			/* The code the iteration ended with. */
+{
+    char *stopResult = NULL, *stopOptions = NULL;
+
+    if (code != TCL_BREAK) {
+	Tcl_Obj *optionsPtr = Tcl_GetReturnOptions(interp, code);
+	const char *bytes;
+	int length;
+
+	Tcl_IncrRefCount(optionsPtr);
+	bytes = TclGetStringFromObj(optionsPtr, &length);
+	stopOptions = ckalloc((unsigned) length + 1);
+	memcpy(stopOptions, bytes, (size_t) length + 1);
+	TclDecrRefCount(optionsPtr);
+	bytes = TclGetStringFromObj(Tcl_GetObjResult(interp), &length);
+	stopResult = ckalloc((unsigned) length + 1);
+	memcpy(stopResult, bytes, (size_t) length + 1);
+    }
+
+    Tcl_MutexLock(&lmapPoolMutex);
+    if (index < jobPtr->stopIndex) {
+	char *freeResult = jobPtr->stopResult;
+	char *freeOptions = jobPtr->stopOptions;
+
+	jobPtr->stopIndex = index;
+	jobPtr->stopCode = code;
+	jobPtr->stopResult = stopResult;
+	jobPtr->stopOptions = stopOptions;
+	stopResult = freeResult;
+	stopOptions = freeOptions;
+    }
+    Tcl_MutexUnlock(&lmapPoolMutex);
+
+    if (stopResult != NULL) {
+	ckfree(stopResult);
+	ckfree(stopOptions);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetLmapThreadData --
+ *
+ *	Returns the data of the calling thread used by [lmap -parallel],
+ *	making its safe interpreter if need be.
+ *
+ * Results:
+ *	The thread's data.
+ *
+ * Side effects:
+ *	The first call in a thread creates a safe interpreter, deleted when
+ *	the thread exits.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ThreadSpecificData *
+GetLmapThreadData(void)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (tsdPtr->interp == NULL) {
+	tsdPtr->interp = Tcl_CreateInterp();
+	Tcl_MakeSafe(tsdPtr->interp);
+	TclNewLiteralStringObj(tsdPtr->applyPtr, "apply");
+	Tcl_IncrRefCount(tsdPtr->applyPtr);
+	tsdPtr->lambdaPtr = NULL;
+	Tcl_CreateThreadExitHandler(DeleteLmapThreadData, tsdPtr);
+    }
+    return tsdPtr;
+}
+
+static void
+DeleteLmapThreadData(
+    ClientData clientData)	/* The thread's data. */
+{
+    ThreadSpecificData *tsdPtr = clientData;
+
+    if (tsdPtr->lambdaPtr != NULL) {
+	TclDecrRefCount(tsdPtr->lambdaPtr);
+	tsdPtr->lambdaPtr = NULL;
+    }
+    TclDecrRefCount(tsdPtr->applyPtr);
+    Tcl_DeleteInterp(tsdPtr->interp);
+    tsdPtr->interp = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CaptureLmapValue, NewLmapValueObj, FreeLmapValue --
+ *
+ *	Convert a value to and from the form in which [lmap -parallel] hands
+ *	it to another thread, and free that form. CaptureLmapValue keeps the
+ *	internal representation of integers, doubles and lists, and the
+ *	string representation if the value has one; NewLmapValueObj makes a
+ *	new Tcl_Obj with both.
+ *
+ * Results:
+ *	NewLmapValueObj returns a new object with a reference count of zero.
+ *
+ * Side effects:
+ *	CaptureLmapValue may generate the string representation of objPtr.
+ *	With copy set to zero, the LmapValue borrows the strings of objPtr
+ *	and its elements, which must outlive it unchanged.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CaptureLmapValue(
+    Tcl_Obj *objPtr,		/* Value to capture. */
+    LmapValue *valuePtr,	/* Where to store it. */
+    int copy,			/* Whether to copy its strings. */
+    int depth)			/* Nesting depth within captured lists. */
+{
+    const Tcl_ObjType *typePtr = objPtr->typePtr;
+
+    if (typePtr == &tclIntType) {
+	valuePtr->type = LMAP_VALUE_INT;
+	valuePtr->internalRep.longValue = objPtr->internalRep.longValue;
+#ifndef NO_WIDE_TYPE
+    } else if (typePtr == &tclWideIntType) {
+	valuePtr->type = LMAP_VALUE_WIDE;
+	valuePtr->internalRep.wideValue = objPtr->internalRep.wideValue;
+#endif
+    } else if (typePtr == &tclDoubleType) {
+	valuePtr->type = LMAP_VALUE_DOUBLE;
+	valuePtr->internalRep.doubleValue = objPtr->internalRep.doubleValue;
+    } else if ((typePtr == &tclListType) && (depth < LMAP_MAX_DEPTH)) {
+	int objc, i;
+	Tcl_Obj **objv;
+
+	TclListObjGetElements(NULL, objPtr, &objc, &objv);
+	valuePtr->type = LMAP_VALUE_LIST;
+	valuePtr->internalRep.list.numElements = objc;
+	valuePtr->internalRep.list.elements = NULL;
+	if (objc > 0) {
+	    valuePtr->internalRep.list.elements = (LmapValue *)
+		    ckalloc(objc * sizeof(LmapValue));
+	}
+	for (i=0 ; i<objc ; i++) {
+	    CaptureLmapValue(objv[i], &valuePtr->internalRep.list.elements[i],
+		    copy, depth + 1);
+	}
+    } else {
+	valuePtr->type = LMAP_VALUE_STRING;
+	TclGetString(objPtr);
+    }
+
+    valuePtr->bytes = objPtr->bytes;
+    valuePtr->length = objPtr->length;
+    valuePtr->ownBytes = 0;
+    if (copy && (objPtr->bytes != NULL)) {
+	valuePtr->bytes = ckalloc((unsigned) objPtr->length + 1);
+	memcpy(valuePtr->bytes, objPtr->bytes, (size_t) objPtr->length + 1);
+	valuePtr->ownBytes = 1;
+    }
+}
+
+static Tcl_Obj *
+NewLmapValueObj(
+    const LmapValue *valuePtr)	/* Value to make an object of. */
+{
+    Tcl_Obj *objPtr;
+
+    switch (valuePtr->type) {
+    case LMAP_VALUE_INT:
+	TclNewLongObj(objPtr, valuePtr->internalRep.longValue);
+	break;
+#ifndef NO_WIDE_TYPE
+    case LMAP_VALUE_WIDE:
+	objPtr = Tcl_NewWideIntObj(valuePtr->internalRep.wideValue);
+	break;
+#endif
+    case LMAP_VALUE_DOUBLE:
+	TclNewDoubleObj(objPtr, valuePtr->internalRep.doubleValue);
+	break;
+    case LMAP_VALUE_LIST: {
+	int objc = valuePtr->internalRep.list.numElements, i;
+	Tcl_Obj **objv;
+
+	if (objc == 0) {
+	    TclNewObj(objPtr);
+	    break;
+	}
+	objv = (Tcl_Obj **) ckalloc(objc * sizeof(Tcl_Obj *));
+	for (i=0 ; i<objc ; i++) {
+	    objv[i] = NewLmapValueObj(&valuePtr->internalRep.list.elements[i]);
+	}
+	objPtr = Tcl_NewListObj(objc, objv);
+	ckfree((char *) objv);
+	break;
+    }
+    default:
+	TclNewStringObj(objPtr, valuePtr->bytes, valuePtr->length);
+	return objPtr;
+    }
+
+    if ((valuePtr->bytes != NULL) && (valuePtr->length > 0)) {
+	TclInvalidateStringRep(objPtr);
+	TclInitStringRep(objPtr, valuePtr->bytes, valuePtr->length);
+    }
+    return objPtr;
+}
+
+static void
+FreeLmapValue(
+    LmapValue *valuePtr)	/* Value to free. */
+{
+    if (valuePtr->type == LMAP_VALUE_LIST) {
+	int i;
+
+	for (i=0 ; i<valuePtr->internalRep.list.numElements ; i++) {
+	    FreeLmapValue(&valuePtr->internalRep.list.elements[i]);
+	}
+	if (valuePtr->internalRep.list.elements != NULL) {
+	    ckfree((char *) valuePtr->internalRep.list.elements);
+	}
+    }
+    if (valuePtr->ownBytes) {
+	ckfree(valuePtr->bytes);
+    }
+    valuePtr->type = LMAP_VALUE_NONE;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -23,9 +23,8 @@
 #include "tclRegexp.h"
 
 /*
- * During execution of the "lsort" command, structures of the following type
- * are used to arrange the objects being sorted into a collection of linked
- * lists.
+ * During execution of the "lsort" command, an array of structures of the
+ * following type is merge sorted, one for each object being sorted.
  */
 
 typedef struct SortElement {
@@ -39,8 +38,10 @@ typedef struct SortElement {
         Tcl_Obj *objPtr;
         int index;
     } payload;
-    struct SortElement *nextPtr;/* Next element in the list, or NULL for end
-				 * of list. */
+    const char *sortKey;	/* For -dictionary and -nocase, strValuePtr
+				 * rewritten once so that strcmp() orders it
+				 * (see DictionaryKey and NocaseKey), or NULL
+				 * when DictionaryCompare has to be used. */
 } SortElement;
 
 /*
@@ -102,6 +103,29 @@ typedef struct SortInfo {
 #define SORTIDX_NONE	-1	/* Not indexed; use whole value. */
 #define SORTIDX_END	-2	/* Indexed from end. */
 
+/*
+ * Sorts without -command are split in up to SORT_MAX_TASKS parts of at least
+ * SORT_MIN_TASK elements, sorted on separate threads and then merged in
+ * pairs, also in parallel. Ranges of up to SORT_RUN elements are insertion
+ * sorted.
+ */
+
+#define SORT_MAX_TASKS	16
+#define SORT_MIN_TASK	32768
+#define SORT_RUN	8
+
+/*
+ * One part of a parallel sort: either sort dst[lo,hi) (mid < 0), or merge the
+ * sorted runs src[lo,mid) and src[mid,hi) into dst[lo,hi).
+ */
+
+typedef struct SortTask {
+    SortElement *dst;		/* Where the result goes. */
+    SortElement *src;		/* Runs to merge, or scratch space. */
+    int lo, mid, hi;		/* Range of the task. */
+    SortInfo *infoPtr;		/* Information about the sort. */
+} SortTask;
+
 /*
  * Forward declarations for procedures defined in this file:
  */
@@ -150,10 +174,15 @@ static int		InfoSharedlibCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
 static int		InfoTclVersionCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
-static SortElement *	MergeLists(SortElement *leftPtr, SortElement *rightPtr,
-			    SortInfo *infoPtr);
+static int		DictionaryKey(const char *str, char *key);
+static void		MergeRuns(SortElement *dst, SortElement *src, int lo,
+			    int mid, int hi, SortInfo *infoPtr);
+static int		NocaseKey(const char *str, char *key);
 static int		SortCompare(SortElement *firstPtr, SortElement *second,
 			    SortInfo *infoPtr);
+static void		SortRange(SortElement *dst, SortElement *src, int lo,
+			    int hi, SortInfo *infoPtr);
+static void		SortTaskProc(ClientData clientData);
 static Tcl_Obj *	SelectObjFromSublist(Tcl_Obj *firstPtr,
 			    SortInfo *infoPtr);
 
@@ -2502,34 +2531,17 @@ Tcl_LrangeObjCmd(
 	return TCL_OK;
     }
 
+    /*
+     * Parsing the indices may have changed the type of the list when it is
+     * also one of them, so get its list rep again.
+     */
+
     result = TclListObjGetElements(interp, objv[1], &listLen, &elemPtrs);
     if (result != TCL_OK) {
 	return result;
     }
 
-    if (Tcl_IsShared(objv[1]) ||
-	    (((List *) objv[1]->internalRep.twoPtrValue.ptr1)->refCount > 1)) {
-	Tcl_SetObjResult(interp, Tcl_NewListObj(last - first + 1,
-		&(elemPtrs[first])));
-    } else {
-	/*
-	 * In-place is possible.
-	 */
-
-	if (last < (listLen - 1)) {
-	    Tcl_ListObjReplace(interp, objv[1], last + 1, listLen - 1 - last,
-		    0, NULL);
-	}
-
-	/*
-	 * This one is not conditioned on (first > 0) in order to preserve the
-	 * string-canonizing effect of [lrange 0 end].
-	 */
-
-	Tcl_ListObjReplace(interp, objv[1], 0, first, 0, NULL);
-	Tcl_SetObjResult(interp, objv[1]);
-    }
-
+    Tcl_SetObjResult(interp, TclListObjRange(objv[1], first, last));
     return TCL_OK;
 }
 
@@ -2819,9 +2831,12 @@ Tcl_LreverseObjCmd(
 	 * It is theoretically possible for a list object to have a shared
 	 * internal representation, but be an unshared object. Check for this
 	 * and use the "shared" code if we have that problem. [Bug 1675044]
+	 * The elements of a slice belong to another list, so they cannot be
+	 * swapped in place either.
 	 */
 
-	if (((List *) objv[1]->internalRep.twoPtrValue.ptr1)->refCount > 1) {
+	if ((((List *) objv[1]->internalRep.twoPtrValue.ptr1)->refCount > 1)
+		|| ListRepIsSlice(ListRepPtr(objv[1]))) {
 	    goto makeNewReversedList;
 	}
 
@@ -3601,16 +3616,17 @@ Tcl_LsortObjCmd(
 {
     int i, j, index, indices, length, nocase = 0, sortMode, indexc;
     int group, groupSize, groupOffset, idx, allocatedIndexVector = 0;
+    int numTasks, width;
     Tcl_Obj *resultPtr, *cmdPtr, **listObjPtrs, *listObj, *indexPtr;
-    SortElement *elementArray, *elementPtr;
+    SortElement *elementArray, *elementPtr, *scratchArray, *sortedArray;
+    char *keyBuffer = NULL;
     SortInfo sortInfo;		/* Information about this sort that needs to
 				 * be passed to the comparison function. */
-#   define NUM_LISTS 30
-    SortElement *subList[NUM_LISTS+1];
-				/* This array holds pointers to temporary
-				 * lists built during the merge sort. Element
-				 * i of the array holds a list of length
-				 * 2**i. */
+    SortTask tasks[SORT_MAX_TASKS];
+    ClientData taskData[SORT_MAX_TASKS];
+    int bounds[SORT_MAX_TASKS+1];
+				/* Parts of a parallel sort: part i is
+				 * [bounds[i], bounds[i+1]). */
     static const char *const switches[] = {
 	"-ascii", "-command", "-decreasing", "-dictionary", "-increasing",
 	"-index", "-indices", "-integer", "-nocase", "-real", "-stride",
@@ -3890,21 +3906,11 @@ Tcl_LsortObjCmd(
     }
 
     /*
-     * Initialize the sublists. After the following loop, subList[i] will
-     * contain a sorted sublist of length 2**i. Use one extra subList at the
-     * end, always at NULL, to indicate the end of the lists.
-     */
-
-    for (j=0 ; j<=NUM_LISTS ; j++) {
-	subList[j] = NULL;
-    }
-
-    /*
-     * The following loop creates a SortElement for each list element and
-     * begins sorting it into the sublists as it appears.
+     * The following loop creates a SortElement for each list element.
      */
 
     elementArray = TclStackAlloc(interp, length * sizeof(SortElement));
+    scratchArray = (SortElement *) ckalloc(length * sizeof(SortElement));
 
     for (i=0; i < length; i++){
 	idx = groupSize * i + groupOffset;
@@ -3957,31 +3963,109 @@ Tcl_LsortObjCmd(
 	} else {
 	    elementArray[i].payload.objPtr = listObjPtrs[idx];
 	}
+	elementArray[i].sortKey = NULL;
+    }
 
-	/*
-	 * Merge this element in the pre-existing sublists (and merge together
-	 * sublists when we have two of the same size).
-	 */
+    /*
+     * Turn the strings of -dictionary and -nocase sorts into keys that are
+     * compared with strcmp(), instead of decoding and folding the characters
+     * of both strings again in every comparison. Strings that already are
+     * their own key are not copied.
+     */
+
+    if ((sortInfo.sortMode == SORTMODE_DICTIONARY)
+	    || (sortInfo.sortMode == SORTMODE_ASCII_NC)) {
+	int (*keyProc)(const char *str, char *key) =
+		(sortInfo.sortMode == SORTMODE_DICTIONARY)
+		? DictionaryKey : NocaseKey;
+	int keyLength;
+	size_t bufferSize = 0;
+	char *keyPtr;
+
+	for (i=0; i < length; i++) {
+	    keyLength = keyProc(elementArray[i].collationKey.strValuePtr,
+		    NULL);
+	    if (keyLength > 0) {
+		bufferSize += keyLength;
+	    }
+	}
+	if (bufferSize > 0) {
+	    keyBuffer = ckalloc(bufferSize);
+	}
+	keyPtr = keyBuffer;
+	for (i=0; i < length; i++) {
+	    const char *str = elementArray[i].collationKey.strValuePtr;
+
+	    keyLength = keyProc(str, NULL);
+	    if (keyLength == 0) {
+		elementArray[i].sortKey = str;
+	    } else if (keyLength > 0) {
+		keyProc(str, keyPtr);
+		elementArray[i].sortKey = keyPtr;
+		keyPtr += keyLength;
+	    }
+	}
+    }
+
+    /*
+     * Sort the array. Comparison commands have to run in this thread, but
+     * other sorts of large lists are split among several threads: each part
+     * is sorted separately, then pairs of adjacent parts are merged until a
+     * single sorted run is left. The runs alternate between elementArray and
+     * scratchArray.
+     */
+
+    numTasks = 1;
+    if (sortInfo.sortMode != SORTMODE_COMMAND) {
+	int maxTasks = TclpNumProcessors();
 
-	elementArray[i].nextPtr = NULL;
-	elementPtr = &elementArray[i];
-	for (j=0 ; subList[j] ; j++) {
-	    elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
-	    subList[j] = NULL;
+	while ((numTasks*2 <= maxTasks) && (numTasks*2 <= SORT_MAX_TASKS)
+		&& (length / (numTasks*2) >= SORT_MIN_TASK)) {
+	    numTasks *= 2;
 	}
-	if (j >= NUM_LISTS) {
-	    j = NUM_LISTS-1;
+    }
+    for (j=0 ; j<=numTasks ; j++) {
+	bounds[j] = (int) (((Tcl_WideInt) length * j) / numTasks);
+    }
+    for (j=0 ; j<numTasks ; j++) {
+	tasks[j].dst = elementArray;
+	tasks[j].src = scratchArray;
+	tasks[j].lo = bounds[j];
+	tasks[j].mid = -1;
+	tasks[j].hi = bounds[j+1];
+	tasks[j].infoPtr = &sortInfo;
+	taskData[j] = &tasks[j];
+    }
+    TclRunTasks(numTasks, SortTaskProc, taskData);
+
+    sortedArray = elementArray;
+    for (width=1 ; width<numTasks ; width*=2) {
+	for (j=0 ; j<numTasks/(2*width) ; j++) {
+	    tasks[j].dst = (sortedArray == elementArray)
+		    ? scratchArray : elementArray;
+	    tasks[j].src = sortedArray;
+	    tasks[j].lo = bounds[2*width*j];
+	    tasks[j].mid = bounds[2*width*j + width];
+	    tasks[j].hi = bounds[2*width*(j+1)];
 	}
-	subList[j] = elementPtr;
+	TclRunTasks(numTasks/(2*width), SortTaskProc, taskData);
+	sortedArray = tasks[0].dst;
     }
 
     /*
-     * Merge all sublists
+     * With -unique, keep only the last of each run of equal elements; as the
+     * sort is stable, that is the one found last in the list.
      */
 
-    elementPtr = subList[0];
-    for (j=1 ; j<NUM_LISTS ; j++) {
-	elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
+    if (sortInfo.unique) {
+	for (i=j=0 ; i<length ; i++) {
+	    if ((i+1 < length) && (SortCompare(&sortedArray[i],
+		    &sortedArray[i+1], &sortInfo) == 0)) {
+		continue;
+	    }
+	    sortedArray[j++] = sortedArray[i];
+	}
+	sortInfo.numElements = j;
     }
 
     /*
@@ -3995,8 +4079,9 @@ Tcl_LsortObjCmd(
 	resultPtr = Tcl_NewListObj(sortInfo.numElements * groupSize, NULL);
 	listRepPtr = resultPtr->internalRep.twoPtrValue.ptr1;
 	newArray = &listRepPtr->elements;
+	elementPtr = sortedArray;
 	if (group) {
-	    for (i=0; elementPtr!=NULL ; elementPtr=elementPtr->nextPtr) {
+	    for (i=0; i < sortInfo.numElements*groupSize ; elementPtr++) {
 		idx = elementPtr->payload.index;
 		for (j = 0; j < groupSize; j++) {
 		    if (indices) {
@@ -4011,13 +4096,13 @@ Tcl_LsortObjCmd(
 		}
 	    }
 	} else if (indices) {
-	    for (i=0; elementPtr != NULL ; elementPtr = elementPtr->nextPtr) {
+	    for (i=0; i < sortInfo.numElements ; elementPtr++) {
 		objPtr = Tcl_NewIntObj(elementPtr->payload.index);
 		newArray[i++] = objPtr;
 		Tcl_IncrRefCount(objPtr);
 	    }
 	} else {
-	    for (i=0; elementPtr != NULL ; elementPtr = elementPtr->nextPtr) {
+	    for (i=0; i < sortInfo.numElements ; elementPtr++) {
 		objPtr = elementPtr->payload.objPtr;
 		newArray[i++] = objPtr;
 		Tcl_IncrRefCount(objPtr);
@@ -4028,6 +4113,10 @@ Tcl_LsortObjCmd(
     }
 
   done1:
+    if (keyBuffer != NULL) {
+	ckfree(keyBuffer);
+    }
+    ckfree((char *) scratchArray);
     TclStackFree(interp, elementArray);
 
   done:
@@ -4046,110 +4135,145 @@ Tcl_LsortObjCmd(
 /*
  *----------------------------------------------------------------------
  *
- * MergeLists -
+ * SortTaskProc --
  *
- *	This procedure combines two sorted lists of SortElement structures
- *	into a single sorted list.
+ *	Runs one part of an lsort, possibly on a worker thread (see
+ *	TclRunTasks): sorts a range of the element array, or merges two
+ *	adjacent sorted runs.
  *
  * Results:
- *	The unified list of SortElement structures.
+ *	None.
  *
  * Side effects:
- *	If infoPtr->unique is set then infoPtr->numElements may be updated.
+ *	The elements are rearranged in taskPtr->dst; when sorting, src is
+ *	used as scratch space.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SortTaskProc(
+    ClientData clientData)	/* The SortTask to run. */
+{
+    SortTask *taskPtr = clientData;
+
+    if (taskPtr->mid < 0) {
+	memcpy(taskPtr->src + taskPtr->lo, taskPtr->dst + taskPtr->lo,
+		(taskPtr->hi - taskPtr->lo) * sizeof(SortElement));
+	SortRange(taskPtr->dst, taskPtr->src, taskPtr->lo, taskPtr->hi,
+		taskPtr->infoPtr);
+    } else {
+	MergeRuns(taskPtr->dst, taskPtr->src, taskPtr->lo, taskPtr->mid,
+		taskPtr->hi, taskPtr->infoPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortRange --
+ *
+ *	Stable merge sort of the elements dst[lo,hi). On entry, src[lo,hi)
+ *	must hold the same elements as dst[lo,hi); the two ranges are used
+ *	alternately as source and destination of the merges, so that no
+ *	element is copied more than once per level.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The elements of dst[lo,hi) are sorted. src[lo,hi) is overwritten.
  *	Possibly others, if a user-defined comparison command does something
  *	weird.
  *
- * Note:
- *	If infoPtr->unique is set, the merge assumes that there are no
- *	"repeated" elements in each of the left and right lists. In that case,
- *	if any element of the left list is equivalent to one in the right list
- *	it is omitted from the merged list.
- *
- *	This simplified mechanism works because of the special way our
- *	MergeSort creates the sublists to be merged and will fail to eliminate
- *	all repeats in the general case where they are already present in
- *	either the left or right list. A general code would need to skip
- *	adjacent initial repeats in the left and right lists before comparing
- *	their initial elements, at each step.
- *
  *----------------------------------------------------------------------
  */
 
-static SortElement *
-MergeLists(
-    SortElement *leftPtr,	/* First list to be merged; may be NULL. */
-    SortElement *rightPtr,	/* Second list to be merged; may be NULL. */
+static void
+SortRange(
+    SortElement *dst,		/* Elements to sort. */
+    SortElement *src,		/* Copy of the elements to sort. */
+    int lo, int hi,		/* Range to sort. */
     SortInfo *infoPtr)		/* Information needed by the comparison
 				 * operator. */
 {
-    SortElement *headPtr, *tailPtr;
-    int cmp;
+    int i, j, mid;
 
-    if (leftPtr == NULL) {
-	return rightPtr;
-    }
-    if (rightPtr == NULL) {
-	return leftPtr;
-    }
-    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-    if (cmp > 0 || (cmp == 0 && infoPtr->unique)) {
-	if (cmp == 0) {
-	    infoPtr->numElements--;
-	    leftPtr = leftPtr->nextPtr;
-	}
-	tailPtr = rightPtr;
-	rightPtr = rightPtr->nextPtr;
-    } else {
-	tailPtr = leftPtr;
-	leftPtr = leftPtr->nextPtr;
-    }
-    headPtr = tailPtr;
-    if (!infoPtr->unique) {
-	while ((leftPtr != NULL) && (rightPtr != NULL)) {
-	    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-	    if (cmp > 0) {
-		tailPtr->nextPtr = rightPtr;
-		tailPtr = rightPtr;
-		rightPtr = rightPtr->nextPtr;
-	    } else {
-		tailPtr->nextPtr = leftPtr;
-		tailPtr = leftPtr;
-		leftPtr = leftPtr->nextPtr;
+    /*
+     * Insertion sort short ranges, except when comparisons run a script:
+     * it needs a few more of them than merging.
+     */
+
+    if (hi - lo <= ((infoPtr->sortMode == SORTMODE_COMMAND) ? 1 : SORT_RUN)) {
+	for (i = lo+1 ; i < hi ; i++) {
+	    SortElement element = dst[i];
+
+	    for (j = i ; (j > lo)
+		    && (SortCompare(&dst[j-1], &element, infoPtr) > 0) ; j--) {
+		dst[j] = dst[j-1];
 	    }
+	    dst[j] = element;
 	}
-    } else {
-	while ((leftPtr != NULL) && (rightPtr != NULL)) {
-	    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-	    if (cmp >= 0) {
-		if (cmp == 0) {
-		    infoPtr->numElements--;
-		    leftPtr = leftPtr->nextPtr;
-		}
-		tailPtr->nextPtr = rightPtr;
-		tailPtr = rightPtr;
-		rightPtr = rightPtr->nextPtr;
+	return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    SortRange(src, dst, lo, mid, infoPtr);
+    SortRange(src, dst, mid, hi, infoPtr);
+    MergeRuns(dst, src, lo, mid, hi, infoPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MergeRuns --
+ *
+ *	This procedure merges the sorted runs src[lo,mid) and src[mid,hi)
+ *	into dst[lo,hi). Equal elements are taken from the first run first,
+ *	which keeps the sort stable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Possibly others, if a user-defined comparison command does something
+ *	weird.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MergeRuns(
+    SortElement *dst,		/* Where to merge to. */
+    SortElement *src,		/* Runs to merge. */
+    int lo, int mid, int hi,	/* Bounds of the runs. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    int i = lo, j = mid, k = lo;
+
+    if ((lo < mid) && (mid < hi)
+	    && (SortCompare(&src[mid-1], &src[mid], infoPtr) > 0)) {
+	while ((i < mid) && (j < hi)) {
+	    if (SortCompare(&src[i], &src[j], infoPtr) > 0) {
+		dst[k++] = src[j++];
 	    } else {
-		tailPtr->nextPtr = leftPtr;
-		tailPtr = leftPtr;
-		leftPtr = leftPtr->nextPtr;
+		dst[k++] = src[i++];
 	    }
 	}
     }
-    if (leftPtr != NULL) {
-	tailPtr->nextPtr = leftPtr;
-    } else {
-	tailPtr->nextPtr = rightPtr;
-    }
-    return headPtr;
+    memcpy(dst + k, src + i, (mid - i) * sizeof(SortElement));
+    k += mid - i;
+    memcpy(dst + k, src + j, (hi - j) * sizeof(SortElement));
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
  * SortCompare --
  *
- *	This procedure is invoked by MergeLists to determine the proper
- *	ordering between two elements.
+ *	This procedure is invoked by SortRange and MergeRuns to determine the
+ *	proper ordering between two elements.
  *
  * Results:
  *	A negative results means the the first element comes before the
@@ -4176,9 +4300,19 @@ SortCompare(
 	order = strcmp(elemPtr1->collationKey.strValuePtr,
 		elemPtr2->collationKey.strValuePtr);
     } else if (infoPtr->sortMode == SORTMODE_ASCII_NC) {
-	order = strcasecmp(elemPtr1->collationKey.strValuePtr,
-		elemPtr2->collationKey.strValuePtr);
+	order = strcmp(elemPtr1->sortKey, elemPtr2->sortKey);
     } else if (infoPtr->sortMode == SORTMODE_DICTIONARY) {
+	/*
+	 * Keys only tell the primary ordering; when they are equal the
+	 * strings can still differ in case or leading zeros.
+	 */
+
+	if ((elemPtr1->sortKey != NULL) && (elemPtr2->sortKey != NULL)) {
+	    order = strcmp(elemPtr1->sortKey, elemPtr2->sortKey);
+	    if (order != 0) {
+		goto done;
+	    }
+	}
 	order = DictionaryCompare(elemPtr1->collationKey.strValuePtr,
 		elemPtr2->collationKey.strValuePtr);
     } else if (infoPtr->sortMode == SORTMODE_INTEGER) {
@@ -4245,6 +4379,8 @@ SortCompare(
 	    return 0;
 	}
     }
+
+  done:
     if (!infoPtr->isIncreasing) {
 	order = -order;
     }
@@ -4383,6 +4519,124 @@ DictionaryCompare(
     }
     return diff;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DictionaryKey --
+ *
+ *	This function computes a key for a string such that strcmp() on two
+ *	keys orders them as DictionaryCompare does the strings, except for
+ *	the case and leading zero differences that only DictionaryCompare
+ *	uses to break ties. Letters are folded to lower case, and each run
+ *	of digits is replaced with a '0', the number of its significant
+ *	digits, then these digits. Only ASCII strings with digit runs shorter
+ *	than 256 digits have a key.
+ *
+ * Results:
+ *	-1 if the string has no key, 0 if it is its own key (no digits nor
+ *	capital letters), otherwise the size of the key including its
+ *	terminating null byte. The key is stored in the key buffer, when it
+ *	is not NULL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DictionaryKey(
+    const char *str,		/* String to make the key of. */
+    char *key)			/* Where to store the key, or NULL to only
+				 * compute its size. */
+{
+    const char *digits;
+    int size = 1, copy = 0, numDigits;
+
+    while (*str != '\0') {
+	if (UCHAR(*str) >= 0x80) {
+	    return -1;
+	}
+	if (isdigit(UCHAR(*str))) {		/* INTL: digit */
+	    while ((*str == '0') && isdigit(UCHAR(str[1]))) {
+		str++;
+	    }
+	    digits = str;
+	    while (isdigit(UCHAR(*str))) {	/* INTL: digit */
+		str++;
+	    }
+	    numDigits = str - digits;
+	    if (numDigits > UCHAR_MAX) {
+		return -1;
+	    }
+	    if (key != NULL) {
+		*key++ = '0';
+		*key++ = (char) numDigits;
+		memcpy(key, digits, numDigits);
+		key += numDigits;
+	    }
+	    size += 2 + numDigits;
+	    copy = 1;
+	} else {
+	    if ((*str >= 'A') && (*str <= 'Z')) {
+		copy = 1;
+	    }
+	    if (key != NULL) {
+		*key++ = (char) Tcl_UniCharToLower(UCHAR(*str));
+	    }
+	    size++;
+	    str++;
+	}
+    }
+    if (key != NULL) {
+	*key = '\0';
+    }
+    return (copy ? size : 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NocaseKey --
+ *
+ *	This function computes a key for a string such that strcmp() on two
+ *	keys orders them as strcasecmp() does the strings: the string with
+ *	each byte folded by tolower().
+ *
+ * Results:
+ *	0 if the string is its own key, otherwise the size of the key
+ *	including its terminating null byte. The key is stored in the key
+ *	buffer, when it is not NULL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+NocaseKey(
+    const char *str,		/* String to make the key of. */
+    char *key)			/* Where to store the key, or NULL to only
+				 * compute its size. */
+{
+    const char *p;
+    int copy = 0;
+
+    for (p = str ; *p != '\0' ; p++) {
+	if (tolower(UCHAR(*p)) != UCHAR(*p)) {
+	    copy = 1;
+	}
+	if (key != NULL) {
+	    *key++ = (char) tolower(UCHAR(*p));
+	}
+    }
+    if (key != NULL) {
+	*key = '\0';
+    }
+    return (copy ? (p - str) + 1 : 0);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -0,0 +1,1064 @@
+/*
+ * tclCompCache.c --
+ *
+ *	This file implements an optional on-disk cache of compiled scripts.
+ *	When the TCL_BYTECODE_CACHE environment variable names a directory,
+ *	the bytecode compiled for the top level of each file evaluated by
+ *	[source] is saved there, and later evaluations of the unchanged file
+ *	rebuild the ByteCode from the saved copy instead of compiling it.
+ *
+ *	The cache directory is trusted: entries carry a checksum against
+ *	accidental damage and are checked for structural consistency and
+ *	against the file they were compiled from, but the bytecode itself is
+ *	not verified.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ * RCS: @(#) $Id$
+ */
+
+#include "tclInt.h"
+#include "tclCompile.h"
+
+/*
+ * Every cache entry starts with this magic string and format version, a
+ * native integer used to reject entries written on a machine of different
+ * byte order, and the patchlevel of the Tcl that wrote it. Bytecode is not
+ * portable across Tcl versions, so an entry from any other patchlevel is
+ * simply a cache miss.
+ */
+
+#define CACHE_MAGIC		"TclBC"
+#define CACHE_MAGIC_LENGTH	5
+#define CACHE_FORMAT_VERSION	1
+#define CACHE_BYTE_ORDER	0x01020304
+
+/*
+ * Kinds of literal recorded in a cache entry. Shared literals are registered
+ * in the interpreter's literal table again when the entry is loaded, as
+ * command names if they were compiled as such; private literals (hidden ones,
+ * or those added without registration) are recreated as fresh objects.
+ */
+
+#define CACHED_LITERAL		0
+#define CACHED_CMD_LITERAL	1
+#define CACHED_PRIVATE_LITERAL	2
+
+/*
+ * The types of auxiliary data that can be saved in a cache entry. Scripts
+ * whose compilation creates any other kind are not cached.
+ */
+
+static const AuxDataType *const cachedAuxDataTypes[] = {
+    &tclForeachInfoType, &tclJumptableInfoType, &tclDictUpdateInfoType, NULL
+};
+
+/*
+ * The identity of a sourced file, as used to name its cache entry and to
+ * decide whether an existing entry is still valid.
+ */
+
+typedef struct CacheKey {
+    Tcl_Obj *entryPathPtr;	/* Path of the cache entry file. */
+    Tcl_Obj *normPathPtr;	/* Normalized path of the sourced file. */
+    Tcl_WideInt mtime;		/* Modification time of the sourced file. */
+    int numSrcBytes;		/* Length of the script, in bytes of UTF-8. */
+    Tcl_WideUInt hash;		/* Hash of the script's UTF-8 text. */
+    Tcl_WideUInt compileEnvHash;/* Fingerprint of the interpreter state that
+				 * the compiler depends on; see
+				 * CompileEnvHash. */
+} CacheKey;
+
+/*
+ * State of the decoding of a cache entry. All Get* routines below leave
+ * 'failed' set instead of reading past 'end', and return zeros from then on,
+ * so that a truncated or corrupt entry is just a cache miss.
+ */
+
+typedef struct CacheReader {
+    const unsigned char *cur;	/* Next byte to decode. */
+    const unsigned char *end;	/* Byte just after the entry. */
+    int failed;			/* Non-zero once anything was inconsistent. */
+} CacheReader;
+
+/*
+ * Prototypes for procedures defined later in this file:
+ */
+
+static int		CacheableContext(Interp *iPtr);
+static void		FreeLoadedEnv(Tcl_Interp *interp, CompileEnv *envPtr);
+static const unsigned char *GetBytes(CacheReader *readerPtr, int length);
+static int		GetCount(CacheReader *readerPtr, int elementSize);
+static int		GetInt(CacheReader *readerPtr);
+static Tcl_WideInt	GetWide(CacheReader *readerPtr);
+static Tcl_WideUInt	CompileEnvHash(Interp *iPtr);
+static Tcl_WideUInt	HashBytes(const char *bytes, int length);
+static int		InitCacheKey(Tcl_Interp *interp, Tcl_Obj *pathPtr,
+			    Tcl_StatBuf *statBufPtr, Tcl_Obj *scriptPtr,
+			    CacheKey *keyPtr);
+static int		LoadAuxData(CacheReader *readerPtr,
+			    CompileEnv *envPtr);
+static int		LoadCachedByteCode(Tcl_Interp *interp,
+			    Tcl_Obj *scriptPtr, CacheKey *keyPtr);
+static void		PutBytes(Tcl_DString *dsPtr, const char *bytes,
+			    int length);
+static void		PutInt(Tcl_DString *dsPtr, int value);
+static void		PutWide(Tcl_DString *dsPtr, Tcl_WideInt value);
+static int		SaveAuxData(Tcl_DString *dsPtr, AuxData *auxDataPtr);
+static int		SaveCompiledScript(Tcl_Interp *interp,
+			    CompileEnv *envPtr, ClientData clientData);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompileCachedScript --
+ *
+ *	Called by [source] once it has read a script file, to give the
+ *	script its bytecode from the cache if possible. On a cache hit the
+ *	ByteCode is rebuilt from the cache entry; on a miss the script is
+ *	compiled here and a new entry is written. Nothing is done if the cache
+ *	is not enabled or the script is evaluated in a context whose
+ *	compilation may differ from that of a fresh global-level [source].
+ *
+ *	Must be called with iPtr->scriptFile and the TCL_EVAL_FILE flag set up
+ *	for the evaluation of the script.
+ *
+ * Results:
+ *	None. Failures to read or write the cache are not reported; the
+ *	script is then compiled as usual.
+ *
+ * Side effects:
+ *	May convert scriptPtr to a bytecode object, and may write a file in
+ *	the cache directory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompileCachedScript(
+    Tcl_Interp *interp,		/* Interpreter that will evaluate the
+				 * script. */
+    Tcl_Obj *scriptPtr,		/* The script read from the file. */
+    Tcl_Obj *pathPtr,		/* Path of the file. */
+    Tcl_StatBuf *statBufPtr)	/* Status of the file as read. */
+{
+    CacheKey key;
+
+    if (!CacheableContext((Interp *) interp)
+	    || !InitCacheKey(interp, pathPtr, statBufPtr, scriptPtr, &key)) {
+	return;
+    }
+
+    if (!LoadCachedByteCode(interp, scriptPtr, &key)) {
+	TclSetByteCodeFromAny(interp, scriptPtr, SaveCompiledScript, &key);
+    }
+
+    Tcl_DecrRefCount(key.entryPathPtr);
+    Tcl_DecrRefCount(key.normPathPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CacheableContext --
+ *
+ *	Decides whether a script about to be compiled in the interpreter's
+ *	current context compiles the same way as at the global level of any
+ *	interpreter with the same compileEnvHash: in the global namespace of
+ *	a trusted interpreter, without name resolvers or execution traces.
+ *
+ * Results:
+ *	Non-zero if the cache may be used.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CacheableContext(
+    Interp *iPtr)
+{
+    Namespace *globalNsPtr = iPtr->globalNsPtr;
+
+    return (iPtr->varFramePtr == iPtr->rootFramePtr)
+	    && (iPtr->compiledProcPtr == NULL)
+	    && (iPtr->resolverPtr == NULL)
+	    && !(iPtr->flags & (DONT_COMPILE_CMDS_INLINE | SAFE_INTERP))
+	    && (globalNsPtr->cmdResProc == NULL)
+	    && (globalNsPtr->varResProc == NULL)
+	    && (globalNsPtr->compiledVarResProc == NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitCacheKey --
+ *
+ *	Fills in the key identifying the cache entry of a sourced file. The
+ *	entry is named after a hash of the normalized path of the file, in the
+ *	directory named by the TCL_BYTECODE_CACHE environment variable.
+ *
+ * Results:
+ *	Non-zero if the cache is enabled, in which case the caller must
+ *	release the two Tcl_Obj references held by the key.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+InitCacheKey(
+    Tcl_Interp *interp,
+    Tcl_Obj *pathPtr,
+    Tcl_StatBuf *statBufPtr,
+    Tcl_Obj *scriptPtr,
+    CacheKey *keyPtr)
+{
+    Tcl_DString ds;
+    const char *cacheDir, *bytes;
+    Tcl_Obj *normPathPtr;
+    int length;
+    char name[TCL_INTEGER_SPACE + 8];
+
+    cacheDir = TclGetEnv("TCL_BYTECODE_CACHE", &ds);
+    if (cacheDir == NULL) {
+	return 0;
+    }
+    if (*cacheDir == '\0') {
+	Tcl_DStringFree(&ds);
+	return 0;
+    }
+    normPathPtr = Tcl_FSGetNormalizedPath(NULL, pathPtr);
+    if (normPathPtr == NULL) {
+	Tcl_DStringFree(&ds);
+	return 0;
+    }
+
+    bytes = TclGetStringFromObj(normPathPtr, &length);
+    sprintf(name, "%08x.tbc", (unsigned) HashBytes(bytes, length));
+    keyPtr->entryPathPtr = Tcl_ObjPrintf("%s/%s", cacheDir, name);
+    Tcl_IncrRefCount(keyPtr->entryPathPtr);
+    keyPtr->normPathPtr = normPathPtr;
+    Tcl_IncrRefCount(normPathPtr);
+    Tcl_DStringFree(&ds);
+
+    bytes = TclGetStringFromObj(scriptPtr, &length);
+    keyPtr->mtime = (Tcl_WideInt) statBufPtr->st_mtime;
+    keyPtr->numSrcBytes = length;
+    keyPtr->hash = HashBytes(bytes, length);
+    keyPtr->compileEnvHash = CompileEnvHash((Interp *) interp);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileEnvHash --
+ *
+ *	Computes a fingerprint of the interpreter state that decides how
+ *	commands are compiled: which global commands have compile procedures,
+ *	and the compileEpoch, which changes whenever a command with a compile
+ *	procedure is renamed, deleted or hidden, or a compiled ensemble is
+ *	reconfigured. The epoch is the same at the same point of any startup
+ *	that makes the same such changes, so entries are shared between runs
+ *	of the same application but not with code that redefined a compiled
+ *	command.
+ *
+ * Results:
+ *	The fingerprint.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_WideUInt
+CompileEnvHash(
+    Interp *iPtr)
+{
+    Tcl_HashTable *tablePtr = &iPtr->globalNsPtr->cmdTable;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    Tcl_WideUInt hash = (Tcl_WideUInt) iPtr->compileEpoch;
+    const char *name;
+
+    /*
+     * Sum the hashes of the names so that the order of the hash table does
+     * not matter.
+     */
+
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	Command *cmdPtr = Tcl_GetHashValue(hPtr);
+
+	if (cmdPtr->compileProc != NULL) {
+	    name = Tcl_GetHashKey(tablePtr, hPtr);
+	    hash += HashBytes(name, (int) strlen(name));
+	}
+    }
+    return hash;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashBytes --
+ *
+ *	Computes the 64-bit FNV-1a hash of a byte sequence.
+ *
+ * Results:
+ *	The hash value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_WideUInt
+HashBytes(
+    const char *bytes,
+    int length)
+{
+    Tcl_WideUInt hash = ((Tcl_WideUInt) 0xcbf29ce4 << 32) | 0x84222325;
+    const Tcl_WideUInt prime = ((Tcl_WideUInt) 0x100 << 32) | 0x1b3;
+
+    while (length-- > 0) {
+	hash ^= (unsigned char) *bytes++;
+	hash *= prime;
+    }
+    return hash;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PutInt, PutWide, PutBytes --
+ *
+ *	Append values to a cache entry under construction. Integers are
+ *	stored in native byte order; byte strings are preceded by their
+ *	length.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Appends to the DString.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PutInt(
+    Tcl_DString *dsPtr,
+    int value)
+{
+    Tcl_DStringAppend(dsPtr, (const char *) &value, sizeof(int));
+}
+
+static void
+PutWide(
+    Tcl_DString *dsPtr,
+    Tcl_WideInt value)
+{
+    Tcl_DStringAppend(dsPtr, (const char *) &value, sizeof(Tcl_WideInt));
+}
+
+static void
+PutBytes(
+    Tcl_DString *dsPtr,
+    const char *bytes,
+    int length)
+{
+    PutInt(dsPtr, length);
+    Tcl_DStringAppend(dsPtr, bytes, length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetInt, GetWide, GetBytes, GetCount --
+ *
+ *	Decode values from a cache entry. GetBytes decodes a length-prefixed
+ *	byte string of the given length, or of its stored length if length is
+ *	negative. GetCount decodes a count of elements each taking at least
+ *	elementSize bytes of the entry, and so rejects counts that the rest of
+ *	the entry cannot hold before anything is allocated for them.
+ *
+ * Results:
+ *	The decoded value; zero or NULL if the entry is exhausted or
+ *	inconsistent, in which case readerPtr->failed is set.
+ *
+ * Side effects:
+ *	Advances the reader.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetInt(
+    CacheReader *readerPtr)
+{
+    int value;
+
+    if (readerPtr->failed
+	    || (readerPtr->end - readerPtr->cur) < (int) sizeof(int)) {
+	readerPtr->failed = 1;
+	return 0;
+    }
+    memcpy(&value, readerPtr->cur, sizeof(int));
+    readerPtr->cur += sizeof(int);
+    return value;
+}
+
+static Tcl_WideInt
+GetWide(
+    CacheReader *readerPtr)
+{
+    Tcl_WideInt value;
+
+    if (readerPtr->failed
+	    || (readerPtr->end - readerPtr->cur) < (int) sizeof(Tcl_WideInt)) {
+	readerPtr->failed = 1;
+	return 0;
+    }
+    memcpy(&value, readerPtr->cur, sizeof(Tcl_WideInt));
+    readerPtr->cur += sizeof(Tcl_WideInt);
+    return value;
+}
+
+static const unsigned char *
+GetBytes(
+    CacheReader *readerPtr,
+    int length)
+{
+    const unsigned char *bytes;
+
+    if (length < 0) {
+	length = GetCount(readerPtr, 1);
+    }
+    if (readerPtr->failed || (readerPtr->end - readerPtr->cur) < length) {
+	readerPtr->failed = 1;
+	return NULL;
+    }
+    bytes = readerPtr->cur;
+    readerPtr->cur += length;
+    return bytes;
+}
+
+static int
+GetCount(
+    CacheReader *readerPtr,
+    int elementSize)
+{
+    int count = GetInt(readerPtr);
+
+    if ((count < 0) || (count > (readerPtr->end - readerPtr->cur)
+	    / elementSize)) {
+	readerPtr->failed = 1;
+	return 0;
+    }
+    return count;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SaveCompiledScript --
+ *
+ *	Compilation hook (see TclSetByteCodeFromAny) that writes the freshly
+ *	compiled CompileEnv of a sourced file to its cache entry. The entry is
+ *	written under a temporary name and renamed into place, so concurrent
+ *	readers see either the old or the new entry.
+ *
+ * Results:
+ *	Always TCL_OK; a cache that cannot be written is just not updated.
+ *
+ * Side effects:
+ *	Writes a file in the cache directory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SaveCompiledScript(
+    Tcl_Interp *interp,		/* Interpreter compiling the script. */
+    CompileEnv *envPtr,		/* The completed compilation. */
+    ClientData clientData)	/* The CacheKey of the sourced file. */
+{
+    CacheKey *keyPtr = clientData;
+    ExtCmdLoc *eclPtr = envPtr->extCmdMapPtr;
+    Tcl_DString ds;
+    Tcl_Channel chan;
+    Tcl_Obj *tmpPathPtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    const char *bytes;
+    int i, j, length, written;
+
+    if ((eclPtr == NULL) || (eclPtr->type != TCL_LOCATION_SOURCE)
+	    || (eclPtr->start != 1)) {
+	return TCL_OK;
+    }
+
+    Tcl_DStringInit(&ds);
+    Tcl_DStringAppend(&ds, CACHE_MAGIC, CACHE_MAGIC_LENGTH);
+    PutInt(&ds, CACHE_FORMAT_VERSION);
+    PutInt(&ds, CACHE_BYTE_ORDER);
+    PutBytes(&ds, TCL_PATCH_LEVEL, (int) strlen(TCL_PATCH_LEVEL));
+    bytes = TclGetStringFromObj(keyPtr->normPathPtr, &length);
+    PutBytes(&ds, bytes, length);
+    PutWide(&ds, keyPtr->mtime);
+    PutInt(&ds, keyPtr->numSrcBytes);
+    PutWide(&ds, (Tcl_WideInt) keyPtr->hash);
+    PutWide(&ds, (Tcl_WideInt) keyPtr->compileEnvHash);
+
+    PutInt(&ds, envPtr->numCommands);
+    PutInt(&ds, envPtr->maxStackDepth);
+    PutInt(&ds, envPtr->maxExceptDepth);
+    PutBytes(&ds, (const char *) envPtr->codeStart,
+	    envPtr->codeNext - envPtr->codeStart);
+
+    PutInt(&ds, envPtr->literalArrayNext);
+    for (i = 0;  i < envPtr->literalArrayNext;  i++) {
+	Tcl_Obj *objPtr = envPtr->literalArrayPtr[i].objPtr;
+	LiteralEntry *globalPtr = TclLookupLiteralEntry(interp, objPtr);
+
+	if (globalPtr == NULL) {
+	    PutInt(&ds, CACHED_PRIVATE_LITERAL);
+	} else if (globalPtr->nsPtr != NULL) {
+	    PutInt(&ds, CACHED_CMD_LITERAL);
+	} else {
+	    PutInt(&ds, CACHED_LITERAL);
+	}
+	bytes = TclGetStringFromObj(objPtr, &length);
+	PutBytes(&ds, bytes, length);
+    }
+
+    PutInt(&ds, envPtr->exceptArrayNext);
+    for (i = 0;  i < envPtr->exceptArrayNext;  i++) {
+	ExceptionRange *rangePtr = &envPtr->exceptArrayPtr[i];
+
+	PutInt(&ds, (int) rangePtr->type);
+	PutInt(&ds, rangePtr->nestingLevel);
+	PutInt(&ds, rangePtr->codeOffset);
+	PutInt(&ds, rangePtr->numCodeBytes);
+	PutInt(&ds, rangePtr->breakOffset);
+	PutInt(&ds, rangePtr->continueOffset);
+	PutInt(&ds, rangePtr->catchOffset);
+    }
+
+    PutInt(&ds, envPtr->auxDataArrayNext);
+    for (i = 0;  i < envPtr->auxDataArrayNext;  i++) {
+	if (!SaveAuxData(&ds, &envPtr->auxDataArrayPtr[i])) {
+	    /*
+	     * Auxiliary data of a type we cannot serialize; such scripts are
+	     * never cached.
+	     */
+
+	    Tcl_DStringFree(&ds);
+	    return TCL_OK;
+	}
+    }
+
+    for (i = 0;  i < envPtr->numCommands;  i++) {
+	CmdLocation *locPtr = &envPtr->cmdMapPtr[i];
+
+	PutInt(&ds, locPtr->codeOffset);
+	PutInt(&ds, locPtr->numCodeBytes);
+	PutInt(&ds, locPtr->srcOffset);
+	PutInt(&ds, locPtr->numSrcBytes);
+    }
+
+    PutInt(&ds, eclPtr->nuloc);
+    for (i = 0;  i < eclPtr->nuloc;  i++) {
+	ECL *ePtr = &eclPtr->loc[i];
+
+	PutInt(&ds, ePtr->srcOffset);
+	PutInt(&ds, ePtr->nline);
+	for (j = 0;  j < ePtr->nline;  j++) {
+	    PutInt(&ds, ePtr->line[j]);
+	}
+    }
+    PutInt(&ds, eclPtr->litInfo.numEntries);
+    for (hPtr = Tcl_FirstHashEntry(&eclPtr->litInfo, &search);
+	    hPtr != NULL;  hPtr = Tcl_NextHashEntry(&search)) {
+	PutInt(&ds, PTR2INT(Tcl_GetHashKey(&eclPtr->litInfo, hPtr)));
+	PutInt(&ds, PTR2INT(Tcl_GetHashValue(hPtr)));
+    }
+
+    /*
+     * Seal the entry with a hash of its contents so that truncated or
+     * damaged entries are never decoded, then write it.
+     */
+
+    PutWide(&ds, (Tcl_WideInt) HashBytes(Tcl_DStringValue(&ds),
+	    Tcl_DStringLength(&ds)));
+
+    tmpPathPtr = Tcl_ObjPrintf("%s.%lx.%lx",
+	    Tcl_GetString(keyPtr->entryPathPtr),
+	    (unsigned long) PTR2INT(Tcl_GetCurrentThread()), TclpGetClicks());
+    Tcl_IncrRefCount(tmpPathPtr);
+    chan = Tcl_FSOpenFileChannel(NULL, tmpPathPtr, "w", 0644);
+    if (chan != NULL) {
+	Tcl_SetChannelOption(NULL, chan, "-translation", "binary");
+	written = Tcl_Write(chan, Tcl_DStringValue(&ds),
+		Tcl_DStringLength(&ds));
+	if ((Tcl_Close(NULL, chan) != TCL_OK)
+		|| (written != Tcl_DStringLength(&ds))
+		|| (Tcl_FSRenameFile(tmpPathPtr, keyPtr->entryPathPtr) != 0)) {
+	    Tcl_FSDeleteFile(tmpPathPtr);
+	}
+    }
+    Tcl_DecrRefCount(tmpPathPtr);
+    Tcl_DStringFree(&ds);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SaveAuxData --
+ *
+ *	Appends one auxiliary data item to a cache entry. Only the types
+ *	created by the core compilers are supported.
+ *
+ * Results:
+ *	Non-zero if the item was saved, zero if its type is not supported.
+ *
+ * Side effects:
+ *	Appends to the DString.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SaveAuxData(
+    Tcl_DString *dsPtr,
+    AuxData *auxDataPtr)
+{
+    const AuxDataType *typePtr = auxDataPtr->type;
+    int i, j;
+
+    PutBytes(dsPtr, typePtr->name, (int) strlen(typePtr->name));
+    if (typePtr == &tclJumptableInfoType) {
+	JumptableInfo *jtPtr = auxDataPtr->clientData;
+	Tcl_HashSearch search;
+	Tcl_HashEntry *hPtr;
+	const char *key;
+
+	PutInt(dsPtr, jtPtr->hashTable.numEntries);
+	for (hPtr = Tcl_FirstHashEntry(&jtPtr->hashTable, &search);
+		hPtr != NULL;  hPtr = Tcl_NextHashEntry(&search)) {
+	    key = Tcl_GetHashKey(&jtPtr->hashTable, hPtr);
+	    PutBytes(dsPtr, key, (int) strlen(key));
+	    PutInt(dsPtr, PTR2INT(Tcl_GetHashValue(hPtr)));
+	}
+    } else if (typePtr == &tclForeachInfoType) {
+	ForeachInfo *infoPtr = auxDataPtr->clientData;
+
+	PutInt(dsPtr, infoPtr->numLists);
+	PutInt(dsPtr, infoPtr->firstValueTemp);
+	PutInt(dsPtr, infoPtr->loopCtTemp);
+	for (i = 0;  i < infoPtr->numLists;  i++) {
+	    ForeachVarList *varListPtr = infoPtr->varLists[i];
+
+	    PutInt(dsPtr, varListPtr->numVars);
+	    for (j = 0;  j < varListPtr->numVars;  j++) {
+		PutInt(dsPtr, varListPtr->varIndexes[j]);
+	    }
+	}
+    } else if (typePtr == &tclDictUpdateInfoType) {
+	DictUpdateInfo *duiPtr = auxDataPtr->clientData;
+
+	PutInt(dsPtr, duiPtr->length);
+	for (i = 0;  i < duiPtr->length;  i++) {
+	    PutInt(dsPtr, duiPtr->varIndices[i]);
+	}
+    } else {
+	return 0;
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoadCachedByteCode --
+ *
+ *	Reads the cache entry of a sourced file and, if it is valid for the
+ *	script read from the file, rebuilds the CompileEnv it was saved from
+ *	and turns it into the script's ByteCode exactly as a compilation
+ *	would.
+ *
+ * Results:
+ *	Non-zero on a cache hit.
+ *
+ * Side effects:
+ *	On a cache hit, converts scriptPtr to a bytecode object and registers
+ *	its literals and location information with the interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LoadCachedByteCode(
+    Tcl_Interp *interp,		/* Interpreter that will evaluate the
+				 * script. */
+    Tcl_Obj *scriptPtr,		/* The script read from the file. */
+    CacheKey *keyPtr)		/* Identity of the file. */
+{
+    CacheReader reader;
+    CompileEnv compEnv;
+    ExtCmdLoc *eclPtr;
+    Tcl_Channel chan;
+    Tcl_Obj *entryPtr;
+    const unsigned char *bytes;
+    const char *script, *normPath;
+    int i, j, length, kind, numItems, normLength, hit = 0;
+    Tcl_WideUInt seal;
+
+    chan = Tcl_FSOpenFileChannel(NULL, keyPtr->entryPathPtr, "r", 0);
+    if (chan == NULL) {
+	return 0;
+    }
+    Tcl_SetChannelOption(NULL, chan, "-translation", "binary");
+    entryPtr = Tcl_NewObj();
+    Tcl_IncrRefCount(entryPtr);
+    if (Tcl_ReadChars(chan, entryPtr, -1, 0) < 0) {
+	Tcl_Close(NULL, chan);
+	Tcl_DecrRefCount(entryPtr);
+	return 0;
+    }
+    Tcl_Close(NULL, chan);
+
+    reader.cur = Tcl_GetByteArrayFromObj(entryPtr, &length);
+    if (length < (int) sizeof(Tcl_WideUInt)) {
+	goto done;
+    }
+    length -= sizeof(Tcl_WideUInt);
+    reader.end = reader.cur + length;
+    reader.failed = 0;
+    memcpy(&seal, reader.end, sizeof(Tcl_WideUInt));
+    if (seal != HashBytes((const char *) reader.cur, length)) {
+	goto done;
+    }
+
+    /*
+     * Check the header against this Tcl and the file.
+     */
+
+    normPath = TclGetStringFromObj(keyPtr->normPathPtr, &normLength);
+    bytes = GetBytes(&reader, CACHE_MAGIC_LENGTH);
+    if ((bytes == NULL)
+	    || (memcmp(bytes, CACHE_MAGIC, CACHE_MAGIC_LENGTH) != 0)
+	    || (GetInt(&reader) != CACHE_FORMAT_VERSION)
+	    || (GetInt(&reader) != CACHE_BYTE_ORDER)) {
+	goto done;
+    }
+    length = (int) strlen(TCL_PATCH_LEVEL);
+    if ((GetInt(&reader) != length)
+	    || ((bytes = GetBytes(&reader, length)) == NULL)
+	    || (memcmp(bytes, TCL_PATCH_LEVEL, (size_t) length) != 0)
+	    || (GetInt(&reader) != normLength)
+	    || ((bytes = GetBytes(&reader, normLength)) == NULL)
+	    || (memcmp(bytes, normPath, (size_t) normLength) != 0)
+	    || (GetWide(&reader) != keyPtr->mtime)
+	    || (GetInt(&reader) != keyPtr->numSrcBytes)
+	    || ((Tcl_WideUInt) GetWide(&reader) != keyPtr->hash)
+	    || ((Tcl_WideUInt) GetWide(&reader) != keyPtr->compileEnvHash)
+	    || reader.failed) {
+	goto done;
+    }
+
+    /*
+     * The entry is for this very script. Rebuild its CompileEnv; this picks
+     * up the TIP #280 context of the sourced file just as compiling it
+     * would.
+     */
+
+    script = TclGetStringFromObj(scriptPtr, &length);
+    TclInitCompileEnv(interp, &compEnv, script, length, NULL, 0);
+    compEnv.numCommands = GetCount(&reader, 4 * sizeof(int));
+    compEnv.maxStackDepth = GetInt(&reader);
+    compEnv.maxExceptDepth = GetInt(&reader);
+
+    length = GetCount(&reader, 1);
+    bytes = GetBytes(&reader, length);
+    if (reader.failed || (length == 0)) {
+	goto freeEnv;
+    }
+    while ((compEnv.codeEnd - compEnv.codeStart) < length) {
+	TclExpandCodeArray(&compEnv);
+    }
+    memcpy(compEnv.codeStart, bytes, (size_t) length);
+    compEnv.codeNext = compEnv.codeStart + length;
+
+    numItems = GetCount(&reader, 2 * sizeof(int));
+    for (i = 0;  i < numItems;  i++) {
+	kind = GetInt(&reader);
+	length = GetCount(&reader, 1);
+	bytes = GetBytes(&reader, length);
+	if (reader.failed) {
+	    goto freeEnv;
+	}
+	if (kind == CACHED_PRIVATE_LITERAL) {
+	    TclAddLiteralObj(&compEnv,
+		    Tcl_NewStringObj((const char *) bytes, length), NULL);
+	} else if (TclRegisterLiteral(&compEnv, (char *) bytes, length,
+		(kind == CACHED_CMD_LITERAL) ? LITERAL_CMD_NAME : 0) != i) {
+	    /*
+	     * Not the literal layout that was saved.
+	     */
+
+	    goto freeEnv;
+	}
+    }
+
+    numItems = GetCount(&reader, 7 * sizeof(int));
+    for (i = 0;  i < numItems;  i++) {
+	ExceptionRange *rangePtr;
+
+	rangePtr = &compEnv.exceptArrayPtr[TclCreateExceptRange(
+		(ExceptionRangeType) GetInt(&reader), &compEnv)];
+	rangePtr->nestingLevel = GetInt(&reader);
+	rangePtr->codeOffset = GetInt(&reader);
+	rangePtr->numCodeBytes = GetInt(&reader);
+	rangePtr->breakOffset = GetInt(&reader);
+	rangePtr->continueOffset = GetInt(&reader);
+	rangePtr->catchOffset = GetInt(&reader);
+    }
+
+    numItems = GetCount(&reader, sizeof(int));
+    for (i = 0;  i < numItems;  i++) {
+	if (!LoadAuxData(&reader, &compEnv)) {
+	    goto freeEnv;
+	}
+    }
+
+    if (compEnv.numCommands > compEnv.cmdMapEnd) {
+	compEnv.cmdMapPtr = (CmdLocation *)
+		ckalloc(compEnv.numCommands * sizeof(CmdLocation));
+	compEnv.cmdMapEnd = compEnv.numCommands;
+	compEnv.mallocedCmdMap = 1;
+    }
+    for (i = 0;  i < compEnv.numCommands;  i++) {
+	CmdLocation *locPtr = &compEnv.cmdMapPtr[i];
+
+	locPtr->codeOffset = GetInt(&reader);
+	locPtr->numCodeBytes = GetInt(&reader);
+	locPtr->srcOffset = GetInt(&reader);
+	locPtr->numSrcBytes = GetInt(&reader);
+    }
+
+    eclPtr = compEnv.extCmdMapPtr;
+    numItems = GetCount(&reader, 2 * sizeof(int));
+    if (numItems > 0) {
+	eclPtr->loc = (ECL *) ckalloc(numItems * sizeof(ECL));
+	eclPtr->nloc = numItems;
+    }
+    for (i = 0;  i < numItems;  i++) {
+	ECL *ePtr = &eclPtr->loc[i];
+
+	ePtr->srcOffset = GetInt(&reader);
+	ePtr->nline = GetCount(&reader, sizeof(int));
+	ePtr->line = (int *) ckalloc(ePtr->nline * sizeof(int));
+	ePtr->next = NULL;
+	eclPtr->nuloc++;
+	for (j = 0;  j < ePtr->nline;  j++) {
+	    ePtr->line[j] = GetInt(&reader);
+	}
+    }
+    numItems = GetCount(&reader, 2 * sizeof(int));
+    for (i = 0;  i < numItems;  i++) {
+	int pc = GetInt(&reader);
+	int isNew;
+	Tcl_HashEntry *hPtr = Tcl_CreateHashEntry(&eclPtr->litInfo,
+		INT2PTR(pc), &isNew);
+
+	Tcl_SetHashValue(hPtr, INT2PTR(GetInt(&reader)));
+    }
+
+    if (reader.failed || (reader.cur != reader.end)) {
+	goto freeEnv;
+    }
+
+    TclInitByteCodeObj(scriptPtr, &compEnv);
+    TclFreeCompileEnv(&compEnv);
+    hit = 1;
+    goto done;
+
+  freeEnv:
+    FreeLoadedEnv(interp, &compEnv);
+
+  done:
+    Tcl_DecrRefCount(entryPtr);
+    return hit;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoadAuxData --
+ *
+ *	Decodes one auxiliary data item of a cache entry and adds it to the
+ *	CompileEnv being rebuilt.
+ *
+ * Results:
+ *	Non-zero on success, zero if the item is inconsistent or of an
+ *	unknown type.
+ *
+ * Side effects:
+ *	Allocates the auxiliary data.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LoadAuxData(
+    CacheReader *readerPtr,
+    CompileEnv *envPtr)
+{
+    const AuxDataType *typePtr = NULL;
+    const unsigned char *name;
+    int i, j, length, numItems;
+
+    length = GetCount(readerPtr, 1);
+    name = GetBytes(readerPtr, length);
+    if (readerPtr->failed) {
+	return 0;
+    }
+    for (i = 0;  cachedAuxDataTypes[i] != NULL;  i++) {
+	if ((strlen(cachedAuxDataTypes[i]->name) == (size_t) length)
+		&& (memcmp(cachedAuxDataTypes[i]->name, name,
+		(size_t) length) == 0)) {
+	    typePtr = cachedAuxDataTypes[i];
+	    break;
+	}
+    }
+
+    if (typePtr == &tclJumptableInfoType) {
+	JumptableInfo *jtPtr = (JumptableInfo *) ckalloc(sizeof(JumptableInfo));
+
+	Tcl_InitHashTable(&jtPtr->hashTable, TCL_STRING_KEYS);
+	TclCreateAuxData(jtPtr, typePtr, envPtr);
+	numItems = GetCount(readerPtr, 2 * sizeof(int));
+	for (i = 0;  i < numItems;  i++) {
+	    Tcl_DString key;
+	    Tcl_HashEntry *hPtr;
+	    int isNew;
+
+	    length = GetCount(readerPtr, 1);
+	    name = GetBytes(readerPtr, length);
+	    if (readerPtr->failed) {
+		return 0;
+	    }
+	    Tcl_DStringInit(&key);
+	    Tcl_DStringAppend(&key, (const char *) name, length);
+	    hPtr = Tcl_CreateHashEntry(&jtPtr->hashTable,
+		    Tcl_DStringValue(&key), &isNew);
+	    Tcl_DStringFree(&key);
+	    Tcl_SetHashValue(hPtr, INT2PTR(GetInt(readerPtr)));
+	}
+    } else if (typePtr == &tclForeachInfoType) {
+	ForeachInfo *infoPtr;
+
+	numItems = GetCount(readerPtr, 3 * sizeof(int));
+	infoPtr = (ForeachInfo *) ckalloc((unsigned)
+		sizeof(ForeachInfo) + numItems*sizeof(ForeachVarList *));
+	infoPtr->numLists = 0;
+	infoPtr->firstValueTemp = GetInt(readerPtr);
+	infoPtr->loopCtTemp = GetInt(readerPtr);
+	TclCreateAuxData(infoPtr, typePtr, envPtr);
+	for (i = 0;  i < numItems;  i++) {
+	    ForeachVarList *varListPtr;
+	    int numVars = GetCount(readerPtr, sizeof(int));
+
+	    varListPtr = (ForeachVarList *) ckalloc((unsigned)
+		    sizeof(ForeachVarList) + numVars*sizeof(int));
+	    varListPtr->numVars = numVars;
+	    for (j = 0;  j < numVars;  j++) {
+		varListPtr->varIndexes[j] = GetInt(readerPtr);
+	    }
+	    infoPtr->varLists[i] = varListPtr;
+	    infoPtr->numLists++;
+	}
+    } else if (typePtr == &tclDictUpdateInfoType) {
+	DictUpdateInfo *duiPtr;
+
+	numItems = GetCount(readerPtr, sizeof(int));
+	duiPtr = (DictUpdateInfo *) ckalloc((unsigned)
+		sizeof(DictUpdateInfo) + numItems*sizeof(int));
+	duiPtr->length = numItems;
+	for (i = 0;  i < numItems;  i++) {
+	    duiPtr->varIndices[i] = GetInt(readerPtr);
+	}
+	TclCreateAuxData(duiPtr, typePtr, envPtr);
+    } else {
+	return 0;
+    }
+    return !readerPtr->failed;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeLoadedEnv --
+ *
+ *	Releases a partially rebuilt CompileEnv when a cache entry turns out
+ *	to be unusable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Releases the literals, auxiliary data and location information added
+ *	to the CompileEnv so far, then the CompileEnv itself.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeLoadedEnv(
+    Tcl_Interp *interp,
+    CompileEnv *envPtr)
+{
+    ExtCmdLoc *eclPtr = envPtr->extCmdMapPtr;
+    int i;
+
+    for (i = 0;  i < envPtr->literalArrayNext;  i++) {
+	TclReleaseLiteral(interp, envPtr->literalArrayPtr[i].objPtr);
+    }
+    for (i = 0;  i < envPtr->auxDataArrayNext;  i++) {
+	AuxData *auxDataPtr = &envPtr->auxDataArrayPtr[i];
+
+	if (auxDataPtr->type->freeProc != NULL) {
+	    auxDataPtr->type->freeProc(auxDataPtr->clientData);
+	}
+    }
+    for (i = 0;  i < eclPtr->nuloc;  i++) {
+	ckfree((char *) eclPtr->loc[i].line);
+    }
+    if (eclPtr->loc != NULL) {
+	ckfree((char *) eclPtr->loc);
+    }
+    if (eclPtr->path != NULL) {
+	Tcl_DecrRefCount(eclPtr->path);
+    }
+    Tcl_DeleteHashTable(&eclPtr->litInfo);
+    TclFreeCompileEnv(envPtr);
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
@@ -209,6 +209,82 @@ TclCompileAppendCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompileBinaryScanCmd --
+ *
+ *	Procedure called to compile the "binary scan" command.
+ *
+ * Results:
+ *	Returns TCL_OK for a successful compile. Returns TCL_ERROR to defer
+ *	evaluation to runtime.
+ *
+ * Side effects:
+ *	Instructions are added to envPtr to execute the "binary scan" command
+ *	at runtime.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclCompileBinaryScanCmd(
+    Tcl_Interp *interp,		/* Used for looking up stuff. */
+    Tcl_Parse *parsePtr,	/* Points to a parse structure for the command
+				 * created by Tcl_ParseCommand. */
+    Command *cmdPtr,		/* Points to defintion of command being
+				 * compiled. */
+    CompileEnv *envPtr)		/* Holds resulting instructions. */
+{
+    DefineLineInformation;	/* TIP #280 */
+    Tcl_Token *valueTokenPtr, *formatTokenPtr, *tokenPtr;
+    DictUpdateInfo *infoPtr;
+    int i, numVars, infoIndex;
+
+    /*
+     * Only compile the case where all the variables are local scalars that
+     * are knowable at compile time, so that the values can be stored
+     * straight into the local variable table.
+     */
+
+    if (parsePtr->numWords < 4) {
+	return TCL_ERROR;
+    }
+    numVars = parsePtr->numWords - 3;
+    valueTokenPtr = TokenAfter(parsePtr->tokenPtr);
+    formatTokenPtr = TokenAfter(valueTokenPtr);
+
+    /*
+     * The list of variable indices has the same form as for [dict update],
+     * so the same kind of auxiliary data holds it.
+     */
+
+    infoPtr = (DictUpdateInfo *)
+	    ckalloc(sizeof(DictUpdateInfo) + sizeof(int) * (numVars - 1));
+    infoPtr->length = numVars;
+    tokenPtr = formatTokenPtr;
+    for (i=0 ; i<numVars ; i++) {
+	tokenPtr = TokenAfter(tokenPtr);
+	if (tokenPtr->type != TCL_TOKEN_SIMPLE_WORD
+		|| !TclIsLocalScalar(tokenPtr[1].start, tokenPtr[1].size)) {
+	    ckfree((char *) infoPtr);
+	    return TCL_ERROR;
+	}
+	infoPtr->varIndices[i] = TclFindCompiledLocal(tokenPtr[1].start,
+		tokenPtr[1].size, 1, envPtr);
+	if (infoPtr->varIndices[i] < 0) {
+	    ckfree((char *) infoPtr);
+	    return TCL_ERROR;
+	}
+    }
+    infoIndex = TclCreateAuxData(infoPtr, &tclDictUpdateInfoType, envPtr);
+
+    CompileWord(envPtr, valueTokenPtr, interp, 1);
+    CompileWord(envPtr, formatTokenPtr, interp, 2);
+    TclEmitInstInt4(INST_BINARY_SCAN, infoIndex, envPtr);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -29,6 +29,13 @@ static void		FreeJumptableInfo(ClientData clientData);
 static void		PrintJumptableInfo(ClientData clientData,
 			    Tcl_Obj *appendObj, ByteCode *codePtr,
 			    unsigned int pcOffset);
+static ClientData	DupNumericSetInfo(ClientData clientData);
+static void		FreeNumericSetInfo(ClientData clientData);
+static void		PrintNumericSetInfo(ClientData clientData,
+			    Tcl_Obj *appendObj, ByteCode *codePtr,
+			    unsigned int pcOffset);
+static void		PrefixNumericSet(CompileEnv *envPtr, int localIndex,
+			    int valueOffset, int storeOffset, int firstCmd);
 static int		PushVarName(Tcl_Interp *interp,
 			    Tcl_Token *varTokenPtr, CompileEnv *envPtr,
 			    int flags, int *localIndexPtr,
@@ -128,6 +135,13 @@ const AuxDataType tclJumptableInfoType = {
     PrintJumptableInfo		/* printProc */
 };
 
+const AuxDataType tclNumericSetInfoType = {
+    "NumericSetInfo",		/* name */
+    DupNumericSetInfo,		/* dupProc */
+    FreeNumericSetInfo,		/* freeProc */
+    PrintNumericSetInfo		/* printProc */
+};
+
 /*
  * Shorthand macros for instruction issuing.
  */
@@ -179,6 +193,7 @@ TclCompileSetCmd(
 {
     Tcl_Token *varTokenPtr, *valueTokenPtr;
     int isAssignment, isScalar, simpleVarName, localIndex, numWords;
+    int valueOffset = 0, storeOffset, firstCmd = 0;
     DefineLineInformation;	/* TIP #280 */
 
     numWords = parsePtr->numWords;
@@ -205,6 +220,8 @@ TclCompileSetCmd(
 
     if (isAssignment) {
 	valueTokenPtr = TokenAfter(varTokenPtr);
+	valueOffset = CurrentOffset(envPtr);
+	firstCmd = envPtr->numCommands;
 	CompileWord(envPtr, valueTokenPtr, interp, 2);
     }
 
@@ -212,6 +229,7 @@ TclCompileSetCmd(
      * Emit instructions to set/get the variable.
      */
 
+    storeOffset = CurrentOffset(envPtr);
     if (simpleVarName) {
 	if (isScalar) {
 	    if (localIndex < 0) {
@@ -245,8 +263,177 @@ TclCompileSetCmd(
 	TclEmitOpcode((isAssignment? INST_STORE_STK : INST_LOAD_STK), envPtr);
     }
 
+    if (isAssignment && simpleVarName && isScalar && (localIndex >= 0)) {
+	PrefixNumericSet(envPtr, localIndex, valueOffset, storeOffset,
+		firstCmd);
+    }
+
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefixNumericSet --
+ *
+ *	Called by TclCompileSetCmd once it has compiled an assignment to a
+ *	local scalar. If the value was compiled to arithmetic on locals and
+ *	numeric constants only, as for [set x [expr {$x + $y*2}]], or is an
+ *	integer constant, the arithmetic is recorded in a NumericSetInfo and
+ *	an INST_NUMERIC_SET is inserted ahead of the code of the value. It
+ *	computes and assigns the value on unboxed numbers, then skips that
+ *	code and the store, which are kept as the generic path. Whether the
+ *	instruction is used at all is only decided when the whole body has
+ *	been compiled; see InferNumericLocals in tclCompile.c.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May insert an instruction at valueOffset, moving the code after it
+ *	and the commands compiled from substitutions in the value.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PrefixNumericSet(
+    CompileEnv *envPtr,		/* Holds the instructions of the [set]. */
+    int localIndex,		/* Index of the local that is assigned. */
+    int valueOffset,		/* Offset of the code of the value. */
+    int storeOffset,		/* Offset of the store into the local. */
+    int firstCmd)		/* Index of the first command compiled in the
+				 * value, if any. */
+{
+    NumericSetOp ops[NUMERIC_SET_MAX_OPS];
+    NumericSetInfo *infoPtr;
+    unsigned char *pc, *limitPc = envPtr->codeStart + storeOffset;
+    int numOps = 0, depth = 0, lastOpcode = INST_NOP;
+    int index, type, auxIndex, i;
+    Tcl_Obj *objPtr = NULL;
+    ClientData ptr;
+
+    for (pc = envPtr->codeStart + valueOffset;  pc < limitPc;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	if (numOps == NUMERIC_SET_MAX_OPS) {
+	    return;
+	}
+	switch (*pc) {
+	case INST_LOAD_SCALAR1:
+	case INST_LOAD_SCALAR4:
+	    ops[numOps].type = NUMERIC_OP_LOCAL;
+	    ops[numOps].u.index = (*pc == INST_LOAD_SCALAR1
+		    ? TclGetUInt1AtPtr(pc+1) : (int) TclGetUInt4AtPtr(pc+1));
+	    depth++;
+	    break;
+	case INST_PUSH1:
+	case INST_PUSH4:
+	    index = (*pc == INST_PUSH1
+		    ? TclGetUInt1AtPtr(pc+1) : (int) TclGetUInt4AtPtr(pc+1));
+	    objPtr = envPtr->literalArrayPtr[index].objPtr;
+	    if (TclGetNumberFromObj(NULL, objPtr, &ptr, &type) != TCL_OK) {
+		return;
+	    }
+	    if (type == TCL_NUMBER_LONG) {
+		ops[numOps].type = NUMERIC_OP_LONG;
+		ops[numOps].u.longValue = *((const long *) ptr);
+	    } else if (type == TCL_NUMBER_DOUBLE) {
+		ops[numOps].type = NUMERIC_OP_DOUBLE;
+		ops[numOps].u.doubleValue = *((const double *) ptr);
+	    } else {
+		return;
+	    }
+	    depth++;
+	    break;
+	case INST_ADD:
+	case INST_SUB:
+	case INST_MULT:
+	case INST_DIV:
+	case INST_MOD:
+	    if (depth < 2) {
+		return;
+	    }
+	    ops[numOps].type = (*pc == INST_ADD ? NUMERIC_OP_ADD
+		    : *pc == INST_SUB ? NUMERIC_OP_SUB
+		    : *pc == INST_MULT ? NUMERIC_OP_MULT
+		    : *pc == INST_DIV ? NUMERIC_OP_DIV : NUMERIC_OP_MOD);
+	    depth--;
+	    break;
+	case INST_UMINUS:
+	    if (depth < 1) {
+		return;
+	    }
+	    ops[numOps].type = NUMERIC_OP_UMINUS;
+	    break;
+	case INST_TRY_CVT_TO_NUMERIC:
+	    /*
+	     * A no-op on ints and doubles, but for giving the result the
+	     * canonical string rep, which an assigned value always has.
+	     */
+
+	    lastOpcode = *pc;
+	    continue;
+	default:
+	    return;
+	}
+	if (depth > NUMERIC_SET_MAX_DEPTH) {
+	    return;
+	}
+	lastOpcode = *pc;
+	numOps++;
+    }
+    if (depth != 1) {
+	return;
+    }
+
+    /*
+     * Plain [set x $y] and [set x 1.0] keep the string of their value,
+     * which the computed value would not. [set x 0] is done, as integer
+     * constants are mostly written in the canonical form.
+     */
+
+    if ((lastOpcode == INST_LOAD_SCALAR1)
+	    || (lastOpcode == INST_LOAD_SCALAR4)) {
+	return;
+    }
+    if ((lastOpcode == INST_PUSH1) || (lastOpcode == INST_PUSH4)) {
+	char buf[TCL_INTEGER_SPACE];
+
+	if (ops[0].type != NUMERIC_OP_LONG) {
+	    return;
+	}
+	sprintf(buf, "%ld", ops[0].u.longValue);
+	if (strcmp(buf, TclGetString(objPtr)) != 0) {
+	    return;
+	}
+    }
+
+    infoPtr = (NumericSetInfo *) ckalloc(sizeof(NumericSetInfo)
+	    + (numOps - 1) * sizeof(NumericSetOp));
+    infoPtr->varIndex = localIndex;
+    infoPtr->numOps = numOps;
+    memcpy(infoPtr->ops, ops, numOps * sizeof(NumericSetOp));
+    auxIndex = TclCreateAuxData(infoPtr, &tclNumericSetInfoType, envPtr);
+
+    /*
+     * Make room for the instruction ahead of the value. Only code and the
+     * location of commands in it move: the value holds no jumps and has no
+     * exception ranges.
+     */
+
+    if ((envPtr->codeNext + 9) > envPtr->codeEnd) {
+	TclExpandCodeArray(envPtr);
+    }
+    pc = envPtr->codeStart + valueOffset;
+    memmove(pc + 9, pc, (size_t) (envPtr->codeNext - pc));
+    envPtr->codeNext += 9;
+    *pc = INST_NUMERIC_SET;
+    TclStoreInt4AtPtr(auxIndex, pc + 1);
+    TclStoreInt4AtPtr(envPtr->codeNext - pc, pc + 5);
+    for (i = firstCmd;  i < envPtr->numCommands;  i++) {
+	envPtr->cmdMapPtr[i].codeOffset += 9;
+    }
+}
 
 /*
  *----------------------------------------------------------------------
@@ -1804,6 +1991,84 @@ PrintJumptableInfo(
 		keyPtr, pcOffset + offset);
     }
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupNumericSetInfo, FreeNumericSetInfo, PrintNumericSetInfo --
+ *
+ *	Functions to duplicate, release and print the expression of an
+ *	INST_NUMERIC_SET instruction.
+ *
+ * Results:
+ *	DupNumericSetInfo: a copy of the expression
+ *	FreeNumericSetInfo: none
+ *	PrintNumericSetInfo: none
+ *
+ * Side effects:
+ *	DupNumericSetInfo: allocates memory
+ *	FreeNumericSetInfo: releases memory
+ *	PrintNumericSetInfo: none
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClientData
+DupNumericSetInfo(
+    ClientData clientData)
+{
+    NumericSetInfo *infoPtr = clientData, *newInfoPtr;
+    unsigned len = sizeof(NumericSetInfo)
+	    + (infoPtr->numOps - 1) * sizeof(NumericSetOp);
+
+    newInfoPtr = (NumericSetInfo *) ckalloc(len);
+    memcpy(newInfoPtr, infoPtr, len);
+    return newInfoPtr;
+}
+
+static void
+FreeNumericSetInfo(
+    ClientData clientData)
+{
+    ckfree(clientData);
+}
+
+static void
+PrintNumericSetInfo(
+    ClientData clientData,
+    Tcl_Obj *appendObj,
+    ByteCode *codePtr,
+    unsigned int pcOffset)
+{
+    NumericSetInfo *infoPtr = clientData;
+    NumericSetOp *opPtr;
+    char buf[TCL_DOUBLE_SPACE];
+    int i;
+
+    Tcl_AppendPrintfToObj(appendObj, "%%v%u <-", infoPtr->varIndex);
+    for (i = 0;  i < infoPtr->numOps;  i++) {
+	opPtr = &infoPtr->ops[i];
+	switch (opPtr->type) {
+	case NUMERIC_OP_LOCAL:
+	    Tcl_AppendPrintfToObj(appendObj, " %%v%u", opPtr->u.index);
+	    break;
+	case NUMERIC_OP_LONG:
+	    Tcl_AppendPrintfToObj(appendObj, " %ld", opPtr->u.longValue);
+	    break;
+	case NUMERIC_OP_DOUBLE:
+	    Tcl_PrintDouble(NULL, opPtr->u.doubleValue, buf);
+	    Tcl_AppendPrintfToObj(appendObj, " %s", buf);
+	    break;
+	case NUMERIC_OP_UMINUS:
+	    Tcl_AppendToObj(appendObj, " neg", -1);
+	    break;
+	default:
+	    Tcl_AppendPrintfToObj(appendObj, " %c",
+		    "+-*/%"[opPtr->type - NUMERIC_OP_ADD]);
+	    break;
+	}
+    }
+}
 
 /*
  *----------------------------------------------------------------------
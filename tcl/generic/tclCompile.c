@@ -423,6 +423,31 @@ InstructionDesc const tclInstructionTable[] = {
 	/* Make general variable cease to exist; unparsed variable name is
 	 * stktop; op1 is 1 for errors on problems, 0 otherwise */
 
+    {"loadScalar1Arith", 2,    1,         1,	{OPERAND_LVT1}},
+	/* loadScalar1 followed by add, sub, mult, div or expon */
+    {"loadScalar1Cmp",	 2,    1,         1,	{OPERAND_LVT1}},
+	/* loadScalar1 followed by eq, neq, lt, gt, le or ge (and possibly by
+	 * a conditional jump, as with the unfused comparison) */
+    {"loadScalar1Incr",	 2,    1,         1,	{OPERAND_LVT1}},
+	/* loadScalar1 followed by incrScalar1 */
+    {"push1Arith",	 2,    1,         1,	{OPERAND_UINT1}},
+	/* push1 followed by add, sub, mult, div or expon */
+    {"push1Cmp",	 2,    1,         1,	{OPERAND_UINT1}},
+	/* push1 followed by eq, neq, lt, gt, le or ge */
+
+    {"binaryScan",	 5,    -1,        1,	{OPERAND_AUX4}},
+	/* [binary scan] of the value under the format at stktop into the
+	 * local variables listed in the aux data; the stack items are
+	 * replaced with the number of variables set */
+
+    {"numericSet",	 9,    0,         2,	{OPERAND_AUX4, OPERAND_INT4}},
+	/* Compute the expression in the aux data on unboxed numbers, assign
+	 * it to the numeric local given there, push it and jump by op4#2,
+	 * past the generic code that follows for the same [set]. If an
+	 * operand is not an int or double, or the result needs more than
+	 * that, go on with the generic code instead. The stack is as if that
+	 * code had been run. */
+
     {NULL, 0, 0, 0, {OPERAND_NONE}}
 };
 
@@ -442,7 +467,18 @@ static void		EnterCmdStartData(CompileEnv *envPtr,
 			    int cmdNumber, int srcOffset, int codeOffset);
 static void		FreeByteCodeInternalRep(Tcl_Obj *objPtr);
 static void		FreeSubstCodeInternalRep(Tcl_Obj *objPtr);
+static void		FuseInstructions(unsigned char *codeStart,
+			    unsigned char *codeLimit);
 static int		GetCmdLocEncodingSize(CompileEnv *envPtr);
+static void		InferNumericLocals(CompileEnv *envPtr,
+			    unsigned char *codeStart,
+			    unsigned char *codeLimit);
+static unsigned char *	InitTypeFeedback(unsigned char *codeStart,
+			    size_t codeBytes);
+static int		IsNumericValue(CompileEnv *envPtr,
+			    unsigned char *pc, unsigned char *prevPc,
+			    unsigned char *codeStart, const char *isTarget,
+			    const char *isNumeric);
 #ifdef TCL_COMPILE_STATS
 static void		RecordByteCodeStats(ByteCode *codePtr);
 #endif /* TCL_COMPILE_STATS */
@@ -813,8 +849,8 @@ TclCleanupByteCode(
      * command location, and auxiliary data arrays. This means we only need to
      * 1) decrement the ref counts of the LiteralEntry's in its literal array,
      * 2) call the free procs for the auxiliary data items, 3) free the
-     * localCache if it is unused, and finally 4) free the ByteCode
-     * structure's heap object.
+     * localCache if it is unused, 4) free the type feedback array, and
+     * finally 5) free the ByteCode structure's heap object.
      *
      * The case for TCL_BYTECODE_PRECOMPILED (precompiled ByteCodes, like
      * those generated from tbcload) is special, as they doesn't make use of
@@ -901,6 +937,10 @@ TclCleanupByteCode(
 	TclFreeLocalCache(interp, codePtr->localCachePtr);
     }
 
+    if (codePtr->typeFeedback != NULL) {
+	ckfree((char *) codePtr->typeFeedback);
+    }
+
     TclHandleRelease(codePtr->interpHandle);
     ckfree((char *) codePtr);
 }
@@ -1517,6 +1557,9 @@ TclCompileScript(
 	if (parsePtr->numWords > 0) {
 	    int expand = 0;	/* Set if there are dynamic expansions to
 				 * handle */
+	    int methodSite;	/* Set if the command may be a method call,
+				 * so its method name gets a literal of its
+				 * own. */
 
 	    /*
 	     * If not the first command, pop the previous command's result
@@ -1574,6 +1617,21 @@ TclCompileScript(
 		}
 	    }
 
+	    /*
+	     * A command whose name is not a literal (such as [$obj method] or
+	     * [[self] method]), or which is [my], is most likely a method call.
+	     * TclOO caches the call chains of a method in its name's Tcl_Obj, so
+	     * a method name literal private to the call site makes that a cache
+	     * per call site instead of one shared by every use of the name in
+	     * the interpreter.
+	     */
+
+	    tokenPtr = parsePtr->tokenPtr;
+	    methodSite = (parsePtr->numWords > 1)
+		    && ((tokenPtr->type != TCL_TOKEN_SIMPLE_WORD)
+		    || ((tokenPtr[1].size == 2)
+		    && (strncmp(tokenPtr[1].start, "my", 2) == 0)));
+
 	    envPtr->numCommands++;
 	    currCmdIndex = envPtr->numCommands - 1;
 	    lastTopLevelCmdIndex = currCmdIndex;
@@ -1766,8 +1824,13 @@ TclCompileScript(
 		     * unmodified. We care only if the we are in a context
 		     * which already allows absolute counting.
 		     */
-		    objIndex = TclRegisterNewLiteral(envPtr,
-			    tokenPtr[1].start, tokenPtr[1].size);
+		    if ((wordIdx == 1) && methodSite) {
+			objIndex = TclAddLiteralObj(envPtr, Tcl_NewStringObj(
+				tokenPtr[1].start, tokenPtr[1].size), NULL);
+		    } else {
+			objIndex = TclRegisterNewLiteral(envPtr,
+				tokenPtr[1].start, tokenPtr[1].size);
+		    }
 
 		    if (envPtr->clNext) {
 			TclContinuationsEnterDerived(
@@ -2435,6 +2498,9 @@ TclInitByteCodeObj(
     p += sizeof(ByteCode);
     codePtr->codeStart = p;
     memcpy(p, envPtr->codeStart, (size_t) codeBytes);
+    InferNumericLocals(envPtr, p, p + codeBytes);
+    FuseInstructions(p, p + codeBytes);
+    codePtr->typeFeedback = InitTypeFeedback(p, codeBytes);
 
     p += TCL_ALIGN(codeBytes);		/* align object array */
     codePtr->objArrayPtr = (Tcl_Obj **) p;
@@ -3509,6 +3575,416 @@ TclFinalizeAuxDataTypeTable(void)
     Tcl_MutexUnlock(&tableMutex);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * InferNumericLocals --
+ *
+ *	Pass over newly compiled bytecode that finds the locals of a proc
+ *	that only ever hold numbers, and keeps the INST_NUMERIC_SET
+ *	instructions that assign to them (see PrefixNumericSet in
+ *	tclCompCmdsSZ.c). Those, and [incr], update the Tcl_Obj of such a
+ *	local in place while nothing else holds it, so that it serves as an
+ *	unboxed slot whose string rep is only made when something asks for
+ *	it, such as [upvar], [info locals] or a trace. The other
+ *	INST_NUMERIC_SETs are turned into a jump to the generic code that
+ *	follows them.
+ *
+ *	A local is numeric-only when it is not an argument, is not set by
+ *	foreach, dict update or another instruction with aux data, and is
+ *	only named by loads, [incr], [info exists] and stores of values made
+ *	by arithmetic, comparisons, numeric constants or loads of other
+ *	numeric-only locals. A store that is the target of a jump does not
+ *	count as numeric, as its value may come from the other branch. What
+ *	the bytecode does not show, such as an [upvar] in a called proc, a
+ *	trace or a variable written by name, is left to the checks that
+ *	INST_NUMERIC_SET makes at runtime.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Modifies the code between codeStart and codeLimit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InferNumericLocals(
+    CompileEnv *envPtr,		/* Compilation environment of the code. */
+    unsigned char *codeStart,	/* First byte of the code to rewrite. */
+    unsigned char *codeLimit)	/* Byte just after the last instruction. */
+{
+    Proc *procPtr = envPtr->procPtr;
+    int numLocals = (procPtr ? procPtr->numCompiledLocals : 0);
+    int numBytes = codeLimit - codeStart;
+    unsigned char *pc, *prevPc, *prev2Pc, *operandPc;
+    const InstructionDesc *instDescPtr;
+    char *isNumeric, *isTarget;
+    int i, j, index, offset, changed;
+
+    for (pc = codeStart; pc < codeLimit;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	if (*pc == INST_NUMERIC_SET) {
+	    break;
+	}
+    }
+    if (pc >= codeLimit) {
+	return;
+    }
+
+    isNumeric = ckalloc(numLocals + numBytes + 1);
+    isTarget = isNumeric + numLocals;
+    memset(isNumeric, 1, (size_t) numLocals);
+    memset(isTarget, 0, (size_t) numBytes + 1);
+    for (i = 0;  i < numLocals && i < procPtr->numArgs;  i++) {
+	isNumeric[i] = 0;
+    }
+
+    /*
+     * Find the instructions that can be reached other than from the one
+     * before them.
+     */
+
+#define MarkTarget(offset) \
+    if (((offset) >= 0) && ((offset) <= numBytes)) {			\
+	isTarget[(offset)] = 1;						\
+    }
+
+    for (pc = codeStart; pc < codeLimit;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	offset = pc - codeStart;
+	switch (*pc) {
+	case INST_JUMP1:
+	case INST_JUMP_TRUE1:
+	case INST_JUMP_FALSE1:
+	    MarkTarget(offset + TclGetInt1AtPtr(pc+1));
+	    break;
+	case INST_JUMP4:
+	case INST_JUMP_TRUE4:
+	case INST_JUMP_FALSE4:
+	case INST_START_CMD:
+	    MarkTarget(offset + TclGetInt4AtPtr(pc+1));
+	    break;
+	case INST_NUMERIC_SET:
+	    MarkTarget(offset + TclGetInt4AtPtr(pc+5));
+	    break;
+	case INST_JUMP_TABLE: {
+	    JumptableInfo *jtPtr = envPtr->auxDataArrayPtr[
+		    TclGetUInt4AtPtr(pc+1)].clientData;
+	    Tcl_HashSearch search;
+	    Tcl_HashEntry *hPtr;
+
+	    for (hPtr = Tcl_FirstHashEntry(&jtPtr->hashTable, &search);
+		    hPtr != NULL;  hPtr = Tcl_NextHashEntry(&search)) {
+		MarkTarget(offset + PTR2INT(Tcl_GetHashValue(hPtr)));
+	    }
+	    break;
+	}
+	}
+    }
+    for (i = 0;  i < envPtr->exceptArrayNext;  i++) {
+	ExceptionRange *rangePtr = &envPtr->exceptArrayPtr[i];
+
+	MarkTarget(rangePtr->codeOffset);
+	if (rangePtr->type == LOOP_EXCEPTION_RANGE) {
+	    MarkTarget(rangePtr->breakOffset);
+	    MarkTarget(rangePtr->continueOffset);
+	} else {
+	    MarkTarget(rangePtr->catchOffset);
+	}
+    }
+#undef MarkTarget
+
+    /*
+     * Rule out locals until a pass over the code rules out no more: a local
+     * that is stored the value of another one is ruled out with it.
+     */
+
+#define RuleOut(index) \
+    if (isNumeric[(index)]) {						\
+	isNumeric[(index)] = 0;						\
+	changed = 1;							\
+    }
+
+    do {
+	changed = 0;
+	prevPc = prev2Pc = NULL;
+	for (pc = codeStart; pc < codeLimit; prev2Pc = prevPc, prevPc = pc,
+		pc += tclInstructionTable[*pc].numBytes) {
+	    switch (*pc) {
+	    case INST_LOAD_SCALAR1:
+	    case INST_LOAD_SCALAR4:
+	    case INST_INCR_SCALAR1:
+	    case INST_INCR_SCALAR1_IMM:
+	    case INST_EXIST_SCALAR:
+		continue;
+	    case INST_STORE_SCALAR1:
+	    case INST_STORE_SCALAR4:
+		index = (*pc == INST_STORE_SCALAR1
+			? TclGetUInt1AtPtr(pc+1) : (int) TclGetUInt4AtPtr(pc+1));
+		if (isTarget[pc - codeStart] || !IsNumericValue(envPtr,
+			prevPc, prev2Pc, codeStart, isTarget, isNumeric)) {
+		    RuleOut(index);
+		}
+		continue;
+	    }
+
+	    /*
+	     * Any other use of a local rules it out.
+	     */
+
+	    instDescPtr = &tclInstructionTable[*pc];
+	    operandPc = pc + 1;
+	    for (i = 0;  i < instDescPtr->numOperands;  i++) {
+		switch (instDescPtr->opTypes[i]) {
+		case OPERAND_INT1:
+		case OPERAND_UINT1:
+		    operandPc++;
+		    break;
+		case OPERAND_LVT1:
+		    RuleOut(TclGetUInt1AtPtr(operandPc));
+		    operandPc++;
+		    break;
+		case OPERAND_LVT4:
+		    RuleOut(TclGetUInt4AtPtr(operandPc));
+		    operandPc += 4;
+		    break;
+		case OPERAND_AUX4: {
+		    AuxData *auxPtr = &envPtr->auxDataArrayPtr[
+			    TclGetUInt4AtPtr(operandPc)];
+
+		    if (auxPtr->type == &tclForeachInfoType) {
+			ForeachInfo *infoPtr = auxPtr->clientData;
+
+			for (j = 0;  j < infoPtr->numLists;  j++) {
+			    ForeachVarList *varListPtr = infoPtr->varLists[j];
+
+			    for (index = 0;  index < varListPtr->numVars;
+				    index++) {
+				RuleOut(varListPtr->varIndexes[index]);
+			    }
+			}
+		    } else if (auxPtr->type == &tclDictUpdateInfoType) {
+			DictUpdateInfo *duiPtr = auxPtr->clientData;
+
+			for (j = 0;  j < duiPtr->length;  j++) {
+			    RuleOut(duiPtr->varIndices[j]);
+			}
+		    } else if ((auxPtr->type != &tclJumptableInfoType)
+			    && (auxPtr->type != &tclNumericSetInfoType)) {
+			for (j = 0;  j < numLocals;  j++) {
+			    RuleOut(j);
+			}
+		    }
+		    operandPc += 4;
+		    break;
+		}
+		default:
+		    operandPc += 4;
+		    break;
+		}
+	    }
+	}
+    } while (changed);
+#undef RuleOut
+
+    for (pc = codeStart; pc < codeLimit;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	NumericSetInfo *infoPtr;
+
+	if (*pc != INST_NUMERIC_SET) {
+	    continue;
+	}
+	infoPtr = envPtr->auxDataArrayPtr[TclGetUInt4AtPtr(pc+1)].clientData;
+	if ((infoPtr->varIndex >= numLocals)
+		|| !isNumeric[infoPtr->varIndex]) {
+	    TclUpdateInstInt4AtPc(INST_JUMP4, 9, pc);
+	    memset(pc + 5, INST_NOP, 4);
+	}
+    }
+    ckfree(isNumeric);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsNumericValue --
+ *
+ *	Helper for InferNumericLocals that tells whether the instruction at
+ *	pc, when run after the one at prevPc, leaves a number on top of the
+ *	stack.
+ *
+ * Results:
+ *	1 if the value is a number, 0 if it may not be.
+ *
+ * Side effects:
+ *	Numeric literals are given their numeric internal rep.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+IsNumericValue(
+    CompileEnv *envPtr,		/* Compilation environment of the code. */
+    unsigned char *pc,		/* The instruction, or NULL. */
+    unsigned char *prevPc,	/* The instruction before it, or NULL. */
+    unsigned char *codeStart,	/* First byte of the code. */
+    const char *isTarget,	/* Which instructions are jump targets. */
+    const char *isNumeric)	/* Which locals are numeric-only so far. */
+{
+    ClientData ptr;
+    int index, type;
+
+    if (pc == NULL) {
+	return 0;
+    }
+    switch (*pc) {
+    case INST_PUSH1:
+    case INST_PUSH4:
+	index = (*pc == INST_PUSH1
+		? TclGetUInt1AtPtr(pc+1) : (int) TclGetUInt4AtPtr(pc+1));
+	if (TclGetNumberFromObj(NULL, envPtr->literalArrayPtr[index].objPtr,
+		&ptr, &type) != TCL_OK) {
+	    return 0;
+	}
+	return (type == TCL_NUMBER_LONG) || (type == TCL_NUMBER_DOUBLE);
+    case INST_LOAD_SCALAR1:
+	return isNumeric[TclGetUInt1AtPtr(pc+1)];
+    case INST_LOAD_SCALAR4:
+	return isNumeric[TclGetUInt4AtPtr(pc+1)];
+    case INST_TRY_CVT_TO_NUMERIC:
+	/*
+	 * Numeric if its operand is; that is the instruction before it, when
+	 * nothing jumps to it.
+	 */
+
+	if (isTarget[pc - codeStart]) {
+	    return 0;
+	}
+	return IsNumericValue(envPtr, prevPc, NULL, codeStart, isTarget,
+		isNumeric);
+    case INST_EXPON:
+    case INST_STR_EQ:
+    case INST_STR_NEQ:
+    case INST_STR_CMP:
+    case INST_STR_LEN:
+    case INST_LIST_LENGTH:
+    case INST_LIST_IN:
+    case INST_LIST_NOT_IN:
+	return 1;
+    default:
+	return (*pc >= INST_LOR) && (*pc <= INST_LNOT);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FuseInstructions --
+ *
+ *	Peephole pass over newly compiled bytecode that turns frequent
+ *	instruction pairs into superinstructions, so that the second
+ *	instruction of the pair is run without a trip through instruction
+ *	dispatch. Only the opcode of the first instruction is rewritten;
+ *	operands and instruction lengths are unchanged and the second
+ *	instruction stays in place, so jump offsets, exception ranges and the
+ *	command location map remain valid, as does any jump to the second
+ *	instruction.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Modifies the code between codeStart and codeLimit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define IsArithOpcode(op) \
+    ((op) == INST_ADD || (op) == INST_SUB || (op) == INST_MULT \
+	    || (op) == INST_DIV || (op) == INST_EXPON)
+#define IsCompareOpcode(op) \
+    ((op) >= INST_EQ && (op) <= INST_GE)
+
+static void
+FuseInstructions(
+    unsigned char *codeStart,	/* First byte of the code to rewrite. */
+    unsigned char *codeLimit)	/* Byte just after the last instruction. */
+{
+    register unsigned char *pc, *nextPc;
+
+    for (pc = codeStart; pc < codeLimit; pc = nextPc) {
+	nextPc = pc + tclInstructionTable[*pc].numBytes;
+	if (nextPc >= codeLimit) {
+	    break;
+	}
+
+	switch (*pc) {
+	case INST_LOAD_SCALAR1:
+	    if (IsArithOpcode(*nextPc)) {
+		*pc = INST_LOAD_SCALAR1_ARITH;
+	    } else if (IsCompareOpcode(*nextPc)) {
+		*pc = INST_LOAD_SCALAR1_CMP;
+	    } else if (*nextPc == INST_INCR_SCALAR1) {
+		*pc = INST_LOAD_SCALAR1_INCR;
+	    }
+	    break;
+	case INST_PUSH1:
+	    if (IsArithOpcode(*nextPc)) {
+		*pc = INST_PUSH1_ARITH;
+	    } else if (IsCompareOpcode(*nextPc)) {
+		*pc = INST_PUSH1_CMP;
+	    }
+	    break;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitTypeFeedback --
+ *
+ *	Allocates the type feedback array for newly compiled bytecode. Every
+ *	arithmetic and comparison site starts as TYPE_FEEDBACK_NONE, except
+ *	INST_EXPON which has no specialized path and starts (and stays)
+ *	TYPE_FEEDBACK_MIXED.
+ *
+ * Results:
+ *	The new array, or NULL if the code contains no arithmetic or
+ *	comparison instructions.
+ *
+ * Side effects:
+ *	Allocates memory that must be freed with the ByteCode.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned char *
+InitTypeFeedback(
+    unsigned char *codeStart,	/* First byte of the code. */
+    size_t codeBytes)		/* Number of bytes of code. */
+{
+    unsigned char *feedback = NULL;
+    unsigned char *pc, *codeLimit = codeStart + codeBytes;
+
+    for (pc = codeStart; pc < codeLimit;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	if (!IsArithOpcode(*pc) && !IsCompareOpcode(*pc)) {
+	    continue;
+	}
+	if (feedback == NULL) {
+	    feedback = (unsigned char *) ckalloc(codeBytes);
+	    memset(feedback, TYPE_FEEDBACK_NONE, codeBytes);
+	}
+	if (*pc == INST_EXPON) {
+	    feedback[pc - codeStart] = TYPE_FEEDBACK_MIXED;
+	}
+    }
+    return feedback;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4158,7 +4634,8 @@ FormatInstruction(
 	case OPERAND_INT4:
 	    opnd = TclGetInt4AtPtr(pc+numBytes); numBytes += 4;
 	    if (opCode == INST_JUMP4 || opCode == INST_JUMP_TRUE4
-		    || opCode == INST_JUMP_FALSE4) {
+		    || opCode == INST_JUMP_FALSE4
+		    || opCode == INST_NUMERIC_SET) {
 		sprintf(suffixBuffer, "pc %u", pcOffset+opnd);
 	    } else if (opCode == INST_START_CMD) {
 		sprintf(suffixBuffer, "next cmd at pc %u", pcOffset+opnd);
@@ -4167,7 +4644,8 @@ FormatInstruction(
 	    break;
 	case OPERAND_UINT1:
 	    opnd = TclGetUInt1AtPtr(pc+numBytes); numBytes++;
-	    if (opCode == INST_PUSH1) {
+	    if (opCode == INST_PUSH1 || opCode == INST_PUSH1_ARITH
+		    || opCode == INST_PUSH1_CMP) {
 		suffixObj = codePtr->objArrayPtr[opnd];
 	    }
 	    Tcl_AppendPrintfToObj(bufferObj, "%u ", (unsigned) opnd);
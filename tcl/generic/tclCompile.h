@@ -443,11 +443,29 @@ typedef struct ByteCode {
     LocalCache *localCachePtr;	/* Pointer to the start of the cached variable
 				 * names and initialisation data for local
 				 * variables. */
+    unsigned char *typeFeedback;/* Operand type feedback for the arithmetic
+				 * and comparison instructions, one
+				 * TYPE_FEEDBACK_* byte per code byte indexed
+				 * by instruction offset. Separately allocated;
+				 * NULL if the code has no such
+				 * instructions. */
 #ifdef TCL_COMPILE_STATS
     Tcl_Time createTime;	/* Absolute time when the ByteCode was
 				 * created. */
 #endif /* TCL_COMPILE_STATS */
 } ByteCode;
+
+/*
+ * Values of the typeFeedback entries of a ByteCode. An arithmetic or
+ * comparison site starts out unseen, specializes on the numeric type of the
+ * first pair of operands it sees if both are of the same kind, and becomes
+ * (permanently) mixed once it sees anything else.
+ */
+
+#define TYPE_FEEDBACK_NONE	0	/* Site not executed yet. */
+#define TYPE_FEEDBACK_LONG	1	/* Only (long, long) operands seen. */
+#define TYPE_FEEDBACK_DOUBLE	2	/* Only (double, double) operands seen. */
+#define TYPE_FEEDBACK_MIXED	3	/* Polymorphic; never specialized. */
 
 /*
  * Opcodes for the Tcl bytecode instructions. These must correspond to the
@@ -678,8 +696,28 @@ typedef struct ByteCode {
 #define INST_UNSET_ARRAY_STK		136
 #define INST_UNSET_STK			137
 
+/*
+ * Superinstructions, produced only by the peephole pass in
+ * TclInitByteCodeObj. Each replaces the opcode of the first instruction of a
+ * pair and keeps the same operands; the second instruction is left intact
+ * (so it remains a valid jump target) and is executed without going through
+ * instruction dispatch.
+ */
+
+#define INST_LOAD_SCALAR1_ARITH		138
+#define INST_LOAD_SCALAR1_CMP		139
+#define INST_LOAD_SCALAR1_INCR		140
+#define INST_PUSH1_ARITH		141
+#define INST_PUSH1_CMP			142
+
+/* For [binary scan] compilation */
+#define INST_BINARY_SCAN		143
+
+/* For [set] of numeric-only locals */
+#define INST_NUMERIC_SET		144
+
 /* The last opcode */
-#define LAST_INST_OPCODE		137
+#define LAST_INST_OPCODE		144
 
 /*
  * Table describing the Tcl bytecode instructions: their name (for displaying
@@ -844,6 +882,47 @@ typedef struct {
 
 MODULE_SCOPE const AuxDataType tclDictUpdateInfoType;
 
+/*
+ * Structure used to hold the value of a [set] of a local scalar in a proc to
+ * an arithmetic expression, for INST_NUMERIC_SET. The expression is kept in
+ * postfix form over locals and numeric constants, so that it can be computed
+ * on unboxed longs and doubles. These structures are stored in CompileEnv and
+ * ByteCode structures as auxiliary data.
+ */
+
+#define NUMERIC_OP_LOCAL	0	/* Push the value of local u.index. */
+#define NUMERIC_OP_LONG		1	/* Push u.longValue. */
+#define NUMERIC_OP_DOUBLE	2	/* Push u.doubleValue. */
+#define NUMERIC_OP_ADD		3	/* Replace the top two values with */
+#define NUMERIC_OP_SUB		4	/* the result of the operator. */
+#define NUMERIC_OP_MULT		5
+#define NUMERIC_OP_DIV		6
+#define NUMERIC_OP_MOD		7
+#define NUMERIC_OP_UMINUS	8	/* Negate the top value. */
+
+#define NUMERIC_SET_MAX_OPS	32	/* Limits on the expressions given to */
+#define NUMERIC_SET_MAX_DEPTH	8	/* INST_NUMERIC_SET. */
+
+typedef struct NumericSetOp {
+    int type;			/* One of the NUMERIC_OP_* values above. */
+    union {
+	int index;		/* Index of the local, for NUMERIC_OP_LOCAL. */
+	long longValue;		/* Constant, for NUMERIC_OP_LONG. */
+	double doubleValue;	/* Constant, for NUMERIC_OP_DOUBLE. */
+    } u;
+} NumericSetOp;
+
+typedef struct NumericSetInfo {
+    int varIndex;		/* Index of the local that is assigned. */
+    int numOps;			/* Number of entries in ops. */
+    NumericSetOp ops[1];	/* The expression, in postfix order. There is
+				 * really more than one entry, and the
+				 * structure is allocated to take account of
+				 * this. MUST BE LAST FIELD IN STRUCTURE. */
+} NumericSetInfo;
+
+MODULE_SCOPE const AuxDataType tclNumericSetInfoType;
+
 /*
  * ClientData type used by the math operator commands.
  */
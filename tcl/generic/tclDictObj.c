@@ -177,7 +177,7 @@ const Tcl_ObjType tclDictType = {
 
 static const Tcl_HashKeyType chainHashType = {
     TCL_HASH_KEY_TYPE_VERSION,
-    0,
+    TCL_HASH_KEY_OPEN_ADDRESSING,
     TclHashObjKey,
     TclCompareObjKeys,
     AllocChainEntry,
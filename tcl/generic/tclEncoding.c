@@ -82,6 +82,10 @@ typedef struct TableEncodingData {
 				 * is no corresponding character the encoding,
 				 * the value in the matrix is 0x0000.
 				 * malloc'd. */
+    int asciiIdentity;		/* Nonzero if the chars 0x01 to 0x7E are
+				 * single bytes that map to themselves in both
+				 * directions, so that runs of them can be
+				 * copied as they are. */
 } TableEncodingData;
 
 /*
@@ -192,10 +196,28 @@ static Tcl_Encoding systemEncoding;
 
 static unsigned short emptyPage[256];
 
+/*
+ * Runs of printable ASCII and control chars other than NUL and DEL (which
+ * the "ascii" encoding does not map) are the same bytes in UTF-8 and in most
+ * encodings. AsciiLength finds how long such a run is a machine word at a
+ * time: a word holds none of the bytes 0x00 and 0x7F to 0xFF when neither it
+ * nor the word with 0x01 subtracted from or added to each byte has any high
+ * bit set.
+ */
+
+typedef size_t AsciiWord;
+
+#define ASCII_WORD_ONES		(~(AsciiWord) 0 / 0xFF)
+#define ASCII_WORD_HIGH_BITS	(ASCII_WORD_ONES * 0x80)
+#define IsAsciiByte(byte) \
+	((unsigned) (UCHAR(byte) - 1) < 0x7E)
+
 /*
  * Functions used only in this module.
  */
 
+static int		AsciiLength(const char *src, int srcLen,
+			    int dstLen);
 static int		BinaryProc(ClientData clientData,
 			    const char *src, int srcLen, int flags,
 			    Tcl_EncodingState *statePtr, char *dst, int dstLen,
@@ -615,6 +637,7 @@ TclInitEncodingSubsystem(void)
 	dataPtr->toUnicode[0][i] = i;
 	dataPtr->fromUnicode[0][i] = i;
     }
+    dataPtr->asciiIdentity = 1;
 
     type.encodingName	= "iso8859-1";
     type.toUtfProc	= Iso88591ToUtfProc;
@@ -1910,6 +1933,18 @@ LoadTableEncoding(
   doneParse:
     Tcl_DStringFree(&lineString);
 
+    /*
+     * Note whether ASCII text goes through this encoding unchanged.
+     */
+
+    dataPtr->asciiIdentity = (dataPtr->prefixBytes[0] == 0);
+    for (i = 1; i < 0x7F && dataPtr->asciiIdentity; i++) {
+	if (dataPtr->prefixBytes[i] || (dataPtr->toUnicode[0][i] != i)
+		|| (dataPtr->fromUnicode[0][i] != i)) {
+	    dataPtr->asciiIdentity = 0;
+	}
+    }
+
     /*
      * Package everything into an encoding structure.
      */
@@ -2212,6 +2247,48 @@ UtfExtToUtfIntProc(
 	    srcReadPtr, dstWrotePtr, dstCharsPtr, 0);
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * AsciiLength --
+ *
+ *	Measures the run of ASCII chars other than NUL and DEL at the start
+ *	of a string, a machine word at a time, as far as it can be copied to
+ *	an output buffer.
+ *
+ * Results:
+ *	Returns the number of bytes in the run, at most the smaller of srcLen
+ *	and dstLen.
+ *
+ * Side effects:
+ *	None.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+AsciiLength(
+    const char *src,		/* Bytes to look at. */
+    int srcLen,			/* Number of bytes that may be looked at. */
+    int dstLen)			/* Room left in the output buffer. */
+{
+    int len = 0, maxLen = (srcLen < dstLen) ? srcLen : dstLen;
+    AsciiWord word;
+
+    while (len + (int) sizeof(AsciiWord) <= maxLen) {
+	memcpy(&word, src + len, sizeof(AsciiWord));
+	if (((word | (word - ASCII_WORD_ONES) | (word + ASCII_WORD_ONES))
+		& ASCII_WORD_HIGH_BITS) != 0) {
+	    break;
+	}
+	len += sizeof(AsciiWord);
+    }
+    while ((len < maxLen) && IsAsciiByte(src[len])) {
+	len++;
+    }
+    return len;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -2294,10 +2371,19 @@ UtfToUtfProc(
 	if (UCHAR(*src) < 0x80 && !(UCHAR(*src) == 0 && pureNullMode == 0)) {
 	    /*
 	     * Copy 7bit chatacters, but skip null-bytes when we are in input
-	     * mode, so that they get converted to 0xc080.
+	     * mode, so that they get converted to 0xc080. Whole runs of other
+	     * 7bit characters are copied at once.
 	     */
 
-	    *dst++ = *src++;
+	    int len = AsciiLength(src, srcEnd - src, dstEnd - dst + 1);
+
+	    if (len == 0) {
+		len = 1;
+	    }
+	    memcpy(dst, src, (size_t) len);
+	    src += len;
+	    dst += len;
+	    numChars += len - 1;
 	} else if (pureNullMode == 1 && UCHAR(*src) == 0xc0 &&
 		UCHAR(*(src+1)) == 0x80) {
 	    /*
@@ -2579,6 +2665,15 @@ TableToUtfProc(
 	    result = TCL_CONVERT_NOSPACE;
 	    break;
 	}
+	if (dataPtr->asciiIdentity && IsAsciiByte(*src)) {
+	    int len = AsciiLength(src, srcEnd - src, dstEnd - dst + 1);
+
+	    memcpy(dst, src, (size_t) len);
+	    src += len;
+	    dst += len;
+	    numChars += len - 1;
+	    continue;
+	}
 	byte = *((unsigned char *) src);
 	if (prefixBytes[byte]) {
 	    src++;
@@ -2697,6 +2792,14 @@ TableFromUtfProc(
 	    result = TCL_CONVERT_MULTIBYTE;
 	    break;
 	}
+	if (dataPtr->asciiIdentity && IsAsciiByte(*src) && (dst <= dstEnd)) {
+	    len = AsciiLength(src, srcEnd - src, dstEnd - dst + 1);
+	    memcpy(dst, src, (size_t) len);
+	    src += len;
+	    dst += len;
+	    numChars += len - 1;
+	    continue;
+	}
 	len = TclUtfToUniChar(src, &ch);
 
 #if TCL_UTF_MAX > 3
@@ -2804,6 +2907,15 @@ Iso88591ToUtfProc(
 	    result = TCL_CONVERT_NOSPACE;
 	    break;
 	}
+	if (IsAsciiByte(*src)) {
+	    int len = AsciiLength(src, srcEnd - src, dstEnd - dst + 1);
+
+	    memcpy(dst, src, (size_t) len);
+	    src += len;
+	    dst += len;
+	    numChars += len - 1;
+	    continue;
+	}
 	ch = (Tcl_UniChar) *((unsigned char *) src);
 
 	/*
@@ -2896,6 +3008,14 @@ Iso88591FromUtfProc(
 	    result = TCL_CONVERT_MULTIBYTE;
 	    break;
 	}
+	if (IsAsciiByte(*src) && (dst <= dstEnd)) {
+	    len = AsciiLength(src, srcEnd - src, dstEnd - dst + 1);
+	    memcpy(dst, src, (size_t) len);
+	    src += len;
+	    dst += len;
+	    numChars += len - 1;
+	    continue;
+	}
 	len = TclUtfToUniChar(src, &ch);
 
 	/*
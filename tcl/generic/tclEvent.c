@@ -1086,6 +1086,14 @@ Tcl_Finalize(void)
 
     InvokeExitHandlers();   
 
+    /*
+     * Stop the worker threads of [lmap -parallel] and of TclRunTasks while
+     * everything they use is still in place.
+     */
+
+    TclFinalizeLmapPool();
+    TclFinalizeTaskPool();
+
     TclpInitLock();
     if (subsystemsInitialized == 0) {
 	goto alreadyFinalized;
@@ -1158,6 +1166,12 @@ Tcl_Finalize(void)
 
     TclFinalizeObjects();
 
+    /*
+     * The compiled regexps held by Tcl_Obj's have been released by now.
+     */
+
+    TclFinalizeRegexpCache();
+
     /*
      * We must be sure the encoding finalization doesn't need to examine the
      * filesystem in any way. Since it only needs to clean up internal data
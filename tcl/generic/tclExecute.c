@@ -47,6 +47,16 @@
 #   define ASYNC_CHECK_COUNT_MASK	63
 #endif /* !ASYNC_CHECK_COUNT_MASK */
 
+/*
+ * Threaded dispatch (see the --enable-threaded-dispatch configure option)
+ * needs the "labels as values" extension; fall back to the plain switch with
+ * compilers that do not provide it.
+ */
+
+#if defined(USE_THREADED_DISPATCH) && !defined(__GNUC__)
+#   undef USE_THREADED_DISPATCH
+#endif
+
 /*
  * Boolean flag indicating whether the Tcl bytecode interpreter has been
  * initialized.
@@ -262,7 +272,7 @@ VarHashCreateVar(
 		}						\
 	    }							\
 	    pc += (pcAdjustment);				\
-	    goto cleanup0;					\
+	    NEXT_DISPATCH();					\
 	} else if (resultHandling != 0) {			\
 	    if ((resultHandling) > 0) {				\
 		Tcl_IncrRefCount(objResultPtr);			\
@@ -295,6 +305,58 @@ VarHashCreateVar(
 	}							\
     } while (0)
 
+/*
+ * Macros for instruction dispatch. Normally the main loop in TEBCresume is a
+ * switch on the opcode at pc, entered from the common code at cleanup0. With
+ * USE_THREADED_DISPATCH each opcode is also given a label, and the addresses
+ * of those labels are collected in a table indexed by opcode:
+ *
+ *    INST_CASE(op):	marks the handler for opcode (op) in the main switch;
+ *			this is just "case op:" without threaded dispatch.
+ *    DISPATCH():	jumps to the handler for the opcode at pc (threaded
+ *			dispatch only).
+ *    NEXT_DISPATCH():	used by instructions that leave nothing to clean up
+ *			on the stack. With threaded dispatch this jumps
+ *			directly to the next handler, so that every such
+ *			instruction gets its own (better predicted) indirect
+ *			jump. Every ASYNC_CHECK_COUNT_MASK+1 instructions it
+ *			goes through cleanup0 instead, so that async handlers,
+ *			cancellation and limits are still checked.
+ *
+ * Instruction tracing under TCL_COMPILE_DEBUG happens at cleanup0, so in that
+ * case all instructions go through there.
+ */
+
+#ifdef USE_THREADED_DISPATCH
+#   define INST_CASE(op)	case op: lbl_ ## op
+#   define DISPATCH()		goto *dispatchTable[*pc]
+#else
+#   define INST_CASE(op)	case op
+#endif /* USE_THREADED_DISPATCH */
+
+#ifdef TCL_COMPILE_STATS
+#   define INST_STATS_COUNT() \
+    iPtr->stats.instructionCount[*pc]++
+#else
+#   define INST_STATS_COUNT()
+#endif /* TCL_COMPILE_STATS */
+
+#if defined(USE_THREADED_DISPATCH) && !defined(TCL_COMPILE_DEBUG)
+#   define NEXT_DISPATCH() \
+    do {							\
+	if ((instructionCount & ASYNC_CHECK_COUNT_MASK) == 0) {	\
+	    goto cleanup0;					\
+	}							\
+	instructionCount++;					\
+	INST_STATS_COUNT();					\
+	TCL_DTRACE_INST_NEXT();					\
+	DISPATCH();						\
+    } while (0)
+#else
+#   define NEXT_DISPATCH() \
+    goto cleanup0
+#endif
+
 /*
  * Macros used to cache often-referenced Tcl evaluation stack information
  * in local variables. Note that a DECACHE_STACK_INFO()-CACHE_STACK_INFO()
@@ -452,6 +514,82 @@ VarHashCreateVar(
     TclGetNumberFromObj((interp), (objPtr), (ptrPtr), (tPtr)))
 #endif /* NO_WIDE_TYPE */
 
+/*
+ * Macros used in this file to maintain the operand type feedback of
+ * arithmetic and comparison sites (see the typeFeedback field of ByteCode).
+ * FeedbackForTypes maps a pair of TCL_NUMBER_* types to the TYPE_FEEDBACK_*
+ * state they would specialize a site to, and RecordTypeFeedback merges such
+ * a state into the site's current one.
+ */
+
+#define GetTypeFeedbackPtr(codePtr, pc) \
+    (((codePtr)->typeFeedback == NULL) ? NULL :				\
+	    ((codePtr)->typeFeedback + ((pc) - (codePtr)->codeStart)))
+
+#define FeedbackForTypes(type1, type2) \
+    ((((type1) == TCL_NUMBER_LONG) && ((type2) == TCL_NUMBER_LONG))	\
+	? TYPE_FEEDBACK_LONG :						\
+    (((type1) == TCL_NUMBER_DOUBLE) && ((type2) == TCL_NUMBER_DOUBLE))	\
+	? TYPE_FEEDBACK_DOUBLE : TYPE_FEEDBACK_MIXED)
+
+#define RecordTypeFeedback(feedbackPtr, state) \
+    do {								\
+	if (((feedbackPtr) != NULL) && (*(feedbackPtr) != (state))) {	\
+	    *(feedbackPtr) = ((*(feedbackPtr) == TYPE_FEEDBACK_NONE)	\
+		    ? (state) : TYPE_FEEDBACK_MIXED);			\
+	}								\
+    } while (0)
+
+#ifdef TCL_COMPILE_STATS
+#   define TypeFeedbackStat(field) \
+    iPtr->stats.field++
+#else
+#   define TypeFeedbackStat(field)
+#endif
+
+/*
+ * Arithmetic instructions overwrite their first operand with the result when
+ * nothing else refers to it. The compiled local that the next instruction
+ * stores the result into does not count: when it holds the operand, as in
+ * [set x [expr {$x + $y}]], the Tcl_Obj of the local is updated in place and
+ * then stored back into it, instead of a new Tcl_Obj being allocated for the
+ * result and the old one freed. Numeric locals thus stay in the same Tcl_Obj
+ * for the whole life of a loop, and a new one is only made once the value
+ * has escaped elsewhere (a list, another variable, an upvar alias in use by
+ * a command).
+ */
+
+#define ReuseArithOperand(objPtr, nextPc) \
+    (!Tcl_IsShared(objPtr) || StoredBackToLocal(iPtr, (objPtr), (nextPc)))
+
+static inline int
+StoredBackToLocal(
+    Interp *iPtr,
+    Tcl_Obj *objPtr,
+    const unsigned char *nextPc)
+{
+    Var *varPtr = iPtr->varFramePtr->compiledLocals;
+
+    if (objPtr->refCount != 2) {
+	return 0;
+    }
+    switch (*nextPc) {
+    case INST_STORE_SCALAR1:
+	varPtr += TclGetUInt1AtPtr(nextPc+1);
+	break;
+    case INST_STORE_SCALAR4:
+	varPtr += TclGetUInt4AtPtr(nextPc+1);
+	break;
+    default:
+	return 0;
+    }
+    while (TclIsVarLink(varPtr)) {
+	varPtr = varPtr->value.linkPtr;
+    }
+    return (TclIsVarDirectWritable(varPtr)
+	    && (varPtr->value.objPtr == objPtr));
+}
+
 /*
  * Macro used in this file to save a function call for common uses of
  * Tcl_GetBooleanFromObj(). The ANSI C "prototype" is:
@@ -693,6 +831,8 @@ static Tcl_Obj *	ExecuteExtendedBinaryMathOp(Tcl_Interp *interp,
 			    Tcl_Obj *valuePtr, Tcl_Obj *value2Ptr);
 static Tcl_Obj *	ExecuteExtendedUnaryMathOp(int opcode,
 			    Tcl_Obj *valuePtr);
+static Tcl_Obj *	ExecuteNumericSet(Interp *iPtr,
+			    const NumericSetInfo *infoPtr);
 static void		FreeExprCodeInternalRep(Tcl_Obj *objPtr);
 static ExceptionRange *	GetExceptRangeForPc(const unsigned char *pc,
 			    int catchOnly, ByteCode *codePtr);
@@ -2102,6 +2242,74 @@ TEBCresume(
 #ifdef TCL_COMPILE_DEBUG
     char cmdNameBuf[21];
 #endif
+#ifdef USE_THREADED_DISPATCH
+    /*
+     * Addresses of the instruction handlers in the main switch, indexed by
+     * opcode. Must match the order and number of the opcodes in
+     * tclCompile.h; opcodes beyond LAST_INST_OPCODE are invalid.
+     */
+
+    static const void *const dispatchTable[256] = {
+	&&lbl_INST_DONE, &&lbl_INST_PUSH1, &&lbl_INST_PUSH4, &&lbl_INST_POP,
+	&&lbl_INST_DUP, &&lbl_INST_CONCAT1, &&lbl_INST_INVOKE_STK1,
+	&&lbl_INST_INVOKE_STK4, &&lbl_INST_EVAL_STK, &&lbl_INST_EXPR_STK,
+	&&lbl_INST_LOAD_SCALAR1, &&lbl_INST_LOAD_SCALAR4,
+	&&lbl_INST_LOAD_SCALAR_STK, &&lbl_INST_LOAD_ARRAY1,
+	&&lbl_INST_LOAD_ARRAY4, &&lbl_INST_LOAD_ARRAY_STK,
+	&&lbl_INST_LOAD_STK, &&lbl_INST_STORE_SCALAR1,
+	&&lbl_INST_STORE_SCALAR4, &&lbl_INST_STORE_SCALAR_STK,
+	&&lbl_INST_STORE_ARRAY1, &&lbl_INST_STORE_ARRAY4,
+	&&lbl_INST_STORE_ARRAY_STK, &&lbl_INST_STORE_STK,
+	&&lbl_INST_INCR_SCALAR1, &&lbl_INST_INCR_SCALAR_STK,
+	&&lbl_INST_INCR_ARRAY1, &&lbl_INST_INCR_ARRAY_STK,
+	&&lbl_INST_INCR_STK, &&lbl_INST_INCR_SCALAR1_IMM,
+	&&lbl_INST_INCR_SCALAR_STK_IMM, &&lbl_INST_INCR_ARRAY1_IMM,
+	&&lbl_INST_INCR_ARRAY_STK_IMM, &&lbl_INST_INCR_STK_IMM,
+	&&lbl_INST_JUMP1, &&lbl_INST_JUMP4, &&lbl_INST_JUMP_TRUE1,
+	&&lbl_INST_JUMP_TRUE4, &&lbl_INST_JUMP_FALSE1, &&lbl_INST_JUMP_FALSE4,
+	&&lbl_INST_LOR, &&lbl_INST_LAND, &&lbl_INST_BITOR, &&lbl_INST_BITXOR,
+	&&lbl_INST_BITAND, &&lbl_INST_EQ, &&lbl_INST_NEQ, &&lbl_INST_LT,
+	&&lbl_INST_GT, &&lbl_INST_LE, &&lbl_INST_GE, &&lbl_INST_LSHIFT,
+	&&lbl_INST_RSHIFT, &&lbl_INST_ADD, &&lbl_INST_SUB, &&lbl_INST_MULT,
+	&&lbl_INST_DIV, &&lbl_INST_MOD, &&lbl_INST_UPLUS, &&lbl_INST_UMINUS,
+	&&lbl_INST_BITNOT, &&lbl_INST_LNOT, &&lbl_INST_CALL_BUILTIN_FUNC1,
+	&&lbl_INST_CALL_FUNC1, &&lbl_INST_TRY_CVT_TO_NUMERIC,
+	&&lbl_INST_BREAK, &&lbl_INST_CONTINUE, &&lbl_INST_FOREACH_START4,
+	&&lbl_INST_FOREACH_STEP4, &&lbl_INST_BEGIN_CATCH4,
+	&&lbl_INST_END_CATCH, &&lbl_INST_PUSH_RESULT,
+	&&lbl_INST_PUSH_RETURN_CODE, &&lbl_INST_STR_EQ, &&lbl_INST_STR_NEQ,
+	&&lbl_INST_STR_CMP, &&lbl_INST_STR_LEN, &&lbl_INST_STR_INDEX,
+	&&lbl_INST_STR_MATCH, &&lbl_INST_LIST, &&lbl_INST_LIST_INDEX,
+	&&lbl_INST_LIST_LENGTH, &&lbl_INST_APPEND_SCALAR1,
+	&&lbl_INST_APPEND_SCALAR4, &&lbl_INST_APPEND_ARRAY1,
+	&&lbl_INST_APPEND_ARRAY4, &&lbl_INST_APPEND_ARRAY_STK,
+	&&lbl_INST_APPEND_STK, &&lbl_INST_LAPPEND_SCALAR1,
+	&&lbl_INST_LAPPEND_SCALAR4, &&lbl_INST_LAPPEND_ARRAY1,
+	&&lbl_INST_LAPPEND_ARRAY4, &&lbl_INST_LAPPEND_ARRAY_STK,
+	&&lbl_INST_LAPPEND_STK, &&lbl_INST_LIST_INDEX_MULTI, &&lbl_INST_OVER,
+	&&lbl_INST_LSET_LIST, &&lbl_INST_LSET_FLAT, &&lbl_INST_RETURN_IMM,
+	&&lbl_INST_EXPON, &&lbl_INST_EXPAND_START, &&lbl_INST_EXPAND_STKTOP,
+	&&lbl_INST_INVOKE_EXPANDED, &&lbl_INST_LIST_INDEX_IMM,
+	&&lbl_INST_LIST_RANGE_IMM, &&lbl_INST_START_CMD, &&lbl_INST_LIST_IN,
+	&&lbl_INST_LIST_NOT_IN, &&lbl_INST_PUSH_RETURN_OPTIONS,
+	&&lbl_INST_RETURN_STK, &&lbl_INST_DICT_GET, &&lbl_INST_DICT_SET,
+	&&lbl_INST_DICT_UNSET, &&lbl_INST_DICT_INCR_IMM,
+	&&lbl_INST_DICT_APPEND, &&lbl_INST_DICT_LAPPEND,
+	&&lbl_INST_DICT_FIRST, &&lbl_INST_DICT_NEXT, &&lbl_INST_DICT_DONE,
+	&&lbl_INST_DICT_UPDATE_START, &&lbl_INST_DICT_UPDATE_END,
+	&&lbl_INST_JUMP_TABLE, &&lbl_INST_UPVAR, &&lbl_INST_NSUPVAR,
+	&&lbl_INST_VARIABLE, &&lbl_INST_SYNTAX, &&lbl_INST_REVERSE,
+	&&lbl_INST_REGEXP, &&lbl_INST_EXIST_SCALAR, &&lbl_INST_EXIST_ARRAY,
+	&&lbl_INST_EXIST_ARRAY_STK, &&lbl_INST_EXIST_STK, &&lbl_INST_NOP,
+	&&lbl_INST_RETURN_CODE_BRANCH, &&lbl_INST_UNSET_SCALAR,
+	&&lbl_INST_UNSET_ARRAY, &&lbl_INST_UNSET_ARRAY_STK,
+	&&lbl_INST_UNSET_STK, &&lbl_INST_LOAD_SCALAR1_ARITH,
+	&&lbl_INST_LOAD_SCALAR1_CMP, &&lbl_INST_LOAD_SCALAR1_INCR,
+	&&lbl_INST_PUSH1_ARITH, &&lbl_INST_PUSH1_CMP,
+	&&lbl_INST_BINARY_SCAN, &&lbl_INST_NUMERIC_SET,
+	[LAST_INST_OPCODE+1 ... 255] = &&instUnrecognized
+    };
+#endif /* USE_THREADED_DISPATCH */
 
     NR_DATA_DIG();
 
@@ -2299,18 +2507,23 @@ TEBCresume(
      * [http://www.cs.toronto.edu/syslab/pubs/tcl2005-vitale-zaleski.pdf]
      * Resolving them before the switch reduces the cost of branch
      * mispredictions, seems to improve runtime by 5% to 15%, and (amazingly!)
-     * reduces total obj size.
+     * reduces total obj size. With threaded dispatch every opcode gets its
+     * own jump anyway.
      */
 
+#ifdef USE_THREADED_DISPATCH
+    DISPATCH();
+#else
     if (*pc == INST_LOAD_SCALAR1) {
 	goto instLoadScalar1;
     } else if (*pc == INST_PUSH1) {
 	goto instPush1Peephole;
     }
+#endif
 
     switch (*pc) {
-    case INST_SYNTAX:
-    case INST_RETURN_IMM: {
+    INST_CASE(INST_SYNTAX):
+    INST_CASE(INST_RETURN_IMM): {
 	int code = TclGetInt4AtPtr(pc+1);
 	int level = TclGetUInt4AtPtr(pc+5);
 
@@ -2333,7 +2546,7 @@ TEBCresume(
 	goto processExceptionReturn;
     }
 
-    case INST_RETURN_STK:
+    INST_CASE(INST_RETURN_STK):
 	TRACE(("=> "));
 	objResultPtr = POP_OBJECT();
 	result = Tcl_SetReturnOptions(interp, OBJ_AT_TOS);
@@ -2348,7 +2561,7 @@ TEBCresume(
 	cleanup = 1;
 	goto processExceptionReturn;
 
-    case INST_DONE:
+    INST_CASE(INST_DONE):
 	if (tosPtr > initTosPtr) {
 	    /*
 	     * Set the interpreter's object result to point to the topmost
@@ -2370,8 +2583,10 @@ TEBCresume(
 	(void) POP_OBJECT();
 	goto abnormalReturn;
 
-    case INST_PUSH1:
+    INST_CASE(INST_PUSH1):
+#if !defined(USE_THREADED_DISPATCH) || !TCL_COMPILE_DEBUG
     instPush1Peephole:
+#endif
 	PUSH_OBJECT(codePtr->objArrayPtr[TclGetUInt1AtPtr(pc+1)]);
 	TRACE_WITH_OBJ(("%u => ", TclGetInt1AtPtr(pc+1)), OBJ_AT_TOS);
 	pc += 2;
@@ -2387,12 +2602,32 @@ TEBCresume(
 #endif
 	NEXT_INST_F(0, 0, 0);
 
-    case INST_PUSH4:
+    INST_CASE(INST_PUSH1_ARITH):
+    INST_CASE(INST_PUSH1_CMP):
+	/*
+	 * Superinstructions: push1 followed by an arithmetic operator or a
+	 * comparison. Go straight to the handler of the second instruction.
+	 */
+
+	PUSH_OBJECT(codePtr->objArrayPtr[TclGetUInt1AtPtr(pc+1)]);
+	TRACE_WITH_OBJ(("%u => ", TclGetInt1AtPtr(pc+1)), OBJ_AT_TOS);
+#ifndef TCL_COMPILE_DEBUG
+	if (*pc == INST_PUSH1_ARITH) {
+	    pc += 2;
+	    goto instArith;
+	}
+	pc += 2;
+	goto instCompare;
+#else
+	NEXT_INST_F(2, 0, 0);
+#endif
+
+    INST_CASE(INST_PUSH4):
 	objResultPtr = codePtr->objArrayPtr[TclGetUInt4AtPtr(pc+1)];
 	TRACE_WITH_OBJ(("%u => ", TclGetUInt4AtPtr(pc+1)), objResultPtr);
 	NEXT_INST_F(5, 0, 1);
 
-    case INST_POP:
+    INST_CASE(INST_POP):
 	TRACE_WITH_OBJ(("=> discarding "), OBJ_AT_TOS);
 	objPtr = POP_OBJECT();
 	TclDecrRefCount(objPtr);
@@ -2412,7 +2647,7 @@ TEBCresume(
 #endif
 	NEXT_INST_F(0, 0, 0);
 
-    case INST_START_CMD:
+    INST_CASE(INST_START_CMD):
 #if !TCL_COMPILE_DEBUG
     instStartCmdPeephole:
 #endif
@@ -2455,22 +2690,22 @@ TEBCresume(
 	    goto instEvalStk;
 	}
 
-    case INST_NOP:
+    INST_CASE(INST_NOP):
 	pc += 1;
 	goto cleanup0;
 
-    case INST_DUP:
+    INST_CASE(INST_DUP):
 	objResultPtr = OBJ_AT_TOS;
 	TRACE_WITH_OBJ(("=> "), objResultPtr);
 	NEXT_INST_F(1, 0, 1);
 
-    case INST_OVER:
+    INST_CASE(INST_OVER):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	objResultPtr = OBJ_AT_DEPTH(opnd);
 	TRACE_WITH_OBJ(("=> "), objResultPtr);
 	NEXT_INST_F(5, 0, 1);
 
-    case INST_REVERSE: {
+    INST_CASE(INST_REVERSE): {
 	Tcl_Obj **a, **b;
 
 	opnd = TclGetUInt4AtPtr(pc+1);
@@ -2485,7 +2720,7 @@ TEBCresume(
 	NEXT_INST_F(5, 0, 0);
     }
 
-    case INST_CONCAT1: {
+    INST_CASE(INST_CONCAT1): {
 	int appendLen = 0;
 	char *bytes, *p;
 	Tcl_Obj **currPtr;
@@ -2635,7 +2870,7 @@ TEBCresume(
 	NEXT_INST_V(2, opnd, 1);
     }
 
-    case INST_EXPAND_START:
+    INST_CASE(INST_EXPAND_START):
 	/*
 	 * Push an element to the auxObjList. This records the current
 	 * stack depth - i.e., the point in the stack where the expanded
@@ -2654,7 +2889,7 @@ TEBCresume(
 	PUSH_TAUX_OBJ(objPtr);
 	NEXT_INST_F(1, 0, 0);
 
-    case INST_EXPAND_STKTOP: {
+    INST_CASE(INST_EXPAND_STKTOP): {
 	int i;
 	ptrdiff_t moved;
 
@@ -2711,7 +2946,7 @@ TEBCresume(
 	NEXT_INST_F(5, 0, 0);
     }
 
-    case INST_EXPR_STK: {
+    INST_CASE(INST_EXPR_STK): {
 	ByteCode *newCodePtr;
 
 	bcFramePtr->data.tebc.pc = (char *) pc;
@@ -2730,7 +2965,7 @@ TEBCresume(
 	 */
 
     instEvalStk:
-    case INST_EVAL_STK:
+    INST_CASE(INST_EVAL_STK):
 	bcFramePtr->data.tebc.pc = (char *) pc;
 	iPtr->cmdFramePtr = bcFramePtr;
 
@@ -2739,7 +2974,7 @@ TEBCresume(
 	NR_YIELD(1);
 	return TclNREvalObjEx(interp, OBJ_AT_TOS, 0, NULL, 0);
 
-    case INST_INVOKE_EXPANDED:
+    INST_CASE(INST_INVOKE_EXPANDED):
 	CLANG_ASSERT(auxObjList);
 	objc = CURR_DEPTH
 		- (ptrdiff_t) auxObjList->internalRep.twoPtrValue.ptr1;
@@ -2756,12 +2991,12 @@ TEBCresume(
 	TclNewObj(objResultPtr);
 	NEXT_INST_F(1, 0, 1);
 
-    case INST_INVOKE_STK4:
+    INST_CASE(INST_INVOKE_STK4):
 	objc = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	goto doInvocation;
 
-    case INST_INVOKE_STK1:
+    INST_CASE(INST_INVOKE_STK1):
 	objc = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 
@@ -2812,7 +3047,7 @@ TEBCresume(
 		TCL_EVAL_NOERR, NULL);
 
 #if TCL_SUPPORT_84_BYTECODE
-    case INST_CALL_BUILTIN_FUNC1:
+    INST_CASE(INST_CALL_BUILTIN_FUNC1):
 	/*
 	 * Call one of the built-in pre-8.5 Tcl math functions. This
 	 * translates to INST_INVOKE_STK1 with the first argument of
@@ -2858,7 +3093,7 @@ TEBCresume(
 	pcAdjustment = 2;
 	goto doInvocation;
 
-    case INST_CALL_FUNC1:
+    INST_CASE(INST_CALL_FUNC1):
 	/*
 	 * Call a non-builtin Tcl math function previously registered by a
 	 * call to Tcl_CreateMathFunc pre-8.5. This is essentially
@@ -2890,9 +3125,9 @@ TEBCresume(
      * remains for existing bytecode precompiled files.
      */
 
-    case INST_CALL_BUILTIN_FUNC1:
+    INST_CASE(INST_CALL_BUILTIN_FUNC1):
 	Tcl_Panic("TclNRExecuteByteCode: obsolete INST_CALL_BUILTIN_FUNC1 found");
-    case INST_CALL_FUNC1:
+    INST_CASE(INST_CALL_FUNC1):
 	Tcl_Panic("TclNRExecuteByteCode: obsolete INST_CALL_FUNC1 found");
 #endif
 
@@ -2905,7 +3140,41 @@ TEBCresume(
      * common execution code.
      */
 
-    case INST_LOAD_SCALAR1:
+    INST_CASE(INST_LOAD_SCALAR1_ARITH):
+    INST_CASE(INST_LOAD_SCALAR1_CMP):
+    INST_CASE(INST_LOAD_SCALAR1_INCR):
+	/*
+	 * Superinstructions: loadScalar1 followed by an arithmetic operator,
+	 * a comparison or incrScalar1 (see FuseInstructions in tclCompile.c).
+	 * When the variable can be read directly, push its value and go
+	 * straight to the handler of the following instruction. Otherwise,
+	 * and when instruction tracing is compiled in, this is just
+	 * loadScalar1.
+	 */
+
+#ifndef TCL_COMPILE_DEBUG
+	varPtr = LOCAL(TclGetUInt1AtPtr(pc+1));
+	while (TclIsVarLink(varPtr)) {
+	    varPtr = varPtr->value.linkPtr;
+	}
+	if (TclIsVarDirectReadable(varPtr)) {
+	    PUSH_OBJECT(varPtr->value.objPtr);
+	    switch (*pc) {
+	    case INST_LOAD_SCALAR1_ARITH:
+		pc += 2;
+		goto instArith;
+	    case INST_LOAD_SCALAR1_CMP:
+		pc += 2;
+		goto instCompare;
+	    default:
+		pc += 2;
+		goto instIncrScalar1;
+	    }
+	}
+#endif
+	goto instLoadScalar1;
+
+    INST_CASE(INST_LOAD_SCALAR1):
     instLoadScalar1:
 	opnd = TclGetUInt1AtPtr(pc+1);
 	varPtr = LOCAL(opnd);
@@ -2928,7 +3197,7 @@ TEBCresume(
 	part1Ptr = part2Ptr = NULL;
 	goto doCallPtrGetVar;
 
-    case INST_LOAD_SCALAR4:
+    INST_CASE(INST_LOAD_SCALAR4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	varPtr = LOCAL(opnd);
 	while (TclIsVarLink(varPtr)) {
@@ -2950,12 +3219,12 @@ TEBCresume(
 	part1Ptr = part2Ptr = NULL;
 	goto doCallPtrGetVar;
 
-    case INST_LOAD_ARRAY4:
+    INST_CASE(INST_LOAD_ARRAY4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	goto doLoadArray;
 
-    case INST_LOAD_ARRAY1:
+    INST_CASE(INST_LOAD_ARRAY1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 
@@ -2988,15 +3257,15 @@ TEBCresume(
 	cleanup = 1;
 	goto doCallPtrGetVar;
 
-    case INST_LOAD_ARRAY_STK:
+    INST_CASE(INST_LOAD_ARRAY_STK):
 	cleanup = 2;
 	part2Ptr = OBJ_AT_TOS;		/* element name */
 	objPtr = OBJ_UNDER_TOS;		/* array name */
 	TRACE(("\"%.30s(%.30s)\" => ", O2S(objPtr), O2S(part2Ptr)));
 	goto doLoadStk;
 
-    case INST_LOAD_STK:
-    case INST_LOAD_SCALAR_STK:
+    INST_CASE(INST_LOAD_STK):
+    INST_CASE(INST_LOAD_SCALAR_STK):
 	cleanup = 1;
 	part2Ptr = NULL;
 	objPtr = OBJ_AT_TOS;		/* variable name */
@@ -3054,12 +3323,12 @@ TEBCresume(
     {
 	int storeFlags;
 
-    case INST_STORE_ARRAY4:
+    INST_CASE(INST_STORE_ARRAY4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	goto doStoreArrayDirect;
 
-    case INST_STORE_ARRAY1:
+    INST_CASE(INST_STORE_ARRAY1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 
@@ -3086,12 +3355,12 @@ TEBCresume(
 	part1Ptr = NULL;
 	goto doStoreArrayDirectFailed;
 
-    case INST_STORE_SCALAR4:
+    INST_CASE(INST_STORE_SCALAR4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	goto doStoreScalarDirect;
 
-    case INST_STORE_SCALAR1:
+    INST_CASE(INST_STORE_SCALAR1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 
@@ -3132,40 +3401,40 @@ TEBCresume(
 	Tcl_IncrRefCount(objResultPtr);
 	NEXT_INST_F(pcAdjustment, 0, 0);
 
-    case INST_LAPPEND_STK:
+    INST_CASE(INST_LAPPEND_STK):
 	valuePtr = OBJ_AT_TOS; /* value to append */
 	part2Ptr = NULL;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreStk;
 
-    case INST_LAPPEND_ARRAY_STK:
+    INST_CASE(INST_LAPPEND_ARRAY_STK):
 	valuePtr = OBJ_AT_TOS; /* value to append */
 	part2Ptr = OBJ_UNDER_TOS;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreStk;
 
-    case INST_APPEND_STK:
+    INST_CASE(INST_APPEND_STK):
 	valuePtr = OBJ_AT_TOS; /* value to append */
 	part2Ptr = NULL;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
 	goto doStoreStk;
 
-    case INST_APPEND_ARRAY_STK:
+    INST_CASE(INST_APPEND_ARRAY_STK):
 	valuePtr = OBJ_AT_TOS; /* value to append */
 	part2Ptr = OBJ_UNDER_TOS;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
 	goto doStoreStk;
 
-    case INST_STORE_ARRAY_STK:
+    INST_CASE(INST_STORE_ARRAY_STK):
 	valuePtr = OBJ_AT_TOS;
 	part2Ptr = OBJ_UNDER_TOS;
 	storeFlags = TCL_LEAVE_ERR_MSG;
 	goto doStoreStk;
 
-    case INST_STORE_STK:
-    case INST_STORE_SCALAR_STK:
+    INST_CASE(INST_STORE_STK):
+    INST_CASE(INST_STORE_SCALAR_STK):
 	valuePtr = OBJ_AT_TOS;
 	part2Ptr = NULL;
 	storeFlags = TCL_LEAVE_ERR_MSG;
@@ -3192,27 +3461,27 @@ TEBCresume(
 	opnd = -1;
 	goto doCallPtrSetVar;
 
-    case INST_LAPPEND_ARRAY4:
+    INST_CASE(INST_LAPPEND_ARRAY4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreArray;
 
-    case INST_LAPPEND_ARRAY1:
+    INST_CASE(INST_LAPPEND_ARRAY1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreArray;
 
-    case INST_APPEND_ARRAY4:
+    INST_CASE(INST_APPEND_ARRAY4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
 	goto doStoreArray;
 
-    case INST_APPEND_ARRAY1:
+    INST_CASE(INST_APPEND_ARRAY1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
@@ -3239,27 +3508,27 @@ TEBCresume(
 	}
 	goto doCallPtrSetVar;
 
-    case INST_LAPPEND_SCALAR4:
+    INST_CASE(INST_LAPPEND_SCALAR4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreScalar;
 
-    case INST_LAPPEND_SCALAR1:
+    INST_CASE(INST_LAPPEND_SCALAR1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE
 		| TCL_LIST_ELEMENT);
 	goto doStoreScalar;
 
-    case INST_APPEND_SCALAR4:
+    INST_CASE(INST_APPEND_SCALAR4):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	pcAdjustment = 5;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
 	goto doStoreScalar;
 
-    case INST_APPEND_SCALAR1:
+    INST_CASE(INST_APPEND_SCALAR1):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	pcAdjustment = 2;
 	storeFlags = (TCL_LEAVE_ERR_MSG | TCL_APPEND_VALUE);
@@ -3313,11 +3582,14 @@ TEBCresume(
 #endif
 	long increment;
 
-    case INST_INCR_SCALAR1:
-    case INST_INCR_ARRAY1:
-    case INST_INCR_ARRAY_STK:
-    case INST_INCR_SCALAR_STK:
-    case INST_INCR_STK:
+    INST_CASE(INST_INCR_SCALAR1):
+    INST_CASE(INST_INCR_ARRAY1):
+    INST_CASE(INST_INCR_ARRAY_STK):
+    INST_CASE(INST_INCR_SCALAR_STK):
+    INST_CASE(INST_INCR_STK):
+#ifndef TCL_COMPILE_DEBUG
+    instIncrScalar1:
+#endif
 	opnd = TclGetUInt1AtPtr(pc+1);
 	incrPtr = POP_OBJECT();
 	switch (*pc) {
@@ -3332,9 +3604,9 @@ TEBCresume(
 	    goto doIncrStk;
 	}
 
-    case INST_INCR_ARRAY_STK_IMM:
-    case INST_INCR_SCALAR_STK_IMM:
-    case INST_INCR_STK_IMM:
+    INST_CASE(INST_INCR_ARRAY_STK_IMM):
+    INST_CASE(INST_INCR_SCALAR_STK_IMM):
+    INST_CASE(INST_INCR_STK_IMM):
 	increment = TclGetInt1AtPtr(pc+1);
 	incrPtr = Tcl_NewIntObj(increment);
 	Tcl_IncrRefCount(incrPtr);
@@ -3366,7 +3638,7 @@ TEBCresume(
 	cleanup = ((part2Ptr == NULL)? 1 : 2);
 	goto doIncrVar;
 
-    case INST_INCR_ARRAY1_IMM:
+    INST_CASE(INST_INCR_ARRAY1_IMM):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	increment = TclGetInt1AtPtr(pc+2);
 	incrPtr = Tcl_NewIntObj(increment);
@@ -3391,7 +3663,7 @@ TEBCresume(
 	}
 	goto doIncrVar;
 
-    case INST_INCR_SCALAR1_IMM:
+    INST_CASE(INST_INCR_SCALAR1_IMM):
 	opnd = TclGetUInt1AtPtr(pc+1);
 	increment = TclGetInt1AtPtr(pc+2);
 	pcAdjustment = 3;
@@ -3568,7 +3840,7 @@ TEBCresume(
      *	   Start of INST_EXIST instructions.
      */
 
-    case INST_EXIST_SCALAR:
+    INST_CASE(INST_EXIST_SCALAR):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	varPtr = LOCAL(opnd);
 	while (TclIsVarLink(varPtr)) {
@@ -3594,7 +3866,7 @@ TEBCresume(
 	TRACE_APPEND(("%.30s\n", O2S(objResultPtr)));
 	NEXT_INST_F(5, 0, 1);
 
-    case INST_EXIST_ARRAY:
+    INST_CASE(INST_EXIST_ARRAY):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	part2Ptr = OBJ_AT_TOS;
 	arrayPtr = LOCAL(opnd);
@@ -3627,14 +3899,14 @@ TEBCresume(
 	TRACE_APPEND(("%.30s\n", O2S(objResultPtr)));
 	NEXT_INST_F(5, 1, 1);
 
-    case INST_EXIST_ARRAY_STK:
+    INST_CASE(INST_EXIST_ARRAY_STK):
 	cleanup = 2;
 	part2Ptr = OBJ_AT_TOS;		/* element name */
 	part1Ptr = OBJ_UNDER_TOS;	/* array name */
 	TRACE(("\"%.30s(%.30s)\" => ", O2S(part1Ptr), O2S(part2Ptr)));
 	goto doExistStk;
 
-    case INST_EXIST_STK:
+    INST_CASE(INST_EXIST_STK):
 	cleanup = 1;
 	part2Ptr = NULL;
 	part1Ptr = OBJ_AT_TOS;		/* variable name */
@@ -3668,7 +3940,7 @@ TEBCresume(
     {
 	int flags;
 
-    case INST_UNSET_SCALAR:
+    INST_CASE(INST_UNSET_SCALAR):
 	flags = TclGetUInt1AtPtr(pc+1) ? TCL_LEAVE_ERR_MSG : 0;
 	opnd = TclGetUInt4AtPtr(pc+2);
 	varPtr = LOCAL(opnd);
@@ -3700,7 +3972,7 @@ TEBCresume(
 	CACHE_STACK_INFO();
 	NEXT_INST_F(6, 0, 0);
 
-    case INST_UNSET_ARRAY:
+    INST_CASE(INST_UNSET_ARRAY):
 	flags = TclGetUInt1AtPtr(pc+1) ? TCL_LEAVE_ERR_MSG : 0;
 	opnd = TclGetUInt4AtPtr(pc+2);
 	part2Ptr = OBJ_AT_TOS;
@@ -3748,7 +4020,7 @@ TEBCresume(
 	CACHE_STACK_INFO();
 	NEXT_INST_F(6, 1, 0);
 
-    case INST_UNSET_ARRAY_STK:
+    INST_CASE(INST_UNSET_ARRAY_STK):
 	flags = TclGetUInt1AtPtr(pc+1) ? TCL_LEAVE_ERR_MSG : 0;
 	cleanup = 2;
 	part2Ptr = OBJ_AT_TOS;		/* element name */
@@ -3757,7 +4029,7 @@ TEBCresume(
 		O2S(part1Ptr), O2S(part2Ptr)));
 	goto doUnsetStk;
 
-    case INST_UNSET_STK:
+    INST_CASE(INST_UNSET_STK):
 	flags = TclGetUInt1AtPtr(pc+1) ? TCL_LEAVE_ERR_MSG : 0;
 	cleanup = 1;
 	part2Ptr = NULL;
@@ -3782,7 +4054,7 @@ TEBCresume(
 	 * This is really an unset operation these days. Do not issue.
 	 */
 
-    case INST_DICT_DONE:
+    INST_CASE(INST_DICT_DONE):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	TRACE(("%u\n", opnd));
 	varPtr = LOCAL(opnd);
@@ -3814,7 +4086,7 @@ TEBCresume(
 	Tcl_Namespace *nsPtr;
 	Namespace *savedNsPtr;
 
-    case INST_UPVAR:
+    INST_CASE(INST_UPVAR):
 	TRACE_WITH_OBJ(("upvar "), OBJ_UNDER_TOS);
 
 	if (TclObjGetFrame(interp, OBJ_UNDER_TOS, &framePtr) == -1) {
@@ -3836,7 +4108,7 @@ TEBCresume(
 	}
 	goto doLinkVars;
 
-    case INST_NSUPVAR:
+    INST_CASE(INST_NSUPVAR):
 	TRACE_WITH_OBJ(("nsupvar "), OBJ_UNDER_TOS);
 	if (TclGetNamespaceFromObj(interp, OBJ_UNDER_TOS, &nsPtr) != TCL_OK) {
 	    goto gotError;
@@ -3857,7 +4129,7 @@ TEBCresume(
 	}
 	goto doLinkVars;
 
-    case INST_VARIABLE:
+    INST_CASE(INST_VARIABLE):
 	TRACE(("variable "));
 	otherPtr = TclObjLookupVarEx(interp, OBJ_AT_TOS, NULL,
 		(TCL_NAMESPACE_ONLY | TCL_LEAVE_ERR_MSG), "access",
@@ -3924,13 +4196,13 @@ TEBCresume(
      * -----------------------------------------------------------------
      */
 
-    case INST_JUMP1:
+    INST_CASE(INST_JUMP1):
 	opnd = TclGetInt1AtPtr(pc+1);
 	TRACE(("%d => new pc %u\n", opnd,
 		(unsigned)(pc + opnd - codePtr->codeStart)));
 	NEXT_INST_F(opnd, 0, 0);
 
-    case INST_JUMP4:
+    INST_CASE(INST_JUMP4):
 	opnd = TclGetInt4AtPtr(pc+1);
 	TRACE(("%d => new pc %u\n", opnd,
 		(unsigned)(pc + opnd - codePtr->codeStart)));
@@ -3941,22 +4213,22 @@ TEBCresume(
 
 	/* TODO: consider rewrite so we don't compute the offset we're not
 	 * going to take. */
-    case INST_JUMP_FALSE4:
+    INST_CASE(INST_JUMP_FALSE4):
 	jmpOffset[0] = TclGetInt4AtPtr(pc+1);	/* FALSE offset */
 	jmpOffset[1] = 5;			/* TRUE offset */
 	goto doCondJump;
 
-    case INST_JUMP_TRUE4:
+    INST_CASE(INST_JUMP_TRUE4):
 	jmpOffset[0] = 5;
 	jmpOffset[1] = TclGetInt4AtPtr(pc+1);
 	goto doCondJump;
 
-    case INST_JUMP_FALSE1:
+    INST_CASE(INST_JUMP_FALSE1):
 	jmpOffset[0] = TclGetInt1AtPtr(pc+1);
 	jmpOffset[1] = 2;
 	goto doCondJump;
 
-    case INST_JUMP_TRUE1:
+    INST_CASE(INST_JUMP_TRUE1):
 	jmpOffset[0] = 2;
 	jmpOffset[1] = TclGetInt1AtPtr(pc+1);
 
@@ -3994,7 +4266,7 @@ TEBCresume(
 	NEXT_INST_F(jmpOffset[b], 1, 0);
     }
 
-    case INST_JUMP_TABLE: {
+    INST_CASE(INST_JUMP_TABLE): {
 	Tcl_HashEntry *hPtr;
 	JumptableInfo *jtPtr;
 
@@ -4024,8 +4296,8 @@ TEBCresume(
      * and LAND is now handled by the expression compiler.
      */
 
-    case INST_LOR:
-    case INST_LAND: {
+    INST_CASE(INST_LOR):
+    INST_CASE(INST_LAND): {
 	/*
 	 * Operands must be boolean or numeric. No int->double conversions are
 	 * performed.
@@ -4073,7 +4345,7 @@ TEBCresume(
 	int nocase, match, length2, cflags, s1len, s2len;
 	const char *s1, *s2;
 
-    case INST_LIST:
+    INST_CASE(INST_LIST):
 	/*
 	 * Pop the opnd (objc) top stack elements into a new list obj and then
 	 * decrement their ref counts.
@@ -4084,7 +4356,7 @@ TEBCresume(
 	TRACE_WITH_OBJ(("%u => ", opnd), objResultPtr);
 	NEXT_INST_V(5, opnd, 1);
 
-    case INST_LIST_LENGTH:
+    INST_CASE(INST_LIST_LENGTH):
 	valuePtr = OBJ_AT_TOS;
 	if (TclListObjLength(interp, valuePtr, &length) != TCL_OK) {
 	    TRACE_WITH_OBJ(("%.30s => ERROR: ", O2S(valuePtr)),
@@ -4095,7 +4367,7 @@ TEBCresume(
 	TRACE(("%.20s => %d\n", O2S(valuePtr), length));
 	NEXT_INST_F(1, 1, 1);
 
-    case INST_LIST_INDEX:	/* lindex with objc == 3 */
+    INST_CASE(INST_LIST_INDEX):	/* lindex with objc == 3 */
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
@@ -4128,7 +4400,7 @@ TEBCresume(
 		O2S(valuePtr), O2S(value2Ptr), O2S(objResultPtr)));
 	NEXT_INST_F(1, 2, -1);	/* Already has the correct refCount */
 
-    case INST_LIST_INDEX_IMM:	/* lindex with objc==3 and index in bytecode
+    INST_CASE(INST_LIST_INDEX_IMM):	/* lindex with objc==3 and index in bytecode
 				 * stream */
 
 	/*
@@ -4172,7 +4444,7 @@ TEBCresume(
 		objResultPtr);
 	NEXT_INST_F(pcAdjustment, 1, 1);
 
-    case INST_LIST_INDEX_MULTI:	/* 'lindex' with multiple index args */
+    INST_CASE(INST_LIST_INDEX_MULTI):	/* 'lindex' with multiple index args */
 	/*
 	 * Determine the count of index args.
 	 */
@@ -4198,7 +4470,7 @@ TEBCresume(
 	TRACE(("%d => %s\n", opnd, O2S(objResultPtr)));
 	NEXT_INST_V(5, opnd, -1);
 
-    case INST_LSET_FLAT:
+    INST_CASE(INST_LSET_FLAT):
 	/*
 	 * Lset with 3, 5, or more args. Get the number of index args.
 	 */
@@ -4234,7 +4506,7 @@ TEBCresume(
 	TRACE(("%d => %s\n", opnd, O2S(objResultPtr)));
 	NEXT_INST_V(5, numIndices+1, -1);
 
-    case INST_LSET_LIST:	/* 'lset' with 4 args */
+    INST_CASE(INST_LSET_LIST):	/* 'lset' with 4 args */
 	/*
 	 * Get the old value of variable, and remove the stack ref. This is
 	 * safe because the variable still references the object; the ref
@@ -4270,7 +4542,7 @@ TEBCresume(
 	TRACE(("=> %s\n", O2S(objResultPtr)));
 	NEXT_INST_F(1, 2, -1);
 
-    case INST_LIST_RANGE_IMM:	/* lrange with objc==4 and both indices in
+    INST_CASE(INST_LIST_RANGE_IMM):	/* lrange with objc==4 and both indices in
 				 * bytecode stream */
 
 	/*
@@ -4336,7 +4608,18 @@ TEBCresume(
 	    if (toIdx >= objc) {
 		toIdx = objc-1;
 	    }
-	    objResultPtr = Tcl_NewListObj(toIdx-fromIdx+1, objv+fromIdx);
+	    objResultPtr = TclListObjRange(valuePtr, fromIdx, toIdx);
+	    if (objResultPtr == valuePtr) {
+		/*
+		 * The unshared list was trimmed in place; leave it on the
+		 * stack.
+		 */
+
+		TRACE_WITH_OBJ(("\"%.30s\" %d %d => ", O2S(valuePtr),
+			TclGetInt4AtPtr(pc+1), TclGetInt4AtPtr(pc+5)),
+			objResultPtr);
+		NEXT_INST_F(9, 0, 0);
+	    }
 	} else {
 	    TclNewObj(objResultPtr);
 	}
@@ -4345,8 +4628,8 @@ TEBCresume(
 		TclGetInt4AtPtr(pc+1), TclGetInt4AtPtr(pc+5)), objResultPtr);
 	NEXT_INST_F(9, 1, 1);
 
-    case INST_LIST_IN:
-    case INST_LIST_NOT_IN:	/* Basic list containment operators. */
+    INST_CASE(INST_LIST_IN):
+    INST_CASE(INST_LIST_NOT_IN):	/* Basic list containment operators. */
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
@@ -4414,9 +4697,9 @@ TEBCresume(
      *	   Start of string-related instructions.
      */
 
-    case INST_STR_EQ:
-    case INST_STR_NEQ:		/* String (in)equality check */
-    case INST_STR_CMP:		/* String compare. */
+    INST_CASE(INST_STR_EQ):
+    INST_CASE(INST_STR_NEQ):		/* String (in)equality check */
+    INST_CASE(INST_STR_CMP):		/* String compare. */
     stringCompare:
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
@@ -4544,14 +4827,14 @@ TEBCresume(
 		O2S(objResultPtr)));
 	NEXT_INST_F(1, 2, 1);
 
-    case INST_STR_LEN:
+    INST_CASE(INST_STR_LEN):
 	valuePtr = OBJ_AT_TOS;
 	length = Tcl_GetCharLength(valuePtr);
 	TclNewIntObj(objResultPtr, length);
 	TRACE(("%.20s => %d\n", O2S(valuePtr), length));
 	NEXT_INST_F(1, 1, 1);
 
-    case INST_STR_INDEX:
+    INST_CASE(INST_STR_INDEX):
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
@@ -4590,7 +4873,7 @@ TEBCresume(
 		O2S(objResultPtr)));
 	NEXT_INST_F(1, 2, 1);
 
-    case INST_STR_MATCH:
+    INST_CASE(INST_STR_MATCH):
 	nocase = TclGetInt1AtPtr(pc+1);
 	valuePtr = OBJ_AT_TOS;		/* String */
 	value2Ptr = OBJ_UNDER_TOS;	/* Pattern */
@@ -4646,7 +4929,7 @@ TEBCresume(
 	objResultPtr = TCONST(match);
 	NEXT_INST_F(0, 2, 1);
 
-    case INST_REGEXP:
+    INST_CASE(INST_REGEXP):
 	cflags = TclGetInt1AtPtr(pc+1); /* RE compile flages like NOCASE */
 	valuePtr = OBJ_AT_TOS;		/* String */
 	value2Ptr = OBJ_UNDER_TOS;	/* Pattern */
@@ -4710,23 +4993,68 @@ TEBCresume(
 	ClientData ptr1, ptr2;
 	int type1, type2;
 	long l1, l2, lResult;
-
-    case INST_EQ:
-    case INST_NEQ:
-    case INST_LT:
-    case INST_GT:
-    case INST_LE:
-    case INST_GE: {
+	double d1, d2, dResult;
+	unsigned char *feedbackPtr;
+
+    INST_CASE(INST_EQ):
+    INST_CASE(INST_NEQ):
+    INST_CASE(INST_LT):
+    INST_CASE(INST_GT):
+    INST_CASE(INST_LE):
+    INST_CASE(INST_GE):
+#ifndef TCL_COMPILE_DEBUG
+    instCompare:
+#endif
+    {
 	int iResult = 0, compare = 0;
 
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
+	/*
+	 * Sites that have only compared numbers of one kind so far try that
+	 * kind first, without the general type dispatch below.
+	 */
+
+	feedbackPtr = GetTypeFeedbackPtr(codePtr, pc);
+	if (feedbackPtr != NULL) {
+	    switch (*feedbackPtr) {
+	    case TYPE_FEEDBACK_LONG:
+		if ((valuePtr->typePtr == &tclIntType)
+			&& (value2Ptr->typePtr == &tclIntType)) {
+		    TypeFeedbackStat(numTypeFeedbackHits);
+		    l1 = valuePtr->internalRep.longValue;
+		    l2 = value2Ptr->internalRep.longValue;
+		    compare = (l1 < l2) ? MP_LT : ((l1 > l2) ? MP_GT : MP_EQ);
+		    goto convertComparison;
+		}
+		TypeFeedbackStat(numTypeFeedbackMisses);
+		break;
+	    case TYPE_FEEDBACK_DOUBLE:
+		if ((valuePtr->typePtr == &tclDoubleType)
+			&& (value2Ptr->typePtr == &tclDoubleType)) {
+		    d1 = valuePtr->internalRep.doubleValue;
+		    d2 = value2Ptr->internalRep.doubleValue;
+		    if (!TclIsNaN(d1) && !TclIsNaN(d2)) {
+			TypeFeedbackStat(numTypeFeedbackHits);
+			compare = (d1 < d2) ? MP_LT :
+				((d1 > d2) ? MP_GT : MP_EQ);
+			goto convertComparison;
+		    }
+		}
+		TypeFeedbackStat(numTypeFeedbackMisses);
+		break;
+	    default:
+		TypeFeedbackStat(numTypeFeedbackGeneric);
+	    }
+	}
+
 	if (GetNumberFromObj(NULL, valuePtr, &ptr1, &type1) != TCL_OK) {
 	    /*
 	     * At least one non-numeric argument - compare as strings.
 	     */
 
+	    RecordTypeFeedback(feedbackPtr, TYPE_FEEDBACK_MIXED);
 	    goto stringCompare;
 	}
 	if (type1 == TCL_NUMBER_NAN) {
@@ -4734,6 +5062,7 @@ TEBCresume(
 	     * NaN first arg: NaN != to everything, other compares are false.
 	     */
 
+	    RecordTypeFeedback(feedbackPtr, TYPE_FEEDBACK_MIXED);
 	    iResult = (*pc == INST_NEQ);
 	    goto foundResult;
 	}
@@ -4746,8 +5075,10 @@ TEBCresume(
 	     * At least one non-numeric argument - compare as strings.
 	     */
 
+	    RecordTypeFeedback(feedbackPtr, TYPE_FEEDBACK_MIXED);
 	    goto stringCompare;
 	}
+	RecordTypeFeedback(feedbackPtr, FeedbackForTypes(type1, type2));
 	if (type2 == TCL_NUMBER_NAN) {
 	    /*
 	     * NaN 2nd arg: NaN != to everything, other compares are false.
@@ -4812,12 +5143,12 @@ TEBCresume(
 	NEXT_INST_F(0, 2, 1);
     }
 
-    case INST_MOD:
-    case INST_LSHIFT:
-    case INST_RSHIFT:
-    case INST_BITOR:
-    case INST_BITXOR:
-    case INST_BITAND:
+    INST_CASE(INST_MOD):
+    INST_CASE(INST_LSHIFT):
+    INST_CASE(INST_RSHIFT):
+    INST_CASE(INST_BITOR):
+    INST_CASE(INST_BITXOR):
+    INST_CASE(INST_BITAND):
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
@@ -5007,7 +5338,7 @@ TEBCresume(
 		lResult = l1 ^ l2;
 	    longResultOfArithmetic:
 		TRACE(("%s %s => ", O2S(valuePtr), O2S(value2Ptr)));
-		if (Tcl_IsShared(valuePtr)) {
+		if (!ReuseArithOperand(valuePtr, pc+1)) {
 		    TclNewLongObj(objResultPtr, lResult);
 		    TRACE(("%s\n", O2S(objResultPtr)));
 		    NEXT_INST_F(1, 2, 1);
@@ -5042,14 +5373,84 @@ TEBCresume(
 	    NEXT_INST_F(1, 2, 1);
 	}
 
-    case INST_EXPON:
-    case INST_ADD:
-    case INST_SUB:
-    case INST_DIV:
-    case INST_MULT:
+    INST_CASE(INST_EXPON):
+    INST_CASE(INST_ADD):
+    INST_CASE(INST_SUB):
+    INST_CASE(INST_DIV):
+    INST_CASE(INST_MULT):
+#ifndef TCL_COMPILE_DEBUG
+    instArith:
+#endif
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
 
+	/*
+	 * Sites that have only seen operands of one numeric kind so far try
+	 * that kind first, without the general type dispatch below. Anything
+	 * unusual (overflow, NaN results, division by zero) is left to the
+	 * general code.
+	 */
+
+	feedbackPtr = GetTypeFeedbackPtr(codePtr, pc);
+	if (feedbackPtr != NULL) {
+	    switch (*feedbackPtr) {
+	    case TYPE_FEEDBACK_LONG:
+		if ((valuePtr->typePtr == &tclIntType)
+			&& (value2Ptr->typePtr == &tclIntType)) {
+		    TypeFeedbackStat(numTypeFeedbackHits);
+		    l1 = valuePtr->internalRep.longValue;
+		    l2 = value2Ptr->internalRep.longValue;
+		    goto longArithmetic;
+		}
+		TypeFeedbackStat(numTypeFeedbackMisses);
+		break;
+	    case TYPE_FEEDBACK_DOUBLE:
+		if ((valuePtr->typePtr == &tclDoubleType)
+			&& (value2Ptr->typePtr == &tclDoubleType)) {
+		    d1 = valuePtr->internalRep.doubleValue;
+		    d2 = value2Ptr->internalRep.doubleValue;
+		    switch (*pc) {
+		    case INST_ADD:
+			dResult = d1 + d2;
+			break;
+		    case INST_SUB:
+			dResult = d1 - d2;
+			break;
+		    case INST_MULT:
+			dResult = d1 * d2;
+			break;
+		    default:
+#ifndef IEEE_FLOATING_POINT
+			if (d2 == 0.0) {
+			    goto doubleArithmeticMiss;
+			}
+#endif
+			dResult = d1 / d2;
+			break;
+		    }
+		    if (!TclIsNaN(dResult)) {
+			TypeFeedbackStat(numTypeFeedbackHits);
+			TRACE(("%.20s %.20s => ", O2S(valuePtr), O2S(value2Ptr)));
+			if (!ReuseArithOperand(valuePtr, pc+1)) {
+			    TclNewDoubleObj(objResultPtr, dResult);
+			    TRACE(("%s\n", O2S(objResultPtr)));
+			    NEXT_INST_F(1, 2, 1);
+			}
+			TclSetDoubleObj(valuePtr, dResult);
+			TRACE(("%s\n", O2S(valuePtr)));
+			NEXT_INST_F(1, 1, 0);
+		    }
+		}
+#ifndef IEEE_FLOATING_POINT
+	    doubleArithmeticMiss:
+#endif
+		TypeFeedbackStat(numTypeFeedbackMisses);
+		break;
+	    default:
+		TypeFeedbackStat(numTypeFeedbackGeneric);
+	    }
+	}
+
 	if ((GetNumberFromObj(NULL, valuePtr, &ptr1, &type1) != TCL_OK)
 		|| IsErroringNaNType(type1)) {
 	    TRACE(("%.20s %.20s => ILLEGAL 1st TYPE %s\n",
@@ -5093,6 +5494,8 @@ TEBCresume(
 	}
 #endif
 
+	RecordTypeFeedback(feedbackPtr, FeedbackForTypes(type1, type2));
+
 	/*
 	 * Handle (long,long) arithmetic as best we can without going out to
 	 * an external function.
@@ -5104,6 +5507,7 @@ TEBCresume(
 	    l1 = *((const long *)ptr1);
 	    l2 = *((const long *)ptr2);
 
+	longArithmetic:
 	    switch (*pc) {
 	    case INST_ADD:
 		w1 = (Tcl_WideInt) l1;
@@ -5141,12 +5545,24 @@ TEBCresume(
 #endif
 	    wideResultOfArithmetic:
 		TRACE(("%s %s => ", O2S(valuePtr), O2S(value2Ptr)));
-		if (Tcl_IsShared(valuePtr)) {
+		if (!ReuseArithOperand(valuePtr, pc+1)) {
 		    objResultPtr = Tcl_NewWideIntObj(wResult);
 		    TRACE(("%s\n", O2S(objResultPtr)));
 		    NEXT_INST_F(1, 2, 1);
 		}
-		Tcl_SetWideIntObj(valuePtr, wResult);
+
+		/*
+		 * Same as Tcl_SetWideIntObj, which would refuse an operand
+		 * still held by the local it is stored back into.
+		 */
+
+#ifndef NO_WIDE_TYPE
+		if ((wResult < (Tcl_WideInt) LONG_MIN)
+			|| (wResult > (Tcl_WideInt) LONG_MAX)) {
+		    TclSetWideIntObj(valuePtr, wResult);
+		} else
+#endif
+		TclSetLongObj(valuePtr, (long) wResult);
 		TRACE(("%s\n", O2S(valuePtr)));
 		NEXT_INST_F(1, 1, 0);
 
@@ -5215,7 +5631,7 @@ TEBCresume(
 	    NEXT_INST_F(1, 2, 1);
 	}
 
-    case INST_LNOT: {
+    INST_CASE(INST_LNOT): {
 	int b;
 
 	valuePtr = OBJ_AT_TOS;
@@ -5235,7 +5651,7 @@ TEBCresume(
 	NEXT_INST_F(1, 1, 1);
     }
 
-   case INST_BITNOT:
+    INST_CASE(INST_BITNOT):
 	valuePtr = OBJ_AT_TOS;
 	if ((GetNumberFromObj(NULL, valuePtr, &ptr1, &type1) != TCL_OK)
 		|| (type1==TCL_NUMBER_NAN) || (type1==TCL_NUMBER_DOUBLE)) {
@@ -5266,7 +5682,7 @@ TEBCresume(
 	    NEXT_INST_F(1, 0, 0);
 	}
 
-    case INST_UMINUS:
+    INST_CASE(INST_UMINUS):
 	valuePtr = OBJ_AT_TOS;
 	if ((GetNumberFromObj(NULL, valuePtr, &ptr1, &type1) != TCL_OK)
 		|| IsErroringNaNType(type1)) {
@@ -5300,8 +5716,8 @@ TEBCresume(
 	    NEXT_INST_F(1, 0, 0);
 	}
 
-    case INST_UPLUS:
-    case INST_TRY_CVT_TO_NUMERIC:
+    INST_CASE(INST_UPLUS):
+    INST_CASE(INST_TRY_CVT_TO_NUMERIC):
 	/*
 	 * Try to convert the topmost stack object to numeric object. This is
 	 * done in order to support [expr]'s policy of interpreting operands
@@ -5391,7 +5807,7 @@ TEBCresume(
      * -----------------------------------------------------------------
      */
 
-    case INST_BREAK:
+    INST_CASE(INST_BREAK):
 	/*
 	DECACHE_STACK_INFO();
 	Tcl_ResetResult(interp);
@@ -5401,7 +5817,7 @@ TEBCresume(
 	cleanup = 0;
 	goto processExceptionReturn;
 
-    case INST_CONTINUE:
+    INST_CASE(INST_CONTINUE):
 	/*
 	DECACHE_STACK_INFO();
 	Tcl_ResetResult(interp);
@@ -5420,7 +5836,7 @@ TEBCresume(
 	int varIndex, valIndex, continueLoop, j, iterTmpIndex;
 	long i;
 
-    case INST_FOREACH_START4:
+    INST_CASE(INST_FOREACH_START4):
 	/*
 	 * Initialize the temporary local var that holds the count of the
 	 * number of iterations of the loop body to -1.
@@ -5453,7 +5869,7 @@ TEBCresume(
 	NEXT_INST_F(5, 0, 0);
 #endif
 
-    case INST_FOREACH_STEP4:
+    INST_CASE(INST_FOREACH_STEP4):
 	/*
 	 * "Step" a foreach loop (i.e., begin its next iteration) by assigning
 	 * the next value list element to each loop var.
@@ -5573,7 +5989,7 @@ TEBCresume(
 	}
     }
 
-    case INST_BEGIN_CATCH4:
+    INST_CASE(INST_BEGIN_CATCH4):
 	/*
 	 * Record start of the catch command with exception range index equal
 	 * to the operand. Push the current stack depth onto the special catch
@@ -5586,7 +6002,7 @@ TEBCresume(
 		(int) CURR_DEPTH));
 	NEXT_INST_F(5, 0, 0);
 
-    case INST_END_CATCH:
+    INST_CASE(INST_END_CATCH):
 	catchTop--;
 	DECACHE_STACK_INFO();
 	Tcl_ResetResult(interp);
@@ -5595,7 +6011,7 @@ TEBCresume(
 	TRACE(("=> catchTop=%d\n", (int) (catchTop - initCatchTop - 1)));
 	NEXT_INST_F(1, 0, 0);
 
-    case INST_PUSH_RESULT:
+    INST_CASE(INST_PUSH_RESULT):
 	objResultPtr = Tcl_GetObjResult(interp);
 	TRACE_WITH_OBJ(("=> "), objResultPtr);
 
@@ -5608,19 +6024,19 @@ TEBCresume(
 	iPtr->objResultPtr = objPtr;
 	NEXT_INST_F(1, 0, -1);
 
-    case INST_PUSH_RETURN_CODE:
+    INST_CASE(INST_PUSH_RETURN_CODE):
 	TclNewIntObj(objResultPtr, result);
 	TRACE(("=> %u\n", result));
 	NEXT_INST_F(1, 0, 1);
 
-    case INST_PUSH_RETURN_OPTIONS:
+    INST_CASE(INST_PUSH_RETURN_OPTIONS):
 	DECACHE_STACK_INFO();
 	objResultPtr = Tcl_GetReturnOptions(interp, result);
 	CACHE_STACK_INFO();
 	TRACE_WITH_OBJ(("=> "), objResultPtr);
 	NEXT_INST_F(1, 0, 1);
 
-    case INST_RETURN_CODE_BRANCH: {
+    INST_CASE(INST_RETURN_CODE_BRANCH): {
 	int code;
 
 	if (TclGetIntFromObj(NULL, OBJ_AT_TOS, &code) != TCL_OK) {
@@ -5647,7 +6063,7 @@ TEBCresume(
 	Tcl_DictSearch *searchPtr;
 	DictUpdateInfo *duiPtr;
 
-    case INST_DICT_GET:
+    INST_CASE(INST_DICT_GET):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	TRACE(("%u => ", opnd));
 	dictPtr = OBJ_AT_DEPTH(opnd);
@@ -5683,9 +6099,9 @@ TEBCresume(
 	}
 	goto gotError;
 
-    case INST_DICT_SET:
-    case INST_DICT_UNSET:
-    case INST_DICT_INCR_IMM:
+    INST_CASE(INST_DICT_SET):
+    INST_CASE(INST_DICT_UNSET):
+    INST_CASE(INST_DICT_INCR_IMM):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	opnd2 = TclGetUInt4AtPtr(pc+5);
 
@@ -5790,8 +6206,8 @@ TEBCresume(
 	TRACE_APPEND(("%.30s\n", O2S(objResultPtr)));
 	NEXT_INST_V(9, cleanup, 1);
 
-    case INST_DICT_APPEND:
-    case INST_DICT_LAPPEND:
+    INST_CASE(INST_DICT_APPEND):
+    INST_CASE(INST_DICT_LAPPEND):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	varPtr = LOCAL(opnd);
 	while (TclIsVarLink(varPtr)) {
@@ -5926,7 +6342,7 @@ TEBCresume(
 	TRACE_APPEND(("%.30s\n", O2S(objResultPtr)));
 	NEXT_INST_F(5, 2, 1);
 
-    case INST_DICT_FIRST:
+    INST_CASE(INST_DICT_FIRST):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	TRACE(("%u => ", opnd));
 	dictPtr = POP_OBJECT();
@@ -5951,7 +6367,7 @@ TEBCresume(
 	Tcl_IncrRefCount(statePtr);
 	goto pushDictIteratorResult;
 
-    case INST_DICT_NEXT:
+    INST_CASE(INST_DICT_NEXT):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	TRACE(("%u => ", opnd));
 	statePtr = (*LOCAL(opnd)).value.objPtr;
@@ -6000,7 +6416,7 @@ TEBCresume(
 	/* TODO: consider opt like INST_FOREACH_STEP4 */
 	NEXT_INST_F(5, 0, 1);
 
-    case INST_DICT_UPDATE_START:
+    INST_CASE(INST_DICT_UPDATE_START):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	opnd2 = TclGetUInt4AtPtr(pc+5);
 	varPtr = LOCAL(opnd);
@@ -6051,7 +6467,7 @@ TEBCresume(
 	}
 	NEXT_INST_F(9, 0, 0);
 
-    case INST_DICT_UPDATE_END:
+    INST_CASE(INST_DICT_UPDATE_END):
 	opnd = TclGetUInt4AtPtr(pc+1);
 	opnd2 = TclGetUInt4AtPtr(pc+5);
 	varPtr = LOCAL(opnd);
@@ -6129,7 +6545,56 @@ TEBCresume(
      * -----------------------------------------------------------------
      */
 
+    INST_CASE(INST_BINARY_SCAN): {
+	DictUpdateInfo *infoPtr;
+	int numScanned;
+
+	opnd = TclGetUInt4AtPtr(pc+1);
+	infoPtr = codePtr->auxDataArrayPtr[opnd].clientData;
+	TRACE(("\"%.20s\" \"%.20s\" => ", O2S(OBJ_UNDER_TOS),
+		O2S(OBJ_AT_TOS)));
+	DECACHE_STACK_INFO();
+	if (TclBinaryScan(interp, OBJ_UNDER_TOS, OBJ_AT_TOS, infoPtr->length,
+		NULL, infoPtr->varIndices, &numScanned) != TCL_OK) {
+	    CACHE_STACK_INFO();
+	    TRACE_APPEND(("ERROR: %.30s\n",
+		    O2S(Tcl_GetObjResult(interp))));
+	    goto gotError;
+	}
+	CACHE_STACK_INFO();
+	TRACE_APPEND(("%d\n", numScanned));
+	TclNewIntObj(objResultPtr, numScanned);
+	NEXT_INST_F(5, 2, 1);
+    }
+
+    INST_CASE(INST_NUMERIC_SET):
+	opnd = TclGetUInt4AtPtr(pc+1);
+	TRACE(("%u => ", opnd));
+	objResultPtr = ExecuteNumericSet(iPtr,
+		codePtr->auxDataArrayPtr[opnd].clientData);
+	if (objResultPtr == NULL) {
+	    TRACE_APPEND(("not numeric\n"));
+	    NEXT_INST_F(9, 0, 0);
+	}
+	TRACE_APPEND(("%.30s\n", O2S(objResultPtr)));
+
+	/*
+	 * Continue after the store at the end of the generic code, skipping
+	 * its push and pop as INST_STORE_SCALAR does.
+	 */
+
+	pcAdjustment = TclGetInt4AtPtr(pc+5);
+#ifndef TCL_COMPILE_DEBUG
+	if (*(pc+pcAdjustment) == INST_POP) {
+	    NEXT_INST_F((pcAdjustment+1), 0, 0);
+	}
+#endif
+	NEXT_INST_F(pcAdjustment, 0, 1);
+
     default:
+#ifdef USE_THREADED_DISPATCH
+    instUnrecognized:
+#endif
 	Tcl_Panic("TclNRExecuteByteCode: unrecognized opCode %u", *pc);
     } /* end of switch on opCode */
 
@@ -7543,6 +8008,223 @@ ExecuteExtendedUnaryMathOp(
     Tcl_Panic("unexpected opcode");
     return NULL;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExecuteNumericSet --
+ *
+ *	Does the work of INST_NUMERIC_SET: computes the expression of a [set]
+ *	of a numeric-only local on unboxed longs and doubles, and assigns the
+ *	result to the local, in its own Tcl_Obj when nothing else holds that.
+ *	Gives up, leaving everything as it was, if an operand is not a
+ *	readable local or constant of type int or double, if the local cannot
+ *	be written to directly, or if the result would not be a long or a
+ *	double; the generic code then does the [set].
+ *
+ * Results:
+ *	The new value of the local, or NULL when giving up.
+ *
+ * Side effects:
+ *	Sets the local.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    int isDouble;		/* Whether the value is d rather than l. */
+    union {
+	long l;
+	double d;
+    } u;
+} NumericValue;
+
+static Tcl_Obj *
+ExecuteNumericSet(
+    Interp *iPtr,		/* Interpreter running the proc. */
+    const NumericSetInfo *infoPtr)
+				/* What to compute and assign. */
+{
+    Var *compiledLocals = iPtr->varFramePtr->compiledLocals;
+    NumericValue stack[NUMERIC_SET_MAX_DEPTH], *topPtr = stack - 1;
+    const NumericSetOp *opPtr = infoPtr->ops;
+    const NumericSetOp *lastOpPtr = opPtr + infoPtr->numOps;
+    Var *varPtr;
+    Tcl_Obj *objPtr;
+    long l1, l2, lResult;
+    double d1, d2, dResult;
+
+    for (; opPtr < lastOpPtr; opPtr++) {
+	switch (opPtr->type) {
+	case NUMERIC_OP_LOCAL:
+	    varPtr = compiledLocals + opPtr->u.index;
+	    while (TclIsVarLink(varPtr)) {
+		varPtr = varPtr->value.linkPtr;
+	    }
+	    if (!TclIsVarDirectReadable(varPtr)) {
+		return NULL;
+	    }
+	    objPtr = varPtr->value.objPtr;
+	    topPtr++;
+	    if (objPtr->typePtr == &tclIntType) {
+		topPtr->isDouble = 0;
+		topPtr->u.l = objPtr->internalRep.longValue;
+	    } else if ((objPtr->typePtr == &tclDoubleType)
+		    && !TclIsNaN(objPtr->internalRep.doubleValue)) {
+		topPtr->isDouble = 1;
+		topPtr->u.d = objPtr->internalRep.doubleValue;
+	    } else {
+		return NULL;
+	    }
+	    continue;
+	case NUMERIC_OP_LONG:
+	    topPtr++;
+	    topPtr->isDouble = 0;
+	    topPtr->u.l = opPtr->u.longValue;
+	    continue;
+	case NUMERIC_OP_DOUBLE:
+	    topPtr++;
+	    topPtr->isDouble = 1;
+	    topPtr->u.d = opPtr->u.doubleValue;
+	    continue;
+	case NUMERIC_OP_UMINUS:
+	    if (topPtr->isDouble) {
+		topPtr->u.d = -topPtr->u.d;
+	    } else if (topPtr->u.l == LONG_MIN) {
+		return NULL;
+	    } else {
+		topPtr->u.l = -topPtr->u.l;
+	    }
+	    continue;
+	}
+
+	/*
+	 * A binary operator, as for INST_ADD etc.
+	 */
+
+	topPtr--;
+	if (topPtr[0].isDouble || topPtr[1].isDouble) {
+	    if (opPtr->type == NUMERIC_OP_MOD) {
+		return NULL;
+	    }
+	    d1 = (topPtr[0].isDouble ? topPtr[0].u.d : (double) topPtr[0].u.l);
+	    d2 = (topPtr[1].isDouble ? topPtr[1].u.d : (double) topPtr[1].u.l);
+	    switch (opPtr->type) {
+	    case NUMERIC_OP_ADD:
+		dResult = d1 + d2;
+		break;
+	    case NUMERIC_OP_SUB:
+		dResult = d1 - d2;
+		break;
+	    case NUMERIC_OP_MULT:
+		dResult = d1 * d2;
+		break;
+	    default:
+		if (d2 == 0.0) {
+		    return NULL;
+		}
+		dResult = d1 / d2;
+		break;
+	    }
+	    if (TclIsNaN(dResult)) {
+		return NULL;
+	    }
+	    topPtr->isDouble = 1;
+	    topPtr->u.d = dResult;
+	    continue;
+	}
+
+	l1 = topPtr[0].u.l;
+	l2 = topPtr[1].u.l;
+	switch (opPtr->type) {
+	case NUMERIC_OP_ADD:
+	    lResult = (long) ((unsigned long) l1 + (unsigned long) l2);
+	    if (Overflowing(l1, l2, lResult)) {
+		return NULL;
+	    }
+	    break;
+	case NUMERIC_OP_SUB:
+	    lResult = (long) ((unsigned long) l1 - (unsigned long) l2);
+	    if (Overflowing(l1, ~l2, lResult)) {
+		return NULL;
+	    }
+	    break;
+	case NUMERIC_OP_MULT:
+	    if ((sizeof(long) < 2*sizeof(int))
+		    || (l1 > INT_MAX) || (l1 < INT_MIN)
+		    || (l2 > INT_MAX) || (l2 < INT_MIN)) {
+		return NULL;
+	    }
+	    lResult = l1 * l2;
+	    break;
+	case NUMERIC_OP_DIV:
+	    if ((l2 == 0) || ((l1 == LONG_MIN) && (l2 == -1))) {
+		return NULL;
+	    }
+	    lResult = l1 / l2;
+
+	    /*
+	     * Force Tcl's integer division rules.
+	     */
+
+	    if (((lResult < 0) || ((lResult == 0) &&
+		    ((l1 < 0 && l2 > 0) || (l1 > 0 && l2 < 0)))) &&
+		    ((lResult * l2) != l1)) {
+		lResult -= 1;
+	    }
+	    break;
+	default:
+	    if (l2 == 0) {
+		return NULL;
+	    } else if ((l2 == 1) || (l2 == -1)) {
+		lResult = 0;
+		break;
+	    }
+	    lResult = l1 / l2;
+	    if (((lResult < 0) || ((lResult == 0) &&
+		    ((l1 < 0 && l2 > 0) || (l1 > 0 && l2 < 0)))) &&
+		    ((lResult * l2) != l1)) {
+		lResult -= 1;
+	    }
+	    lResult = l1 - l2*lResult;
+	    break;
+	}
+	topPtr->u.l = lResult;
+    }
+
+    /*
+     * Assign the value as INST_STORE_SCALAR would when it takes its fast
+     * path, but into the Tcl_Obj of the local if that is not shared.
+     */
+
+    varPtr = compiledLocals + infoPtr->varIndex;
+    while (TclIsVarLink(varPtr)) {
+	varPtr = varPtr->value.linkPtr;
+    }
+    if (!TclIsVarDirectWritable(varPtr)) {
+	return NULL;
+    }
+    objPtr = varPtr->value.objPtr;
+    if ((objPtr != NULL) && !Tcl_IsShared(objPtr)) {
+	if (topPtr->isDouble) {
+	    TclSetDoubleObj(objPtr, topPtr->u.d);
+	} else {
+	    TclSetLongObj(objPtr, topPtr->u.l);
+	}
+	return objPtr;
+    }
+    if (objPtr != NULL) {
+	TclDecrRefCount(objPtr);
+    }
+    if (topPtr->isDouble) {
+	TclNewDoubleObj(objPtr, topPtr->u.d);
+    } else {
+	TclNewLongObj(objPtr, topPtr->u.l);
+    }
+    Tcl_IncrRefCount(objPtr);
+    varPtr->value.objPtr = objPtr;
+    return objPtr;
+}
 #undef LONG_RESULT
 #undef WIDE_RESULT
 #undef BIG_RESULT
@@ -8772,6 +9454,26 @@ EvalStatsCmd(
 	}
     }
 
+    /*
+     * Type feedback of arithmetic and comparison instructions.
+     */
+
+    sum = statsPtr->numTypeFeedbackHits + statsPtr->numTypeFeedbackMisses
+	    + statsPtr->numTypeFeedbackGeneric;
+    Tcl_AppendPrintfToObj(objPtr, "\nArith/compare type feedback\t%ld\n",
+	    sum);
+    if (sum > 0) {
+	Tcl_AppendPrintfToObj(objPtr, "  Fast path hits\t\t%ld\t%6.1f%%\n",
+		statsPtr->numTypeFeedbackHits,
+		Percent(statsPtr->numTypeFeedbackHits, sum));
+	Tcl_AppendPrintfToObj(objPtr, "  Guard misses\t\t\t%ld\t%6.1f%%\n",
+		statsPtr->numTypeFeedbackMisses,
+		Percent(statsPtr->numTypeFeedbackMisses, sum));
+	Tcl_AppendPrintfToObj(objPtr, "  Unspecialized sites\t\t%ld\t%6.1f%%\n",
+		statsPtr->numTypeFeedbackGeneric,
+		Percent(statsPtr->numTypeFeedbackGeneric, sum));
+    }
+
 #ifdef TCL_MEM_DEBUG
     Tcl_AppendPrintfToObj(objPtr, "\nHeap Statistics:\n");
     TclDumpMemoryInfo((ClientData) objPtr, 1);
@@ -14,6 +14,11 @@
  */
 
 #include "tclInt.h"
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define HAVE_SSE2_GROUPS 1
+#endif
 
 /*
  * Prevent macros from clashing with function definitions.
@@ -39,6 +44,70 @@
 #define RANDOM_INDEX(tablePtr, i) \
     ((((i)*1103515245L) >> (tablePtr)->downShift) & (tablePtr)->mask)
 
+/*
+ * Tables whose key type has the TCL_HASH_KEY_OPEN_ADDRESSING flag use open
+ * addressing instead of bucket chains. Entries are still allocated one by
+ * one (so that callers may hold on to them, and embed them in their own
+ * structures), but instead of chains the table has an array of HashChunks,
+ * each a pair of cache lines holding up to CHUNK_SLOTS entry pointers and a
+ * tag byte for each: 0 for an empty slot, otherwise 7 bits of the scrambled
+ * hash value of the entry with the top bit set. A search compares all the
+ * tags of a chunk at once (with SSE2 where available) and only looks at the
+ * entries whose tags match. An entry that finds its chunk full goes to the
+ * next chunk of its probe sequence, and counts itself in the overflow of
+ * the chunk it passed, so a search may stop at the first chunk that nothing
+ * has overflowed from; there is no need for tombstones. The fields of the
+ * Tcl_HashTable are used as follows:
+ *
+ * buckets	    The chunk array.
+ * staticBuckets[0] The memory block holding the chunks, which are aligned
+ *		    to a cache line within it.
+ * numBuckets	    Number of chunks, a power of two.
+ * rebuildSize	    Grow the table when numEntries gets to be this large.
+ * mask		    numBuckets - 1.
+ *
+ * Until a table has rebuildSize entries it is an ordinary chained table
+ * using staticBuckets, which costs nothing to set up and is just as fast for
+ * a handful of entries. Only findProc and createProc tell it apart.
+ */
+
+#define CHUNK_SLOTS		14
+#define CHUNK_MAX_FILL		12
+#define CHUNK_ALIGN		64
+
+typedef struct HashChunk {
+    unsigned char tags[CHUNK_SLOTS];
+				/* Tag of the entry in each slot, or 0. */
+    unsigned char overflow;	/* Number of entries in other chunks whose
+				 * probe sequence passed this one, saturating
+				 * at 255. */
+    unsigned char unused;	/* Pads the tags to 16 bytes. */
+    Tcl_HashEntry *slots[CHUNK_SLOTS];
+				/* The entry in each slot, or NULL. */
+} HashChunk;
+
+#define CHUNK_TAG(h)		((unsigned char) (((h) >> 24) | 0x80))
+#define CHUNK_HOME(typePtr, hash, h) \
+    (((typePtr)->hashKeyProc == NULL \
+	    || ((typePtr)->flags & TCL_HASH_KEY_RANDOMIZE_HASH)) ? (h) : (hash))
+#define CHUNK_DELTA(tag)	(2 * (int) (tag) + 1)
+#define OPEN_CHUNKS(tablePtr)	((HashChunk *) (tablePtr)->buckets)
+#define IS_OPEN_TABLE(tablePtr) \
+    ((tablePtr)->createProc == CreateOpenEntry)
+#define OPEN_IS_SMALL(tablePtr) \
+    ((tablePtr)->buckets == (tablePtr)->staticBuckets)
+#define OPEN_IS_CHUNKED(tablePtr) \
+    (IS_OPEN_TABLE(tablePtr) && !OPEN_IS_SMALL(tablePtr))
+
+#if TCL_HASH_KEY_STORE_HASH
+#   define ENTRY_HASH(typePtr, tablePtr, hPtr) PTR2UINT((hPtr)->hash)
+#else
+#   define ENTRY_HASH(typePtr, tablePtr, hPtr) \
+	((typePtr)->hashKeyProc ? (typePtr)->hashKeyProc((tablePtr), \
+		Tcl_GetHashKey((tablePtr), (hPtr))) \
+		: PTR2UINT(Tcl_GetHashKey((tablePtr), (hPtr))))
+#endif
+
 /*
  * Prototypes for the array hash key methods.
  */
@@ -76,8 +145,20 @@ static Tcl_HashEntry *	BogusCreate(Tcl_HashTable *tablePtr, const char *key,
 			    int *newPtr);
 static Tcl_HashEntry *	CreateHashEntry(Tcl_HashTable *tablePtr, const char *key,
 			    int *newPtr);
+static Tcl_HashEntry *	CreateOpenEntry(Tcl_HashTable *tablePtr,
+			    const char *key, int *newPtr);
 static Tcl_HashEntry *	FindHashEntry(Tcl_HashTable *tablePtr, const char *key);
+static Tcl_HashEntry *	FindOpenEntry(Tcl_HashTable *tablePtr, const char *key);
+static void		InsertIntoChunks(Tcl_HashTable *tablePtr,
+			    Tcl_HashEntry *hPtr, unsigned int home,
+			    unsigned int h);
+static char *		OpenHashStats(Tcl_HashTable *tablePtr);
+static void		RebuildOpenTable(Tcl_HashTable *tablePtr,
+			    const Tcl_HashKeyType *typePtr);
 static void		RebuildTable(Tcl_HashTable *tablePtr);
+static void		RemoveOpenEntry(Tcl_HashTable *tablePtr,
+			    const Tcl_HashKeyType *typePtr,
+			    Tcl_HashEntry *entryPtr);
 
 const Tcl_HashKeyType tclArrayHashKeyType = {
     TCL_HASH_KEY_TYPE_VERSION,		/* version */
@@ -203,6 +284,13 @@ Tcl_InitCustomHashTable(
 	 */
 
 	tablePtr->typePtr = typePtr;
+
+	if ((typePtr->flags & TCL_HASH_KEY_OPEN_ADDRESSING)
+		&& (keyType == TCL_CUSTOM_TYPE_KEYS
+		|| keyType == TCL_CUSTOM_PTR_KEYS)) {
+	    tablePtr->findProc = FindOpenEntry;
+	    tablePtr->createProc = CreateOpenEntry;
+	}
     } else {
 	/*
 	 * The caller has not been rebuilt so the hash table is not extended.
@@ -433,6 +521,11 @@ Tcl_DeleteHashEntry(
 	typePtr = &tclArrayHashKeyType;
     }
 
+    if (IS_OPEN_TABLE(tablePtr)) {
+	RemoveOpenEntry(tablePtr, typePtr, entryPtr);
+	goto freeEntry;
+    }
+
 #if TCL_HASH_KEY_STORE_HASH
     if (typePtr->hashKeyProc == NULL
 	    || typePtr->flags & TCL_HASH_KEY_RANDOMIZE_HASH) {
@@ -460,6 +553,7 @@ Tcl_DeleteHashEntry(
 	}
     }
 
+  freeEntry:
     tablePtr->numEntries--;
     if (typePtr->freeEntryProc) {
 	typePtr->freeEntryProc(entryPtr);
@@ -505,19 +599,39 @@ Tcl_DeleteHashTable(
     }
 
     /*
-     * Free up all the entries in the table.
+     * Free up all the entries in the table. The chunks of an open table are
+     * walked with a search.
      */
 
-    for (i = 0; i < tablePtr->numBuckets; i++) {
-	hPtr = tablePtr->buckets[i];
-	while (hPtr != NULL) {
-	    nextPtr = hPtr->nextPtr;
+    if (OPEN_IS_CHUNKED(tablePtr)) {
+	Tcl_HashSearch search;
+
+	for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+		hPtr = Tcl_NextHashEntry(&search)) {
 	    if (typePtr->freeEntryProc) {
 		typePtr->freeEntryProc(hPtr);
 	    } else {
 		ckfree((char *) hPtr);
 	    }
-	    hPtr = nextPtr;
+	}
+	tablePtr->buckets = tablePtr->staticBuckets;
+	if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
+	    TclpSysFree((char *) tablePtr->staticBuckets[0]);
+	} else {
+	    ckfree((char *) tablePtr->staticBuckets[0]);
+	}
+    } else {
+	for (i = 0; i < tablePtr->numBuckets; i++) {
+	    hPtr = tablePtr->buckets[i];
+	    while (hPtr != NULL) {
+		nextPtr = hPtr->nextPtr;
+		if (typePtr->freeEntryProc) {
+		    typePtr->freeEntryProc(hPtr);
+		} else {
+		    ckfree((char *) hPtr);
+		}
+		hPtr = nextPtr;
+	    }
 	}
     }
 
@@ -604,6 +718,19 @@ Tcl_NextHashEntry(
     Tcl_HashEntry *hPtr;
     Tcl_HashTable *tablePtr = searchPtr->tablePtr;
 
+    if (OPEN_IS_CHUNKED(tablePtr)) {
+	while (searchPtr->nextIndex < tablePtr->numBuckets * CHUNK_SLOTS) {
+	    int index = searchPtr->nextIndex++;
+
+	    hPtr = OPEN_CHUNKS(tablePtr)[index / CHUNK_SLOTS]
+		    .slots[index % CHUNK_SLOTS];
+	    if (hPtr != NULL) {
+		return hPtr;
+	    }
+	}
+	return NULL;
+    }
+
     while (searchPtr->nextEntryPtr == NULL) {
 	if (searchPtr->nextIndex >= tablePtr->numBuckets) {
 	    return NULL;
@@ -645,6 +772,10 @@ Tcl_HashStats(
     register Tcl_HashEntry *hPtr;
     char *result, *p;
 
+    if (OPEN_IS_CHUNKED(tablePtr)) {
+	return OpenHashStats(tablePtr);
+    }
+
     /*
      * Compute a histogram of bucket usage.
      */
@@ -1107,6 +1238,491 @@ RebuildTable(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * MixHash --
+ *
+ *	Scrambles a hash value so that every bit of it depends on every bit
+ *	of the key's hash. Open tables take tags and probe steps from the high
+ *	bits of the result, and the home chunk of an entry from its low bits
+ *	when the key type has no hashKeyProc or asks for
+ *	TCL_HASH_KEY_RANDOMIZE_HASH. Otherwise the home chunk comes straight
+ *	from the key's hash, as the bucket does in a chained table, which
+ *	keeps the entries for keys like "item1", "item2"... close together.
+ *
+ * Results:
+ *	The scrambled hash value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline unsigned int
+MixHash(
+    unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChunkMatch --
+ *
+ *	Compares all the tags of a chunk with a tag, which may be 0 to look
+ *	for empty slots.
+ *
+ * Results:
+ *	A bit mask with bit i set if the tag of slot i matched.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline unsigned int
+ChunkMatch(
+    const HashChunk *chunkPtr,
+    unsigned char tag)
+{
+#ifdef HAVE_SSE2_GROUPS
+    __m128i tags = _mm_loadu_si128((const __m128i *) chunkPtr->tags);
+
+    return (unsigned int) _mm_movemask_epi8(
+	    _mm_cmpeq_epi8(tags, _mm_set1_epi8((char) tag)))
+	    & ((1U << CHUNK_SLOTS) - 1);
+#else
+    unsigned int i, bits = 0;
+
+    for (i = 0; i < CHUNK_SLOTS; i++) {
+	bits |= (unsigned int) (chunkPtr->tags[i] == tag) << i;
+    }
+    return bits;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LowestBit --
+ *
+ *	Return the index of the lowest set bit of a non-zero mask.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline int
+LowestBit(
+    unsigned int bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    int i = 0;
+
+    while (!(bits & 1)) {
+	bits >>= 1;
+	i++;
+    }
+    return i;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindOpenEntry, CreateOpenEntry --
+ *
+ *	The findProc and createProc of open tables; see Tcl_FindHashEntry and
+ *	Tcl_CreateHashEntry.
+ *
+ * Results:
+ *	As for Tcl_FindHashEntry and Tcl_CreateHashEntry.
+ *
+ * Side effects:
+ *	A new entry may be added to the hash table, which may be rebuilt.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+FindOpenEntry(
+    Tcl_HashTable *tablePtr,	/* Table in which to lookup entry. */
+    const char *key)		/* Key to use to find matching entry. */
+{
+    return CreateOpenEntry(tablePtr, key, NULL);
+}
+
+static Tcl_HashEntry *
+CreateOpenEntry(
+    Tcl_HashTable *tablePtr,	/* Table in which to lookup entry. */
+    const char *key,		/* Key to use to find or create matching
+				 * entry. */
+    int *newPtr)		/* Store info here telling whether a new entry
+				 * was created. */
+{
+    const Tcl_HashKeyType *typePtr = tablePtr->typePtr;
+    Tcl_CompareHashKeysProc *compareKeysProc = typePtr->compareKeysProc;
+    register Tcl_HashEntry *hPtr;
+    unsigned int hash, h, bits;
+
+    if (typePtr->hashKeyProc) {
+	hash = typePtr->hashKeyProc(tablePtr, (void *) key);
+    } else {
+	hash = PTR2UINT(key);
+    }
+    h = MixHash(hash);
+
+#define KEY_MATCHES(hPtr) \
+    (ENTRY_HASH(typePtr, tablePtr, hPtr) == hash && (compareKeysProc \
+	    ? compareKeysProc((void *) key, (hPtr)) \
+	    : (key == (hPtr)->key.oneWordValue)))
+
+    if (OPEN_IS_SMALL(tablePtr)) {
+	for (hPtr = tablePtr->buckets[CHUNK_HOME(typePtr, hash, h)
+		& tablePtr->mask]; hPtr != NULL; hPtr = hPtr->nextPtr) {
+	    if (KEY_MATCHES(hPtr)) {
+		goto found;
+	    }
+	}
+    } else {
+	unsigned char tag = CHUNK_TAG(h);
+	int index = CHUNK_HOME(typePtr, hash, h) & tablePtr->mask;
+	int tries = tablePtr->numBuckets;
+	HashChunk *chunkPtr;
+
+	while (1) {
+	    chunkPtr = OPEN_CHUNKS(tablePtr) + index;
+	    for (bits = ChunkMatch(chunkPtr, tag); bits; bits &= bits - 1) {
+		hPtr = chunkPtr->slots[LowestBit(bits)];
+		if (KEY_MATCHES(hPtr)) {
+		    goto found;
+		}
+	    }
+	    if (chunkPtr->overflow == 0 || --tries == 0) {
+		break;
+	    }
+	    index = (index + CHUNK_DELTA(tag)) & tablePtr->mask;
+	}
+    }
+#undef KEY_MATCHES
+
+    if (!newPtr) {
+	return NULL;
+    }
+
+    /*
+     * Entry not found. Add a new one to the table.
+     */
+
+    *newPtr = 1;
+    if (typePtr->allocEntryProc) {
+	hPtr = typePtr->allocEntryProc(tablePtr, (void *) key);
+    } else {
+	hPtr = (Tcl_HashEntry *) ckalloc((unsigned) sizeof(Tcl_HashEntry));
+	hPtr->key.oneWordValue = (char *) key;
+	hPtr->clientData = 0;
+    }
+    hPtr->tablePtr = tablePtr;
+    hPtr->nextPtr = NULL;
+#if TCL_HASH_KEY_STORE_HASH
+    hPtr->hash = UINT2PTR(hash);
+#else
+    hPtr->bucketPtr = NULL;
+#endif
+
+    if (tablePtr->numEntries >= tablePtr->rebuildSize) {
+	RebuildOpenTable(tablePtr, typePtr);
+    }
+    if (OPEN_IS_SMALL(tablePtr)) {
+	Tcl_HashEntry **bucketPtr = &tablePtr->buckets[
+		CHUNK_HOME(typePtr, hash, h) & tablePtr->mask];
+
+	hPtr->nextPtr = *bucketPtr;
+	*bucketPtr = hPtr;
+    } else {
+	InsertIntoChunks(tablePtr, hPtr, CHUNK_HOME(typePtr, hash, h), h);
+    }
+    tablePtr->numEntries++;
+    return hPtr;
+
+  found:
+    if (newPtr) {
+	*newPtr = 0;
+    }
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertIntoChunks --
+ *
+ *	Puts an entry in the first chunk of its probe sequence with an empty
+ *	slot. The table must have room for it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The overflow counts of the full chunks passed on the way go up.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InsertIntoChunks(
+    Tcl_HashTable *tablePtr,	/* Open table, not small. */
+    Tcl_HashEntry *hPtr,	/* Entry to insert. */
+    unsigned int home,		/* Selects the home chunk of the entry. */
+    unsigned int h)		/* Scrambled hash value of the entry. */
+{
+    unsigned char tag = CHUNK_TAG(h);
+    int index = home & tablePtr->mask, slot;
+    HashChunk *chunkPtr;
+    unsigned int bits;
+
+    while (1) {
+	chunkPtr = OPEN_CHUNKS(tablePtr) + index;
+	bits = ChunkMatch(chunkPtr, 0);
+	if (bits) {
+	    break;
+	}
+	if (chunkPtr->overflow < 255) {
+	    chunkPtr->overflow++;
+	}
+	index = (index + CHUNK_DELTA(tag)) & tablePtr->mask;
+    }
+    slot = LowestBit(bits);
+    chunkPtr->tags[slot] = tag;
+    chunkPtr->slots[slot] = hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveOpenEntry --
+ *
+ *	Removes an entry from an open table. The caller frees the entry and
+ *	updates numEntries.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The entry's slot becomes empty, and the chunks that it overflowed
+ *	from get their counts back.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoveOpenEntry(
+    Tcl_HashTable *tablePtr,	/* Open table holding the entry. */
+    const Tcl_HashKeyType *typePtr,
+				/* Key type of the table. */
+    Tcl_HashEntry *entryPtr)	/* Entry to remove. */
+{
+    HashChunk *chunkPtr;
+    unsigned int hash, h, bits;
+    unsigned char tag;
+    int i, index, tries;
+
+    hash = ENTRY_HASH(typePtr, tablePtr, entryPtr);
+    h = MixHash(hash);
+    index = CHUNK_HOME(typePtr, hash, h) & tablePtr->mask;
+    if (OPEN_IS_SMALL(tablePtr)) {
+	Tcl_HashEntry **linkPtr = &tablePtr->buckets[index];
+
+	for (; *linkPtr != NULL; linkPtr = &(*linkPtr)->nextPtr) {
+	    if (*linkPtr == entryPtr) {
+		*linkPtr = entryPtr->nextPtr;
+		return;
+	    }
+	}
+	Tcl_Panic("malformed bucket chain in Tcl_DeleteHashEntry");
+    }
+
+    tag = CHUNK_TAG(h);
+    for (tries = tablePtr->numBuckets; tries > 0; tries--) {
+	chunkPtr = OPEN_CHUNKS(tablePtr) + index;
+	for (bits = ChunkMatch(chunkPtr, tag); bits; bits &= bits - 1) {
+	    i = LowestBit(bits);
+	    if (chunkPtr->slots[i] == entryPtr) {
+		chunkPtr->tags[i] = 0;
+		chunkPtr->slots[i] = NULL;
+		return;
+	    }
+	}
+	if (chunkPtr->overflow == 0) {
+	    break;
+	}
+	if (chunkPtr->overflow < 255) {
+	    chunkPtr->overflow--;
+	}
+	index = (index + CHUNK_DELTA(tag)) & tablePtr->mask;
+    }
+    Tcl_Panic("malformed open table in Tcl_DeleteHashEntry");
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RebuildOpenTable --
+ *
+ *	Called when an open table gets to be rebuildSize large. Makes a new
+ *	chunk array with room for twice as many entries (or, the first time,
+ *	two chunks) and moves the entries into it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory gets reallocated and entries get moved to new chunks.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RebuildOpenTable(
+    Tcl_HashTable *tablePtr,	/* Table to rebuild. */
+    const Tcl_HashKeyType *typePtr)
+				/* Key type of the table. */
+{
+    Tcl_HashTable old = *tablePtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    unsigned int hash, h;
+    int numChunks = 2;
+    size_t size;
+    char *block;
+
+    if (!OPEN_IS_SMALL(tablePtr)) {
+	numChunks = 2 * tablePtr->numBuckets;
+    }
+    if (numChunks > INT_MAX / (CHUNK_SLOTS * CHUNK_MAX_FILL)) {
+	Tcl_Panic("max size for a Tcl hash table exceeded");
+    }
+
+    size = numChunks * sizeof(HashChunk) + CHUNK_ALIGN;
+    if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
+	block = TclpSysAlloc(size, 0);
+    } else {
+	block = ckalloc(size);
+    }
+    memset(block, 0, size);
+
+    /*
+     * Walk the old table through a copy of its header, since the real one
+     * is about to describe the new chunks.
+     */
+
+    old.buckets = (old.buckets == tablePtr->staticBuckets)
+	    ? old.staticBuckets : old.buckets;
+    tablePtr->staticBuckets[0] = (Tcl_HashEntry *) block;
+    tablePtr->buckets = (Tcl_HashEntry **) (block + CHUNK_ALIGN
+	    - (PTR2UINT(block) & (CHUNK_ALIGN - 1)));
+    tablePtr->numBuckets = numChunks;
+    tablePtr->mask = numChunks - 1;
+    tablePtr->rebuildSize = numChunks * CHUNK_MAX_FILL;
+
+    for (hPtr = Tcl_FirstHashEntry(&old, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	hash = ENTRY_HASH(typePtr, tablePtr, hPtr);
+	h = MixHash(hash);
+	InsertIntoChunks(tablePtr, hPtr, CHUNK_HOME(typePtr, hash, h), h);
+    }
+
+    if (old.buckets != old.staticBuckets) {
+	if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
+	    TclpSysFree((char *) old.staticBuckets[0]);
+	} else {
+	    ckfree((char *) old.staticBuckets[0]);
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenHashStats --
+ *
+ *	The open table version of Tcl_HashStats. The "buckets" it reports on
+ *	are the chunks of the table, and the search distance of an entry is
+ *	the number of chunks looked at to find it.
+ *
+ * Results:
+ *	A malloc-ed string, as for Tcl_HashStats.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+OpenHashStats(
+    Tcl_HashTable *tablePtr)	/* Open table for which to produce stats. */
+{
+    int count[NUM_COUNTERS], overflow = 0, i, j, slot;
+    double average = 0.0;
+    HashChunk *chunkPtr;
+    char *result, *p;
+
+    for (i = 0; i < NUM_COUNTERS; i++) {
+	count[i] = 0;
+    }
+    for (i = 0; i < tablePtr->numBuckets; i++) {
+	chunkPtr = OPEN_CHUNKS(tablePtr) + i;
+	for (j = 0, slot = 0; slot < CHUNK_SLOTS; slot++) {
+	    Tcl_HashEntry *hPtr = chunkPtr->slots[slot];
+	    unsigned int hash, h;
+	    int index, distance;
+
+	    if (hPtr == NULL) {
+		continue;
+	    }
+	    j++;
+	    hash = ENTRY_HASH(tablePtr->typePtr, tablePtr, hPtr);
+	    h = MixHash(hash);
+	    index = CHUNK_HOME(tablePtr->typePtr, hash, h) & tablePtr->mask;
+	    for (distance = 1; index != i; distance++) {
+		index = (index + CHUNK_DELTA(CHUNK_TAG(h))) & tablePtr->mask;
+	    }
+	    average += (double) distance / tablePtr->numEntries;
+	}
+	if (j < NUM_COUNTERS) {
+	    count[j]++;
+	} else {
+	    overflow++;
+	}
+    }
+
+    result = (char *) ckalloc((unsigned) (NUM_COUNTERS*60) + 300);
+    sprintf(result, "%d entries in table, %d buckets of %d slots\n",
+	    tablePtr->numEntries, tablePtr->numBuckets, CHUNK_SLOTS);
+    p = result + strlen(result);
+    for (i = 0; i < NUM_COUNTERS; i++) {
+	sprintf(p, "number of buckets with %d entries: %d\n",
+		i, count[i]);
+	p += strlen(p);
+    }
+    sprintf(p, "number of buckets with %d or more entries: %d\n",
+	    NUM_COUNTERS, overflow);
+    p += strlen(p);
+    sprintf(p, "average search distance for entry: %.1f", average);
+    return result;
+}
+
 /*
  * Local Variables:
  * mode: c
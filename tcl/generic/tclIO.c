@@ -17,6 +17,17 @@
 #include "tclIO.h"
 #include <assert.h>
 
+/*
+ * Channel buffers whose size is CHANNELBUFFER_DEFAULT_SIZE times a power of
+ * two, up to MAX_CHANNEL_BUFFER_SIZE, are not freed but kept in a per-thread
+ * pool, at most BUFFER_POOL_BYTES worth (and at least one buffer) per size.
+ * Short-lived channels thus do not go to the memory allocator for every
+ * buffer they use.
+ */
+
+#define BUFFER_POOL_CLASSES	9
+#define BUFFER_POOL_BYTES	(256 * 1024)
+
 /*
  * All static variables used in this file are collected into a single instance
  * of the following structure. For multi-threaded implementations, there is
@@ -41,6 +52,14 @@ typedef struct ThreadSpecificData {
     Tcl_Channel stderrChannel;	/* Static variable for the stderr channel. */
     int stderrInitialized;
     Tcl_Encoding binaryEncoding;
+    ChannelBuffer *bufferPool[BUFFER_POOL_CLASSES];
+				/* Free channel buffers, by size class, for
+				 * reuse by any channel of this thread. See
+				 * AllocChannelBuffer. */
+    int bufferPoolCount[BUFFER_POOL_CLASSES];
+				/* Number of buffers in each pool list. */
+    int bufferPoolClosed;	/* Set once TclFinalizeIOSubsystem has
+				 * released the pool. */
 } ThreadSpecificData;
 
 static Tcl_ThreadDataKey dataKey;
@@ -49,6 +68,8 @@ static Tcl_ThreadDataKey dataKey;
  * Static functions in this file:
  */
 
+static void		AdaptBufferSize(ChannelState *statePtr, int *runPtr,
+			    int used, int length);
 static ChannelBuffer *	AllocChannelBuffer(int length);
 static void		ChannelTimerProc(ClientData clientData);
 static int		CheckChannelErrors(ChannelState *statePtr,
@@ -82,7 +103,11 @@ static void		DiscardInputQueued(ChannelState *statePtr,
 			    int discardSavedBuffers);
 static void		DiscardOutputQueued(ChannelState *chanPtr);
 static int		DoRead(Channel *chanPtr, char *srcPtr, int slen);
+static int		DoReadBuffers(Channel *chanPtr, int toRead,
+			    int maxRead, ChannelBuffer **bufPtrPtr);
 static int		DoWrite(Channel *chanPtr, const char *src, int srcLen);
+static int		DoWriteBuffers(Channel *chanPtr,
+			    ChannelBuffer *bufPtr);
 static int		DoReadChars(Channel *chan, Tcl_Obj *objPtr, int toRead,
 			    int appendFlag);
 static int		DoWriteChars(Channel *chan, const char *src, int len);
@@ -92,6 +117,7 @@ static int		FlushChannel(Tcl_Interp *interp, Channel *chanPtr,
 			    int calledFromAsyncFlush);
 static int		TclGetsObjBinary(Tcl_Channel chan, Tcl_Obj *objPtr);
 static void		FreeBinaryEncoding(ClientData clientData);
+static void		FreeChannelBuffer(ChannelBuffer *bufPtr);
 static Tcl_HashTable *	GetChannelTable(Tcl_Interp *interp);
 static int		GetInput(Channel *chanPtr);
 static int		HaveVersion(const Tcl_ChannelType *typePtr,
@@ -398,6 +424,7 @@ TclFinalizeIOSubsystem(void)
     Channel *chanPtr = NULL;	/* Iterates over open channels. */
     ChannelState *statePtr;	/* State of channel stack */
     int active = 1;		/* Flag == 1 while there's still work to do */
+    int i;
 
     /*
      * Walk all channel state structures known to this thread and close
@@ -482,6 +509,21 @@ TclFinalizeIOSubsystem(void)
 	}
     }
 
+    /*
+     * Release the buffer pool. Buffers freed from now on go to the OS.
+     */
+
+    for (i = 0; i < BUFFER_POOL_CLASSES; i++) {
+	while (tsdPtr->bufferPool[i] != NULL) {
+	    ChannelBuffer *bufPtr = tsdPtr->bufferPool[i];
+
+	    tsdPtr->bufferPool[i] = bufPtr->nextPtr;
+	    ckfree((char *) bufPtr);
+	}
+	tsdPtr->bufferPoolCount[i] = 0;
+    }
+    tsdPtr->bufferPoolClosed = 1;
+
     TclpFinalizeSockets();
     TclpFinalizePipes();
 }
@@ -1432,6 +1474,9 @@ Tcl_CreateChannel(
     statePtr->interestMask	= 0;
     statePtr->scriptRecordPtr	= NULL;
     statePtr->bufSize		= CHANNELBUFFER_DEFAULT_SIZE;
+    statePtr->allocSize		= CHANNELBUFFER_DEFAULT_SIZE;
+    statePtr->inRun		= 0;
+    statePtr->outRun		= 0;
     statePtr->timer		= NULL;
     statePtr->csPtrR		= NULL;
     statePtr->csPtrW		= NULL;
@@ -2128,8 +2173,11 @@ Tcl_GetChannelHandle(
  *	character) that overflow past the end of the buffer and need to be
  *	moved to the next buffer.
  *
+ *	Buffers of a pooled size are taken from the buffer pool of the thread
+ *	when it has any.
+ *
  * Results:
- *	A newly allocated channel buffer.
+ *	A new channel buffer.
  *
  * Side effects:
  *	None.
@@ -2137,15 +2185,42 @@ Tcl_GetChannelHandle(
  *---------------------------------------------------------------------------
  */
 
+static inline int
+BufferPoolClass(
+    int length)			/* Length of channel buffer. */
+{
+    int class, size = CHANNELBUFFER_DEFAULT_SIZE;
+
+    for (class = 0; class < BUFFER_POOL_CLASSES; class++, size <<= 1) {
+	if (length <= size) {
+	    return (length == size) ? class : -1;
+	}
+    }
+    return -1;
+}
+
 static ChannelBuffer *
 AllocChannelBuffer(
     int length)			/* Desired length of channel buffer. */
 {
     ChannelBuffer *bufPtr;
-    int n;
+    int n, class = BufferPoolClass(length);
+
+    if (class >= 0) {
+	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+	bufPtr = tsdPtr->bufferPool[class];
+	if (bufPtr != NULL) {
+	    tsdPtr->bufferPool[class] = bufPtr->nextPtr;
+	    tsdPtr->bufferPoolCount[class]--;
+	    goto initBuffer;
+	}
+    }
 
     n = length + CHANNELBUFFER_HEADER_SIZE + BUFFER_PADDING + BUFFER_PADDING;
     bufPtr = (ChannelBuffer *) ckalloc((unsigned) n);
+
+  initBuffer:
     bufPtr->nextAdded	= BUFFER_PADDING;
     bufPtr->nextRemoved	= BUFFER_PADDING;
     bufPtr->bufLength	= length + BUFFER_PADDING;
@@ -2153,6 +2228,108 @@ AllocChannelBuffer(
     return bufPtr;
 }
 
+/*
+ *---------------------------------------------------------------------------
+ *
+ * FreeChannelBuffer --
+ *
+ *	Releases a channel buffer, into the buffer pool of the thread if it has
+ *	a pooled size and its pool list is not full yet.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free the buffer to the OS.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+FreeChannelBuffer(
+    ChannelBuffer *bufPtr)	/* The buffer to release. */
+{
+    ThreadSpecificData *tsdPtr;
+    int length = bufPtr->bufLength - BUFFER_PADDING;
+    int class = BufferPoolClass(length);
+
+    if (class >= 0) {
+	tsdPtr = TCL_TSD_INIT(&dataKey);
+	if (!tsdPtr->bufferPoolClosed && (tsdPtr->bufferPoolCount[class] == 0
+		|| tsdPtr->bufferPoolCount[class] < BUFFER_POOL_BYTES/length)) {
+	    bufPtr->nextPtr = tsdPtr->bufferPool[class];
+	    tsdPtr->bufferPool[class] = bufPtr;
+	    tsdPtr->bufferPoolCount[class]++;
+	    return;
+	}
+    }
+    ckfree((char *) bufPtr);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * AdaptBufferSize --
+ *
+ *	Adapts the size of the buffers a channel allocates to its traffic,
+ *	unless its buffer size was set explicitly. After ADAPT_RUN buffers in
+ *	a row that were filled completely the size doubles, up to
+ *	MAX_CHANNEL_BUFFER_SIZE. After ADAPT_RUN buffers in a row that were
+ *	used less than half it halves, down to the configured buffer size.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May change the allocSize of the channel and updates *runPtr.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+#define ADAPT_RUN	4
+
+static void
+AdaptBufferSize(
+    ChannelState *statePtr,	/* Channel whose buffer was used. */
+    int *runPtr,		/* The inRun or outRun field of the
+				 * channel. */
+    int used,			/* Number of bytes that went through the
+				 * buffer. */
+    int length)			/* Size of the buffer. */
+{
+    if (GotFlag(statePtr, CHANNEL_FIXED_BUFSIZE)) {
+	return;
+    }
+
+    if (used >= length) {
+	if (*runPtr < 0) {
+	    *runPtr = 0;
+	}
+	if (++(*runPtr) >= ADAPT_RUN) {
+	    *runPtr = 0;
+	    if (statePtr->allocSize <= MAX_CHANNEL_BUFFER_SIZE / 2) {
+		statePtr->allocSize *= 2;
+	    } else {
+		statePtr->allocSize = MAX_CHANNEL_BUFFER_SIZE;
+	    }
+	}
+    } else if (used < length / 2) {
+	if (*runPtr > 0) {
+	    *runPtr = 0;
+	}
+	if (--(*runPtr) <= -ADAPT_RUN) {
+	    *runPtr = 0;
+	    if (statePtr->allocSize / 2 >= statePtr->bufSize) {
+		statePtr->allocSize /= 2;
+	    } else {
+		statePtr->allocSize = statePtr->bufSize;
+	    }
+	}
+    } else {
+	*runPtr = 0;
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2184,18 +2361,18 @@ RecycleBuffer(
      */
 
     if (mustDiscard) {
-	ckfree((char *) bufPtr);
+	FreeChannelBuffer(bufPtr);
 	return;
     }
 
     /*
-     * Only save buffers which are at least as big as the requested buffersize
-     * for the channel. This is to honor dynamic changes of the buffersize
-     * made by the user.
+     * Only save buffers of the size the channel currently allocates. This is
+     * to honor dynamic changes of the buffersize made by the user, or by
+     * AdaptBufferSize.
      */
 
-    if ((bufPtr->bufLength - BUFFER_PADDING) < statePtr->bufSize) {
-	ckfree((char *) bufPtr);
+    if ((bufPtr->bufLength - BUFFER_PADDING) != statePtr->allocSize) {
+	FreeChannelBuffer(bufPtr);
 	return;
     }
 
@@ -2227,10 +2404,10 @@ RecycleBuffer(
     }
 
     /*
-     * If we reached this code we return the buffer to the OS.
+     * If we reached this code we release the buffer.
      */
 
-    ckfree((char *) bufPtr);
+    FreeChannelBuffer(bufPtr);
     return;
 
   keepBuffer:
@@ -2372,6 +2549,9 @@ FlushChannel(
 		|| (GotFlag(statePtr, BUFFER_READY) &&
 			(statePtr->outQueueHead == NULL))) {
 	    ResetFlag(statePtr, BUFFER_READY);
+	    AdaptBufferSize(statePtr, &statePtr->outRun,
+		    statePtr->curOutPtr->nextAdded - BUFFER_PADDING,
+		    statePtr->curOutPtr->bufLength - BUFFER_PADDING);
 	    statePtr->curOutPtr->nextPtr = NULL;
 	    if (statePtr->outQueueHead == NULL) {
 		statePtr->outQueueHead = statePtr->curOutPtr;
@@ -2621,7 +2801,7 @@ CloseChannel(
      */
 
     if (statePtr->curOutPtr != NULL) {
-	ckfree((char *) statePtr->curOutPtr);
+	FreeChannelBuffer(statePtr->curOutPtr);
 	statePtr->curOutPtr = NULL;
     }
 
@@ -3927,7 +4107,7 @@ WriteBytes(
     while (srcLen + savedLF > 0) {
 	bufPtr = statePtr->curOutPtr;
 	if (bufPtr == NULL) {
-	    bufPtr = AllocChannelBuffer(statePtr->bufSize);
+	    bufPtr = AllocChannelBuffer(statePtr->allocSize);
 	    statePtr->curOutPtr = bufPtr;
 	}
 	dst = InsertPoint(bufPtr);
@@ -4091,7 +4271,7 @@ WriteChars(
 	while (stageLen + saved + endEncoding > 0) {
 	    bufPtr = statePtr->curOutPtr;
 	    if (bufPtr == NULL) {
-		bufPtr = AllocChannelBuffer(statePtr->bufSize);
+		bufPtr = AllocChannelBuffer(statePtr->allocSize);
 		statePtr->curOutPtr = bufPtr;
 	    }
 	    dst = InsertPoint(bufPtr);
@@ -5241,7 +5421,7 @@ FilterInputBytes(
 	    }
 	} else {
 	    if (nextPtr == NULL) {
-		nextPtr = AllocChannelBuffer(statePtr->bufSize);
+		nextPtr = AllocChannelBuffer(statePtr->allocSize);
 		bufPtr->nextPtr = nextPtr;
 		statePtr->inQueueTail = nextPtr;
 	    }
@@ -6560,7 +6740,7 @@ DiscardInputQueued(
      */
 
     if (discardSavedBuffers && statePtr->saveInBufPtr != NULL) {
-	ckfree((char *) statePtr->saveInBufPtr);
+	FreeChannelBuffer(statePtr->saveInBufPtr);
 	statePtr->saveInBufPtr = NULL;
     }
 }
@@ -6590,6 +6770,7 @@ GetInput(
     int result;			/* Of calling driver. */
     int nread;			/* How much was read from channel? */
     ChannelBuffer *bufPtr;	/* New buffer to add to input queue. */
+    int freshBuffer = 0;	/* Is bufPtr a new, empty buffer? */
     ChannelState *statePtr = chanPtr->state;
 				/* State info for channel */
 
@@ -6648,18 +6829,20 @@ GetInput(
 	/*
 	 * Check the actual buffersize against the requested buffersize.
 	 * Buffers which are smaller than requested are squashed. This is done
-	 * to honor dynamic changes of the buffersize made by the user.
+	 * to honor dynamic changes of the buffersize made by the user, or by
+	 * AdaptBufferSize.
 	 */
 
 	if ((bufPtr != NULL)
-		&& (bufPtr->bufLength - BUFFER_PADDING < statePtr->bufSize)) {
-	    ckfree((char *) bufPtr);
+		&& (bufPtr->bufLength - BUFFER_PADDING < statePtr->allocSize)) {
+	    FreeChannelBuffer(bufPtr);
 	    bufPtr = NULL;
 	}
 
 	if (bufPtr == NULL) {
-	    bufPtr = AllocChannelBuffer(statePtr->bufSize);
+	    bufPtr = AllocChannelBuffer(statePtr->allocSize);
 	}
+	freshBuffer = 1;
 	bufPtr->nextPtr = NULL;
 
 	/*
@@ -6720,6 +6903,9 @@ GetInput(
 
     if (nread > 0) {
 	bufPtr->nextAdded += nread;
+	if (freshBuffer) {
+	    AdaptBufferSize(statePtr, &statePtr->inRun, nread, toRead);
+	}
 
 	/*
 	 * If we get a short read, signal up that we may be BLOCKED. We should
@@ -7439,6 +7625,8 @@ Tcl_SetChannelBufferSize(
 
     statePtr = ((Channel *) chan)->state;
     statePtr->bufSize = sz;
+    statePtr->allocSize = sz;
+    SetFlag(statePtr, CHANNEL_FIXED_BUFSIZE);
 
     if (statePtr->outputStage != NULL) {
 	ckfree((char *) statePtr->outputStage);
@@ -9107,6 +9295,11 @@ CopyData(
     const char *buffer;
     int inBinary, outBinary, sameEncoding;
 				/* Encoding control */
+    int moveBuffers;		/* Hand whole buffers from input to output */
+    int useKernel;		/* Let the OS copy between the descriptors */
+    ChannelBuffer *bufList = NULL;
+				/* Buffers taken from the input queue */
+    Tcl_WideInt copied;		/* Bytes copied by TclpCopyChannelData */
     int underflow;		/* Input underflow */
 
     inChan	= (Tcl_Channel) csPtr->readPtr;
@@ -9133,6 +9326,24 @@ CopyData(
 	Tcl_IncrRefCount(bufObj);
     }
 
+    /*
+     * When the bytes pass through unchanged, the input buffers themselves
+     * are queued for output instead of being copied twice. A foreground
+     * copy between two unstacked blocking channels may go further and let
+     * the OS move the data without it ever entering a channel buffer.
+     */
+
+    moveBuffers = sameEncoding
+	    && (inStatePtr->inputTranslation == TCL_TRANSLATE_LF)
+	    && (inStatePtr->inEofChar == 0)
+	    && (outStatePtr->outputTranslation == TCL_TRANSLATE_LF);
+    useKernel = moveBuffers && (cmdPtr == NULL)
+	    && !GotFlag(inStatePtr, CHANNEL_NONBLOCKING)
+	    && !GotFlag(outStatePtr, CHANNEL_NONBLOCKING)
+	    && (inStatePtr != outStatePtr)
+	    && (inStatePtr->topChanPtr == inStatePtr->bottomChanPtr)
+	    && (outStatePtr->topChanPtr == outStatePtr->bottomChanPtr);
+
     while (csPtr->toRead != (Tcl_WideInt) 0) {
 	/*
 	 * Check for unreported background errors.
@@ -9151,6 +9362,35 @@ CopyData(
 	    goto writeError;
 	}
 
+	/*
+	 * Once nothing is buffered on either side, try to have the OS copy
+	 * the rest. If it cannot (or stops on an error) the copy carries on
+	 * through the channel buffers, which also reports any error.
+	 */
+
+	if (useKernel && !GotFlag(inStatePtr, CHANNEL_STICKY_EOF)
+		&& (inStatePtr->topChanPtr->inQueueHead == NULL)
+		&& ((inStatePtr->inQueueHead == NULL)
+			|| IsBufferEmpty(inStatePtr->inQueueHead))
+		&& (outStatePtr->outQueueHead == NULL)
+		&& ((outStatePtr->curOutPtr == NULL)
+			|| IsBufferEmpty(outStatePtr->curOutPtr))) {
+	    useKernel = TclpCopyChannelData(inChan, outChan, csPtr->toRead,
+		    &copied);
+	    if (csPtr->toRead != -1) {
+		csPtr->toRead -= copied;
+	    }
+	    csPtr->total += copied;
+	    if (useKernel) {
+		if (csPtr->toRead != 0) {
+		    SetFlag(inStatePtr, CHANNEL_EOF);
+		    inStatePtr->inputEncodingFlags |= TCL_ENCODING_END;
+		}
+		break;
+	    }
+	    continue;
+	}
+
 	if (cmdPtr && (mask == 0)) {
 	    /*
 	     * In async mode, we skip reading synchronously and fake an
@@ -9171,7 +9411,11 @@ CopyData(
 		sizeb = (int) csPtr->toRead;
 	    }
 
-	    if (inBinary || sameEncoding) {
+	    if (moveBuffers) {
+		size = DoReadBuffers(inStatePtr->topChanPtr, sizeb,
+			(csPtr->toRead == -1 || csPtr->toRead > INT_MAX) ?
+			INT_MAX : (int) csPtr->toRead, &bufList);
+	    } else if (inBinary || sameEncoding) {
 		size = DoRead(inStatePtr->topChanPtr, csPtr->buffer, sizeb);
 	    } else {
 		size = DoReadChars(inStatePtr->topChanPtr, bufObj, sizeb,
@@ -9229,17 +9473,22 @@ CopyData(
 	 * Now write the buffer out.
 	 */
 
-	if (inBinary || sameEncoding) {
-	    buffer = csPtr->buffer;
-	    sizeb = size;
+	if (moveBuffers) {
+	    sizeb = DoWriteBuffers(outStatePtr->topChanPtr, bufList);
+	    bufList = NULL;
 	} else {
-	    buffer = TclGetStringFromObj(bufObj, &sizeb);
-	}
+	    if (inBinary || sameEncoding) {
+		buffer = csPtr->buffer;
+		sizeb = size;
+	    } else {
+		buffer = TclGetStringFromObj(bufObj, &sizeb);
+	    }
 
-	if (outBinary || sameEncoding) {
-	    sizeb = DoWrite(outStatePtr->topChanPtr, buffer, sizeb);
-	} else {
-	    sizeb = DoWriteChars(outStatePtr->topChanPtr, buffer, sizeb);
+	    if (outBinary || sameEncoding) {
+		sizeb = DoWrite(outStatePtr->topChanPtr, buffer, sizeb);
+	    } else {
+		sizeb = DoWriteChars(outStatePtr->topChanPtr, buffer, sizeb);
+	    }
 	}
 
 	/*
@@ -9466,6 +9715,117 @@ DoRead(
     UpdateInterest(chanPtr);
     return copied;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DoReadBuffers --
+ *
+ *	Takes at least toRead bytes of input off a channel by unlinking whole
+ *	buffers from its input queue, without copying them. A buffer is only
+ *	split (and the part taken copied) where taking all of it would go
+ *	past maxRead bytes. The input of the channel must need neither EOL
+ *	translation nor EOF character handling.
+ *
+ * Results:
+ *	The number of bytes taken, or -1 on error. Use Tcl_GetErrno() to
+ *	retrieve the error code for the error that occurred. The buffers are
+ *	left as a list in *bufPtrPtr, which is NULL if none were taken.
+ *
+ * Side effects:
+ *	May cause input to be buffered.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DoReadBuffers(
+    Channel *chanPtr,		/* The channel from which to read. */
+    int toRead,			/* Number of bytes to read. */
+    int maxRead,		/* Maximum number of bytes to take, at least
+				 * toRead. */
+    ChannelBuffer **bufPtrPtr)	/* Where to store the list of buffers. */
+{
+    ChannelState *statePtr = chanPtr->state;
+				/* State info for channel */
+    ChannelBuffer *bufPtr;	/* The buffer being taken. */
+    ChannelBuffer *headPtr = NULL, *tailPtr = NULL;
+				/* List of the buffers taken so far. */
+    int copied;			/* How many bytes were taken so far? */
+    int bytesInBuffer;		/* How many bytes are taken from the current
+				 * input buffer? */
+    int result;			/* Of calling GetInput. */
+
+    if (!GotFlag(statePtr, CHANNEL_STICKY_EOF)) {
+	ResetFlag(statePtr, CHANNEL_EOF);
+    }
+    ResetFlag(statePtr, CHANNEL_BLOCKED | CHANNEL_NEED_MORE_DATA);
+
+    for (copied = 0; copied < toRead; copied += bytesInBuffer) {
+	bufPtr = statePtr->inQueueHead;
+	bytesInBuffer = (bufPtr == NULL) ? 0 : BytesLeft(bufPtr);
+	if (bytesInBuffer == 0) {
+	    if (GotFlag(statePtr, CHANNEL_EOF)) {
+		goto done;
+	    }
+	    if (GotFlag(statePtr, CHANNEL_BLOCKED)) {
+		if (GotFlag(statePtr, CHANNEL_NONBLOCKING)) {
+		    goto done;
+		}
+		ResetFlag(statePtr, CHANNEL_BLOCKED);
+	    }
+	    result = GetInput(chanPtr);
+	    if (result != 0) {
+		if (result != EAGAIN) {
+		    copied = -1;
+		}
+		goto done;
+	    }
+	    continue;
+	}
+
+	if (bytesInBuffer > maxRead - copied) {
+	    /*
+	     * Only the front of this buffer is wanted. Copy it out and leave
+	     * the rest queued.
+	     */
+
+	    bytesInBuffer = maxRead - copied;
+	    bufPtr = AllocChannelBuffer(bytesInBuffer);
+	    memcpy(InsertPoint(bufPtr), RemovePoint(statePtr->inQueueHead),
+		    (size_t) bytesInBuffer);
+	    bufPtr->nextAdded += bytesInBuffer;
+	    statePtr->inQueueHead->nextRemoved += bytesInBuffer;
+	} else {
+	    statePtr->inQueueHead = bufPtr->nextPtr;
+	    if (statePtr->inQueueHead == NULL) {
+		statePtr->inQueueTail = NULL;
+	    }
+	    bufPtr->nextPtr = NULL;
+	}
+
+	if (tailPtr == NULL) {
+	    headPtr = bufPtr;
+	} else {
+	    tailPtr->nextPtr = bufPtr;
+	}
+	tailPtr = bufPtr;
+    }
+
+    ResetFlag(statePtr, CHANNEL_BLOCKED);
+
+  done:
+    if (copied < 0) {
+	while (headPtr != NULL) {
+	    bufPtr = headPtr;
+	    headPtr = bufPtr->nextPtr;
+	    RecycleBuffer(statePtr, bufPtr, 0);
+	}
+    }
+    *bufPtrPtr = headPtr;
+    UpdateInterest(chanPtr);
+    return copied;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -9850,7 +10210,7 @@ DoWrite(
 	 */
 
 	if (statePtr->curOutPtr == NULL) {
-	    statePtr->curOutPtr = AllocChannelBuffer(statePtr->bufSize);
+	    statePtr->curOutPtr = AllocChannelBuffer(statePtr->allocSize);
 	}
 
 	outBufPtr = statePtr->curOutPtr;
@@ -9939,6 +10299,77 @@ DoWrite(
 
     return totalDestCopied;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DoWriteBuffers --
+ *
+ *	Queues a list of buffers taken from an input queue by DoReadBuffers
+ *	for output, after any output already in the current buffer, and
+ *	flushes the channel. The buffers become owned by the channel. The
+ *	output of the channel must not need EOL translation.
+ *
+ * Results:
+ *	The number of bytes queued or -1 in case of error. If -1,
+ *	Tcl_GetErrno will return the error code.
+ *
+ * Side effects:
+ *	May cause output to be produced on the channel.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DoWriteBuffers(
+    Channel *chanPtr,		/* The channel to queue output for. */
+    ChannelBuffer *bufPtr)	/* List of buffers to queue. */
+{
+    ChannelState *statePtr = chanPtr->state;
+				/* State info for channel */
+    ChannelBuffer *curOutPtr = statePtr->curOutPtr;
+    ChannelBuffer *lastPtr;	/* Last buffer in the list. */
+    int written = 0;		/* How many bytes were queued? */
+
+    if (bufPtr == NULL) {
+	return 0;
+    }
+
+    /*
+     * The current output buffer is not yet in the output queue. Put it there
+     * first, to keep its contents in front of the new buffers.
+     */
+
+    if ((curOutPtr != NULL) && !IsBufferEmpty(curOutPtr)) {
+	ResetFlag(statePtr, BUFFER_READY);
+	curOutPtr->nextPtr = NULL;
+	if (statePtr->outQueueHead == NULL) {
+	    statePtr->outQueueHead = curOutPtr;
+	} else {
+	    statePtr->outQueueTail->nextPtr = curOutPtr;
+	}
+	statePtr->outQueueTail = curOutPtr;
+	statePtr->curOutPtr = NULL;
+    }
+
+    for (lastPtr = bufPtr; ; lastPtr = lastPtr->nextPtr) {
+	written += BytesLeft(lastPtr);
+	if (lastPtr->nextPtr == NULL) {
+	    break;
+	}
+    }
+    if (statePtr->outQueueHead == NULL) {
+	statePtr->outQueueHead = bufPtr;
+    } else {
+	statePtr->outQueueTail->nextPtr = bufPtr;
+    }
+    statePtr->outQueueTail = lastPtr;
+
+    if (FlushChannel(NULL, chanPtr, 0) != 0) {
+	return -1;
+    }
+    return written;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -218,6 +218,13 @@ typedef struct ChannelState {
 				/* Chain of all scripts registered for event
 				 * handlers ("fileevent") on this channel. */
     int bufSize;		/* What size buffers to allocate? */
+    int allocSize;		/* Size of the buffers actually allocated.
+				 * This is bufSize, unless the channel has
+				 * grown it under sustained throughput, see
+				 * AdaptBufferSize. */
+    int inRun, outRun;		/* Number of consecutive input and output
+				 * buffers that were filled (positive) or
+				 * used less than half (negative). */
     Tcl_TimerToken timer;	/* Handle to wakeup timer for this channel. */
     CopyState *csPtrR;		/* State of background copy for which channel is input, or NULL. */
     CopyState *csPtrW;		/* State of background copy for which channel is output, or NULL. */
@@ -342,6 +349,9 @@ typedef struct ChannelState {
 #define CHANNEL_CLOSEDWRITE	(1<<21)	/* Channel write side has been closed.
 					 * No further Tcl-level write IO on
 					 * the channel is allowed. */
+#define CHANNEL_FIXED_BUFSIZE	(1<<22)	/* The buffer size was set explicitly
+					 * and does not adapt to the
+					 * traffic on the channel. */
 
 /*
  * For each channel handler registered in a call to Tcl_CreateChannelHandler,
@@ -34,6 +34,48 @@ typedef struct ThreadSpecificData {
 
 static Tcl_ThreadDataKey dataKey;
 
+/*
+ * State of a [chan await] operation, kept while its coroutine waits for the
+ * channel.
+ */
+
+typedef struct ChanAwait {
+    Tcl_Interp *interp;		/* Interpreter of the coroutine. */
+    Tcl_Channel chan;		/* The channel, or NULL once it is closed. */
+    Tcl_Obj *chanObjPtr;	/* Name of the channel, for messages. */
+    int operation;		/* AWAIT_GETS, AWAIT_PUTS or AWAIT_READ. */
+    int newline;		/* Zero if -nonewline was given. */
+    int toRead;			/* Characters to read in all, or -1 to read
+				 * until EOF. */
+    Tcl_Obj *objPtr;		/* Variable to store the line in, or string to
+				 * write, or NULL. */
+    Tcl_Obj *resultPtr;		/* What has been read so far. */
+    Tcl_Command coroutine;	/* The waiting coroutine. */
+} ChanAwait;
+
+/*
+ * The coroutines waiting for a channel in [chan await]. These are kept in a
+ * per-interpreter table once made, and the channel handler stays registered
+ * between waits so that a coroutine waiting for the same channel over and
+ * over does not make the notifier update its interest each time; an event
+ * that nothing waits for any more drops the interest in it.
+ */
+
+typedef struct ChanWaiter {
+    Tcl_Channel chan;		/* The channel. */
+    int mask;			/* Events the channel handler is registered
+				 * for, zero if it is not. */
+    ChanAwait *readPtr;		/* Operation waiting for input, or NULL. */
+    ChanAwait *writePtr;	/* Operation waiting to write, or NULL. */
+    Tcl_HashEntry *hPtr;	/* Entry in the table of waiters. */
+} ChanWaiter;
+
+#define CHAN_WAITERS_KEY "tclChanWaiters"
+
+enum {
+    AWAIT_GETS, AWAIT_PUTS, AWAIT_READ
+};
+
 /*
  * Static functions for this file:
  */
@@ -41,12 +83,30 @@ static Tcl_ThreadDataKey dataKey;
 static void		FinalizeIOCmdTSD(ClientData clientData);
 static void		AcceptCallbackProc(ClientData callbackData,
 			    Tcl_Channel chan, char *address, int port);
+static int		ChanAwaitObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
+static Tcl_ObjCmdProc	ChanAwaitNRCmd;
+static Tcl_NRPostProc	ChanAwaitCallback;
+static int		ChanAwaitError(ChanAwait *awaitPtr,
+			    Tcl_Interp *interp, const char *doing);
+static void		ChanAwaitResume(ClientData clientData);
+static int		ChanAwaitStep(ChanAwait *awaitPtr,
+			    Tcl_Interp *interp);
 static int		ChanPendingObjCmd(ClientData unused,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
 static int		ChanTruncateObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
+static void		ChanWaiterClosed(ClientData clientData);
+static void		ChanWaiterReady(ClientData clientData, int mask);
+static void		ChanWaitersDeleteProc(ClientData clientData,
+			    Tcl_Interp *interp);
+static void		FreeChanAwait(ChanAwait *awaitPtr);
+static ChanWaiter *	GetChanWaiter(Tcl_Interp *interp, Tcl_Channel chan,
+			    int create);
+static void		SetChanWaiterMask(ChanWaiter *waiterPtr, int mask);
 static void		RegisterTcpServerInterpCleanup(Tcl_Interp *interp,
 			    AcceptCallback *acceptCallbackPtr);
 static void		TcpAcceptCallbacksDeleteProc(ClientData clientData,
@@ -1895,6 +1955,622 @@ ChanPipeObjCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanAwaitObjCmd, ChanAwaitNRCmd --
+ *
+ *	This function is invoked to process the Tcl "chan await" command. See
+ *	the user documentation for details on what it does. Inside a
+ *	coroutine, an operation that cannot complete on a non-blocking
+ *	channel suspends the coroutine, and the notifier resumes it when the
+ *	channel is ready; elsewhere, the operation behaves like the plain
+ *	command.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	May consume input from or produce output on the channel, and may
+ *	yield from the current coroutine.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChanAwaitObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    return Tcl_NRCallObjProc(interp, ChanAwaitNRCmd, clientData, objc, objv);
+}
+
+static int
+ChanAwaitNRCmd(
+    ClientData dummy,		/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    static const char *const operations[] = {
+	"gets", "puts", "read", NULL
+    };
+    Tcl_Channel chan;
+    Tcl_Obj *chanObjPtr, *objPtr = NULL;
+    ChanAwait *awaitPtr;
+    int operation, newline = 1, toRead = -1, mode, i;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "operation ?arg ...?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], operations, "operation", 0,
+	    &operation) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    /*
+     * The arguments are those of the plain commands, except that [puts]
+     * needs its channel.
+     */
+
+    i = 2;
+    if ((operation != AWAIT_GETS) && (i < objc)
+	    && (strcmp(TclGetString(objv[i]), "-nonewline") == 0)) {
+	newline = 0;
+	i++;
+    }
+    switch (operation) {
+    case AWAIT_GETS:
+	if ((objc != 3) && (objc != 4)) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "channelId ?varName?");
+	    return TCL_ERROR;
+	}
+	if (objc == 4) {
+	    objPtr = objv[3];
+	}
+	break;
+    case AWAIT_PUTS:
+	if (objc != i + 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "?-nonewline? channelId string");
+	    return TCL_ERROR;
+	}
+	objPtr = objv[i + 1];
+	break;
+    case AWAIT_READ:
+	if ((objc != i + 1) && ((objc != i + 2) || !newline)) {
+	    Tcl_WrongNumArgs(interp, 2, objv,
+		    "?-nonewline? channelId ?numChars?");
+	    return TCL_ERROR;
+	}
+	if ((objc == i + 2) && ((TclGetIntFromObj(interp, objv[i + 1],
+		&toRead) != TCL_OK) || (toRead < 0))) {
+	    Tcl_ResetResult(interp);
+	    Tcl_AppendResult(interp, "expected non-negative integer but got \"",
+		    TclGetString(objv[i + 1]), "\"", NULL);
+	    Tcl_SetErrorCode(interp, "TCL", "VALUE", "NUMBER", NULL);
+	    return TCL_ERROR;
+	}
+	break;
+    }
+
+    chanObjPtr = objv[i];
+    if (TclGetChannelFromObj(interp, chanObjPtr, &chan, &mode, 0) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    mode &= (operation == AWAIT_PUTS ? TCL_WRITABLE : TCL_READABLE);
+    if (mode == 0) {
+	Tcl_AppendResult(interp, "channel \"", TclGetString(chanObjPtr),
+		"\" wasn't opened for ",
+		(operation == AWAIT_PUTS ? "writing" : "reading"), NULL);
+	return TCL_ERROR;
+    }
+
+    awaitPtr = (ChanAwait *) ckalloc(sizeof(ChanAwait));
+    awaitPtr->interp = interp;
+    awaitPtr->chan = chan;
+    awaitPtr->chanObjPtr = chanObjPtr;
+    Tcl_IncrRefCount(chanObjPtr);
+    awaitPtr->operation = operation;
+    awaitPtr->newline = newline;
+    awaitPtr->toRead = toRead;
+    awaitPtr->objPtr = objPtr;
+    if (objPtr != NULL) {
+	Tcl_IncrRefCount(objPtr);
+    }
+    awaitPtr->resultPtr = NULL;
+    awaitPtr->coroutine = NULL;
+
+    /*
+     * The output is written in one go, and then waited for.
+     */
+
+    if (operation == AWAIT_PUTS) {
+	if ((Tcl_WriteObj(chan, objPtr) < 0)
+		|| (newline && (Tcl_WriteChars(chan, "\n", 1) < 0))) {
+	    return ChanAwaitError(awaitPtr, interp, "writing");
+	}
+	if (Tcl_Flush(chan) != TCL_OK) {
+	    return ChanAwaitError(awaitPtr, interp, "flushing");
+	}
+    } else if (operation == AWAIT_READ) {
+	TclNewObj(awaitPtr->resultPtr);
+	Tcl_IncrRefCount(awaitPtr->resultPtr);
+    }
+    return ChanAwaitStep(awaitPtr, interp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanAwaitStep --
+ *
+ *	Carries a [chan await] operation as far as the channel allows. If it
+ *	cannot be completed, and the command runs in a coroutine, arranges for
+ *	the coroutine to be resumed when the channel becomes ready and
+ *	yields.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Frees the ChanAwait once the operation is over.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChanAwaitStep(
+    ChanAwait *awaitPtr,	/* The operation. */
+    Tcl_Interp *interp)		/* Current interpreter. */
+{
+    Tcl_Channel chan = awaitPtr->chan;
+    Tcl_Obj *linePtr;
+    CoroutineData *corPtr = ((Interp *) interp)->execEnvPtr->corPtr;
+    ChanWaiter *waiterPtr;
+    ChanAwait **slotPtr;
+    int length, mask;
+
+    switch (awaitPtr->operation) {
+    case AWAIT_GETS:
+	TclNewObj(linePtr);
+	length = Tcl_GetsObj(chan, linePtr);
+	if (length >= 0 || Tcl_Eof(chan) || (corPtr == NULL)) {
+	    if ((length < 0) && !Tcl_Eof(chan) && !Tcl_InputBlocked(chan)) {
+		Tcl_DecrRefCount(linePtr);
+		return ChanAwaitError(awaitPtr, interp, "reading");
+	    }
+	    if (awaitPtr->objPtr == NULL) {
+		Tcl_SetObjResult(interp, linePtr);
+	    } else if (Tcl_ObjSetVar2(interp, awaitPtr->objPtr, NULL, linePtr,
+		    TCL_LEAVE_ERR_MSG) == NULL) {
+		FreeChanAwait(awaitPtr);
+		return TCL_ERROR;
+	    } else {
+		Tcl_SetObjResult(interp, Tcl_NewIntObj(length < 0 ? -1 : length));
+	    }
+	    FreeChanAwait(awaitPtr);
+	    return TCL_OK;
+	}
+	Tcl_DecrRefCount(linePtr);
+	if (!Tcl_InputBlocked(chan)) {
+	    return ChanAwaitError(awaitPtr, interp, "reading");
+	}
+	mask = TCL_READABLE;
+	break;
+
+    case AWAIT_READ: {
+	int toRead = awaitPtr->toRead;
+
+	if (toRead >= 0) {
+	    toRead -= Tcl_GetCharLength(awaitPtr->resultPtr);
+	}
+	if (toRead != 0) {
+	    if (Tcl_ReadChars(chan, awaitPtr->resultPtr, toRead, 1) < 0) {
+		return ChanAwaitError(awaitPtr, interp, "reading");
+	    }
+	    if (toRead > 0) {
+		toRead = awaitPtr->toRead
+			- Tcl_GetCharLength(awaitPtr->resultPtr);
+	    }
+	}
+	if ((toRead != 0) && !Tcl_Eof(chan) && (corPtr != NULL)) {
+	    mask = TCL_READABLE;
+	    break;
+	}
+
+	/*
+	 * If requested, remove the last newline in the channel if at EOF.
+	 */
+
+	if (!awaitPtr->newline && Tcl_Eof(chan)) {
+	    char *result = TclGetStringFromObj(awaitPtr->resultPtr, &length);
+
+	    if ((length > 0) && (result[length - 1] == '\n')) {
+		if (Tcl_IsShared(awaitPtr->resultPtr)) {
+		    Tcl_DecrRefCount(awaitPtr->resultPtr);
+		    awaitPtr->resultPtr = Tcl_DuplicateObj(awaitPtr->resultPtr);
+		    Tcl_IncrRefCount(awaitPtr->resultPtr);
+		}
+		Tcl_SetObjLength(awaitPtr->resultPtr, length - 1);
+	    }
+	}
+	Tcl_SetObjResult(interp, awaitPtr->resultPtr);
+	FreeChanAwait(awaitPtr);
+	return TCL_OK;
+    }
+
+    default:			/* AWAIT_PUTS */
+	if ((Tcl_OutputBuffered(chan) == 0) || (corPtr == NULL)) {
+	    FreeChanAwait(awaitPtr);
+	    return TCL_OK;
+	}
+	mask = TCL_WRITABLE;
+	break;
+    }
+
+    /*
+     * Wait for the channel: suspend the coroutine, to be resumed by
+     * ChanWaiterReady (or ChanWaiterClosed) and continue in
+     * ChanAwaitCallback.
+     */
+
+    waiterPtr = GetChanWaiter(interp, chan, 1);
+    if (mask == TCL_READABLE) {
+	slotPtr = &waiterPtr->readPtr;
+    } else {
+	slotPtr = &waiterPtr->writePtr;
+    }
+    if (*slotPtr != NULL) {
+	Tcl_ResetResult(interp);
+	Tcl_AppendResult(interp, "channel \"",
+		TclGetString(awaitPtr->chanObjPtr), "\" is already awaited for ",
+		(mask == TCL_READABLE ? "reading" : "writing"),
+		" by another coroutine", NULL);
+	FreeChanAwait(awaitPtr);
+	return TCL_ERROR;
+    }
+    *slotPtr = awaitPtr;
+    if (!(waiterPtr->mask & mask)) {
+	SetChanWaiterMask(waiterPtr, waiterPtr->mask | mask);
+    }
+    awaitPtr->coroutine = (Tcl_Command) corPtr->cmdPtr;
+    Tcl_ResetResult(interp);
+    TclNRAddCallback(interp, ChanAwaitCallback, awaitPtr, NULL, NULL, NULL);
+    return TclNRYieldObjCmd(NULL, interp, 1, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanAwaitCallback --
+ *
+ *	Runs in the coroutine when it is resumed after [chan await] yielded,
+ *	however that came about, and carries on with the operation.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Stops waiting for the channel. If the coroutine is being deleted, or
+ *	the channel was closed, ends the operation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChanAwaitCallback(
+    ClientData data[],
+    Tcl_Interp *interp,
+    int result)
+{
+    ChanAwait *awaitPtr = data[0];
+    ChanWaiter *waiterPtr;
+
+    /*
+     * The channel handler is left in place for the next wait; the waiters
+     * are gone already if the interpreter is being deleted.
+     */
+
+    Tcl_CancelIdleCall(ChanAwaitResume, awaitPtr);
+    if (awaitPtr->chan != NULL) {
+	waiterPtr = GetChanWaiter(interp, awaitPtr->chan, 0);
+	if (waiterPtr != NULL) {
+	    if (waiterPtr->readPtr == awaitPtr) {
+		waiterPtr->readPtr = NULL;
+	    }
+	    if (waiterPtr->writePtr == awaitPtr) {
+		waiterPtr->writePtr = NULL;
+	    }
+	}
+    }
+    if ((result != TCL_OK) || ((Interp *) interp)->execEnvPtr->rewind) {
+	FreeChanAwait(awaitPtr);
+	return result;
+    }
+    if (awaitPtr->chan == NULL) {
+	Tcl_ResetResult(interp);
+	Tcl_AppendResult(interp, "channel \"",
+		TclGetString(awaitPtr->chanObjPtr),
+		"\" was closed while waiting", NULL);
+	FreeChanAwait(awaitPtr);
+	return TCL_ERROR;
+    }
+    return ChanAwaitStep(awaitPtr, interp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetChanWaiter, SetChanWaiterMask --
+ *
+ *	GetChanWaiter finds the record of the coroutines waiting for a
+ *	channel in an interpreter, making it if asked to. SetChanWaiterMask
+ *	changes the events its channel handler is registered for.
+ *
+ * Results:
+ *	GetChanWaiter returns the record, or NULL if there is none and none
+ *	is to be made.
+ *
+ * Side effects:
+ *	A new record registers a close handler for the channel.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ChanWaiter *
+GetChanWaiter(
+    Tcl_Interp *interp,		/* Interpreter of the waiters. */
+    Tcl_Channel chan,		/* The channel waited for. */
+    int create)			/* Whether to make the record if there is
+				 * none. */
+{
+    Tcl_HashTable *tablePtr;
+    Tcl_HashEntry *hPtr;
+    ChanWaiter *waiterPtr;
+    int isNew;
+
+    tablePtr = Tcl_GetAssocData(interp, CHAN_WAITERS_KEY, NULL);
+    if (tablePtr == NULL) {
+	if (!create) {
+	    return NULL;
+	}
+	tablePtr = (Tcl_HashTable *) ckalloc(sizeof(Tcl_HashTable));
+	Tcl_InitHashTable(tablePtr, TCL_ONE_WORD_KEYS);
+	Tcl_SetAssocData(interp, CHAN_WAITERS_KEY, ChanWaitersDeleteProc,
+		tablePtr);
+    }
+    if (!create) {
+	hPtr = Tcl_FindHashEntry(tablePtr, (char *) chan);
+	return (hPtr == NULL) ? NULL : Tcl_GetHashValue(hPtr);
+    }
+
+    hPtr = Tcl_CreateHashEntry(tablePtr, (char *) chan, &isNew);
+    if (!isNew) {
+	return Tcl_GetHashValue(hPtr);
+    }
+    waiterPtr = (ChanWaiter *) ckalloc(sizeof(ChanWaiter));
+    waiterPtr->chan = chan;
+    waiterPtr->mask = 0;
+    waiterPtr->readPtr = NULL;
+    waiterPtr->writePtr = NULL;
+    waiterPtr->hPtr = hPtr;
+    Tcl_SetHashValue(hPtr, waiterPtr);
+    Tcl_CreateCloseHandler(chan, ChanWaiterClosed, waiterPtr);
+    return waiterPtr;
+}
+
+static void
+SetChanWaiterMask(
+    ChanWaiter *waiterPtr,	/* The waiters. */
+    int mask)			/* Events to wait for, or zero. */
+{
+    if (mask != 0) {
+	Tcl_CreateChannelHandler(waiterPtr->chan, mask, ChanWaiterReady,
+		waiterPtr);
+    } else if (waiterPtr->mask != 0) {
+	Tcl_DeleteChannelHandler(waiterPtr->chan, ChanWaiterReady, waiterPtr);
+    }
+    waiterPtr->mask = mask;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanWaiterReady, ChanWaiterClosed, ChanAwaitResume --
+ *
+ *	ChanWaiterReady is the channel handler, and ChanWaiterClosed the close
+ *	handler, of a channel waited for by [chan await]. Both resume a
+ *	waiting coroutine, the latter from an idle callback as the channel is
+ *	going away; ChanAwaitResume does the resuming.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Evaluates the coroutine until it next yields or returns. Errors are
+ *	reported as background errors. ChanWaiterReady drops the interest in
+ *	events no coroutine waits for any more.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ChanWaiterReady(
+    ClientData clientData,	/* The waiters. */
+    int mask)			/* Events that occurred. */
+{
+    ChanWaiter *waiterPtr = clientData;
+    ChanAwait *awaitPtr = NULL;
+    int wanted = 0;
+
+    if (waiterPtr->readPtr != NULL) {
+	wanted |= TCL_READABLE;
+    }
+    if (waiterPtr->writePtr != NULL) {
+	wanted |= TCL_WRITABLE;
+    }
+    if (waiterPtr->mask & ~wanted) {
+	SetChanWaiterMask(waiterPtr, waiterPtr->mask & wanted);
+    }
+
+    /*
+     * Only one coroutine is resumed, as the waiters may be gone once it has
+     * run; the notifier reports the channel again for the other.
+     */
+
+    if ((mask & TCL_READABLE) && (waiterPtr->readPtr != NULL)) {
+	awaitPtr = waiterPtr->readPtr;
+    } else if ((mask & TCL_WRITABLE) && (waiterPtr->writePtr != NULL)) {
+	awaitPtr = waiterPtr->writePtr;
+    }
+    if (awaitPtr != NULL) {
+	ChanAwaitResume(awaitPtr);
+    }
+}
+
+static void
+ChanWaiterClosed(
+    ClientData clientData)	/* The waiters. */
+{
+    ChanWaiter *waiterPtr = clientData;
+
+    if (waiterPtr->readPtr != NULL) {
+	waiterPtr->readPtr->chan = NULL;
+	Tcl_DoWhenIdle(ChanAwaitResume, waiterPtr->readPtr);
+    }
+    if (waiterPtr->writePtr != NULL) {
+	waiterPtr->writePtr->chan = NULL;
+	Tcl_DoWhenIdle(ChanAwaitResume, waiterPtr->writePtr);
+    }
+    SetChanWaiterMask(waiterPtr, 0);
+    Tcl_DeleteHashEntry(waiterPtr->hPtr);
+    ckfree((char *) waiterPtr);
+}
+
+static void
+ChanAwaitResume(
+    ClientData clientData)	/* The operation. */
+{
+    ChanAwait *awaitPtr = clientData;
+    Tcl_Interp *interp = awaitPtr->interp;
+    Tcl_Obj *cmdPtr;
+    int result;
+
+    /*
+     * The ChanAwait is freed while the coroutine runs, so take what is needed
+     * first.
+     */
+
+    if (Tcl_InterpDeleted(interp)) {
+	return;
+    }
+    TclNewObj(cmdPtr);
+    Tcl_GetCommandFullName(interp, awaitPtr->coroutine, cmdPtr);
+    Tcl_IncrRefCount(cmdPtr);
+    Tcl_Preserve(interp);
+    result = Tcl_EvalObjv(interp, 1, &cmdPtr, TCL_EVAL_GLOBAL);
+    if (result != TCL_OK) {
+	Tcl_BackgroundException(interp, result);
+    }
+    Tcl_Release(interp);
+    Tcl_DecrRefCount(cmdPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanWaitersDeleteProc --
+ *
+ *	Removes the handlers of the channels waited for by [chan await] when
+ *	their interpreter is deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the table of waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ChanWaitersDeleteProc(
+    ClientData clientData,	/* The table of waiters. */
+    Tcl_Interp *interp)		/* Not used. */
+{
+    Tcl_HashTable *tablePtr = clientData;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    ChanWaiter *waiterPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	waiterPtr = Tcl_GetHashValue(hPtr);
+	SetChanWaiterMask(waiterPtr, 0);
+	Tcl_DeleteCloseHandler(waiterPtr->chan, ChanWaiterClosed, waiterPtr);
+	ckfree((char *) waiterPtr);
+    }
+    Tcl_DeleteHashTable(tablePtr);
+    ckfree((char *) tablePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChanAwaitError, FreeChanAwait --
+ *
+ *	ChanAwaitError ends a [chan await] operation with an I/O error on its
+ *	channel, and FreeChanAwait releases the ChanAwait of an operation.
+ *
+ * Results:
+ *	ChanAwaitError returns TCL_ERROR.
+ *
+ * Side effects:
+ *	ChanAwaitError sets the interpreter's result.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChanAwaitError(
+    ChanAwait *awaitPtr,	/* The operation. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    const char *doing)		/* What failed, for the message. */
+{
+    /*
+     * TIP #219.
+     * Capture error messages put by the driver into the bypass area and put
+     * them into the regular interpreter result. Fall back to the regular
+     * message if nothing was found in the bypass.
+     */
+
+    if (!TclChanCaughtErrorBypass(interp, awaitPtr->chan)) {
+	Tcl_ResetResult(interp);
+	Tcl_AppendResult(interp, "error ", doing, " \"",
+		TclGetString(awaitPtr->chanObjPtr), "\": ",
+		Tcl_PosixError(interp), NULL);
+    }
+    FreeChanAwait(awaitPtr);
+    return TCL_ERROR;
+}
+
+static void
+FreeChanAwait(
+    ChanAwait *awaitPtr)	/* The operation. */
+{
+    Tcl_DecrRefCount(awaitPtr->chanObjPtr);
+    if (awaitPtr->objPtr != NULL) {
+	Tcl_DecrRefCount(awaitPtr->objPtr);
+    }
+    if (awaitPtr->resultPtr != NULL) {
+	Tcl_DecrRefCount(awaitPtr->resultPtr);
+    }
+    ckfree((char *) awaitPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1957,6 +2633,7 @@ TclInitChanCmd(
      * function at the moment.
      */
     static const EnsembleImplMap initMap[] = {
+	{"await",	ChanAwaitObjCmd, NULL, ChanAwaitNRCmd, NULL, 0},
 	{"blocked",	Tcl_FblockedObjCmd, NULL, NULL, NULL, 0},
 	{"close",	Tcl_CloseObjCmd, NULL, NULL, NULL, 0},
 	{"copy",	Tcl_FcopyObjCmd, NULL, NULL, NULL, 0},
@@ -122,6 +122,25 @@ typedef struct {
     int mode;			/* Mask of R/W mode */
     int interest;		/* Mask of events the channel is interested
 				 * in. */
+    int batchSize;		/* Number of bytes the handler wants to move
+				 * per 'read' and 'write', as returned by its
+				 * 'batch' method, or 0 if it has none. */
+
+    /*
+     * Read-ahead of a batched channel: the bytes a 'read' delivered beyond
+     * what was requested. Later reads are served from here without calling
+     * on the handler, and, in a threaded build, without a round-trip to the
+     * thread owning the handler. Data is only added when the read-ahead is
+     * empty, so a flat buffer with a start and end index serves as the
+     * ring.
+     */
+
+    unsigned char *readAhead;	/* Bytes not yet read, or NULL. */
+    int aheadAllocated;		/* Size of the readAhead buffer. */
+    int aheadStart;		/* Index of the first unread byte. */
+    int aheadEnd;		/* Index after the last unread byte. */
+    Tcl_TimerToken timer;	/* Timer posting readable events while the
+				 * read-ahead holds data. */
 
     /*
      * Note regarding the usage of timers.
@@ -136,7 +155,8 @@ typedef struct {
      * level via 'watch'. And posting of events is possible from the Tcl level
      * as well, via 'chan postevent'. This means that the generation of all
      * events, fake or not, timer based or not, is completely in the hands of
-     * the Tcl level. Therefore no timer here.
+     * the Tcl level. Therefore no timer here, except for the read-ahead of
+     * batched channels, which the Tcl level does not know about.
      */
 } ReflectedChannel;
 
@@ -173,6 +193,7 @@ typedef enum {
  */
 
 static const char *const methodNames[] = {
+    "batch",		/* OPT */
     "blocking",		/* OPT */
     "cget",		/* OPT \/ Together or none */
     "cgetall",		/* OPT /\ of these two     */
@@ -186,6 +207,7 @@ static const char *const methodNames[] = {
     NULL
 };
 typedef enum {
+    METH_BATCH,
     METH_BLOCKING,
     METH_CGET,
     METH_CGETALL,
@@ -449,6 +471,19 @@ static ReflectedChannelMap *	GetReflectedChannelMap(Tcl_Interp *interp);
 static void		DeleteReflectedChannelMap(ClientData clientData,
 			    Tcl_Interp *interp);
 static int		ErrnoReturn(ReflectedChannel *rcPtr, Tcl_Obj *resObj);
+static void		ReadAheadAppend(ReflectedChannel *rcPtr,
+			    const unsigned char *bytes, int length);
+
+/*
+ * Timer management (readable events for the read-ahead of batched
+ * channels).
+ */
+
+#define FLUSH_DELAY (5)
+
+static void		TimerKill(ReflectedChannel *rcPtr);
+static void		TimerSetup(ReflectedChannel *rcPtr);
+static void		TimerRun(ClientData clientData);
 
 /*
  * Global constant strings (messages). ==================
@@ -674,6 +709,31 @@ TclChanCreateObjCmd(
 	goto error;
     }
 
+    /*
+     * A handler supporting 'batch' is asked once how many bytes it wants to
+     * move per call of 'read' and 'write'.
+     */
+
+    if (HAS(methods, METH_BATCH)) {
+	result = InvokeTclMethod(rcPtr, "batch", NULL, NULL, &resObj);
+	if (result != TCL_OK) {
+	    UnmarshallErrorResult(interp, resObj);
+	    Tcl_DecrRefCount(resObj);	/* Remove reference held from invoke */
+	    goto error;
+	}
+	if ((Tcl_GetIntFromObj(NULL, resObj, &rcPtr->batchSize) != TCL_OK)
+		|| (rcPtr->batchSize < 0)) {
+	    TclNewLiteralStringObj(err, "chan handler \"");
+	    Tcl_AppendObjToObj(err, cmdObj);
+	    Tcl_AppendToObj(err, " batch\" returned bad size: ", -1);
+	    Tcl_AppendObjToObj(err, resObj);
+	    Tcl_SetObjResult(interp, err);
+	    Tcl_DecrRefCount(resObj);
+	    goto error;
+	}
+	Tcl_DecrRefCount(resObj);
+    }
+
     Tcl_ResetResult(interp);
 
     /*
@@ -682,6 +742,16 @@ TclChanCreateObjCmd(
 
     rcPtr->methods = methods;
 
+    /*
+     * A batched channel buffers as much as the handler wants per call, so
+     * that 'write' gets the data of many small writes at once, and 'read' is
+     * asked for that much.
+     */
+
+    if (rcPtr->batchSize > 0) {
+	Tcl_SetChannelBufferSize(chan, rcPtr->batchSize);
+    }
+
     if ((methods & NULLABLE_METHODS) != NULLABLE_METHODS) {
 	/*
 	 * Some of the nullable methods are not supported. We clone the
@@ -1052,6 +1122,8 @@ ReflectClose(
 				 * this interp */
     Tcl_HashEntry *hPtr;	/* Entry in the above map */
 
+    TimerKill(rcPtr);
+
     if (TclInThreadExit()) {
 	/*
 	 * This call comes from TclFinalizeIOSystem. There are no
@@ -1211,6 +1283,22 @@ ReflectInput(
 	return -1;
     }
 
+    /*
+     * Serve the read-ahead of a batched channel first. It is only filled
+     * while this thread waits for the handler, so no locking is needed.
+     */
+
+    if (rcPtr->aheadStart < rcPtr->aheadEnd) {
+	bytec = rcPtr->aheadEnd - rcPtr->aheadStart;
+	if (bytec > toRead) {
+	    bytec = toRead;
+	}
+	memcpy(buf, rcPtr->readAhead + rcPtr->aheadStart, (size_t) bytec);
+	rcPtr->aheadStart += bytec;
+	*errorCodePtr = EOK;
+	return bytec;
+    }
+
     /*
      * Are we in the correct thread?
      */
@@ -1264,8 +1352,12 @@ ReflectInput(
     bytev = Tcl_GetByteArrayFromObj(resObj, &bytec);
 
     if (toRead < bytec) {
-	SetChannelErrorStr(rcPtr->chan, msg_read_toomuch);
-        goto invalid;
+	if (rcPtr->batchSize == 0) {
+	    SetChannelErrorStr(rcPtr->chan, msg_read_toomuch);
+	    goto invalid;
+	}
+	ReadAheadAppend(rcPtr, bytev + toRead, bytec - toRead);
+	bytec = toRead;
     }
 
     *errorCodePtr = EOK;
@@ -1441,6 +1533,24 @@ ReflectSeekWide(
     Tcl_Obj *offObj, *baseObj;
     Tcl_Obj *resObj;		/* Result for 'seek' */
     Tcl_WideInt newLoc;
+    int ahead = 0;		/* Bytes of read-ahead kept over the seek. */
+
+    /*
+     * The handler is ahead of the channel by the bytes in the read-ahead.
+     * A seek by 0 from the current position, which is how [tell] asks for
+     * the position, keeps them and takes them off the handler's position.
+     * Other seeks account for them in relative offsets, and drop them, as
+     * the generic layer does with its own input buffers.
+     */
+
+    if ((seekMode == SEEK_CUR) && (offset == 0)) {
+	ahead = rcPtr->aheadEnd - rcPtr->aheadStart;
+    } else {
+	if (seekMode == SEEK_CUR) {
+	    offset -= rcPtr->aheadEnd - rcPtr->aheadStart;
+	}
+	rcPtr->aheadStart = rcPtr->aheadEnd = 0;
+    }
 
     /*
      * Are we in the correct thread?
@@ -1461,6 +1571,7 @@ ReflectSeekWide(
 	    p.seek.offset = -1;
 	} else {
 	    *errorCodePtr = EOK;
+	    p.seek.offset -= ahead;
 	}
 
 	return p.seek.offset;
@@ -1493,6 +1604,7 @@ ReflectSeekWide(
     }
 
     *errorCodePtr = EOK;
+    newLoc -= ahead;
  stop:
     Tcl_DecrRefCount(offObj);
     Tcl_DecrRefCount(baseObj);
@@ -1558,6 +1670,17 @@ ReflectWatch(
 
     mask &= rcPtr->mode;
 
+    /*
+     * Management of the internal timer. The handler cannot know about data
+     * in the read-ahead, so readable events for it are generated here.
+     */
+
+    if (!(mask & TCL_READABLE) || (rcPtr->aheadStart == rcPtr->aheadEnd)) {
+	TimerKill(rcPtr);
+    } else {
+	TimerSetup(rcPtr);
+    }
+
     if (mask == rcPtr->interest) {
 	/*
 	 * Same old, same old, why should we do something?
@@ -2045,6 +2168,12 @@ NewReflectedChannel(
 #endif
     rcPtr->mode = mode;
     rcPtr->interest = 0;		/* Initially no interest registered */
+    rcPtr->batchSize = 0;
+    rcPtr->readAhead = NULL;
+    rcPtr->aheadAllocated = 0;
+    rcPtr->aheadStart = 0;
+    rcPtr->aheadEnd = 0;
+    rcPtr->timer = NULL;
 
     /*
      * Method placeholder.
@@ -2165,6 +2294,9 @@ FreeReflectedChannel(
 
     Tcl_DecrRefCount(rcPtr->argv[n+1]);
 
+    if (rcPtr->readAhead != NULL) {
+	ckfree((char *) rcPtr->readAhead);
+    }
     ckfree((char *) rcPtr->argv);
     ckfree((char *) rcPtr);
 }
@@ -2392,6 +2524,138 @@ ErrnoReturn(
     Tcl_RestoreInterpState(rcPtr->interp, sr);
     return code;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReadAheadAppend --
+ *
+ *	Keeps bytes a 'read' of a batched channel delivered beyond what was
+ *	requested, for the next reads.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May (re)allocate the read-ahead buffer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReadAheadAppend(
+    ReflectedChannel *rcPtr,
+    const unsigned char *bytes,	/* The bytes to keep. */
+    int length)			/* How many. */
+{
+    int used = rcPtr->aheadEnd - rcPtr->aheadStart;
+
+    if (rcPtr->aheadStart > 0) {
+	memmove(rcPtr->readAhead, rcPtr->readAhead + rcPtr->aheadStart,
+		(size_t) used);
+	rcPtr->aheadStart = 0;
+	rcPtr->aheadEnd = used;
+    }
+    if (used + length > rcPtr->aheadAllocated) {
+	rcPtr->aheadAllocated = used + length;
+	if (rcPtr->readAhead == NULL) {
+	    rcPtr->readAhead = (unsigned char *)
+		    ckalloc((unsigned) rcPtr->aheadAllocated);
+	} else {
+	    rcPtr->readAhead = (unsigned char *) ckrealloc(
+		    (char *) rcPtr->readAhead, (unsigned) rcPtr->aheadAllocated);
+	}
+    }
+    memcpy(rcPtr->readAhead + used, bytes, (size_t) length);
+    rcPtr->aheadEnd += length;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TimerKill --
+ *
+ *	Timer management. Removes the internal timer if it exists.
+ *
+ * Side effects:
+ *	See above.
+ *
+ * Result:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TimerKill(
+    ReflectedChannel *rcPtr)
+{
+    if (rcPtr->timer == NULL) {
+	return;
+    }
+
+    /*
+     * Delete an existing timer, prevent it from firing on a removed/dead
+     * channel.
+     */
+
+    Tcl_DeleteTimerHandler(rcPtr->timer);
+    rcPtr->timer = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TimerSetup --
+ *
+ *	Timer management. Creates the internal timer if it does not exist.
+ *
+ * Side effects:
+ *	See above.
+ *
+ * Result:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TimerSetup(
+    ReflectedChannel *rcPtr)
+{
+    if (rcPtr->timer != NULL) {
+	return;
+    }
+
+    rcPtr->timer = Tcl_CreateTimerHandler(FLUSH_DELAY, TimerRun, rcPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TimerRun --
+ *
+ *	Called by the notifier (-> timer) to signal that the read-ahead of a
+ *	batched channel has data.
+ *
+ * Side effects:
+ *	As of 'Tcl_NotifyChannel'.
+ *
+ * Result:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TimerRun(
+    ClientData clientData)
+{
+    ReflectedChannel *rcPtr = clientData;
+
+    rcPtr->timer = NULL;
+    Tcl_NotifyChannel(rcPtr->chan, TCL_READABLE);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -2903,10 +3167,20 @@ ForwardProc(
 
 	    bytev = Tcl_GetByteArrayFromObj(resObj, &bytec);
 
-	    if (paramPtr->input.toRead < bytec) {
+	    if ((paramPtr->input.toRead < bytec)
+		    && (rcPtr->batchSize == 0)) {
 		ForwardSetStaticError(paramPtr, msg_read_toomuch);
 		paramPtr->input.toRead = -1;
 	    } else {
+		if (paramPtr->input.toRead < bytec) {
+		    /*
+		     * Keep the surplus of a batched channel.
+		     */
+
+		    ReadAheadAppend(rcPtr, bytev + paramPtr->input.toRead,
+			    bytec - paramPtr->input.toRead);
+		    bytec = paramPtr->input.toRead;
+		}
 		if (bytec > 0) {
 		    memcpy(paramPtr->input.buf, bytev, (size_t)bytec);
 		}
@@ -1861,6 +1861,12 @@ TclNREvalFile(
      */
 
     iPtr->evalFlags |= TCL_EVAL_FILE;
+
+    /*
+     * Use the bytecode cache, if enabled, to compile the script.
+     */
+
+    TclCompileCachedScript(interp, objPtr, pathPtr, &statBuf);
     TclNRAddCallback(interp, EvalFileCallback, oldScriptFile, pathPtr, objPtr,
 	    NULL);
     return TclNREvalObjEx(interp, objPtr, 0, NULL, INT_MIN);
@@ -1586,6 +1586,14 @@ typedef struct ByteCodeStats {
     double currentLitStringBytes;
 				/* String bytes in current literals. */
     long literalCount[32];	/* Distribution of literal string sizes. */
+
+    long numTypeFeedbackHits;	/* Arithmetic and comparison instructions
+				 * executed on their type-specialized fast
+				 * path. */
+    long numTypeFeedbackMisses;	/* Executions at specialized sites whose
+				 * operands failed the type guard. */
+    long numTypeFeedbackGeneric;/* Executions at sites not (or no longer)
+				 * specialized. */
 } ByteCodeStats;
 #endif /* TCL_COMPILE_STATS */
 
@@ -2165,6 +2173,19 @@ typedef struct Interp {
     Tcl_Obj *innerContext;	/* cached list for fast reallocation */
     int resetErrorStack;        /* controls cleaning up of ::errorStack */
 
+    /*
+     * Cache of the command lookups done by Tcl_FindCommand, see tclNamesp.c.
+     */
+
+    Tcl_HashTable *cmdCacheTablePtr;
+				/* Maps command names to lists of
+				 * CmdCacheEntry structures, one for each
+				 * namespace the name was looked up from.
+				 * NULL until the first lookup. */
+    int numCmdCacheEntries;	/* Number of CmdCacheEntry structures. */
+    long numCmdCacheHits;	/* Lookups answered from the cache. */
+    long numCmdCacheMisses;	/* Lookups which resolved the name. */
+
 #ifdef TCL_COMPILE_STATS
     /*
      * Statistical information about the bytecode compiler and interpreter's
@@ -2413,6 +2434,13 @@ typedef enum TclEolTranslation {
  * list's element pointers. The struct might contain more slots than currently
  * used to hold all element pointers. This is done to make append operations
  * faster.
+ *
+ * A List may instead be a slice: a range of the element array of another
+ * List (its store), created by TclListObjRange and by deleting from the ends
+ * of a shared list, so that those operations need not copy the elements. The
+ * store holds the references to the elements, and the slice holds a
+ * reference to the store. A slice is never modified in place except for
+ * appending into unused slots at the end of a store that nothing else uses.
  */
 
 typedef struct List {
@@ -2423,10 +2451,17 @@ typedef struct List {
 				 * derived from the list representation. May
 				 * be ignored if there is no string rep at
 				 * all.*/
+    struct List *storePtr;	/* For a slice, the List that owns the
+				 * elements; NULL otherwise. */
+    Tcl_Obj **elemPtrs;		/* The first list element: &elements, or a
+				 * slot in the element array of storePtr. */
     Tcl_Obj *elements;		/* First list element; the struct is grown to
 				 * accomodate all elements. */
 } List;
 
+#define ListRepIsSlice(listRepPtr) \
+    ((listRepPtr)->storePtr != NULL)
+
 /*
  * Macro used to get the elements of a list object.
  */
@@ -2435,7 +2470,7 @@ typedef struct List {
     ((List *) (listPtr)->internalRep.twoPtrValue.ptr1)
 
 #define ListObjGetElements(listPtr, objc, objv) \
-    ((objv) = &(ListRepPtr(listPtr)->elements), \
+    ((objv) = ListRepPtr(listPtr)->elemPtrs, \
      (objc) = ListRepPtr(listPtr)->elemCount)
 
 #define ListObjLength(listPtr, len) \
@@ -2547,6 +2582,13 @@ typedef struct TclFileAttrProcs {
 
 typedef struct TclFile_ *TclFile;
 
+/*
+ * Type of the functions run on worker threads by TclRunTasks. They must not
+ * use an interpreter or allocate Tcl_Objs.
+ */
+
+typedef void (TclTaskProc)(ClientData clientData);
+
 /*
  * The "globParameters" argument of the function TclGlob is an or'ed
  * combination of the following values:
@@ -2743,6 +2785,7 @@ MODULE_SCOPE Tcl_ObjCmdProc TclNRCatchObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRExprObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRForObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRForeachCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclNRLmapCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRIfObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRSourceObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclNRSubstObjCmd;
@@ -2852,6 +2895,10 @@ MODULE_SCOPE void	TclArgumentGet(Tcl_Interp *interp, Tcl_Obj *obj,
 MODULE_SCOPE int	TclArraySet(Tcl_Interp *interp,
 			    Tcl_Obj *arrayNameObj, Tcl_Obj *arrayElemObj);
 MODULE_SCOPE double	TclBignumToDouble(const mp_int *bignum);
+MODULE_SCOPE int	TclBinaryScan(Tcl_Interp *interp, Tcl_Obj *dataObj,
+			    Tcl_Obj *formatObj, int numVars,
+			    Tcl_Obj *const varNameObjs[],
+			    const int *varIndices, int *numScannedPtr);
 MODULE_SCOPE int	TclByteArrayMatch(const unsigned char *string,
 			    int strLen, const unsigned char *pattern,
 			    int ptnLen, int flags);
@@ -2865,6 +2912,9 @@ MODULE_SCOPE int	TclClearRootEnsemble(ClientData data[],
 			    Tcl_Interp *interp, int result);
 MODULE_SCOPE void	TclCleanupLiteralTable(Tcl_Interp *interp,
 			    LiteralTable *tablePtr);
+MODULE_SCOPE void	TclCompileCachedScript(Tcl_Interp *interp,
+			    Tcl_Obj *scriptPtr, Tcl_Obj *pathPtr,
+			    Tcl_StatBuf *statBufPtr);
 MODULE_SCOPE ContLineLoc *TclContinuationsEnter(Tcl_Obj *objPtr, int num,
 			    int *loc);
 MODULE_SCOPE void	TclContinuationsEnterDerived(Tcl_Obj *objPtr,
@@ -2899,18 +2949,22 @@ MODULE_SCOPE void	TclFinalizeExecution(void);
 MODULE_SCOPE void	TclFinalizeIOSubsystem(void);
 MODULE_SCOPE void	TclFinalizeFilesystem(void);
 MODULE_SCOPE void	TclResetFilesystem(void);
+MODULE_SCOPE void	TclFinalizeLmapPool(void);
+MODULE_SCOPE void	TclFinalizeTaskPool(void);
 MODULE_SCOPE void	TclFinalizeLoad(void);
 MODULE_SCOPE void	TclFinalizeLock(void);
 MODULE_SCOPE void	TclFinalizeMemorySubsystem(void);
 MODULE_SCOPE void	TclFinalizeNotifier(void);
 MODULE_SCOPE void	TclFinalizeObjects(void);
 MODULE_SCOPE void	TclFinalizePreserve(void);
+MODULE_SCOPE void	TclFinalizeRegexpCache(void);
 MODULE_SCOPE void	TclFinalizeSynchronization(void);
 MODULE_SCOPE void	TclFinalizeThreadAlloc(void);
 MODULE_SCOPE void	TclFinalizeThreadData(void);
 MODULE_SCOPE void	TclFinalizeThreadObjects(void);
 MODULE_SCOPE double	TclFloor(const mp_int *a);
 MODULE_SCOPE void	TclFormatNaN(double value, char *buffer);
+MODULE_SCOPE void	TclFreeCmdCache(Interp *iPtr);
 MODULE_SCOPE int	TclFSFileAttrIndex(Tcl_Obj *pathPtr,
 			    const char *attributeName, int *indexPtr);
 MODULE_SCOPE int	TclNREvalFile(Tcl_Interp *interp, Tcl_Obj *pathPtr,
@@ -2973,6 +3027,8 @@ MODULE_SCOPE Tcl_Obj *	TclLindexFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
 MODULE_SCOPE void	TclListLines(Tcl_Obj *listObj, int line, int n,
 			    int *lines, Tcl_Obj *const *elems);
 MODULE_SCOPE Tcl_Obj *	TclListObjCopy(Tcl_Interp *interp, Tcl_Obj *listPtr);
+MODULE_SCOPE Tcl_Obj *	TclListObjRange(Tcl_Obj *listPtr, int fromIdx,
+			    int toIdx);
 MODULE_SCOPE Tcl_Obj *	TclLsetList(Tcl_Interp *interp, Tcl_Obj *listPtr,
 			    Tcl_Obj *indexPtr, Tcl_Obj *valuePtr);
 MODULE_SCOPE Tcl_Obj *	TclLsetFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
@@ -3013,6 +3069,9 @@ MODULE_SCOPE Tcl_Obj *	TclpTempFileName(void);
 MODULE_SCOPE Tcl_Obj *  TclpTempFileNameForLibrary(Tcl_Interp *interp, Tcl_Obj* pathPtr);
 MODULE_SCOPE Tcl_Obj *	TclNewFSPathObj(Tcl_Obj *dirPtr, const char *addStrRep,
 			    int len);
+MODULE_SCOPE int	TclpCopyChannelData(Tcl_Channel inChan,
+			    Tcl_Channel outChan, Tcl_WideInt toCopy,
+			    Tcl_WideInt *copiedPtr);
 MODULE_SCOPE int	TclpDeleteFile(const void *path);
 MODULE_SCOPE void	TclpFinalizeCondition(Tcl_Condition *condPtr);
 MODULE_SCOPE void	TclpFinalizeMutex(Tcl_Mutex *mutexPtr);
@@ -3040,6 +3099,7 @@ MODULE_SCOPE int	TclpLoadFile(Tcl_Interp *interp, Tcl_Obj *pathPtr,
 MODULE_SCOPE Tcl_Obj *	TclpObjListVolumes(void);
 MODULE_SCOPE void	TclpMasterLock(void);
 MODULE_SCOPE void	TclpMasterUnlock(void);
+MODULE_SCOPE int	TclpNumProcessors(void);
 MODULE_SCOPE int	TclpMatchFiles(Tcl_Interp *interp, char *separators,
 			    Tcl_DString *dirPtr, char *pattern, char *tail);
 MODULE_SCOPE int	TclpObjNormalizePath(Tcl_Interp *interp,
@@ -3075,6 +3135,8 @@ MODULE_SCOPE void	TclRememberCondition(Tcl_Condition *mutex);
 MODULE_SCOPE void	TclRememberJoinableThread(Tcl_ThreadId id);
 MODULE_SCOPE void	TclRememberMutex(Tcl_Mutex *mutex);
 MODULE_SCOPE void	TclRemoveScriptLimitCallbacks(Tcl_Interp *interp);
+MODULE_SCOPE void	TclRunTasks(int numTasks, TclTaskProc *proc,
+			    ClientData clientData[]);
 MODULE_SCOPE int	TclReToGlob(Tcl_Interp *interp, const char *reStr,
 			    int reStrLen, Tcl_DString *dsPtr, int *flagsPtr);
 MODULE_SCOPE void	TclSetBgErrorHandler(Tcl_Interp *interp,
@@ -3283,6 +3345,9 @@ MODULE_SCOPE int	Tcl_LlengthObjCmd(ClientData clientData,
 MODULE_SCOPE int	Tcl_ListObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
+MODULE_SCOPE int	Tcl_LmapObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
 MODULE_SCOPE int	Tcl_LoadObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -3335,6 +3400,9 @@ MODULE_SCOPE int	Tcl_ReadObjCmd(ClientData clientData,
 MODULE_SCOPE int	Tcl_RegexpObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
+MODULE_SCOPE int	TclRegexpCacheObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
 MODULE_SCOPE int	Tcl_RegsubObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -3420,6 +3488,9 @@ MODULE_SCOPE int	Tcl_WhileObjCmd(ClientData clientData,
 MODULE_SCOPE int	TclCompileAppendCmd(Tcl_Interp *interp,
 			    Tcl_Parse *parsePtr, Command *cmdPtr,
 			    struct CompileEnv *envPtr);
+MODULE_SCOPE int	TclCompileBinaryScanCmd(Tcl_Interp *interp,
+			    Tcl_Parse *parsePtr, Command *cmdPtr,
+			    struct CompileEnv *envPtr);
 MODULE_SCOPE int	TclCompileBreakCmd(Tcl_Interp *interp,
 			    Tcl_Parse *parsePtr, Command *cmdPtr,
 			    struct CompileEnv *envPtr);
@@ -4118,7 +4189,7 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
     do { \
 	int count, i = (numBytes); \
 	unsigned char *str = (unsigned char *) (bytes); \
-	while (i && (*str < 0xC0)) { i--; str++; } \
+	while (i && (*str < 0xC0) && ((numBytes) - i < 16)) { i--; str++; } \
 	count = (numBytes) - i; \
 	if (i) { \
 	    count += Tcl_NumUtfChars((bytes) + count, i); \
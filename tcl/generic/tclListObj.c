@@ -20,6 +20,9 @@
  */
 
 static List *		NewListIntRep(int objc, Tcl_Obj *const objv[]);
+static List *		NewListSlice(List *listRepPtr, int first, int count);
+static void		ReleaseListIntRep(List *listRepPtr);
+static int		SliceIsWorthwhile(List *listRepPtr, int count);
 static void		DupListInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr);
 static void		FreeListInternalRep(Tcl_Obj *listPtr);
 static int		SetListFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
@@ -36,8 +39,16 @@ static void		UpdateStringOfList(Tcl_Obj *listPtr);
  * The second pointer is normally NULL; during execution of functions in this
  * file that operate on nested sublists, it is occasionally used as working
  * storage to avoid an auxiliary stack.
+ *
+ * Ranges of a list are represented as slices of the original element array
+ * (see the List struct in tclInt.h) when they hold at least
+ * LIST_SLICE_THRESHOLD elements and at least a quarter of the elements of the
+ * array. The second condition limits how many unreachable elements a slice
+ * can keep alive; a smaller range is copied.
  */
 
+#define LIST_SLICE_THRESHOLD	16
+
 const Tcl_ObjType tclListType = {
     "list",			/* name */
     FreeListInternalRep,	/* freeIntRepProc */
@@ -100,6 +111,8 @@ NewListIntRep(
     listRepPtr->canonicalFlag = 0;
     listRepPtr->refCount = 0;
     listRepPtr->maxElemCount = objc;
+    listRepPtr->storePtr = NULL;
+    listRepPtr->elemPtrs = &listRepPtr->elements;
 
     if (objv) {
 	Tcl_Obj **elemPtrs;
@@ -116,6 +129,111 @@ NewListIntRep(
     }
     return listRepPtr;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewListSlice --
+ *
+ *	Creates a list internal rep that designates count elements of an
+ *	existing one, starting at index first, without copying them.
+ *
+ * Results:
+ *	A new List struct with refCount 0. It has no spare element slots of
+ *	its own.
+ *
+ * Side effects:
+ *	The slice holds a reference to the List that owns the elements, which
+ *	is listRepPtr itself or, if that is a slice too, its store.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static List *
+NewListSlice(
+    List *listRepPtr,		/* List to take the elements from. */
+    int first,			/* Index of the first element of the slice. */
+    int count)			/* Number of elements in the slice. */
+{
+    List *sliceRepPtr = (List *) ckalloc(sizeof(List));
+
+    sliceRepPtr->refCount = 0;
+    sliceRepPtr->maxElemCount = count;
+    sliceRepPtr->elemCount = count;
+    sliceRepPtr->canonicalFlag = 0;
+    sliceRepPtr->storePtr = ListRepIsSlice(listRepPtr)
+	    ? listRepPtr->storePtr : listRepPtr;
+    sliceRepPtr->storePtr->refCount++;
+    sliceRepPtr->elemPtrs = listRepPtr->elemPtrs + first;
+    return sliceRepPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseListIntRep --
+ *
+ *	Removes a reference to a list internal rep, and frees it when the last
+ *	reference is gone.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Freeing a List decrements the ref counts of its elements, or for a
+ *	slice releases its store.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseListIntRep(
+    List *listRepPtr)		/* List rep to release. */
+{
+    if (--listRepPtr->refCount > 0) {
+	return;
+    }
+    if (ListRepIsSlice(listRepPtr)) {
+	ReleaseListIntRep(listRepPtr->storePtr);
+    } else {
+	Tcl_Obj **elemPtrs = &listRepPtr->elements;
+	int i;
+
+	for (i = 0;  i < listRepPtr->elemCount;  i++) {
+	    Tcl_DecrRefCount(elemPtrs[i]);
+	}
+    }
+    ckfree((char *) listRepPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SliceIsWorthwhile --
+ *
+ *	Decides whether a range of count elements of a list should be made a
+ *	slice of it rather than a copy.
+ *
+ * Results:
+ *	Non-zero if a slice should be made.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SliceIsWorthwhile(
+    List *listRepPtr,		/* List the range is taken from. */
+    int count)			/* Number of elements in the range. */
+{
+    List *storePtr = ListRepIsSlice(listRepPtr)
+	    ? listRepPtr->storePtr : listRepPtr;
+
+    return (count >= LIST_SLICE_THRESHOLD)
+	    && (count >= storePtr->elemCount / 4);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -382,6 +500,88 @@ TclListObjCopy(
     DupListInternalRep(listPtr, copyPtr);
     return copyPtr;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclListObjRange --
+ *
+ *	Makes a list value containing the elements of an existing list from
+ *	index fromIdx to index toIdx; the C level counterpart of [lrange].
+ *
+ * Results:
+ *	If listPtr is unshared and a copy would be needed, listPtr itself,
+ *	modified to hold just the range. Otherwise a new Tcl_Obj with refCount
+ *	zero, that shares the elements of listPtr when the range is large
+ *	enough. listPtr must already be a list.
+ *
+ * Side effects:
+ *	May modify listPtr, as described above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclListObjRange(
+    Tcl_Obj *listPtr,		/* List object to take a range of. */
+    int fromIdx,		/* Index of first element to include. */
+    int toIdx)			/* Index of last element to include. */
+{
+    List *listRepPtr = ListRepPtr(listPtr), *sliceRepPtr;
+    Tcl_Obj *resultPtr;
+    int listLen = listRepPtr->elemCount, count;
+
+    if (fromIdx < 0) {
+	fromIdx = 0;
+    }
+    if (toIdx >= listLen) {
+	toIdx = listLen - 1;
+    }
+    if (fromIdx > toIdx) {
+	return Tcl_NewObj();
+    }
+    count = toIdx - fromIdx + 1;
+
+    if (Tcl_IsShared(listPtr) || (listRepPtr->refCount > 1)
+	    || ListRepIsSlice(listRepPtr) || (fromIdx > 0)) {
+	if (SliceIsWorthwhile(listRepPtr, count)) {
+	    sliceRepPtr = NewListSlice(listRepPtr, fromIdx, count);
+	    sliceRepPtr->refCount++;
+	    if (Tcl_IsShared(listPtr)) {
+		TclNewObj(resultPtr);
+	    } else {
+		resultPtr = listPtr;
+		TclFreeIntRep(resultPtr);
+	    }
+	    TclInvalidateStringRep(resultPtr);
+	    resultPtr->internalRep.twoPtrValue.ptr1 = (void *) sliceRepPtr;
+	    resultPtr->internalRep.twoPtrValue.ptr2 = NULL;
+	    resultPtr->typePtr = &tclListType;
+	    return resultPtr;
+	}
+	if (Tcl_IsShared(listPtr) || (listRepPtr->refCount > 1)
+		|| ListRepIsSlice(listRepPtr)) {
+	    return Tcl_NewListObj(count, listRepPtr->elemPtrs + fromIdx);
+	}
+    }
+
+    /*
+     * In-place is possible.
+     */
+
+    if (toIdx < (listLen - 1)) {
+	Tcl_ListObjReplace(NULL, listPtr, toIdx + 1, listLen - 1 - toIdx,
+		0, NULL);
+    }
+
+    /*
+     * This one is not conditioned on (fromIdx > 0) in order to preserve the
+     * string-canonizing effect of [lrange 0 end].
+     */
+
+    Tcl_ListObjReplace(NULL, listPtr, 0, fromIdx, 0, NULL);
+    return listPtr;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -451,7 +651,7 @@ Tcl_ListObjGetElements(
     }
     listRepPtr = (List *) listPtr->internalRep.twoPtrValue.ptr1;
     *objcPtr = listRepPtr->elemCount;
-    *objvPtr = &listRepPtr->elements;
+    *objvPtr = listRepPtr->elemPtrs;
     return TCL_OK;
 }
 
@@ -571,10 +771,32 @@ Tcl_ListObjAppendElement(
     numElems = listRepPtr->elemCount;
     numRequired = numElems + 1 ;
 
+    /*
+     * A slice that ends at the last used slot of a store that nothing else
+     * refers to can grow into the store's free slots.
+     */
+
+    if (ListRepIsSlice(listRepPtr)) {
+	List *storePtr = listRepPtr->storePtr;
+
+	elemPtrs = &storePtr->elements;
+	if ((listRepPtr->refCount == 1) && (storePtr->refCount == 1)
+		&& (storePtr->elemCount < storePtr->maxElemCount)
+		&& (listRepPtr->elemPtrs + numElems
+			== elemPtrs + storePtr->elemCount)) {
+	    elemPtrs[storePtr->elemCount++] = objPtr;
+	    Tcl_IncrRefCount(objPtr);
+	    listRepPtr->elemCount++;
+	    listRepPtr->maxElemCount++;
+	    Tcl_InvalidateStringRep(listPtr);
+	    return TCL_OK;
+	}
+    }
+
     /*
      * If there is no room in the current array of element pointers, allocate
      * a new, larger array and copy the pointers to it. If the List struct is
-     * shared, allocate a new one.
+     * shared or a slice, allocate a new one.
      */
 
     if (numRequired > listRepPtr->maxElemCount){
@@ -585,7 +807,7 @@ Tcl_ListObjAppendElement(
 	newSize = 0;
     }
 
-    if (listRepPtr->refCount > 1) {
+    if ((listRepPtr->refCount > 1) || ListRepIsSlice(listRepPtr)) {
 	List *oldListRepPtr = listRepPtr;
 	Tcl_Obj **oldElems;
 
@@ -593,7 +815,7 @@ Tcl_ListObjAppendElement(
 	if (!listRepPtr) {
 	    Tcl_Panic("Not enough memory to allocate list");
 	}
-	oldElems = &oldListRepPtr->elements;
+	oldElems = oldListRepPtr->elemPtrs;
 	elemPtrs = &listRepPtr->elements;
 	for (i=0; i<numElems; i++) {
 	    elemPtrs[i] = oldElems[i];
@@ -601,11 +823,12 @@ Tcl_ListObjAppendElement(
 	}
 	listRepPtr->elemCount = numElems;
 	listRepPtr->refCount++;
-	oldListRepPtr->refCount--;
+	ReleaseListIntRep(oldListRepPtr);
 	listPtr->internalRep.twoPtrValue.ptr1 = (void *) listRepPtr;
     } else if (newSize) {
 	listRepPtr = (List *) ckrealloc((char *)listRepPtr, (size_t)newSize);
 	listRepPtr->maxElemCount = newMax;
+	listRepPtr->elemPtrs = &listRepPtr->elements;
 	listPtr->internalRep.twoPtrValue.ptr1 = (void *) listRepPtr;
     }
 
@@ -682,7 +905,7 @@ Tcl_ListObjIndex(
     if ((index < 0) || (index >= listRepPtr->elemCount)) {
 	*objPtrPtr = NULL;
     } else {
-	*objPtrPtr = (&listRepPtr->elements)[index];
+	*objPtrPtr = listRepPtr->elemPtrs[index];
     }
 
     return TCL_OK;
@@ -821,7 +1044,7 @@ Tcl_ListObjReplace(
      */
 
     listRepPtr = (List *) listPtr->internalRep.twoPtrValue.ptr1;
-    elemPtrs = &listRepPtr->elements;
+    elemPtrs = listRepPtr->elemPtrs;
     numElems = listRepPtr->elemCount;
 
     if (first < 0) {
@@ -840,9 +1063,27 @@ Tcl_ListObjReplace(
 	count = numElems - first;
     }
 
-    isShared = (listRepPtr->refCount > 1);
+    isShared = (listRepPtr->refCount > 1) || ListRepIsSlice(listRepPtr);
     numRequired = numElems - count + objc;
 
+    /*
+     * Deleting elements from either end of a shared list leaves a range of
+     * it, which can be a slice.
+     */
+
+    if (isShared && (objc == 0) && (count > 0)
+	    && ((first == 0) || (first + count == numElems))
+	    && SliceIsWorthwhile(listRepPtr, numRequired)) {
+	List *sliceRepPtr = NewListSlice(listRepPtr,
+		(first == 0) ? count : 0, numRequired);
+
+	sliceRepPtr->refCount++;
+	listPtr->internalRep.twoPtrValue.ptr1 = (void *) sliceRepPtr;
+	ReleaseListIntRep(listRepPtr);
+	Tcl_InvalidateStringRep(listPtr);
+	return TCL_OK;
+    }
+
     if ((numRequired <= listRepPtr->maxElemCount) && !isShared) {
 	int shift;
 
@@ -898,9 +1139,9 @@ Tcl_ListObjReplace(
 
 	if (isShared) {
 	    /*
-	     * The old struct will remain in place; need new refCounts for the
-	     * new List struct references. Copy over only the surviving
-	     * elements.
+	     * The old struct will remain in place, or is a slice that does not
+	     * own its elements; need new refCounts for the new List struct
+	     * references. Copy over only the surviving elements.
 	     */
 
 	    for (i=0; i < first; i++) {
@@ -913,7 +1154,7 @@ Tcl_ListObjReplace(
 		Tcl_IncrRefCount(elemPtrs[j]);
 	    }
 
-	    oldListRepPtr->refCount--;
+	    ReleaseListIntRep(oldListRepPtr);
 	} else {
 	    /*
 	     * The old struct will be removed; use its inherited refCounts.
@@ -1519,7 +1760,7 @@ TclListObjSetElement(
 
     listRepPtr = (List *) listPtr->internalRep.twoPtrValue.ptr1;
     elemCount = listRepPtr->elemCount;
-    elemPtrs = &listRepPtr->elements;
+    elemPtrs = listRepPtr->elemPtrs;
 
     /*
      * Ensure that the index is in bounds.
@@ -1534,10 +1775,11 @@ TclListObjSetElement(
     }
 
     /*
-     * If the internal rep is shared, replace it with an unshared copy.
+     * If the internal rep is shared or a slice, replace it with an unshared
+     * copy.
      */
 
-    if (listRepPtr->refCount > 1) {
+    if ((listRepPtr->refCount > 1) || ListRepIsSlice(listRepPtr)) {
 	List *oldListRepPtr = listRepPtr;
 	Tcl_Obj **oldElemPtrs = elemPtrs;
 	int i;
@@ -1555,7 +1797,7 @@ TclListObjSetElement(
 	listRepPtr->refCount++;
 	listRepPtr->elemCount = elemCount;
 	listPtr->internalRep.twoPtrValue.ptr1 = (void *) listRepPtr;
-	oldListRepPtr->refCount--;
+	ReleaseListIntRep(oldListRepPtr);
     }
 
     /*
@@ -1591,9 +1833,9 @@ TclListObjSetElement(
  *	None.
  *
  * Side effects:
- *	Frees listPtr's List* internal representation and sets listPtr's
- *	internalRep.twoPtrValue.ptr1 to NULL. Decrements the ref counts of all
- *	element objects, which may free them.
+ *	Releases listPtr's List* internal representation and sets listPtr's
+ *	internalRep.twoPtrValue.ptr1 to NULL. Freeing the List decrements the
+ *	ref counts of all element objects, which may free them.
  *
  *----------------------------------------------------------------------
  */
@@ -1602,20 +1844,7 @@ static void
 FreeListInternalRep(
     Tcl_Obj *listPtr)		/* List object with internal rep to free. */
 {
-    register List *listRepPtr = (List *) listPtr->internalRep.twoPtrValue.ptr1;
-    register Tcl_Obj **elemPtrs = &listRepPtr->elements;
-    register Tcl_Obj *objPtr;
-    int numElems = listRepPtr->elemCount;
-    int i;
-
-    if (--listRepPtr->refCount <= 0) {
-	for (i = 0;  i < numElems;  i++) {
-	    objPtr = elemPtrs[i];
-	    Tcl_DecrRefCount(objPtr);
-	}
-	ckfree((char *) listRepPtr);
-    }
-
+    ReleaseListIntRep((List *) listPtr->internalRep.twoPtrValue.ptr1);
     listPtr->internalRep.twoPtrValue.ptr1 = NULL;
     listPtr->internalRep.twoPtrValue.ptr2 = NULL;
     listPtr->typePtr = NULL;
@@ -1888,7 +2117,7 @@ UpdateStringOfList(
 	flagPtr = (int *) ckalloc((unsigned) numElems * sizeof(int));
     }
     listPtr->length = 1;
-    elemPtrs = &listRepPtr->elements;
+    elemPtrs = listRepPtr->elemPtrs;
     for (i = 0; i < numElems; i++) {
 	elem = TclGetStringFromObj(elemPtrs[i], &length);
 	listPtr->length += Tcl_ScanCountedElement(elem, length, flagPtr+i)+1;
@@ -68,10 +68,44 @@ typedef struct ResolvedNsName {
 				 * becomes zero. */
 } ResolvedNsName;
 
+/*
+ * This structure records the result of looking up a command name from some
+ * namespace in Tcl_FindCommand. The entries for one name are chained in the
+ * interpreter's cmdCacheTablePtr table. An entry stays valid under the same
+ * conditions as the internal rep of a cmdName object: the command has not
+ * been deleted or renamed since (its cmdEpoch) and no command has been
+ * created that shadows it or the path of the namespace changed (the
+ * namespace's cmdRefEpoch).
+ */
+
+typedef struct CmdCacheEntry {
+    Namespace *nsPtr;		/* The namespace the name was looked up from.
+				 * Only compared, never dereferenced. */
+    long nsId;			/* Its id, in case another namespace gets
+				 * allocated at the same address. */
+    int cmdRefEpoch;		/* Its cmdRefEpoch at lookup time. */
+    Command *cmdPtr;		/* The command found. The entry holds a
+				 * reference to it. */
+    int cmdEpoch;		/* The command's cmdEpoch at lookup time. */
+    struct CmdCacheEntry *nextPtr;
+				/* Next entry for the same name. */
+} CmdCacheEntry;
+
+/*
+ * The maximum number of entries in the command cache. The cache is emptied
+ * when it is full.
+ */
+
+#define CMD_CACHE_SIZE	4096
+
 /*
  * Declarations for functions local to this file:
  */
 
+static Command *	CmdCacheLookup(Interp *iPtr, Namespace *nsPtr,
+			    const char *name);
+static void		CmdCacheStore(Interp *iPtr, Namespace *nsPtr,
+			    const char *name, Command *cmdPtr);
 static void		DeleteImportedCmd(ClientData clientData);
 static int		DoImport(Tcl_Interp *interp,
 			    Namespace *nsPtr, Tcl_HashEntry *hPtr,
@@ -95,6 +129,8 @@ static int		InvokeImportedCmd(ClientData clientData,
 			    Tcl_Interp *interp,int objc,Tcl_Obj *const objv[]);
 static int		InvokeImportedNRCmd(ClientData clientData,
 			    Tcl_Interp *interp,int objc,Tcl_Obj *const objv[]);
+static int		NamespaceCachestatsCmd(ClientData dummy,
+			    Tcl_Interp *interp,int objc,Tcl_Obj *const objv[]);
 static int		NamespaceChildrenCmd(ClientData dummy,
 			    Tcl_Interp *interp,int objc,Tcl_Obj *const objv[]);
 static int		NamespaceCodeCmd(ClientData dummy, Tcl_Interp *interp,
@@ -2415,7 +2451,7 @@ Tcl_FindCommand(
 				 * TCL_GLOBAL_ONLY is ignored. */
 {
     Interp *iPtr = (Interp *) interp;
-    Namespace *cxtNsPtr;
+    Namespace *cxtNsPtr, *cacheNsPtr;
     register Tcl_HashEntry *entryPtr;
     register Command *cmdPtr;
     const char *simpleName;
@@ -2463,6 +2499,26 @@ Tcl_FindCommand(
 	}
     }
 
+    /*
+     * Unless the lookup is restricted to one namespace, an earlier lookup of
+     * the same name from the same namespace may still be good. A relative
+     * qualified name looked up along a path is not cached: a command created
+     * in a child of the namespace or of a path namespace can shadow the one
+     * found without any epoch telling.
+     */
+
+    cacheNsPtr = NULL;
+    if (!(flags & (TCL_GLOBAL_ONLY|TCL_NAMESPACE_ONLY))
+	    && !(cxtNsPtr->flags & NS_DYING)
+	    && ((cxtNsPtr->commandPathLength == 0)
+		|| (strstr(name, "::") == NULL) || !strncmp(name, "::", 2))) {
+	cmdPtr = CmdCacheLookup(iPtr, cxtNsPtr, name);
+	if (cmdPtr != NULL) {
+	    return (Tcl_Command) cmdPtr;
+	}
+	cacheNsPtr = cxtNsPtr;
+    }
+
     /*
      * Find the namespace(s) that contain the command.
      */
@@ -2549,6 +2605,9 @@ Tcl_FindCommand(
     }
 
     if (cmdPtr != NULL) {
+	if (cacheNsPtr != NULL) {
+	    CmdCacheStore(iPtr, cacheNsPtr, name, cmdPtr);
+	}
 	return (Tcl_Command) cmdPtr;
     }
 
@@ -2559,6 +2618,181 @@ Tcl_FindCommand(
     }
     return NULL;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CmdCacheLookup --
+ *
+ *	Looks for a still valid result of an earlier lookup of a command name
+ *	from a namespace in the interpreter's command cache.
+ *
+ * Results:
+ *	Returns the command, or NULL if the cache has no valid entry for the
+ *	name and namespace.
+ *
+ * Side effects:
+ *	An outdated entry is removed from the cache. The hit and miss counters
+ *	of the interpreter are updated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Command *
+CmdCacheLookup(
+    Interp *iPtr,		/* Interpreter the lookup is done in. */
+    Namespace *nsPtr,		/* Namespace the name is looked up from. */
+    const char *name)		/* Command's name. */
+{
+    Tcl_HashEntry *hPtr;
+    CmdCacheEntry *cachePtr, **prevPtrPtr;
+    Command *cmdPtr;
+
+    if (iPtr->cmdCacheTablePtr != NULL) {
+	hPtr = Tcl_FindHashEntry(iPtr->cmdCacheTablePtr, name);
+    } else {
+	hPtr = NULL;
+    }
+    if (hPtr == NULL) {
+	iPtr->numCmdCacheMisses++;
+	return NULL;
+    }
+
+    prevPtrPtr = (CmdCacheEntry **) &hPtr->clientData;
+    for (cachePtr = *prevPtrPtr; cachePtr != NULL;
+	    prevPtrPtr = &cachePtr->nextPtr, cachePtr = cachePtr->nextPtr) {
+	if (cachePtr->nsPtr == nsPtr) {
+	    break;
+	}
+    }
+    if (cachePtr == NULL) {
+	iPtr->numCmdCacheMisses++;
+	return NULL;
+    }
+
+    cmdPtr = cachePtr->cmdPtr;
+    if ((cachePtr->nsId == nsPtr->nsId)
+	    && (cachePtr->cmdRefEpoch == nsPtr->cmdRefEpoch)
+	    && (cachePtr->cmdEpoch == cmdPtr->cmdEpoch)
+	    && !(cmdPtr->flags & CMD_IS_DELETED)
+	    && !(cmdPtr->nsPtr->flags & NS_DYING)) {
+	iPtr->numCmdCacheHits++;
+	return cmdPtr;
+    }
+
+    /*
+     * The entry is outdated, drop it.
+     */
+
+    *prevPtrPtr = cachePtr->nextPtr;
+    if (hPtr->clientData == NULL) {
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    if (--cmdPtr->refCount == 0) {
+	TclCleanupCommandMacro(cmdPtr);
+    }
+    ckfree((char *) cachePtr);
+    iPtr->numCmdCacheEntries--;
+    iPtr->numCmdCacheMisses++;
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CmdCacheStore --
+ *
+ *	Records the result of a lookup of a command name from a namespace in
+ *	the interpreter's command cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The cache may be emptied first if it is full.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CmdCacheStore(
+    Interp *iPtr,		/* Interpreter the lookup was done in. */
+    Namespace *nsPtr,		/* Namespace the name was looked up from. */
+    const char *name,		/* Command's name. */
+    Command *cmdPtr)		/* The command found. */
+{
+    Tcl_HashEntry *hPtr;
+    CmdCacheEntry *cachePtr;
+    int isNew;
+
+    if (iPtr->numCmdCacheEntries >= CMD_CACHE_SIZE) {
+	TclFreeCmdCache(iPtr);
+    }
+    if (iPtr->cmdCacheTablePtr == NULL) {
+	iPtr->cmdCacheTablePtr = (Tcl_HashTable *)
+		ckalloc(sizeof(Tcl_HashTable));
+	Tcl_InitHashTable(iPtr->cmdCacheTablePtr, TCL_STRING_KEYS);
+    }
+
+    hPtr = Tcl_CreateHashEntry(iPtr->cmdCacheTablePtr, name, &isNew);
+    cachePtr = (CmdCacheEntry *) ckalloc(sizeof(CmdCacheEntry));
+    cachePtr->nsPtr = nsPtr;
+    cachePtr->nsId = nsPtr->nsId;
+    cachePtr->cmdRefEpoch = nsPtr->cmdRefEpoch;
+    cachePtr->cmdPtr = cmdPtr;
+    cachePtr->cmdEpoch = cmdPtr->cmdEpoch;
+    cachePtr->nextPtr = isNew ? NULL : Tcl_GetHashValue(hPtr);
+    Tcl_SetHashValue(hPtr, cachePtr);
+    cmdPtr->refCount++;
+    iPtr->numCmdCacheEntries++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreeCmdCache --
+ *
+ *	Empties the command cache of an interpreter.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Releases the references the cache holds to commands, which may free
+ *	deleted commands.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreeCmdCache(
+    Interp *iPtr)		/* Interpreter whose cache is emptied. */
+{
+    Tcl_HashTable *tablePtr = iPtr->cmdCacheTablePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    CmdCacheEntry *cachePtr, *nextPtr;
+
+    if (tablePtr == NULL) {
+	return;
+    }
+    iPtr->cmdCacheTablePtr = NULL;
+    iPtr->numCmdCacheEntries = 0;
+
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	for (cachePtr = Tcl_GetHashValue(hPtr); cachePtr != NULL;
+		cachePtr = nextPtr) {
+	    nextPtr = cachePtr->nextPtr;
+	    if (--cachePtr->cmdPtr->refCount == 0) {
+		TclCleanupCommandMacro(cachePtr->cmdPtr);
+	    }
+	    ckfree((char *) cachePtr);
+	}
+    }
+    Tcl_DeleteHashTable(tablePtr);
+    ckfree((char *) tablePtr);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -2577,7 +2811,9 @@ Tcl_FindCommand(
  *	      "b::foo" in the global namespace. If so, then all command
  *	      references in "a" * are suspect.
  *	The same checks are applied to all parent namespaces, until we reach
- *	the global :: namespace.
+ *	the global :: namespace. Besides, a lookup of "foo" from "b" or from a
+ *	namespace that has "b" in its path may have found a "foo" further
+ *	along a path; the new command now comes first.
  *
  * Results:
  *	None.
@@ -2626,6 +2862,18 @@ TclResetShadowedCmdRefs(
      */
 
     cmdName = Tcl_GetHashKey(newCmdPtr->hPtr->tablePtr, newCmdPtr->hPtr);
+
+    /*
+     * The trail below does not cover command paths. A lookup from the new
+     * command's namespace, or from one that has it in its path, may have
+     * found a command of the same name further along a path.
+     */
+
+    if (newCmdPtr->nsPtr->commandPathLength != 0) {
+	newCmdPtr->nsPtr->cmdRefEpoch++;
+    }
+    TclInvalidateNsPath(newCmdPtr->nsPtr);
+
     for (nsPtr=newCmdPtr->nsPtr ; (nsPtr!=NULL) && (nsPtr!=globalNsPtr) ;
 	    nsPtr=nsPtr->parentPtr) {
 	/*
@@ -2848,12 +3096,13 @@ TclNRNamespaceObjCmd(
     Tcl_Obj *const objv[])	/* Argument objects. */
 {
     static const char *const subCmds[] = {
-	"children", "code", "current", "delete", "ensemble",
+	"cachestats", "children", "code", "current", "delete", "ensemble",
 	"eval", "exists", "export", "forget", "import",
 	"inscope", "origin", "parent", "path", "qualifiers",
 	"tail", "unknown", "upvar", "which", NULL
     };
     enum NSSubCmdIdx {
+	NSCachestatsIdx,
 	NSChildrenIdx, NSCodeIdx, NSCurrentIdx, NSDeleteIdx, NSEnsembleIdx,
 	NSEvalIdx, NSExistsIdx, NSExportIdx, NSForgetIdx, NSImportIdx,
 	NSInscopeIdx, NSOriginIdx, NSParentIdx, NSPathIdx, NSQualifiersIdx,
@@ -2876,6 +3125,8 @@ TclNRNamespaceObjCmd(
     }
 
     switch (index) {
+    case NSCachestatsIdx:
+	return NamespaceCachestatsCmd(clientData, interp, objc, objv);
     case NSChildrenIdx:
 	return NamespaceChildrenCmd(clientData, interp, objc, objv);
     case NSCodeIdx:
@@ -2920,6 +3171,57 @@ TclNRNamespaceObjCmd(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * NamespaceCachestatsCmd --
+ *
+ *	Invoked to implement the "namespace cachestats" command that returns
+ *	the statistics of the interpreter's cache of command lookups as a
+ *	dictionary with the keys "entries", "hits" and "misses". Handles the
+ *	following syntax:
+ *
+ *	    namespace cachestats
+ *
+ * Results:
+ *	Returns TCL_OK if successful, and TCL_ERROR if anything goes wrong.
+ *
+ * Side effects:
+ *	Returns a result in the interpreter's result object. If anything goes
+ *	wrong, the result is an error message.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+NamespaceCachestatsCmd(
+    ClientData dummy,		/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Interp *iPtr = (Interp *) interp;
+    Tcl_Obj *resultPtr;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	return TCL_ERROR;
+    }
+
+    resultPtr = Tcl_NewObj();
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("entries", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewIntObj(iPtr->numCmdCacheEntries));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("hits", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewLongObj(iPtr->numCmdCacheHits));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("misses", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewLongObj(iPtr->numCmdCacheMisses));
+    Tcl_SetObjResult(interp, resultPtr);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -81,6 +81,8 @@ static int		FinalizeNext(ClientData data[],
 			    Tcl_Interp *interp, int result);
 static int		FinalizeObjectCall(ClientData data[],
 			    Tcl_Interp *interp, int result);
+static int		FinalizeSimpleCall(ClientData data[],
+			    Tcl_Interp *interp, int result);
 static void		InitFoundation(Tcl_Interp *interp);
 static void		KillFoundation(ClientData clientData,
 			    Tcl_Interp *interp);
@@ -863,14 +865,7 @@ ReleaseClassContents(
 	clsPtr->destructorChainPtr = NULL;
     }
     if (clsPtr->classChainCache) {
-	FOREACH_HASH_DECLS;
-	CallChain *callPtr;
-
-	FOREACH_HASH_VALUE(callPtr, clsPtr->classChainCache) {
-	    TclOODeleteChain(callPtr);
-	}
-	Tcl_DeleteHashTable(clsPtr->classChainCache);
-	ckfree((char *) clsPtr->classChainCache);
+	TclOODeleteChainCache(clsPtr->classChainCache);
 	clsPtr->classChainCache = NULL;
     }
 
@@ -2215,11 +2210,12 @@ TclOOInvokeObject(
 /*
  * ----------------------------------------------------------------------
  *
- * TclOOObjectCmdCore, FinalizeObjectCall --
+ * TclOOObjectCmdCore, FinalizeObjectCall, FinalizeSimpleCall --
  *
  *	Main function for object invokations. Does call chain creation,
- *	management and invokation. The function FinalizeObjectCall exists to
- *	clean up after the non-recursive processing of TclOOObjectCmdCore.
+ *	management and invokation. The functions FinalizeObjectCall and
+ *	FinalizeSimpleCall exist to clean up after the non-recursive
+ *	processing of TclOOObjectCmdCore.
  *
  * ----------------------------------------------------------------------
  */
@@ -2330,6 +2326,28 @@ TclOOObjectCmdCore(
      */
 
     AddRef(oPtr);
+
+    /*
+     * Fast path for the common case, such as a [my] call on an object
+     * without filters, where the chain is a single ordinary method: there is
+     * no filter state to save and no further chain entry to lock, so call the
+     * method directly and clean up with a single callback. The context is
+     * still needed, as [self] and [next] read it.
+     */
+
+    if ((contextPtr->index == 0) && (contextPtr->callPtr->numChain == 1)
+	    && !contextPtr->callPtr->chain[0].isFilter
+	    && !(contextPtr->callPtr->flags&(OO_UNKNOWN_METHOD|FILTER_HANDLING))
+	    && !(oPtr->flags & FILTER_HANDLING)) {
+	Method *mPtr = contextPtr->callPtr->chain[0].mPtr;
+
+	AddRef(mPtr);
+	TclNRAddCallback(interp, FinalizeSimpleCall, contextPtr, oPtr, mPtr,
+		NULL);
+	return mPtr->typePtr->callProc(mPtr->clientData, interp,
+		(Tcl_ObjectContext) contextPtr, objc, objv);
+    }
+
     TclNRAddCallback(interp, FinalizeObjectCall, contextPtr,oPtr, NULL,NULL);
     return TclOOInvokeContext(contextPtr, interp, objc, objv);
 }
@@ -2351,6 +2369,27 @@ FinalizeObjectCall(
     DelRef(oPtr);
     return result;
 }
+
+static int
+FinalizeSimpleCall(
+    ClientData data[],
+    Tcl_Interp *interp,
+    int result)
+{
+    register CallContext *contextPtr = data[0];
+    register Object *oPtr = data[1];
+    Method *mPtr = data[2];
+
+    /*
+     * Drop the lock on the method as well as doing what FinalizeObjectCall
+     * does.
+     */
+
+    TclOODelMethodRef(mPtr);
+    TclOODeleteContext(contextPtr);
+    DelRef(oPtr);
+    return result;
+}
 
 /*
  * ----------------------------------------------------------------------
@@ -41,6 +41,25 @@ struct ChainBuilder {
 #define KNOWN_STATE	   (DEFINITE_PROTECTED | DEFINITE_PUBLIC)
 #define SPECIAL		   (CONSTRUCTOR | DESTRUCTOR)
 
+/*
+ * The internal representation of a method name that is used to cache call
+ * chains. Literals are shared across the interpreter, but the compiler gives
+ * the method name of a likely method call ([$obj m], [my m]) a literal of its
+ * own (see TclCompileScript), so for compiled code this is a cache per call
+ * site. A call site that is used with objects of several classes sees a
+ * different chain for each of them, so a few chains are kept, most recently
+ * stashed first.
+ */
+
+#define METHOD_CACHE_SIZE 4
+
+typedef struct MethodNameCache {
+    int numChains;		/* Number of chains in the cache. */
+    CallChain *chains[METHOD_CACHE_SIZE];
+				/* The cached chains, each holding a
+				 * reference. */
+} MethodNameCache;
+
 /*
  * Function declarations for things defined in this file.
  */
@@ -68,6 +87,8 @@ static int		CmpStr(const void *ptr1, const void *ptr2);
 static void		DupMethodNameRep(Tcl_Obj *srcPtr, Tcl_Obj *dstPtr);
 static int		FinalizeMethodRefs(ClientData data[],
 			    Tcl_Interp *interp, int result);
+static inline CallChain *FindCachedChain(Tcl_Obj *objPtr, Object *oPtr,
+			    int flags, int reuseMask);
 static void		FreeMethodNameRep(Tcl_Obj *objPtr);
 static inline int	IsStillValid(CallChain *callPtr, Object *oPtr,
 			    int flags, int reuseMask);
@@ -162,7 +183,9 @@ TclOODeleteChain(
  * TclOOStashContext --
  *
  *	Saves a reference to a method call context in a Tcl_Obj's internal
- *	representation.
+ *	representation. If the object already caches chains, the new one is
+ *	added in front of them, pushing out the least recently stashed chain
+ *	if there is no room.
  *
  * ----------------------------------------------------------------------
  */
@@ -172,10 +195,25 @@ StashCallChain(
     Tcl_Obj *objPtr,
     CallChain *callPtr)
 {
+    MethodNameCache *cachePtr;
+
     callPtr->refCount++;
-    TclFreeIntRep(objPtr);
-    objPtr->typePtr = &methodNameType;
-    objPtr->internalRep.otherValuePtr = callPtr;
+    if (objPtr->typePtr == &methodNameType) {
+	cachePtr = objPtr->internalRep.otherValuePtr;
+	if (cachePtr->numChains == METHOD_CACHE_SIZE) {
+	    TclOODeleteChain(cachePtr->chains[--cachePtr->numChains]);
+	}
+	memmove(cachePtr->chains + 1, cachePtr->chains,
+		sizeof(CallChain *) * cachePtr->numChains);
+    } else {
+	TclFreeIntRep(objPtr);
+	cachePtr = (MethodNameCache *) ckalloc(sizeof(MethodNameCache));
+	cachePtr->numChains = 0;
+	objPtr->typePtr = &methodNameType;
+	objPtr->internalRep.otherValuePtr = cachePtr;
+    }
+    cachePtr->chains[0] = callPtr;
+    cachePtr->numChains++;
 }
 
 void
@@ -202,20 +240,30 @@ DupMethodNameRep(
     Tcl_Obj *srcPtr,
     Tcl_Obj *dstPtr)
 {
-    register CallChain *callPtr = srcPtr->internalRep.otherValuePtr;
+    MethodNameCache *srcCachePtr = srcPtr->internalRep.otherValuePtr;
+    MethodNameCache *cachePtr = (MethodNameCache *)
+	    ckalloc(sizeof(MethodNameCache));
+    int i;
 
+    *cachePtr = *srcCachePtr;
+    for (i=0 ; i<cachePtr->numChains ; i++) {
+	cachePtr->chains[i]->refCount++;
+    }
     dstPtr->typePtr = &methodNameType;
-    dstPtr->internalRep.otherValuePtr = callPtr;
-    callPtr->refCount++;
+    dstPtr->internalRep.otherValuePtr = cachePtr;
 }
 
 static void
 FreeMethodNameRep(
     Tcl_Obj *objPtr)
 {
-    register CallChain *callPtr = objPtr->internalRep.otherValuePtr;
+    MethodNameCache *cachePtr = objPtr->internalRep.otherValuePtr;
+    int i;
 
-    TclOODeleteChain(callPtr);
+    for (i=0 ; i<cachePtr->numChains ; i++) {
+	TclOODeleteChain(cachePtr->chains[i]);
+    }
+    ckfree((char *) cachePtr);
     objPtr->internalRep.otherValuePtr = NULL;
     objPtr->typePtr = NULL;
 }
@@ -280,9 +328,16 @@ TclOOInvokeContext(
     }
 
     /*
-     * Save whether we were in a filter and set up whether we are now.
+     * Save whether we were in a filter and set up whether we are now. In the
+     * common case of an ordinary method called outside any filter, there is
+     * nothing to change and so nothing to restore afterwards.
      */
 
+    if (!isFilter && !(contextPtr->oPtr->flags & FILTER_HANDLING)
+	    && !(contextPtr->callPtr->flags & FILTER_HANDLING)) {
+	return mPtr->typePtr->callProc(mPtr->clientData, interp,
+		(Tcl_ObjectContext) contextPtr, objc, objv);
+    }
     if (contextPtr->oPtr->flags & FILTER_HANDLING) {
 	TclNRAddCallback(interp, SetFilterFlags, contextPtr, NULL,NULL,NULL);
     } else {
@@ -876,6 +931,51 @@ IsStillValid(
 	    && (callPtr->objectEpoch == oPtr->epoch)
 	    && ((callPtr->flags & mask) == (flags & mask)));
 }
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * FindCachedChain --
+ *	Looks through the call chains cached in a method name object for one
+ *	that can be used for executing a method for the given object. Chains
+ *	that were built for the same object (or class) but which are no
+ *	longer valid are discarded as they are found.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static inline CallChain *
+FindCachedChain(
+    Tcl_Obj *objPtr,
+    Object *oPtr,
+    int flags,
+    int reuseMask)
+{
+    MethodNameCache *cachePtr = objPtr->internalRep.otherValuePtr;
+    Object *epochObjPtr = oPtr;
+    CallChain *callPtr;
+    int i;
+
+    if (oPtr->flags & USE_CLASS_CACHE) {
+	epochObjPtr = oPtr->selfCls->thisPtr;
+    }
+    for (i=0 ; i<cachePtr->numChains ; i++) {
+	callPtr = cachePtr->chains[i];
+	if (IsStillValid(callPtr, oPtr, flags, reuseMask)) {
+	    return callPtr;
+	}
+	if (callPtr->objectCreationEpoch == epochObjPtr->creationEpoch
+		&& (callPtr->epoch != oPtr->fPtr->epoch
+		|| callPtr->objectEpoch != epochObjPtr->epoch)) {
+	    TclOODeleteChain(callPtr);
+	    cachePtr->numChains--;
+	    memmove(cachePtr->chains + i, cachePtr->chains + i + 1,
+		    sizeof(CallChain *) * (cachePtr->numChains - i));
+	    i--;
+	}
+    }
+    return NULL;
+}
 
 /*
  * ----------------------------------------------------------------------
@@ -949,12 +1049,11 @@ TclOOGetCallContext(
 	const int reuseMask = ((flags & PUBLIC_METHOD) ? ~0 : ~PUBLIC_METHOD);
 
 	if (cacheInThisObj->typePtr == &methodNameType) {
-	    callPtr = cacheInThisObj->internalRep.otherValuePtr;
-	    if (IsStillValid(callPtr, oPtr, flags, reuseMask)) {
+	    callPtr = FindCachedChain(cacheInThisObj, oPtr, flags, reuseMask);
+	    if (callPtr != NULL) {
 		callPtr->refCount++;
 		goto returnContext;
 	    }
-	    FreeMethodNameRep(cacheInThisObj);
 	}
 
 	if (oPtr->flags & USE_CLASS_CACHE) {
@@ -976,6 +1075,7 @@ TclOOGetCallContext(
 	if (hPtr != NULL && Tcl_GetHashValue(hPtr) != NULL) {
 	    callPtr = Tcl_GetHashValue(hPtr);
 	    if (IsStillValid(callPtr, oPtr, flags, reuseMask)) {
+		StashCallChain(cacheInThisObj, callPtr);
 		callPtr->refCount++;
 		goto returnContext;
 	    }
@@ -61,7 +61,9 @@
 
 /*
  * Thread local storage used to maintain a per-thread cache of compiled
- * regular expressions.
+ * regular expressions. The TclRegexps in it keep the state of the last match
+ * made with them, so they are not shared between threads, but the compiled
+ * forms they hold are found in the process-wide cache below.
  */
 
 #define NUM_REGEXPS 30
@@ -81,12 +83,82 @@ typedef struct ThreadSpecificData {
 
 static Tcl_ThreadDataKey dataKey;
 
+/*
+ * The compiled form of a regexp is only read while matching, so one copy of
+ * it serves all threads. The process-wide cache below maps each pattern and
+ * its compile flags to a RegexpCacheEntry holding the compiled form, with a
+ * reference count of the TclRegexps using it. Entries that are no longer used
+ * are kept, most recently released first, until the estimated size of all
+ * entries exceeds a limit of REGEXP_CACHE_SIZE bytes, or as many as the
+ * TCL_REGEXP_CACHE_SIZE environment variable asks for. Entries in use are
+ * never evicted.
+ */
+
+#define REGEXP_CACHE_SIZE	(32 * 1024 * 1024)
+
+typedef struct RegexpCacheEntry {
+    regex_t re;			/* The compiled regexp. */
+    char *glob;			/* Glob pattern equivalent to the regexp, or
+				 * NULL if none. Malloc-ed. */
+    int globLength;		/* Number of bytes in glob. */
+    char *must;			/* ASCII string that every match contains, or
+				 * NULL if none is known. Malloc-ed. */
+    int mustLength;		/* Number of bytes in must. */
+    int mustNocase;		/* Non-zero if must is lowercase and to be
+				 * compared ignoring case. */
+    size_t size;		/* Estimated memory used by the entry. */
+    int refCount;		/* Number of TclRegexps using the entry. */
+    Tcl_HashEntry *hPtr;	/* The entry in the cache table, or NULL once
+				 * the cache has been finalized. */
+    struct RegexpCacheEntry *prevPtr;
+    struct RegexpCacheEntry *nextPtr;
+				/* Neighbours in the list of unused entries,
+				 * when refCount is 0. */
+} RegexpCacheEntry;
+
+/*
+ * The keys of the cache table, also stored in its entries.
+ */
+
+typedef struct RegexpCacheKey {
+    int flags;			/* Compile flags. */
+    int length;			/* Number of bytes in pattern. */
+    const char *pattern;	/* The pattern, in UTF-8. In the table, it
+				 * points just after the key. */
+} RegexpCacheKey;
+
+static struct {
+    int initialized;		/* Set to 1 when the cache is initialized. */
+    Tcl_HashTable table;	/* Maps RegexpCacheKeys to entries. */
+    RegexpCacheEntry *unusedPtr;/* Most recently released unused entry. */
+    RegexpCacheEntry *lastUnusedPtr;
+				/* Least recently released unused entry. */
+    size_t size;		/* Estimated size of all entries. */
+    size_t limit;		/* Size above which unused entries are
+				 * evicted. */
+} regexpCache;
+TCL_DECLARE_MUTEX(regexpCacheMutex)
+
 /*
  * Declarations for functions used only in this file.
  */
 
+static Tcl_HashEntry *	AllocRegexpCacheKey(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static int		CompareRegexpCacheKeys(void *keyPtr,
+			    Tcl_HashEntry *hPtr);
 static TclRegexp *	CompileRegexp(Tcl_Interp *interp, const char *pattern,
 			    int length, int flags);
+static void		EvictRegexpCacheEntries(void);
+static void		FreeRegexpCacheEntry(RegexpCacheEntry *cachePtr);
+static RegexpCacheEntry *GetRegexpCacheEntry(Tcl_Interp *interp,
+			    const char *pattern, int length, int flags);
+static int		HasMust(RegexpCacheEntry *cachePtr,
+			    const char *bytes, int length);
+static unsigned		HashRegexpCacheKey(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static void		InitRegexpCache(void);
+static void		ReleaseRegexpCacheEntry(RegexpCacheEntry *cachePtr);
 static void		DupRegexpInternalRep(Tcl_Obj *srcPtr,
 			    Tcl_Obj *copyPtr);
 static void		FinalizeRegexp(ClientData clientData);
@@ -109,6 +181,15 @@ const Tcl_ObjType tclRegexpType = {
     NULL,				/* updateStringProc */
     SetRegexpFromAny			/* setFromAnyProc */
 };
+
+static const Tcl_HashKeyType regexpCacheKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    0,					/* flags */
+    HashRegexpCacheKey,			/* hashKeyProc */
+    CompareRegexpCacheKeys,		/* compareKeysProc */
+    AllocRegexpCacheKey,		/* allocEntryProc */
+    NULL				/* freeEntryProc */
+};
 
 /*
  *----------------------------------------------------------------------
@@ -466,6 +547,18 @@ Tcl_RegExpExecObj(
     regexpPtr->string = NULL;
     regexpPtr->objPtr = textObj;
 
+    /*
+     * Text without the string that every match contains can't match. Look
+     * for it in the UTF-8 rep, if there is one, before the text is converted
+     * to Unicode for the RE engine.
+     */
+
+    if ((regexpPtr->cachePtr->must != NULL) && (textObj->bytes != NULL)
+	    && !HasMust(regexpPtr->cachePtr, textObj->bytes,
+		    textObj->length)) {
+	return 0;
+    }
+
     udata = Tcl_GetUnicodeFromObj(textObj, &length);
 
     if (offset > length) {
@@ -830,7 +923,8 @@ SetRegexpFromAny(
  *
  *	Attempt to compile the given regexp pattern. If the compiled regular
  *	expression can be found in the per-thread cache, it will be used
- *	instead of compiling a new copy.
+ *	instead of compiling a new copy. Otherwise the compiled form is taken
+ *	from the process-wide cache, where it is only compiled when missing.
  *
  * Results:
  *	The return value is a pointer to a newly allocated TclRegexp that
@@ -839,8 +933,8 @@ SetRegexpFromAny(
  *	interp's result.
  *
  * Side effects:
- *	The thread-local regexp cache is updated and a new TclRegexp may be
- *	allocated.
+ *	The thread-local and process-wide regexp caches are updated and a new
+ *	TclRegexp may be allocated.
  *
  *----------------------------------------------------------------------
  */
@@ -853,9 +947,8 @@ CompileRegexp(
     int flags)			/* Compilation flags. */
 {
     TclRegexp *regexpPtr;
-    const Tcl_UniChar *uniString;
-    int numChars, status, i, exact;
-    Tcl_DString stringBuf;
+    RegexpCacheEntry *cachePtr;
+    int i;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     if (!tsdPtr->initialized) {
@@ -904,55 +997,33 @@ CompileRegexp(
     }
 
     /*
-     * This is a new expression, so compile it and add it to the cache.
+     * This is a new expression for this thread, so get its compiled form,
+     * from the process-wide cache if possible, and add it to the cache.
      */
 
+    cachePtr = GetRegexpCacheEntry(interp, string, length, flags);
+    if (cachePtr == NULL) {
+	return NULL;
+    }
+
     regexpPtr = (TclRegexp *) ckalloc(sizeof(TclRegexp));
     regexpPtr->objPtr = NULL;
     regexpPtr->string = NULL;
     regexpPtr->details.rm_extend.rm_so = -1;
     regexpPtr->details.rm_extend.rm_eo = -1;
-
-    /*
-     * Get the up-to-date string representation and map to unicode.
-     */
-
-    Tcl_DStringInit(&stringBuf);
-    uniString = Tcl_UtfToUniCharDString(string, length, &stringBuf);
-    numChars = Tcl_DStringLength(&stringBuf) / sizeof(Tcl_UniChar);
-
-    /*
-     * Compile the string and check for errors.
-     */
-
     regexpPtr->flags = flags;
-    status = TclReComp(&regexpPtr->re, uniString, (size_t) numChars, flags);
-    Tcl_DStringFree(&stringBuf);
-
-    if (status != REG_OKAY) {
-	/*
-	 * Clean up and report errors in the interpreter, if possible.
-	 */
-
-	ckfree((char *)regexpPtr);
-	if (interp) {
-	    TclRegError(interp,
-		    "couldn't compile regular expression pattern: ", status);
-	}
-	return NULL;
-    }
+    regexpPtr->re = cachePtr->re;
+    regexpPtr->cachePtr = cachePtr;
 
     /*
-     * Convert RE to a glob pattern equivalent, if any, and cache it.  If this
-     * is not possible, then globObjPtr will be NULL.  This is used by
-     * Tcl_RegExpExecObj to optionally do a fast match (avoids RE engine).
+     * The glob pattern equivalent, if any, is used by Tcl_RegExpExecObj to
+     * optionally do a fast match (avoids RE engine).
      */
 
-    if (TclReToGlob(NULL, string, length, &stringBuf, &exact) == TCL_OK) {
-	regexpPtr->globObjPtr = Tcl_NewStringObj(Tcl_DStringValue(&stringBuf),
-		Tcl_DStringLength(&stringBuf));
+    if (cachePtr->glob != NULL) {
+	regexpPtr->globObjPtr =
+		Tcl_NewStringObj(cachePtr->glob, cachePtr->globLength);
 	Tcl_IncrRefCount(regexpPtr->globObjPtr);
-	Tcl_DStringFree(&stringBuf);
     } else {
 	regexpPtr->globObjPtr = NULL;
     }
@@ -1017,7 +1088,8 @@ static void
 FreeRegexp(
     TclRegexp *regexpPtr)	/* Compiled regular expression to free. */
 {
-    TclReFree(&regexpPtr->re);
+    TclReFreeCache(&regexpPtr->re);
+    ReleaseRegexpCacheEntry(regexpPtr->cachePtr);
     if (regexpPtr->globObjPtr) {
 	TclDecrRefCount(regexpPtr->globObjPtr);
     }
@@ -1067,6 +1139,533 @@ FinalizeRegexp(
 
     tsdPtr->initialized = 0;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitRegexpCache --
+ *
+ *	Initializes the process-wide regexp cache, taking its size limit from
+ *	the TCL_REGEXP_CACHE_SIZE environment variable if set. Must be called
+ *	with regexpCacheMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InitRegexpCache(void)
+{
+    Tcl_DString ds;
+    const char *limit = TclGetEnv("TCL_REGEXP_CACHE_SIZE", &ds);
+
+    regexpCache.limit = REGEXP_CACHE_SIZE;
+    if (limit != NULL) {
+	regexpCache.limit = (size_t) strtoul(limit, NULL, 10);
+	Tcl_DStringFree(&ds);
+    }
+    Tcl_InitCustomHashTable(&regexpCache.table, TCL_CUSTOM_TYPE_KEYS,
+	    &regexpCacheKeyType);
+    regexpCache.initialized = 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetRegexpCacheEntry --
+ *
+ *	Finds the compiled form of a regexp pattern in the process-wide cache,
+ *	compiling the pattern and adding it to the cache if it is not there.
+ *
+ * Results:
+ *	The return value is the cache entry, with a reference held for the
+ *	caller, or NULL if the pattern could not be compiled. If NULL is
+ *	returned, an error message is left in the interp's result.
+ *
+ * Side effects:
+ *	May compile the pattern and evict unused entries from the cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RegexpCacheEntry *
+GetRegexpCacheEntry(
+    Tcl_Interp *interp,		/* Used for error reporting if not NULL. */
+    const char *string,		/* The regexp to compile (UTF-8). */
+    int length,			/* The length of the string in bytes. */
+    int flags)			/* Compilation flags. */
+{
+    RegexpCacheKey key;
+    RegexpCacheEntry *cachePtr, *otherPtr;
+    Tcl_HashEntry *hPtr;
+    const Tcl_UniChar *uniString;
+    int numChars, status, exact, isNew, i, fold;
+    Tcl_DString stringBuf;
+
+    key.flags = flags;
+    key.length = length;
+    key.pattern = string;
+
+    Tcl_MutexLock(&regexpCacheMutex);
+    if (!regexpCache.initialized) {
+	InitRegexpCache();
+    }
+    hPtr = Tcl_FindHashEntry(&regexpCache.table, (char *) &key);
+    if (hPtr != NULL) {
+	cachePtr = Tcl_GetHashValue(hPtr);
+	if (cachePtr->refCount++ == 0) {
+	    TclSpliceOut(cachePtr, regexpCache.unusedPtr);
+	    if (regexpCache.lastUnusedPtr == cachePtr) {
+		regexpCache.lastUnusedPtr = cachePtr->prevPtr;
+	    }
+	}
+	Tcl_MutexUnlock(&regexpCacheMutex);
+	return cachePtr;
+    }
+    Tcl_MutexUnlock(&regexpCacheMutex);
+
+    /*
+     * Map the pattern to unicode and compile it, outside of the lock.
+     */
+
+    cachePtr = (RegexpCacheEntry *) ckalloc(sizeof(RegexpCacheEntry));
+    Tcl_DStringInit(&stringBuf);
+    uniString = Tcl_UtfToUniCharDString(string, length, &stringBuf);
+    numChars = Tcl_DStringLength(&stringBuf) / sizeof(Tcl_UniChar);
+    status = TclReComp(&cachePtr->re, uniString, (size_t) numChars, flags);
+    Tcl_DStringFree(&stringBuf);
+
+    if (status != REG_OKAY) {
+	/*
+	 * Clean up and report errors in the interpreter, if possible.
+	 */
+
+	ckfree((char *) cachePtr);
+	if (interp) {
+	    TclRegError(interp,
+		    "couldn't compile regular expression pattern: ", status);
+	}
+	return NULL;
+    }
+
+    /*
+     * Convert RE to a glob pattern equivalent, if any, and keep it too.
+     */
+
+    if (TclReToGlob(NULL, string, length, &stringBuf, &exact) == TCL_OK) {
+	cachePtr->globLength = Tcl_DStringLength(&stringBuf);
+	cachePtr->glob = ckalloc((unsigned) cachePtr->globLength + 1);
+	memcpy(cachePtr->glob, Tcl_DStringValue(&stringBuf),
+		(unsigned) cachePtr->globLength + 1);
+	Tcl_DStringFree(&stringBuf);
+    } else {
+	cachePtr->glob = NULL;
+	cachePtr->globLength = 0;
+    }
+
+    /*
+     * Keep the string that every match contains in UTF-8 as well, when it is
+     * ASCII, as text without it can be rejected without converting it to
+     * Unicode. ASCII chars are only ever encoded as themselves.
+     */
+
+    cachePtr->must = NULL;
+    cachePtr->mustLength = 0;
+    cachePtr->mustNocase = 0;
+    numChars = (int) TclReMust(&cachePtr->re, &uniString, &fold);
+    for (i = 0; i < numChars; i++) {
+	if (uniString[i] == 0 || uniString[i] >= 0x80) {
+	    break;
+	}
+    }
+    if (numChars > 0 && i == numChars) {
+	cachePtr->must = ckalloc((unsigned) numChars);
+	for (i = 0; i < numChars; i++) {
+	    cachePtr->must[i] = (char) uniString[i];
+	}
+	cachePtr->mustLength = numChars;
+	cachePtr->mustNocase = fold;
+    }
+    cachePtr->size = sizeof(RegexpCacheEntry) + TclReSize(&cachePtr->re)
+	    + sizeof(Tcl_HashEntry) + length + cachePtr->globLength
+	    + cachePtr->mustLength;
+    cachePtr->refCount = 1;
+
+    /*
+     * Another thread may have added the same pattern meanwhile; use its
+     * entry then.
+     */
+
+    Tcl_MutexLock(&regexpCacheMutex);
+    hPtr = Tcl_CreateHashEntry(&regexpCache.table, (char *) &key, &isNew);
+    if (!isNew) {
+	otherPtr = Tcl_GetHashValue(hPtr);
+	if (otherPtr->refCount++ == 0) {
+	    TclSpliceOut(otherPtr, regexpCache.unusedPtr);
+	    if (regexpCache.lastUnusedPtr == otherPtr) {
+		regexpCache.lastUnusedPtr = otherPtr->prevPtr;
+	    }
+	}
+	Tcl_MutexUnlock(&regexpCacheMutex);
+	FreeRegexpCacheEntry(cachePtr);
+	return otherPtr;
+    }
+    cachePtr->hPtr = hPtr;
+    Tcl_SetHashValue(hPtr, cachePtr);
+    regexpCache.size += cachePtr->size;
+    EvictRegexpCacheEntries();
+    Tcl_MutexUnlock(&regexpCacheMutex);
+    return cachePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HasMust --
+ *
+ *	Looks for the string that every match of a regexp contains in some
+ *	UTF-8 text.
+ *
+ * Results:
+ *	Non-zero if the text contains the string.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+HasMust(
+    RegexpCacheEntry *cachePtr,	/* Regexp with a must string. */
+    const char *bytes,		/* The text. */
+    int length)			/* Number of bytes in the text. */
+{
+    const char *must = cachePtr->must;
+    int n = cachePtr->mustLength;
+    const char *p, *last = bytes + length - n;
+    int i;
+    char c;
+
+    if (!cachePtr->mustNocase) {
+	/*
+	 * Let memchr() skip to the candidates.
+	 */
+
+	for (p = bytes; p <= last; p++) {
+	    p = memchr(p, must[0], (size_t) (last - p + 1));
+	    if (p == NULL) {
+		return 0;
+	    }
+	    if (memcmp(p + 1, must + 1, (size_t) (n - 1)) == 0) {
+		return 1;
+	    }
+	}
+	return 0;
+    }
+
+    for (p = bytes; p <= last; p++) {
+	for (i = 0; i < n; i++) {
+	    c = p[i];
+	    if (c >= 'A' && c <= 'Z') {
+		c += 'a' - 'A';
+	    }
+	    if (c != must[i]) {
+		break;
+	    }
+	}
+	if (i == n) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseRegexpCacheEntry --
+ *
+ *	Drops a reference to an entry of the process-wide regexp cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	An entry no longer used becomes the most recently released unused
+ *	entry, and unused entries may be evicted from the cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseRegexpCacheEntry(
+    RegexpCacheEntry *cachePtr)	/* Entry to release. */
+{
+    Tcl_MutexLock(&regexpCacheMutex);
+    if (--cachePtr->refCount > 0) {
+	Tcl_MutexUnlock(&regexpCacheMutex);
+	return;
+    }
+    if (cachePtr->hPtr == NULL) {
+	/*
+	 * The cache has been finalized.
+	 */
+
+	Tcl_MutexUnlock(&regexpCacheMutex);
+	FreeRegexpCacheEntry(cachePtr);
+	return;
+    }
+    TclSpliceIn(cachePtr, regexpCache.unusedPtr);
+    if (regexpCache.lastUnusedPtr == NULL) {
+	regexpCache.lastUnusedPtr = cachePtr;
+    }
+    EvictRegexpCacheEntries();
+    Tcl_MutexUnlock(&regexpCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EvictRegexpCacheEntries --
+ *
+ *	Frees the least recently released unused entries of the process-wide
+ *	regexp cache while the cache is over its size limit. Must be called
+ *	with regexpCacheMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees cache entries.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+EvictRegexpCacheEntries(void)
+{
+    RegexpCacheEntry *cachePtr;
+
+    while ((regexpCache.size > regexpCache.limit)
+	    && (regexpCache.lastUnusedPtr != NULL)) {
+	cachePtr = regexpCache.lastUnusedPtr;
+	regexpCache.lastUnusedPtr = cachePtr->prevPtr;
+	TclSpliceOut(cachePtr, regexpCache.unusedPtr);
+	Tcl_DeleteHashEntry(cachePtr->hPtr);
+	regexpCache.size -= cachePtr->size;
+	FreeRegexpCacheEntry(cachePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeRegexpCacheEntry --
+ *
+ *	Release the storage associated with an entry of the process-wide
+ *	regexp cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeRegexpCacheEntry(
+    RegexpCacheEntry *cachePtr)	/* Entry to free. */
+{
+    TclReFree(&cachePtr->re);
+    if (cachePtr->glob != NULL) {
+	ckfree(cachePtr->glob);
+    }
+    if (cachePtr->must != NULL) {
+	ckfree(cachePtr->must);
+    }
+    ckfree((char *) cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRegexpCacheObjCmd --
+ *
+ *	Implements the "::tcl::unsupported::regexpcache ?limit?" command,
+ *	which reports on the process-wide regexp cache and optionally changes
+ *	its size limit.
+ *
+ * Results:
+ *	A standard Tcl result: the number of entries in the cache, their
+ *	estimated size and the size limit, in bytes.
+ *
+ * Side effects:
+ *	Setting a lower limit evicts unused entries.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclRegexpCacheObjCmd(
+    ClientData clientData,	/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tcl_WideInt limit;
+    Tcl_Obj *resultObjs[3];
+
+    if (objc > 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?limit?");
+	return TCL_ERROR;
+    }
+    if (objc == 2) {
+	if (Tcl_IsSafe(interp)) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "permission denied: safe interpreters cannot change the "
+		    "regexp cache size", -1));
+	    return TCL_ERROR;
+	}
+	if (Tcl_GetWideIntFromObj(interp, objv[1], &limit) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (limit < 0) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "regexp cache size must be >= 0", -1));
+	    return TCL_ERROR;
+	}
+    }
+
+    Tcl_MutexLock(&regexpCacheMutex);
+    if (!regexpCache.initialized) {
+	InitRegexpCache();
+    }
+    if (objc == 2) {
+	regexpCache.limit = (size_t) limit;
+	EvictRegexpCacheEntries();
+    }
+    resultObjs[0] = Tcl_NewIntObj(regexpCache.table.numEntries);
+    resultObjs[1] = Tcl_NewWideIntObj((Tcl_WideInt) regexpCache.size);
+    resultObjs[2] = Tcl_NewWideIntObj((Tcl_WideInt) regexpCache.limit);
+    Tcl_MutexUnlock(&regexpCacheMutex);
+
+    Tcl_SetObjResult(interp, Tcl_NewListObj(3, resultObjs));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeRegexpCache --
+ *
+ *	Release the storage associated with the process-wide regexp cache.
+ *	Entries still in use are freed when released.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeRegexpCache(void)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    RegexpCacheEntry *cachePtr;
+
+    Tcl_MutexLock(&regexpCacheMutex);
+    if (regexpCache.initialized) {
+	for (hPtr = Tcl_FirstHashEntry(&regexpCache.table, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    cachePtr = Tcl_GetHashValue(hPtr);
+	    cachePtr->hPtr = NULL;
+	    if (cachePtr->refCount == 0) {
+		FreeRegexpCacheEntry(cachePtr);
+	    }
+	}
+	Tcl_DeleteHashTable(&regexpCache.table);
+	regexpCache.unusedPtr = NULL;
+	regexpCache.lastUnusedPtr = NULL;
+	regexpCache.size = 0;
+	regexpCache.initialized = 0;
+    }
+    Tcl_MutexUnlock(&regexpCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashRegexpCacheKey, CompareRegexpCacheKeys, AllocRegexpCacheKey --
+ *
+ *	Hash key procedures of the process-wide regexp cache, whose keys are
+ *	RegexpCacheKeys. The table entries hold a copy of the pattern.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned
+HashRegexpCacheKey(
+    Tcl_HashTable *tablePtr,	/* Hash table. */
+    void *keyPtr)		/* Key from which to compute hash value. */
+{
+    RegexpCacheKey *cacheKeyPtr = keyPtr;
+    const char *p = cacheKeyPtr->pattern;
+    unsigned result = (unsigned) cacheKeyPtr->flags;
+    int i;
+
+    for (i = 0; i < cacheKeyPtr->length; i++) {
+	result += (result << 3) + UCHAR(p[i]);
+    }
+    return result;
+}
+
+static int
+CompareRegexpCacheKeys(
+    void *keyPtr,		/* New key to compare. */
+    Tcl_HashEntry *hPtr)	/* Existing key to compare. */
+{
+    RegexpCacheKey *key1Ptr = keyPtr;
+    RegexpCacheKey *key2Ptr = (RegexpCacheKey *) hPtr->key.string;
+
+    return (key1Ptr->flags == key2Ptr->flags)
+	    && (key1Ptr->length == key2Ptr->length)
+	    && (memcmp(key1Ptr->pattern, key2Ptr->pattern,
+		    (size_t) key1Ptr->length) == 0);
+}
+
+static Tcl_HashEntry *
+AllocRegexpCacheKey(
+    Tcl_HashTable *tablePtr,	/* Hash table. */
+    void *keyPtr)		/* Key to store in the hash table entry. */
+{
+    RegexpCacheKey *cacheKeyPtr = keyPtr, *copyPtr;
+    Tcl_HashEntry *hPtr;
+    char *pattern;
+
+    hPtr = (Tcl_HashEntry *) ckalloc(TclOffset(Tcl_HashEntry, key)
+	    + sizeof(RegexpCacheKey) + cacheKeyPtr->length + 1);
+    copyPtr = (RegexpCacheKey *) hPtr->key.string;
+    pattern = (char *) (copyPtr + 1);
+    memcpy(pattern, cacheKeyPtr->pattern, (size_t) cacheKeyPtr->length);
+    pattern[cacheKeyPtr->length] = '\0';
+    copyPtr->flags = cacheKeyPtr->flags;
+    copyPtr->length = cacheKeyPtr->length;
+    copyPtr->pattern = pattern;
+    hPtr->clientData = NULL;
+    return hPtr;
+}
 
 /*
  * Local Variables:
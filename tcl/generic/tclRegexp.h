@@ -29,7 +29,13 @@
 typedef struct TclRegexp {
     int flags;			/* Regexp compile flags. */
     regex_t re;			/* Compiled re, includes number of
-				 * subexpressions. */
+				 * subexpressions. A copy of the one in
+				 * cachePtr, which owns the compiled
+				 * form. */
+    struct RegexpCacheEntry *cachePtr;
+				/* Entry of the process-wide cache of
+				 * compiled regexps that this regexp
+				 * holds a reference to. */
     const char *string;		/* Last string passed to Tcl_RegExpExec. */
     Tcl_Obj *objPtr;		/* Last object passed to Tcl_RegExpExecObj. */
     Tcl_Obj *globObjPtr;	/* Glob pattern rep of RE or NULL if none. */
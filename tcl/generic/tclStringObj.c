@@ -46,6 +46,39 @@
  */
 #define COMPAT 0
 
+/*
+ * The following structures are the internal rep of a "rope": a long string
+ * under construction by appends, held as a sequence of chunks so that an
+ * append does not have to copy what is already there (nor, when the appended
+ * value is itself large, the appended text). Each chunk is a Tcl_Obj holding
+ * part of the text in its string rep. A rope has no string rep of its own
+ * until one is asked for; generating it concatenates the chunks and turns
+ * the value back into an ordinary String. Length, index and range
+ * operations binary search the chunks and never need the string rep.
+ */
+
+typedef struct RopeChunk {
+    Tcl_Obj *objPtr;		/* Holds the text of this chunk. */
+    int byteEnd;		/* Number of bytes in this and all earlier
+				 * chunks. */
+    int charEnd;		/* Number of chars in this and all earlier
+				 * chunks. Only valid when the numChars field
+				 * of the rope is not -1. */
+} RopeChunk;
+
+typedef struct Rope {
+    int numChars;		/* The number of chars in the rope. -1 means
+				 * this value has not been calculated. */
+    int numChunks;		/* Number of chunks in use. */
+    int maxChunks;		/* Number of chunks allocated. */
+    int tailOwned;		/* Boolean determining whether the object of
+				 * the last chunk was made by the rope itself,
+				 * so small appends may be added to it. */
+    RopeChunk chunks[1];	/* The array of chunks. The actual size of
+				 * this field depends on the 'maxChunks' field
+				 * above. */
+} Rope;
+
 /*
  * Prototypes for functions defined later in this file:
  */
@@ -60,6 +93,12 @@ static void		AppendUtfToUnicodeRep(Tcl_Obj *objPtr,
 			    const char *bytes, int numBytes);
 static void		AppendUtfToUtfRep(Tcl_Obj *objPtr,
 			    const char *bytes, int numBytes);
+static void		AppendToRope(Tcl_Obj *objPtr, Tcl_Obj *appendObjPtr,
+			    const char *bytes, int numBytes);
+static int		ChunkNumChars(Tcl_Obj *objPtr);
+static void		CountRopeChars(Rope *ropePtr);
+static void		DupRopeInternalRep(Tcl_Obj *objPtr,
+			    Tcl_Obj *copyPtr);
 static void		DupStringInternalRep(Tcl_Obj *objPtr,
 			    Tcl_Obj *copyPtr);
 static int		ExtendStringRepWithUnicode(Tcl_Obj *objPtr,
@@ -67,15 +106,23 @@ static int		ExtendStringRepWithUnicode(Tcl_Obj *objPtr,
 static void		ExtendUnicodeRepWithString(Tcl_Obj *objPtr,
 			    const char *bytes, int numBytes,
 			    int numAppendChars);
+static void		ExtendUtfIndex(Tcl_Obj *objPtr);
 static void		FillUnicodeRep(Tcl_Obj *objPtr);
+static int		FindRopeChunk(Rope *ropePtr, int index);
+static void		FreeRopeInternalRep(Tcl_Obj *objPtr);
 static void		FreeStringInternalRep(Tcl_Obj *objPtr);
+static Tcl_Obj *	GetRopeRange(Tcl_Obj *objPtr, int first, int last);
 static void		GrowStringBuffer(Tcl_Obj *objPtr, int needed, int flag);
 static void		GrowUnicodeBuffer(Tcl_Obj *objPtr, int needed);
 static int		SetStringFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
 static void		SetUnicodeObj(Tcl_Obj *objPtr,
 			    const Tcl_UniChar *unicode, int numChars);
+static int		ShouldBecomeRope(Tcl_Obj *objPtr, int numBytes);
+static void		StartRope(Tcl_Obj *objPtr);
 static int		UnicodeLength(const Tcl_UniChar *unicode);
+static void		UpdateStringOfRope(Tcl_Obj *objPtr);
 static void		UpdateStringOfString(Tcl_Obj *objPtr);
+static const char *	UtfAtCharIndex(Tcl_Obj *objPtr, int index);
 
 /*
  * The structure below defines the string Tcl object type by means of
@@ -90,6 +137,20 @@ const Tcl_ObjType tclStringType = {
     SetStringFromAny		/* setFromAnyProc */
 };
 
+/*
+ * The rope type is private to this file. Values only become ropes by being
+ * appended to, and lose the type as soon as anything needs their string rep,
+ * so there is no setFromAnyProc.
+ */
+
+static const Tcl_ObjType ropeType = {
+    "rope",			/* name */
+    FreeRopeInternalRep,	/* freeIntRepPro */
+    DupRopeInternalRep,		/* dupIntRepProc */
+    UpdateStringOfRope,		/* updateStringProc */
+    NULL			/* setFromAnyProc */
+};
+
 /*
  * The following structure is the internal rep for a String object. It keeps
  * track of how much memory has been used and how much has been allocated for
@@ -104,6 +165,28 @@ const Tcl_ObjType tclStringType = {
  * tcl.h, but do not do that unless you are sure what you're doing!
  */
 
+/*
+ * Long strings with multi-byte chars are indexed without their Unicode rep,
+ * which takes two bytes for every char, through a sparse index of their UTF
+ * rep holding the byte offset of every UTF_INDEX_STEP'th char: finding a
+ * char then decodes fewer than UTF_INDEX_STEP chars. Strings shorter than
+ * UTF_INDEX_MIN bytes still get a Unicode rep.
+ */
+
+typedef struct UtfIndex {
+    int numOffsets;		/* Number of offsets computed. */
+    int maxOffsets;		/* Number of offsets allocated. */
+    int offsets[1];		/* Byte offset of char i*UTF_INDEX_STEP, for
+				 * i < numOffsets. The actual size of this
+				 * field depends on the 'maxOffsets' field
+				 * above. */
+} UtfIndex;
+
+#define UTF_INDEX_STEP	32
+#define UTF_INDEX_MIN	256
+#define UTF_INDEX_SIZE(maxOffsets) \
+	(sizeof(UtfIndex) + ((maxOffsets) - 1) * sizeof(int))
+
 typedef struct String {
     int numChars;		/* The number of chars in the string. -1 means
 				 * this value has not been calculated. >= 0
@@ -117,6 +200,11 @@ typedef struct String {
 				 * space allocated for the unicode array. */
     int hasUnicode;		/* Boolean determining whether the string has
 				 * a Unicode representation. */
+    UtfIndex *utfIndexPtr;	/* Sparse index of the UTF rep, or NULL. Only
+				 * used without a Unicode rep. Appends to the
+				 * UTF rep leave it valid for the chars it
+				 * already covers; anything else that changes
+				 * the UTF rep frees it. */
     Tcl_UniChar unicode[1];	/* The array of Unicode chars. The actual size
 				 * of this field depends on the 'maxChars'
 				 * field above. */
@@ -138,11 +226,27 @@ typedef struct String {
 #define stringAttemptRealloc(ptr, numChars) \
 	(String *) attemptckrealloc((char *) ptr, \
 		(unsigned) STRING_SIZE(numChars) )
+#define stringFreeUtfIndex(stringPtr) \
+    if ((stringPtr)->utfIndexPtr != NULL) { \
+	ckfree((char *) (stringPtr)->utfIndexPtr); \
+	(stringPtr)->utfIndexPtr = NULL; \
+    }
 #define GET_STRING(objPtr) \
 	((String *) (objPtr)->internalRep.otherValuePtr)
 #define SET_STRING(objPtr, stringPtr) \
 	((objPtr)->internalRep.otherValuePtr = (void *) (stringPtr))
 
+#define ROPE_SIZE(maxChunks) \
+	(sizeof(Rope) + ((maxChunks) - 1) * sizeof(RopeChunk))
+#define GET_ROPE(objPtr) \
+	((Rope *) (objPtr)->internalRep.otherValuePtr)
+#define SET_ROPE(objPtr, ropePtr) \
+	((objPtr)->internalRep.otherValuePtr = (void *) (ropePtr))
+#define ROPE_NUM_BYTES(ropePtr) \
+	((ropePtr)->chunks[(ropePtr)->numChunks - 1].byteEnd)
+#define ROPE_START_CHAR(ropePtr, i) \
+	((i) ? (ropePtr)->chunks[(i) - 1].charEnd : 0)
+
 /*
  * TCL STRING GROWTH ALGORITHM
  *
@@ -181,6 +285,33 @@ typedef struct String {
 #define TCL_GROWTH_MIN_ALLOC	1024
 #endif
 
+/*
+ * TCL ROPE PARAMETERS
+ *
+ * Growing one contiguous buffer means that a string built by many appends is
+ * copied again each time the buffer doubles, and that appending a large
+ * value always copies it. Once a string is long enough that this matters,
+ * an append that would have to grow its buffer turns it into a rope instead
+ * (see above); the string rep is only rebuilt when somebody asks for it.
+ *
+ * TCL_ROPE_MIN_LENGTH		Length, in bytes, that a string must have
+ *				before it may become a rope. Default is 65536
+ *				(64 kilobytes). Define as INT_MAX to disable
+ *				ropes altogether.
+ * ROPE_CHUNK_SIZE		Small appends to a rope are gathered into
+ *				chunks of up to this many bytes.
+ * ROPE_SHARE_MIN		Appended values at least this many bytes long
+ *				become chunks of the rope themselves, and so
+ *				are not copied.
+ */
+
+#ifndef TCL_ROPE_MIN_LENGTH
+#define TCL_ROPE_MIN_LENGTH	65536
+#endif
+#define ROPE_CHUNK_SIZE		16384
+#define ROPE_SHARE_MIN		1024
+#define ROPE_INIT_CHUNKS	8
+
 static void
 GrowStringBuffer(
     Tcl_Obj *objPtr,
@@ -466,6 +597,19 @@ Tcl_GetCharLength(
 	return length;
     }
 
+    /*
+     * A rope knows its length without a string rep.
+     */
+
+    if (objPtr->typePtr == &ropeType) {
+	Rope *ropePtr = GET_ROPE(objPtr);
+
+	if (ropePtr->numChars == -1) {
+	    CountRopeChars(ropePtr);
+	}
+	return ropePtr->numChars;
+    }
+
     /*
      * OK, need to work with the object as a string.
      */
@@ -531,6 +675,22 @@ Tcl_GetUniChar(
 	return (Tcl_UniChar) bytes[index];
     }
 
+    /*
+     * Index into a rope by finding the chunk that holds the character.
+     */
+
+    if (objPtr->typePtr == &ropeType) {
+	Rope *ropePtr = GET_ROPE(objPtr);
+	int i;
+
+	if (ropePtr->numChars == -1) {
+	    CountRopeChars(ropePtr);
+	}
+	i = FindRopeChunk(ropePtr, index);
+	return Tcl_GetUniChar(ropePtr->chunks[i].objPtr,
+		index - ROPE_START_CHAR(ropePtr, i));
+    }
+
     /*
      * OK, need to work with the object as a string.
      */
@@ -546,6 +706,12 @@ Tcl_GetUniChar(
 	if (stringPtr->numChars == objPtr->length) {
 	    return (Tcl_UniChar) objPtr->bytes[index];
 	}
+	if (objPtr->length >= UTF_INDEX_MIN) {
+	    Tcl_UniChar ch;
+
+	    TclUtfToUniChar(UtfAtCharIndex(objPtr, index), &ch);
+	    return ch;
+	}
 	FillUnicodeRep(objPtr);
 	stringPtr = GET_STRING(objPtr);
     }
@@ -662,6 +828,10 @@ Tcl_GetRange(
 	return Tcl_NewByteArrayObj(bytes+first, last-first+1);
     }
 
+    if (objPtr->typePtr == &ropeType) {
+	return GetRopeRange(objPtr, first, last);
+    }
+
     /*
      * OK, need to work with the object as a string.
      */
@@ -683,6 +853,16 @@ Tcl_GetRange(
 	    stringPtr->numChars = newObjPtr->length;
 	    return newObjPtr;
 	}
+	if (objPtr->length >= UTF_INDEX_MIN) {
+	    const char *start = UtfAtCharIndex(objPtr, first);
+	    const char *end = Tcl_UtfAtIndex(start, last-first+1);
+
+	    newObjPtr = Tcl_NewStringObj(start, end - start);
+	    SetStringFromAny(NULL, newObjPtr);
+	    stringPtr = GET_STRING(newObjPtr);
+	    stringPtr->numChars = last-first+1;
+	    return newObjPtr;
+	}
 	FillUnicodeRep(objPtr);
 	stringPtr = GET_STRING(objPtr);
     }
@@ -821,6 +1001,7 @@ Tcl_SetObjLength(
 
 	stringPtr->numChars = -1;
 	stringPtr->hasUnicode = 0;
+	stringFreeUtfIndex(stringPtr);
     } else {
 	/*
 	 * Changing length of pure unicode string.
@@ -926,6 +1107,7 @@ Tcl_AttemptSetObjLength(
 
 	stringPtr->numChars = -1;
 	stringPtr->hasUnicode = 0;
+	stringFreeUtfIndex(stringPtr);
     } else {
 	/*
 	 * Changing length of pure unicode string.
@@ -1030,6 +1212,7 @@ SetUnicodeObj(
     stringPtr->unicode[numChars] = 0;
     stringPtr->numChars = numChars;
     stringPtr->hasUnicode = 1;
+    stringPtr->utfIndexPtr = NULL;
 
     TclInvalidateStringRep(objPtr);
     stringPtr->allocated = 0;
@@ -1090,6 +1273,16 @@ Tcl_AppendLimitedToObj(
 	toCopy = Tcl_UtfPrev(bytes+limit+1-strlen(ellipsis), bytes) - bytes;
     }
 
+    /*
+     * Whole appends to a long string go to (or start) a rope. Truncated ones
+     * are rare enough to not be worth it.
+     */
+
+    if (length <= limit && objPtr->typePtr == &ropeType) {
+	AppendToRope(objPtr, NULL, bytes, length);
+	return;
+    }
+
     /*
      * If objPtr has a valid Unicode rep, then append the Unicode conversion
      * of "bytes" to the objPtr's Unicode rep, otherwise append "bytes" to
@@ -1099,6 +1292,12 @@ Tcl_AppendLimitedToObj(
     SetStringFromAny(NULL, objPtr);
     stringPtr = GET_STRING(objPtr);
 
+    if (length <= limit && ShouldBecomeRope(objPtr, length)) {
+	StartRope(objPtr);
+	AppendToRope(objPtr, NULL, bytes, length);
+	return;
+    }
+
     if (stringPtr->hasUnicode && stringPtr->numChars > 0) {
 	AppendUtfToUnicodeRep(objPtr, bytes, toCopy);
     } else {
@@ -1265,6 +1464,16 @@ Tcl_AppendObjToObj(
 	return;
     }
 
+    /*
+     * Appending to a rope never needs its string rep. Appending a rope to
+     * itself does, so that case flattens it below.
+     */
+
+    if (objPtr->typePtr == &ropeType && appendObjPtr != objPtr) {
+	AppendToRope(objPtr, appendObjPtr, NULL, -1);
+	return;
+    }
+
     /*
      * Must append as strings.
      */
@@ -1306,6 +1515,12 @@ Tcl_AppendObjToObj(
 
     bytes = TclGetStringFromObj(appendObjPtr, &length);
 
+    if (appendObjPtr != objPtr && ShouldBecomeRope(objPtr, length)) {
+	StartRope(objPtr);
+	AppendToRope(objPtr, appendObjPtr, NULL, -1);
+	return;
+    }
+
     numChars = stringPtr->numChars;
     if ((numChars >= 0) && (appendObjPtr->typePtr == &tclStringType)) {
 	String *appendStringPtr = GET_STRING(appendObjPtr);
@@ -1558,6 +1773,311 @@ AppendUtfToUtfRep(
     objPtr->length = newLength;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ShouldBecomeRope --
+ *
+ *	Decides whether an append of numBytes bytes to a "String" object
+ *	should turn it into a rope rather than grow its buffer.
+ *
+ * Results:
+ *	1 if the object should become a rope, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ShouldBecomeRope(
+    Tcl_Obj *objPtr,		/* String object about to be appended to. */
+    int numBytes)		/* Number of bytes about to be appended. */
+{
+    String *stringPtr = GET_STRING(objPtr);
+
+    return (objPtr->bytes != NULL) && !stringPtr->hasUnicode
+	    && (objPtr->length >= TCL_ROPE_MIN_LENGTH)
+	    && (numBytes > stringPtr->allocated - objPtr->length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StartRope --
+ *
+ *	Converts a "String" object into a rope whose only chunk holds the
+ *	current value. The string buffer is handed over to the chunk, not
+ *	copied.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The object becomes a rope and loses its string rep.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StartRope(
+    Tcl_Obj *objPtr)		/* String object to convert. */
+{
+    String *stringPtr = GET_STRING(objPtr);
+    Rope *ropePtr = (Rope *) ckalloc(ROPE_SIZE(ROPE_INIT_CHUNKS));
+    Tcl_Obj *leafPtr;
+
+    TclNewObj(leafPtr);
+    leafPtr->bytes = objPtr->bytes;
+    leafPtr->length = objPtr->length;
+    SET_STRING(leafPtr, stringPtr);
+    leafPtr->typePtr = &tclStringType;
+    Tcl_IncrRefCount(leafPtr);
+
+    ropePtr->numChars = stringPtr->numChars;
+    ropePtr->numChunks = 1;
+    ropePtr->maxChunks = ROPE_INIT_CHUNKS;
+    ropePtr->tailOwned = 0;
+    ropePtr->chunks[0].objPtr = leafPtr;
+    ropePtr->chunks[0].byteEnd = leafPtr->length;
+    ropePtr->chunks[0].charEnd = stringPtr->numChars;
+
+    objPtr->bytes = NULL;
+    objPtr->length = 0;
+    SET_ROPE(objPtr, ropePtr);
+    objPtr->typePtr = &ropeType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendToRope --
+ *
+ *	Appends either the value of appendObjPtr or, if that is NULL, the
+ *	numBytes bytes at bytes to a rope. Large values are added as chunks
+ *	of their own; smaller ones are copied into the last chunk if the rope
+ *	made it, or into a new chunk otherwise.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The rope grows, and may take a reference to appendObjPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendToRope(
+    Tcl_Obj *objPtr,		/* Rope to append to. */
+    Tcl_Obj *appendObjPtr,	/* Object to append, or NULL. */
+    const char *bytes,		/* Bytes to append if appendObjPtr is
+				 * NULL. */
+    int numBytes)		/* Number of bytes at bytes. */
+{
+    Rope *ropePtr = GET_ROPE(objPtr);
+    RopeChunk *chunkPtr = &ropePtr->chunks[ropePtr->numChunks - 1];
+    Tcl_Obj *leafPtr;
+    int numChars, owned;
+
+    if (appendObjPtr != NULL) {
+	if (appendObjPtr->typePtr == &ropeType) {
+	    numBytes = ROPE_NUM_BYTES(GET_ROPE(appendObjPtr));
+	} else {
+	    bytes = TclGetStringFromObj(appendObjPtr, &numBytes);
+	}
+	if (numBytes >= ROPE_SHARE_MIN) {
+	    bytes = NULL;
+	}
+    }
+    if (numBytes == 0) {
+	return;
+    }
+    if (chunkPtr->byteEnd + numBytes < 0) {
+	Tcl_Panic("max size for a Tcl value (%d bytes) exceeded", INT_MAX);
+    }
+
+    if (bytes != NULL && ropePtr->tailOwned
+	    && chunkPtr->objPtr->refCount == 1
+	    && chunkPtr->byteEnd - (ropePtr->numChunks > 1 ?
+		    chunkPtr[-1].byteEnd : 0) + numBytes <= ROPE_CHUNK_SIZE) {
+	/*
+	 * Gather small appends in the last chunk.
+	 */
+
+	Tcl_AppendToObj(chunkPtr->objPtr, bytes, numBytes);
+	chunkPtr->byteEnd += numBytes;
+	if (ropePtr->numChars >= 0) {
+	    TclNumUtfChars(numChars, bytes, numBytes);
+	    chunkPtr->charEnd += numChars;
+	    ropePtr->numChars += numChars;
+	}
+	return;
+    }
+
+    if (bytes != NULL) {
+	leafPtr = Tcl_NewStringObj(bytes, numBytes);
+	owned = 1;
+    } else {
+	leafPtr = appendObjPtr;
+	owned = 0;
+    }
+    Tcl_IncrRefCount(leafPtr);
+
+    if (ropePtr->numChunks == ropePtr->maxChunks) {
+	ropePtr->maxChunks *= 2;
+	ropePtr = (Rope *) ckrealloc((char *) ropePtr,
+		ROPE_SIZE(ropePtr->maxChunks));
+	SET_ROPE(objPtr, ropePtr);
+    }
+    chunkPtr = &ropePtr->chunks[ropePtr->numChunks++];
+    chunkPtr->objPtr = leafPtr;
+    chunkPtr->byteEnd = chunkPtr[-1].byteEnd + numBytes;
+    if (ropePtr->numChars >= 0) {
+	numChars = ChunkNumChars(leafPtr);
+	chunkPtr->charEnd = chunkPtr[-1].charEnd + numChars;
+	ropePtr->numChars += numChars;
+    }
+    ropePtr->tailOwned = owned;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChunkNumChars, CountRopeChars --
+ *
+ *	ChunkNumChars returns the number of chars held by one chunk of a
+ *	rope. CountRopeChars fills in the char counts of all the chunks of a
+ *	rope and its total, which are not kept up to date until the first
+ *	time somebody needs them.
+ *
+ * Results:
+ *	ChunkNumChars returns a count; CountRopeChars returns nothing.
+ *
+ * Side effects:
+ *	May compute and cache the length of the chunks.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChunkNumChars(
+    Tcl_Obj *objPtr)		/* Object of the chunk to count. */
+{
+    const char *bytes;
+    int length, numChars;
+
+    if (objPtr->typePtr == &ropeType || objPtr->typePtr == &tclStringType) {
+	return Tcl_GetCharLength(objPtr);
+    }
+    bytes = TclGetStringFromObj(objPtr, &length);
+    TclNumUtfChars(numChars, bytes, length);
+    return numChars;
+}
+
+static void
+CountRopeChars(
+    Rope *ropePtr)		/* Rope to count the chars of. */
+{
+    int i, numChars = 0;
+
+    for (i = 0; i < ropePtr->numChunks; i++) {
+	numChars += ChunkNumChars(ropePtr->chunks[i].objPtr);
+	ropePtr->chunks[i].charEnd = numChars;
+    }
+    ropePtr->numChars = numChars;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindRopeChunk --
+ *
+ *	Binary searches a rope, whose chars must have been counted, for the
+ *	chunk holding a character.
+ *
+ * Results:
+ *	The index of the chunk holding the index'th char of the rope.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FindRopeChunk(
+    Rope *ropePtr,		/* Rope to search. */
+    int index)			/* Index of the char to find. */
+{
+    int lo = 0, hi = ropePtr->numChunks - 1;
+
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+
+	if (ropePtr->chunks[mid].charEnd > index) {
+	    hi = mid;
+	} else {
+	    lo = mid + 1;
+	}
+    }
+    return lo;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetRopeRange --
+ *
+ *	Implements Tcl_GetRange for a rope. A range within one chunk is taken
+ *	from that chunk; otherwise the result is assembled by appending the
+ *	chunks it spans, so that a long result is itself a rope sharing the
+ *	chunks in its middle.
+ *
+ * Results:
+ *	A new object, with a reference count of zero.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetRopeRange(
+    Tcl_Obj *objPtr,		/* Rope to take the range of. */
+    int first,			/* First index of the range. */
+    int last)			/* Last index of the range. */
+{
+    Rope *ropePtr = GET_ROPE(objPtr);
+    Tcl_Obj *newObjPtr, *pieceObjPtr;
+    int i, j, start;
+
+    if (ropePtr->numChars == -1) {
+	CountRopeChars(ropePtr);
+    }
+    i = FindRopeChunk(ropePtr, first);
+    j = FindRopeChunk(ropePtr, last);
+    start = ROPE_START_CHAR(ropePtr, i);
+    if (i == j) {
+	return Tcl_GetRange(ropePtr->chunks[i].objPtr, first - start,
+		last - start);
+    }
+
+    newObjPtr = Tcl_GetRange(ropePtr->chunks[i].objPtr, first - start,
+	    ropePtr->chunks[i].charEnd - 1 - start);
+    for (i++ ; i < j; i++) {
+	Tcl_AppendObjToObj(newObjPtr, ropePtr->chunks[i].objPtr);
+    }
+    pieceObjPtr = Tcl_GetRange(ropePtr->chunks[j].objPtr, 0,
+	    last - ROPE_START_CHAR(ropePtr, j));
+    Tcl_IncrRefCount(pieceObjPtr);
+    Tcl_AppendObjToObj(newObjPtr, pieceObjPtr);
+    Tcl_DecrRefCount(pieceObjPtr);
+    return newObjPtr;
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -2718,11 +3238,103 @@ ExtendUnicodeRepWithString(
 
     stringPtr->hasUnicode = 1;
     stringPtr->numChars = needed;
+    stringFreeUtfIndex(stringPtr);
     for (dst=stringPtr->unicode + numOrigChars; numAppendChars-- > 0; dst++) {
 	bytes += TclUtfToUniChar(bytes, dst);
     }
     *dst = 0;
 }
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * UtfAtCharIndex --
+ *
+ *	Finds a char in the UTF rep of a String object, using and completing
+ *	its sparse index. The object must have a String internal rep without
+ *	a Unicode rep, and its number of chars must be known.
+ *
+ * Results:
+ *	Returns a pointer to the first byte of the index'th char.
+ *
+ * Side effects:
+ *	May allocate or grow the UtfIndex of the object.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static const char *
+UtfAtCharIndex(
+    Tcl_Obj *objPtr,		/* The object to index. */
+    int index)			/* Index of a char of the object. */
+{
+    String *stringPtr = GET_STRING(objPtr);
+    int i = index / UTF_INDEX_STEP;
+
+    if (i == 0) {
+	return Tcl_UtfAtIndex(objPtr->bytes, index);
+    }
+    if ((stringPtr->utfIndexPtr == NULL)
+	    || (i >= stringPtr->utfIndexPtr->numOffsets)) {
+	ExtendUtfIndex(objPtr);
+    }
+    return Tcl_UtfAtIndex(objPtr->bytes + stringPtr->utfIndexPtr->offsets[i],
+	    index - i * UTF_INDEX_STEP);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * ExtendUtfIndex --
+ *
+ *	Computes the offsets of the sparse index of a String object up to its
+ *	last char, starting from the last offset already known.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Allocates or grows the UtfIndex of the object.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+ExtendUtfIndex(
+    Tcl_Obj *objPtr)		/* The object to index. */
+{
+    String *stringPtr = GET_STRING(objPtr);
+    UtfIndex *indexPtr = stringPtr->utfIndexPtr;
+    int i, needed = (stringPtr->numChars + UTF_INDEX_STEP - 1)
+	    / UTF_INDEX_STEP;
+
+    if (indexPtr == NULL) {
+	indexPtr = (UtfIndex *) ckalloc(UTF_INDEX_SIZE(needed));
+	indexPtr->numOffsets = 1;
+	indexPtr->maxOffsets = needed;
+	indexPtr->offsets[0] = 0;
+    } else if (needed > indexPtr->maxOffsets) {
+	int maxOffsets = 2 * indexPtr->maxOffsets;
+
+	if (maxOffsets < needed) {
+	    maxOffsets = needed;
+	}
+	indexPtr = (UtfIndex *) ckrealloc((char *) indexPtr,
+		UTF_INDEX_SIZE(maxOffsets));
+	indexPtr->maxOffsets = maxOffsets;
+    }
+    stringPtr->utfIndexPtr = indexPtr;
+
+    for (i = indexPtr->numOffsets; i < needed; i++) {
+	const char *bytes = objPtr->bytes + indexPtr->offsets[i-1];
+
+	indexPtr->offsets[i] = indexPtr->offsets[i-1]
+		+ (Tcl_UtfAtIndex(bytes, UTF_INDEX_STEP) - bytes);
+    }
+    if (indexPtr->numOffsets < needed) {
+	indexPtr->numOffsets = needed;
+    }
+}
 
 /*
  *----------------------------------------------------------------------
@@ -2781,6 +3393,7 @@ DupStringInternalRep(
     }
     copyStringPtr->hasUnicode = srcStringPtr->hasUnicode;
     copyStringPtr->numChars = srcStringPtr->numChars;
+    copyStringPtr->utfIndexPtr = NULL;
 
     /*
      * Tricky point: the string value was copied by generic object
@@ -2817,6 +3430,7 @@ DupStringInternalRep(
     }
     copyStringPtr->numChars = srcStringPtr->numChars;
     copyStringPtr->hasUnicode = srcStringPtr->hasUnicode;
+    copyStringPtr->utfIndexPtr = NULL;
 #endif
 
     SET_STRING(copyPtr, copyStringPtr);
@@ -2845,6 +3459,14 @@ SetStringFromAny(
     Tcl_Interp *interp,		/* Used for error reporting if not NULL. */
     Tcl_Obj *objPtr)		/* The object to convert. */
 {
+    if (objPtr->typePtr == &ropeType) {
+	/*
+	 * Generating the string rep of a rope leaves a String behind.
+	 */
+
+	(void) TclGetString(objPtr);
+	return TCL_OK;
+    }
     if (objPtr->typePtr != &tclStringType) {
 	String *stringPtr = stringAlloc(0);
 
@@ -2864,6 +3486,7 @@ SetStringFromAny(
 	stringPtr->allocated = objPtr->length;
 	stringPtr->maxChars = 0;
 	stringPtr->hasUnicode = 0;
+	stringPtr->utfIndexPtr = NULL;
 	SET_STRING(objPtr, stringPtr);
 	objPtr->typePtr = &tclStringType;
     }
@@ -2975,7 +3598,137 @@ static void
 FreeStringInternalRep(
     Tcl_Obj *objPtr)		/* Object with internal rep to free. */
 {
-    ckfree((char *) GET_STRING(objPtr));
+    String *stringPtr = GET_STRING(objPtr);
+
+    stringFreeUtfIndex(stringPtr);
+    ckfree((char *) stringPtr);
+    objPtr->typePtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupRopeInternalRep --
+ *
+ *	Initialize the internal representation of a new Tcl_Obj to a copy of
+ *	the internal representation of an existing rope object. The chunks
+ *	themselves are shared.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	copyPtr's internal rep is set to a copy of srcPtr's internal
+ *	representation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupRopeInternalRep(
+    Tcl_Obj *srcPtr,		/* Object with internal rep to copy. Must have
+				 * an internal rep of type "rope". */
+    Tcl_Obj *copyPtr)		/* Object with internal rep to set. Must not
+				 * currently have an internal rep.*/
+{
+    Rope *srcRopePtr = GET_ROPE(srcPtr);
+    Rope *copyRopePtr = (Rope *)
+	    ckalloc(ROPE_SIZE(srcRopePtr->maxChunks));
+    int i;
+
+    memcpy(copyRopePtr, srcRopePtr, ROPE_SIZE(srcRopePtr->numChunks));
+    copyRopePtr->maxChunks = srcRopePtr->maxChunks;
+    for (i = 0; i < copyRopePtr->numChunks; i++) {
+	Tcl_IncrRefCount(copyRopePtr->chunks[i].objPtr);
+    }
+    SET_ROPE(copyPtr, copyRopePtr);
+    copyPtr->typePtr = &ropeType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UpdateStringOfRope --
+ *
+ *	Generate the string representation of a rope by concatenating its
+ *	chunks. The object is then turned into an ordinary "String" whose
+ *	buffer has room to spare, so that further appends are cheap.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The object's string rep is set and its internal rep becomes a
+ *	"String".
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UpdateStringOfRope(
+    Tcl_Obj *objPtr)		/* Rope to flatten. */
+{
+    Rope *ropePtr = GET_ROPE(objPtr);
+    String *stringPtr = stringAlloc(0);
+    int i, length, numBytes = ROPE_NUM_BYTES(ropePtr);
+    int allocated = 2 * numBytes;
+    const char *bytes;
+    char *dst = NULL;
+
+    if (allocated > numBytes) {
+	dst = attemptckalloc((unsigned) allocated + 1);
+    }
+    if (dst == NULL) {
+	allocated = numBytes;
+	dst = ckalloc((unsigned) allocated + 1);
+    }
+    objPtr->bytes = dst;
+    objPtr->length = numBytes;
+    for (i = 0; i < ropePtr->numChunks; i++) {
+	bytes = TclGetStringFromObj(ropePtr->chunks[i].objPtr, &length);
+	memcpy(dst, bytes, length);
+	dst += length;
+    }
+    *dst = '\0';
+
+    stringPtr->numChars = ropePtr->numChars;
+    stringPtr->allocated = allocated;
+    stringPtr->maxChars = 0;
+    stringPtr->hasUnicode = 0;
+    stringPtr->utfIndexPtr = NULL;
+    FreeRopeInternalRep(objPtr);
+    SET_STRING(objPtr, stringPtr);
+    objPtr->typePtr = &tclStringType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeRopeInternalRep --
+ *
+ *	Deallocate the storage associated with a rope's internal
+ *	representation, releasing its chunks.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeRopeInternalRep(
+    Tcl_Obj *objPtr)		/* Object with internal rep to free. */
+{
+    Rope *ropePtr = GET_ROPE(objPtr);
+    int i;
+
+    for (i = 0; i < ropePtr->numChunks; i++) {
+	Tcl_DecrRefCount(ropePtr->chunks[i].objPtr);
+    }
+    ckfree((char *) ropePtr);
     objPtr->typePtr = NULL;
 }
 
@@ -470,6 +470,271 @@ Tcl_ExitThread(
 #endif
 }
 
+/*
+ * The tasks of TclRunTasks are run by a pool of worker threads shared by the
+ * whole process, so that commands that run tasks often (such as a zlib
+ * stream flushed after every few blocks) do not pay for creating and joining
+ * threads each time. The pool is started on first use and grows to the
+ * largest number of tasks asked for at once, less the calling thread, up to
+ * TASK_POOL_MAX workers. Each call posts a job to the queue; idle workers and
+ * the calling thread claim its tasks one at a time, so a job whose tasks
+ * outnumber the free workers still finishes, and a nested or concurrent call
+ * never waits for another job.
+ */
+
+#ifdef TCL_THREADS
+#define TASK_POOL_MAX	64
+
+typedef struct TaskJob {
+    TclTaskProc *proc;		/* Function to run. */
+    ClientData *clientData;	/* Argument of each task. */
+    int numTasks;		/* Number of tasks. */
+    int nextTask;		/* First task not claimed yet. */
+    int active;			/* Number of pool threads running one of the
+				 * tasks. */
+    Tcl_Condition doneCond;	/* Notified when active drops to zero. */
+    struct TaskJob *nextPtr;	/* Next job in the queue. */
+} TaskJob;
+
+static struct {
+    int shutdown;		/* Set to make the workers exit. */
+    int numWorkers;		/* Number of worker threads. */
+    Tcl_ThreadId *workers;	/* Their ids. */
+    TaskJob *firstJobPtr;	/* Queue of jobs that have tasks not claimed
+				 * yet. */
+    Tcl_Condition workCond;	/* Notified when a job is posted or the pool
+				 * shuts down. */
+} taskPool;
+
+TCL_DECLARE_MUTEX(taskPoolMutex)
+
+static int		ClaimTask(TaskJob *jobPtr);
+static Tcl_ThreadCreateType TaskWorkerThread(ClientData clientData);
+#endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRunTasks --
+ *
+ *	Runs proc once for each of the numTasks values in clientData, with
+ *	the help of the task worker pool, and waits for all of them. This is
+ *	used by commands that split a large piece of pure computation
+ *	(sorting, compression) into independent parts; the tasks must not
+ *	touch interpreters or Tcl_Objs.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Starts or grows the worker pool. When Tcl is built without threads,
+ *	or no worker can be started, the tasks are run one after the other in
+ *	the calling thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclRunTasks(
+    int numTasks,		/* Number of tasks. */
+    TclTaskProc *proc,		/* Function run for each task. */
+    ClientData clientData[])	/* Argument of each task. */
+{
+    int i;
+#ifdef TCL_THREADS
+    TaskJob job, **jobPtrPtr;
+
+    if (numTasks > 1) {
+	job.proc = proc;
+	job.clientData = clientData;
+	job.numTasks = numTasks;
+	job.nextTask = 0;
+	job.active = 0;
+	job.doneCond = NULL;
+	job.nextPtr = NULL;
+
+	Tcl_MutexLock(&taskPoolMutex);
+	if (!taskPool.shutdown) {
+	    int wanted = (numTasks - 1 < TASK_POOL_MAX)
+		    ? numTasks - 1 : TASK_POOL_MAX;
+
+	    if (taskPool.numWorkers < wanted) {
+		taskPool.workers = (Tcl_ThreadId *) ckrealloc(
+			(char *) taskPool.workers,
+			wanted * sizeof(Tcl_ThreadId));
+		while (taskPool.numWorkers < wanted) {
+		    if (TclpThreadCreate(
+			    &taskPool.workers[taskPool.numWorkers],
+			    TaskWorkerThread, NULL, TCL_THREAD_STACK_DEFAULT,
+			    TCL_THREAD_JOINABLE) != TCL_OK) {
+			break;
+		    }
+		    taskPool.numWorkers++;
+		}
+	    }
+	    for (jobPtrPtr = &taskPool.firstJobPtr; *jobPtrPtr != NULL;
+		    jobPtrPtr = &(*jobPtrPtr)->nextPtr) {
+		/* Empty loop body. */
+	    }
+	    *jobPtrPtr = &job;
+	    Tcl_ConditionNotify(&taskPool.workCond);
+	}
+	while ((i = ClaimTask(&job)) >= 0) {
+	    Tcl_MutexUnlock(&taskPoolMutex);
+	    proc(clientData[i]);
+	    Tcl_MutexLock(&taskPoolMutex);
+	}
+	while (job.active > 0) {
+	    Tcl_ConditionWait(&job.doneCond, &taskPoolMutex, NULL);
+	}
+	Tcl_MutexUnlock(&taskPoolMutex);
+	Tcl_ConditionFinalize(&job.doneCond);
+	return;
+    }
+#endif /* TCL_THREADS */
+    for (i = 0; i < numTasks; i++) {
+	proc(clientData[i]);
+    }
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClaimTask --
+ *
+ *	Claims the next task of a job for the calling thread. Must be called
+ *	with taskPoolMutex held.
+ *
+ * Results:
+ *	The index of the task, or -1 if all were claimed already.
+ *
+ * Side effects:
+ *	Removes the job from the queue once its last task is claimed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClaimTask(
+    TaskJob *jobPtr)		/* Job to take a task from. */
+{
+    TaskJob **jobPtrPtr;
+
+    if (jobPtr->nextTask >= jobPtr->numTasks) {
+	return -1;
+    }
+    if (jobPtr->nextTask == jobPtr->numTasks - 1) {
+	for (jobPtrPtr = &taskPool.firstJobPtr; *jobPtrPtr != NULL;
+		jobPtrPtr = &(*jobPtrPtr)->nextPtr) {
+	    if (*jobPtrPtr == jobPtr) {
+		*jobPtrPtr = jobPtr->nextPtr;
+		break;
+	    }
+	}
+    }
+    return jobPtr->nextTask++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TaskWorkerThread --
+ *
+ *	The main function of the worker threads of the task pool. Runs tasks
+ *	of the queued jobs until the pool shuts down.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the tasks do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+TaskWorkerThread(
+    ClientData clientData)	/* Not used. */
+{
+    TaskJob *jobPtr;
+    int i;
+
+    Tcl_MutexLock(&taskPoolMutex);
+    while (1) {
+	while (!taskPool.shutdown && (taskPool.firstJobPtr == NULL)) {
+	    Tcl_ConditionWait(&taskPool.workCond, &taskPoolMutex, NULL);
+	}
+	if (taskPool.shutdown) {
+	    break;
+	}
+	jobPtr = taskPool.firstJobPtr;
+	i = ClaimTask(jobPtr);
+	jobPtr->active++;
+	Tcl_MutexUnlock(&taskPoolMutex);
+
+	jobPtr->proc(jobPtr->clientData[i]);
+
+	Tcl_MutexLock(&taskPoolMutex);
+	if (--jobPtr->active == 0) {
+	    Tcl_ConditionNotify(&jobPtr->doneCond);
+	}
+    }
+    Tcl_MutexUnlock(&taskPoolMutex);
+
+    Tcl_FinalizeThread();
+    TclpThreadExit(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeTaskPool --
+ *
+ *	Stops the worker threads of the task pool, if it was started. Called
+ *	by Tcl_Finalize.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Waits for the workers to finish the task they are running and to
+ *	exit. Tasks still queued are left to the threads that posted them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeTaskPool(void)
+{
+#ifdef TCL_THREADS
+    int i;
+
+    Tcl_MutexLock(&taskPoolMutex);
+    if (taskPool.numWorkers == 0) {
+	Tcl_MutexUnlock(&taskPoolMutex);
+	return;
+    }
+    taskPool.shutdown = 1;
+    Tcl_ConditionNotify(&taskPool.workCond);
+    Tcl_MutexUnlock(&taskPoolMutex);
+
+    for (i = 0; i < taskPool.numWorkers; i++) {
+	Tcl_JoinThread(taskPool.workers[i], NULL);
+    }
+
+    Tcl_MutexLock(&taskPoolMutex);
+    ckfree((char *) taskPool.workers);
+    taskPool.workers = NULL;
+    taskPool.numWorkers = 0;
+    taskPool.shutdown = 0;
+    Tcl_ConditionFinalize(&taskPool.workCond);
+    Tcl_MutexUnlock(&taskPoolMutex);
+#endif /* TCL_THREADS */
+}
+
 #ifndef TCL_THREADS
 
 /*
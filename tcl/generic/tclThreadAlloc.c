@@ -43,32 +43,38 @@
 
 /*
  * The following union stores accounting information for each block including
- * two small magic numbers and a bucket number when in use or a next pointer
- * when free. The original requested size (not including the Block overhead)
- * is also maintained.
+ * two small magic numbers, a bucket number and the original requested size
+ * (not including the Block overhead) when in use or a next pointer when free.
+ * The cache which allocated the block is also remembered so that a block
+ * freed by another thread can be handed back to it.
  */
 
+typedef struct BlockHeader {
+    union {
+	union Block *next;		/* Next in free list. */
+	struct {
+	    unsigned char magic1;	/* First magic number. */
+	    unsigned char bucket;	/* Bucket block allocated from. */
+	    unsigned char unused;	/* Padding. */
+	    unsigned char magic2;	/* Second magic number. */
+	    unsigned int reqSize;	/* Requested allocation size. */
+	} s;
+    } u;
+    struct Cache *owner;		/* Cache which allocated the block. */
+} BlockHeader;
+
 typedef union Block {
-    struct {
-	union {
-	    union Block *next;		/* Next in free list. */
-	    struct {
-		unsigned char magic1;	/* First magic number. */
-		unsigned char bucket;	/* Bucket block allocated from. */
-		unsigned char unused;	/* Padding. */
-		unsigned char magic2;	/* Second magic number. */
-	    } s;
-	} u;
-	size_t reqSize;			/* Requested allocation size. */
-    } b;
-    unsigned char padding[TCL_ALLOCALIGN];
+    BlockHeader b;
+    unsigned char padding[(sizeof(BlockHeader) + TCL_ALLOCALIGN - 1)
+	    & ~(TCL_ALLOCALIGN - 1)];
 } Block;
 #define nextBlock	b.u.next
 #define sourceBucket	b.u.s.bucket
 #define magicNum1	b.u.s.magic1
 #define magicNum2	b.u.s.magic2
 #define MAGIC		0xEF
-#define blockReqSize	b.reqSize
+#define blockReqSize	b.u.s.reqSize
+#define blockOwner	b.owner
 
 /*
  * The following defines the minimum and and maximum block sizes and the number
@@ -82,11 +88,25 @@ typedef union Block {
 /*
  * The following structure defines a bucket of blocks with various accounting
  * and statistics information.
+ *
+ * Blocks freed by a thread other than the one which allocated them are not
+ * kept by the freeing thread. They are collected in a pending batch per
+ * bucket and the whole batch is pushed, without taking any lock, on the
+ * remote list of the owning cache once it is full or a block with another
+ * owner turns up. The owner takes back its remote list in one step before it
+ * looks into the shared cache.
  */
 
 typedef struct Bucket {
     Block *firstPtr;		/* First block available */
     long numFree;		/* Number of blocks available */
+    Block *volatile remotePtr;	/* Blocks freed by other threads, returned
+				 * to this cache. Only changed atomically. */
+    Block *pendingPtr;		/* Batch of blocks freed by this thread which
+				 * belong to pendingOwner. */
+    Block *pendingLastPtr;	/* Last block of the pending batch. */
+    struct Cache *pendingOwner;	/* Cache the pending batch goes to. */
+    int numPending;		/* Number of blocks in the pending batch. */
 
     /* All fields below for accounting only */
 
@@ -95,6 +115,9 @@ typedef struct Bucket {
     long numWaits;		/* Number of waits to acquire a lock */
     long numLocks;		/* Number of locks acquired */
     long totalAssigned;		/* Total space assigned to bucket */
+    long numRemoteFrees;	/* Number of blocks freed for other caches */
+    long numRemoteGets;		/* Number of blocks taken back from other
+				 * threads */
 } Bucket;
 
 /*
@@ -110,6 +133,8 @@ typedef struct Cache {
     Tcl_Obj *firstObjPtr;	/* List of free objects for thread */
     int numObjects;		/* Number of objects for thread */
     int totalAssigned;		/* Total space assigned to thread */
+    int dead;			/* Set once the owning thread has exited and
+				 * the cache waits to be reused. */
     Bucket buckets[NBUCKETS];	/* The buckets for this thread */
 } Cache;
 
@@ -135,8 +160,14 @@ static void	UnlockBucket(Cache *cachePtr, int bucket);
 static void	PutBlocks(Cache *cachePtr, int bucket, int numMove);
 static int	GetBlocks(Cache *cachePtr, int bucket);
 static Block *	Ptr2Block(char *ptr);
-static char *	Block2Ptr(Block *blockPtr, int bucket, unsigned int reqSize);
+static char *	Block2Ptr(Cache *cachePtr, Block *blockPtr, int bucket,
+		    unsigned int reqSize);
 static void	MoveObjs(Cache *fromPtr, Cache *toPtr, int numMove);
+static void	RemoteFree(Cache *cachePtr, Block *blockPtr, int bucket);
+static void	FlushRemote(Cache *cachePtr, int bucket);
+static int	GetRemoteBlocks(Cache *cachePtr, int bucket);
+static int	CompareAndSwap(Block *volatile *ptrPtr, Block *oldPtr,
+		    Block *newPtr);
 
 /*
  * Local variables defined in this file and initialized at startup.
@@ -147,6 +178,28 @@ static Tcl_Mutex *objLockPtr;
 static Cache sharedCache;
 static Cache *sharedPtr = &sharedCache;
 static Cache *firstCachePtr = &sharedCache;
+
+/*
+ * Caches of exited threads are never freed since other threads may still
+ * push blocks on their remote lists. They are kept on this list and handed
+ * to the next new thread instead.
+ */
+
+static Cache *deadCachePtr = NULL;
+
+/*
+ * Where the compiler offers no atomic compare-and-swap, the remote lists are
+ * protected by a mutex.
+ */
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || \
+	((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define HAVE_ALLOC_CAS 1
+#elif defined(_WIN32)
+#define HAVE_ALLOC_CAS 1
+#else
+static Tcl_Mutex *remoteLockPtr;
+#endif
 
 /*
  *----------------------------------------------------------------------
@@ -182,6 +235,9 @@ GetCache(void)
 	if (listLockPtr == NULL) {
 	    listLockPtr = TclpNewAllocMutex();
 	    objLockPtr = TclpNewAllocMutex();
+#ifndef HAVE_ALLOC_CAS
+	    remoteLockPtr = TclpNewAllocMutex();
+#endif
 	    for (i = 0; i < NBUCKETS; ++i) {
 		bucketInfo[i].blockSize = MINALLOC << i;
 		bucketInfo[i].maxBlocks = 1 << (NBUCKETS - 1 - i);
@@ -199,11 +255,18 @@ GetCache(void)
 
     cachePtr = TclpGetAllocCache();
     if (cachePtr == NULL) {
-	cachePtr = calloc(1, sizeof(Cache));
-	if (cachePtr == NULL) {
-	    Tcl_Panic("alloc: could not allocate new cache");
-	}
 	Tcl_MutexLock(listLockPtr);
+	cachePtr = deadCachePtr;
+	if (cachePtr != NULL) {
+	    deadCachePtr = cachePtr->nextPtr;
+	    cachePtr->dead = 0;
+	} else {
+	    cachePtr = calloc(1, sizeof(Cache));
+	    if (cachePtr == NULL) {
+		Tcl_MutexUnlock(listLockPtr);
+		Tcl_Panic("alloc: could not allocate new cache");
+	    }
+	}
 	cachePtr->nextPtr = firstCachePtr;
 	firstCachePtr = cachePtr;
 	Tcl_MutexUnlock(listLockPtr);
@@ -218,7 +281,8 @@ GetCache(void)
  *
  * TclFreeAllocCache --
  *
- *	Flush and delete a cache, removing from list of caches.
+ *	Flush a cache and move it from the list of caches to the list of
+ *	caches waiting to be reused.
  *
  * Results:
  *	None.
@@ -238,10 +302,17 @@ TclFreeAllocCache(
     register unsigned int bucket;
 
     /*
-     * Flush blocks.
+     * Flush blocks, including the ones freed for other caches and the ones
+     * other threads have returned to this cache so far. Blocks returned
+     * later stay on the remote lists until the cache is reused.
      */
 
+    cachePtr->dead = 1;
     for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	if (cachePtr->buckets[bucket].numPending > 0) {
+	    FlushRemote(cachePtr, bucket);
+	}
+	GetRemoteBlocks(cachePtr, bucket);
 	if (cachePtr->buckets[bucket].numFree > 0) {
 	    PutBlocks(cachePtr, bucket, cachePtr->buckets[bucket].numFree);
 	}
@@ -258,18 +329,29 @@ TclFreeAllocCache(
     }
 
     /*
-     * Remove from pool list.
+     * Reset the statistics and move from the pool list to the list of dead
+     * caches.
      */
 
+    cachePtr->totalAssigned = 0;
+    for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	Bucket *bucketPtr = &cachePtr->buckets[bucket];
+
+	bucketPtr->numRemoves = bucketPtr->numInserts = 0;
+	bucketPtr->numWaits = bucketPtr->numLocks = 0;
+	bucketPtr->totalAssigned = 0;
+	bucketPtr->numRemoteFrees = bucketPtr->numRemoteGets = 0;
+    }
+
     Tcl_MutexLock(listLockPtr);
     nextPtrPtr = &firstCachePtr;
     while (*nextPtrPtr != cachePtr) {
 	nextPtrPtr = &(*nextPtrPtr)->nextPtr;
     }
     *nextPtrPtr = cachePtr->nextPtr;
-    cachePtr->nextPtr = NULL;
+    cachePtr->nextPtr = deadCachePtr;
+    deadCachePtr = cachePtr;
     Tcl_MutexUnlock(listLockPtr);
-    free(cachePtr);
 }
 
 /*
@@ -349,7 +431,7 @@ TclpAlloc(
     if (blockPtr == NULL) {
 	return NULL;
     }
-    return Block2Ptr(blockPtr, bucket, reqSize);
+    return Block2Ptr(cachePtr, blockPtr, bucket, reqSize);
 }
 
 /*
@@ -387,8 +469,9 @@ TclpFree(
 
     /*
      * Get the block back from the user pointer and call system free directly
-     * for large blocks. Otherwise, push the block back on the bucket and move
-     * blocks to the shared cache if there are now too many free.
+     * for large blocks. Blocks of another live cache are handed back to it.
+     * Otherwise, push the block back on the bucket and move blocks to the
+     * shared cache if there are now too many free.
      */
 
     blockPtr = Ptr2Block(ptr);
@@ -400,6 +483,11 @@ TclpFree(
     }
 
     cachePtr->buckets[bucket].totalAssigned -= blockPtr->blockReqSize;
+    if (blockPtr->blockOwner != cachePtr && cachePtr != sharedPtr
+	    && !blockPtr->blockOwner->dead) {
+	RemoteFree(cachePtr, blockPtr, bucket);
+	return;
+    }
     blockPtr->nextBlock = cachePtr->buckets[bucket].firstPtr;
     cachePtr->buckets[bucket].firstPtr = blockPtr;
     cachePtr->buckets[bucket].numFree++;
@@ -481,7 +569,7 @@ TclpRealloc(
 	if (size > min && size <= bucketInfo[bucket].blockSize) {
 	    cachePtr->buckets[bucket].totalAssigned -= blockPtr->blockReqSize;
 	    cachePtr->buckets[bucket].totalAssigned += reqSize;
-	    return Block2Ptr(blockPtr, bucket, reqSize);
+	    return Block2Ptr(cachePtr, blockPtr, bucket, reqSize);
 	}
     } else if (size > MAXALLOC) {
 	cachePtr->totalAssigned -= blockPtr->blockReqSize;
@@ -490,7 +578,7 @@ TclpRealloc(
 	if (blockPtr == NULL) {
 	    return NULL;
 	}
-	return Block2Ptr(blockPtr, NBUCKETS, reqSize);
+	return Block2Ptr(cachePtr, blockPtr, NBUCKETS, reqSize);
     }
 
     /*
@@ -637,7 +725,11 @@ TclThreadFreeObj(
  *
  * Tcl_GetMemoryInfo --
  *
- *	Return a list-of-lists of memory stats.
+ *	Return a list-of-lists of memory stats. Each bucket is described by
+ *	its block size, the number of free blocks, the number of removes and
+ *	inserts, the total space assigned, the number of locks and waits, the
+ *	number of blocks freed for other threads and the number of blocks
+ *	taken back from other threads.
  *
  * Results:
  *	None.
@@ -667,14 +759,16 @@ Tcl_GetMemoryInfo(
 	    Tcl_DStringAppendElement(dsPtr, buf);
 	}
 	for (n = 0; n < NBUCKETS; ++n) {
-	    sprintf(buf, "%lu %ld %ld %ld %ld %ld %ld",
+	    sprintf(buf, "%lu %ld %ld %ld %ld %ld %ld %ld %ld",
 		    (unsigned long) bucketInfo[n].blockSize,
 		    cachePtr->buckets[n].numFree,
 		    cachePtr->buckets[n].numRemoves,
 		    cachePtr->buckets[n].numInserts,
 		    cachePtr->buckets[n].totalAssigned,
 		    cachePtr->buckets[n].numLocks,
-		    cachePtr->buckets[n].numWaits);
+		    cachePtr->buckets[n].numWaits,
+		    cachePtr->buckets[n].numRemoteFrees,
+		    cachePtr->buckets[n].numRemoteGets);
 	    Tcl_DStringAppendElement(dsPtr, buf);
 	}
 	Tcl_DStringEndSublist(dsPtr);
@@ -748,6 +842,7 @@ MoveObjs(
 
 static char *
 Block2Ptr(
+    Cache *cachePtr,
     Block *blockPtr,
     int bucket,
     unsigned int reqSize)
@@ -757,6 +852,7 @@ Block2Ptr(
     blockPtr->magicNum1 = blockPtr->magicNum2 = MAGIC;
     blockPtr->sourceBucket = bucket;
     blockPtr->blockReqSize = reqSize;
+    blockPtr->blockOwner = cachePtr;
     ptr = ((void *) (blockPtr + 1));
 #if RCHECK
     ((unsigned char *)(ptr))[reqSize] = MAGIC;
@@ -877,6 +973,170 @@ PutBlocks(
     UnlockBucket(cachePtr, bucket);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompareAndSwap --
+ *
+ *	Atomically replace the head of a remote list if it still is the
+ *	expected one.
+ *
+ * Results:
+ *	1 if the head was replaced, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CompareAndSwap(
+    Block *volatile *ptrPtr,
+    Block *oldPtr,
+    Block *newPtr)
+{
+#if defined(__GNUC__) && defined(HAVE_ALLOC_CAS)
+    return __sync_bool_compare_and_swap(ptrPtr, oldPtr, newPtr);
+#elif defined(_WIN32)
+    return InterlockedCompareExchangePointer((PVOID volatile *) ptrPtr,
+	    newPtr, oldPtr) == oldPtr;
+#else
+    int swapped = 0;
+
+    Tcl_MutexLock(remoteLockPtr);
+    if (*ptrPtr == oldPtr) {
+	*ptrPtr = newPtr;
+	swapped = 1;
+    }
+    Tcl_MutexUnlock(remoteLockPtr);
+    return swapped;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoteFree --
+ *
+ *	Add a block allocated by another cache to the pending batch of its
+ *	bucket.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May hand the previous batch back to its owner.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoteFree(
+    Cache *cachePtr,
+    Block *blockPtr,
+    int bucket)
+{
+    Bucket *bucketPtr = &cachePtr->buckets[bucket];
+
+    if (bucketPtr->numPending > 0
+	    && bucketPtr->pendingOwner != blockPtr->blockOwner) {
+	FlushRemote(cachePtr, bucket);
+    }
+    if (bucketPtr->numPending == 0) {
+	bucketPtr->pendingOwner = blockPtr->blockOwner;
+	bucketPtr->pendingLastPtr = blockPtr;
+    }
+    blockPtr->nextBlock = bucketPtr->pendingPtr;
+    bucketPtr->pendingPtr = blockPtr;
+    bucketPtr->numPending++;
+    bucketPtr->numRemoteFrees++;
+
+    if (bucketPtr->numPending >= bucketInfo[bucket].numMove) {
+	FlushRemote(cachePtr, bucket);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushRemote --
+ *
+ *	Push the pending batch of a bucket on the remote list of its owner.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushRemote(
+    Cache *cachePtr,
+    int bucket)
+{
+    Bucket *bucketPtr = &cachePtr->buckets[bucket];
+    Block *volatile *remotePtrPtr =
+	    &bucketPtr->pendingOwner->buckets[bucket].remotePtr;
+    Block *headPtr;
+
+    do {
+	headPtr = *remotePtrPtr;
+	bucketPtr->pendingLastPtr->nextBlock = headPtr;
+    } while (!CompareAndSwap(remotePtrPtr, headPtr, bucketPtr->pendingPtr));
+
+    bucketPtr->pendingPtr = bucketPtr->pendingLastPtr = NULL;
+    bucketPtr->pendingOwner = NULL;
+    bucketPtr->numPending = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetRemoteBlocks --
+ *
+ *	Take back the blocks other threads have freed for a bucket.
+ *
+ * Results:
+ *	1 if blocks where taken back, 0 otherwise.
+ *
+ * Side effects:
+ *	The blocks are added to the bucket.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetRemoteBlocks(
+    Cache *cachePtr,
+    int bucket)
+{
+    Bucket *bucketPtr = &cachePtr->buckets[bucket];
+    Block *firstPtr, *lastPtr;
+    long n;
+
+    do {
+	firstPtr = bucketPtr->remotePtr;
+	if (firstPtr == NULL) {
+	    return 0;
+	}
+    } while (!CompareAndSwap(&bucketPtr->remotePtr, firstPtr, NULL));
+
+    n = 1;
+    for (lastPtr = firstPtr; lastPtr->nextBlock != NULL;
+	    lastPtr = lastPtr->nextBlock) {
+	n++;
+    }
+    lastPtr->nextBlock = bucketPtr->firstPtr;
+    bucketPtr->firstPtr = firstPtr;
+    bucketPtr->numFree += n;
+    bucketPtr->numRemoteGets += n;
+    return 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -902,7 +1162,16 @@ GetBlocks(
     register int n;
 
     /*
-     * First, atttempt to move blocks from the shared cache. Note the
+     * Blocks other threads have handed back come first, they need no lock.
+     */
+
+    if (cachePtr->buckets[bucket].remotePtr != NULL
+	    && GetRemoteBlocks(cachePtr, bucket)) {
+	return 1;
+    }
+
+    /*
+     * Next, atttempt to move blocks from the shared cache. Note the
      * potentially dirty read of numFree before acquiring the lock which is a
      * slight performance enhancement. The value is verified after the lock is
      * actually acquired.
@@ -1020,6 +1289,11 @@ TclFinalizeThreadAlloc(void)
     TclpFreeAllocMutex(objLockPtr);
     objLockPtr = NULL;
 
+#ifndef HAVE_ALLOC_CAS
+    TclpFreeAllocMutex(remoteLockPtr);
+    remoteLockPtr = NULL;
+#endif
+
     TclpFreeAllocMutex(listLockPtr);
     listLockPtr = NULL;
 
@@ -141,6 +141,11 @@ static void		ThreadFreeProc(ClientData clientData);
 static int		ThreadDeleteEvent(Tcl_Event *eventPtr,
 			    ClientData clientData);
 static void		ThreadExitProc(ClientData clientData);
+#ifdef USE_THREAD_ALLOC
+static int		MemoryInfoObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
+#endif
 extern int		Tcltest_Init(Tcl_Interp *interp);
 
 /*
@@ -174,8 +179,52 @@ TclThread_Init(
     Tcl_MutexUnlock(&threadMutex);
 
     Tcl_CreateObjCommand(interp, "testthread", ThreadObjCmd, NULL, NULL);
+#ifdef USE_THREAD_ALLOC
+    Tcl_CreateObjCommand(interp, "testmemoryinfo", MemoryInfoObjCmd,
+	    NULL, NULL);
+#endif
+    return TCL_OK;
+}
+
+#ifdef USE_THREAD_ALLOC
+/*
+ *----------------------------------------------------------------------
+ *
+ * MemoryInfoObjCmd --
+ *
+ *	This procedure is invoked to process the "testmemoryinfo" Tcl
+ *	command. It returns the statistics of the threaded allocator as
+ *	collected by Tcl_GetMemoryInfo.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+MemoryInfoObjCmd(
+    ClientData dummy,		/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tcl_DString ds;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    Tcl_DStringInit(&ds);
+    Tcl_GetMemoryInfo(&ds);
+    Tcl_DStringResult(interp, &ds);
     return TCL_OK;
 }
+#endif /* USE_THREAD_ALLOC */
 
 
 /*
@@ -57,6 +57,21 @@
 
 #define UNICODE_SELF	0x80
 
+/*
+ * Bytes below 0xC0 found where a character starts are characters by
+ * themselves. The following macros load a machine word of bytes and check
+ * that none of them is 0xC0 or above (has both high bits set), so that runs
+ * of such characters, like ASCII text, are skipped a word at a time.
+ */
+
+typedef size_t UtfWord;
+
+#define UTF_WORD_HIGH_BITS	((~(UtfWord) 0 / 0xFF) * 0x80)
+#define UtfLoadWord(wordPtr, src) \
+    memcpy((wordPtr), (src), sizeof(UtfWord))
+#define UtfWordIsSingleBytes(word) \
+    ((((word) & ((word) << 1)) & UTF_WORD_HIGH_BITS) == 0)
+
 /*
  * The following structures are used when mapping between Unicode (UCS-2) and
  * UTF-8.
@@ -509,8 +524,18 @@ Tcl_NumUtfChars(
 	}
     } else {
 	register int n;
+	UtfWord word;
 
 	while (length > 0) {
+	    if (length >= (int) sizeof(UtfWord)) {
+		UtfLoadWord(&word, src);
+		if (UtfWordIsSingleBytes(word)) {
+		    length -= sizeof(UtfWord);
+		    src += sizeof(UtfWord);
+		    i += sizeof(UtfWord);
+		    continue;
+		}
+	    }
 	    if (UCHAR(*src) < 0xC0) {
 		length--;
 		src++;
@@ -739,8 +764,22 @@ Tcl_UtfAtIndex(
     register int index)		/* The position of the desired character. */
 {
     Tcl_UniChar ch;
+    UtfWord word;
 
     while (index > 0) {
+	/*
+	 * There are at least index bytes before the character, so a word can
+	 * be read when index is that large.
+	 */
+
+	if (index >= (int) sizeof(UtfWord)) {
+	    UtfLoadWord(&word, src);
+	    if (UtfWordIsSingleBytes(word)) {
+		index -= sizeof(UtfWord);
+		src += sizeof(UtfWord);
+		continue;
+	    }
+	}
 	index--;
 	src += TclUtfToUniChar(src, &ch);
     }
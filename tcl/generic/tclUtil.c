@@ -2590,10 +2590,10 @@ TclFormatInt(buffer, n)
     /*
      * Check whether "n" is the maximum negative value. This is
      * -2^(m-1) for an m-bit word, and has no positive equivalent;
-     * negating it produces the same value.
+     * negating it overflows.
      */
 
-    if (n == -n) {
+    if (n == LONG_MIN) {
 	return sprintf(buffer, "%ld", n);
     }
 
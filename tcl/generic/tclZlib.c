@@ -45,6 +45,73 @@ typedef struct {
     char nativeCommentBuf[MAX_COMMENT_LEN];
 } GzipHeader;
 
+/*
+ * Structure used for compressing with several threads. The input is cut into
+ * blocks that are compressed independently (and concurrently) as raw deflate
+ * data, each primed with the 32kB of input before it as a dictionary and each
+ * but the very last ended with a sync flush, so that the compressed blocks
+ * can simply be concatenated. The zlib or gzip header and trailer are written
+ * around them here, the checksums of the blocks being combined. This is the
+ * scheme used by pigz.
+ */
+
+#define PARALLEL_BLOCK_SIZE	131072
+#define DICTIONARY_SIZE		32768
+
+typedef struct {
+    int format;			/* One of the TCL_ZLIB_FORMAT_* values, other
+				 * than TCL_ZLIB_FORMAT_AUTO. */
+    int level;			/* Compression level, 0-9 or
+				 * Z_DEFAULT_COMPRESSION. */
+    int numThreads;		/* How many blocks to compress at once. */
+    gz_header *headerPtr;	/* Description of the gzip header to write, or
+				 * NULL for a default header. */
+    int started;		/* Whether the header has been produced. */
+    int finished;		/* Whether the trailer has been produced. */
+    uLong check;		/* Checksum of the input compressed so far. */
+    uLong totalIn;		/* Length of that input, modulo 2**32. */
+    Bytef dict[DICTIONARY_SIZE];/* The last input compressed, for priming the
+				 * compression of the block after it. */
+    int dictLen;		/* How much of dict is in use. */
+    Bytef *pending;		/* Input waiting until there is enough of it
+				 * to give each thread a whole block, or NULL
+				 * if not allocated yet. */
+    int pendingLen;		/* How much of pending is in use. */
+} ParallelDeflate;
+
+/*
+ * Structure describing the compression of one block, which is done on a
+ * thread of its own.
+ */
+
+typedef struct {
+    const Bytef *data;		/* The input for the block. */
+    uInt length;		/* Length of the input. */
+    const Bytef *dict;		/* The input before the block, or NULL. */
+    uInt dictLen;		/* Length of the dictionary. */
+    int format;			/* Format of the stream, which determines what
+				 * checksum to compute. */
+    int level;			/* Compression level. */
+    int flush;			/* Z_SYNC_FLUSH, or Z_FINISH if this is the
+				 * last block of the stream. */
+    Bytef *out;			/* Where to put the compressed block. */
+    uInt outSize;		/* Space available at out. */
+    uInt outLength;		/* Length of the compressed block. */
+    uLong check;		/* Checksum of the input. */
+    int code;			/* Z_OK, or a zlib error code. */
+} DeflateBlock;
+
+/*
+ * Operating system code written into gzip headers when no header
+ * dictionary is given, the same as zlib's.
+ */
+
+#ifdef _WIN32
+#define GZIP_OS_CODE		0x0b
+#else
+#define GZIP_OS_CODE		0x03
+#endif
+
 /*
  * Structure used for the Tcl_ZlibStream* commands and [zlib stream ...]
  */
@@ -66,6 +133,8 @@ typedef struct {
     int wbits;			/* The encoded compression mode, so we can
 				 * restart the stream if necessary. */
     Tcl_Command cmd;		/* Token for the associated Tcl command. */
+    ParallelDeflate *pdPtr;	/* State of the compression when it is done
+				 * with several threads, or NULL. */
 } ZlibStreamHandle;
 
 /*
@@ -92,6 +161,8 @@ typedef struct {
     GzipHeader outHeader;	/* Header to write to an output stream, when
 				 * compressing a gzip stream. */
     Tcl_TimerToken timer;	/* Timer used for keeping events fresh. */
+    ParallelDeflate *pdPtr;	/* State of the compression when it is done
+				 * with several threads, or NULL. */
 } ZlibChannelData;
 
 /*
@@ -137,14 +208,33 @@ static Tcl_DriverWatchProc ZlibTransformWatch;
 static Tcl_ObjCmdProc ZlibCmd;
 static Tcl_ObjCmdProc ZlibStreamCmd;
 
+static void AppendBytes(Tcl_Obj *objPtr, const Bytef *bytes, int length);
+static void AppendDeflateHeader(ParallelDeflate *pdPtr, Tcl_Obj *outObj);
 static void ConvertError(Tcl_Interp *interp, int code);
+static int DeflateBlocks(ParallelDeflate *pdPtr, const Bytef *data,
+	int length, int flush, Tcl_Obj *outObj);
+static void DeflateBlockProc(ClientData clientData);
+static void FreeParallelDeflate(ParallelDeflate *pdPtr);
+static int GetThreadCount(Tcl_Interp *interp, Tcl_Obj *objPtr,
+	int *countPtr);
+static ParallelDeflate *NewParallelDeflate(int format, int level,
+	int numThreads, gz_header *headerPtr);
+static int ParallelDeflateAdd(ParallelDeflate *pdPtr, const Bytef *data,
+	int length, int flush, Tcl_Obj *outObj);
+static uLong ParallelDeflateChecksum(ParallelDeflate *pdPtr);
+static void ResetParallelDeflate(ParallelDeflate *pdPtr);
 static void ExtractHeader(gz_header *headerPtr, Tcl_Obj *dictObj);
 static int GenerateHeader(Tcl_Interp *interp, Tcl_Obj *dictObj,
 	GzipHeader *headerPtr, int *extraSizePtr);
+static int ZlibParallelDeflate(Tcl_Interp *interp, int format,
+	Tcl_Obj *data, int level, Tcl_Obj *gzipHeaderDictObj,
+	int numThreads);
 static Tcl_Channel ZlibStackChannelTransform(Tcl_Interp *interp,
-	int mode, int format, int level,
+	int mode, int format, int level, int numThreads,
 	Tcl_Channel channel, Tcl_Obj *gzipHeaderDictPtr);
 static void ZlibStreamCleanup(ZlibStreamHandle *zshPtr);
+static int ZlibTransformParallelWrite(ZlibChannelData *cd,
+	const char *buf, int toWrite, int flush);
 static void ZlibTransformTimerKill(ZlibChannelData *cd);
 static void ZlibTransformTimerRun(ClientData clientData);
 static void ZlibTransformTimerSetup(ZlibChannelData *cd);
@@ -544,6 +634,7 @@ Tcl_ZlibStreamInit(
     zshPtr->wbits = wbits;
     zshPtr->currentInput = NULL;
     zshPtr->streamEnd = 0;
+    zshPtr->pdPtr = NULL;
     memset(&zshPtr->stream, 0, sizeof(z_stream));
 
     /*
@@ -726,6 +817,9 @@ ZlibStreamCleanup(
     if (zshPtr->currentInput) {
 	Tcl_DecrRefCount(zshPtr->currentInput);
     }
+    if (zshPtr->pdPtr) {
+	FreeParallelDeflate(zshPtr->pdPtr);
+    }
 
     ckfree((char *) zshPtr);
 }
@@ -770,6 +864,9 @@ Tcl_ZlibStreamReset(
     zshPtr->outPos = 0;
     zshPtr->streamEnd = 0;
     memset(&zshPtr->stream, 0, sizeof(z_stream));
+    if (zshPtr->pdPtr) {
+	ResetParallelDeflate(zshPtr->pdPtr);
+    }
 
     /*
      * No output buffer available yet.
@@ -870,6 +967,9 @@ Tcl_ZlibStreamChecksum(
 {
     ZlibStreamHandle *zshPtr = (ZlibStreamHandle *) zshandle;
 
+    if (zshPtr->pdPtr) {
+	return ParallelDeflateChecksum(zshPtr->pdPtr);
+    }
     return zshPtr->stream.adler;
 }
 
@@ -896,7 +996,8 @@ Tcl_ZlibStreamPut(
     int e, size, outSize;
     Tcl_Obj *obj;
 
-    if (zshPtr->streamEnd) {
+    if (zshPtr->streamEnd
+	    || (zshPtr->pdPtr != NULL && zshPtr->pdPtr->finished)) {
 	if (zshPtr->interp) {
 	    Tcl_SetResult(zshPtr->interp,
 		    "already past compressed stream end", TCL_STATIC);
@@ -904,7 +1005,29 @@ Tcl_ZlibStreamPut(
 	return TCL_ERROR;
     }
 
-    if (zshPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
+    if (zshPtr->pdPtr != NULL) {
+	/*
+	 * Compressing with several threads. Whatever whole blocks can be
+	 * compressed now are appended to the outData list as one piece.
+	 */
+
+	TclNewObj(obj);
+	dataTmp = (char *) Tcl_GetByteArrayFromObj(data, &size);
+	e = ParallelDeflateAdd(zshPtr->pdPtr, (Bytef *) dataTmp, size, flush,
+		obj);
+	if (e != Z_OK) {
+	    ConvertError(zshPtr->interp, e);
+	    TclDecrRefCount(obj);
+	    return TCL_ERROR;
+	}
+	(void) Tcl_GetByteArrayFromObj(obj, &outSize);
+	if (outSize > 0) {
+	    Tcl_ListObjAppendElement(NULL, zshPtr->outData, obj);
+	} else {
+	    TclDecrRefCount(obj);
+	}
+	return TCL_OK;
+    } else if (zshPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	zshPtr->stream.next_in = Tcl_GetByteArrayFromObj(data, &size);
 	zshPtr->stream.avail_in = size;
 
@@ -1563,6 +1686,572 @@ Tcl_ZlibAdler32(
 {
     return adler32(adler, (Bytef *) buf, (unsigned) len);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewParallelDeflate, ResetParallelDeflate, FreeParallelDeflate --
+ *
+ *	Create, restart and dispose of the state of a compression that is
+ *	done with several threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ParallelDeflate *
+NewParallelDeflate(
+    int format,			/* TCL_ZLIB_FORMAT_RAW, TCL_ZLIB_FORMAT_ZLIB
+				 * or TCL_ZLIB_FORMAT_GZIP. */
+    int level,			/* 0-9 or Z_DEFAULT_COMPRESSION. */
+    int numThreads,		/* How many threads to use. */
+    gz_header *headerPtr)	/* Header to write for the gzip format, or
+				 * NULL for a default one. Must live as long
+				 * as the compression. */
+{
+    ParallelDeflate *pdPtr = (ParallelDeflate *)
+	    ckalloc(sizeof(ParallelDeflate));
+
+    pdPtr->format = format;
+    pdPtr->level = level;
+    pdPtr->numThreads = numThreads;
+    pdPtr->headerPtr = headerPtr;
+    pdPtr->pending = NULL;
+    ResetParallelDeflate(pdPtr);
+    return pdPtr;
+}
+
+static void
+ResetParallelDeflate(
+    ParallelDeflate *pdPtr)
+{
+    pdPtr->started = 0;
+    pdPtr->finished = 0;
+    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	pdPtr->check = crc32(0, Z_NULL, 0);
+    } else {
+	pdPtr->check = adler32(0, Z_NULL, 0);
+    }
+    pdPtr->totalIn = 0;
+    pdPtr->dictLen = 0;
+    pdPtr->pendingLen = 0;
+}
+
+static void
+FreeParallelDeflate(
+    ParallelDeflate *pdPtr)
+{
+    if (pdPtr->pending != NULL) {
+	ckfree((char *) pdPtr->pending);
+    }
+    ckfree((char *) pdPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateAdd --
+ *
+ *	Compresses data with several threads. Input is held back until there
+ *	is a whole block for each thread, unless a flush is requested, in
+ *	which case all input given so far is compressed.
+ *
+ * Results:
+ *	Z_OK, or a zlib error code. Compressed data is appended to the
+ *	bytearray outObj, which must be unshared.
+ *
+ * Side effects:
+ *	Runs threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateAdd(
+    ParallelDeflate *pdPtr,
+    const Bytef *data,		/* Data to compress. */
+    int length,			/* Length of the data. */
+    int flush,			/* Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FULL_FLUSH or
+				 * Z_FINISH. */
+    Tcl_Obj *outObj)		/* Where to append compressed data. */
+{
+    int groupSize = pdPtr->numThreads * PARALLEL_BLOCK_SIZE;
+    int n, e;
+
+    /*
+     * Top up the input that is already waiting, and compress it if that
+     * makes a whole group of blocks or a flush is wanted.
+     */
+
+    if (pdPtr->pendingLen > 0) {
+	n = groupSize - pdPtr->pendingLen;
+	if (n > length) {
+	    n = length;
+	}
+	memcpy(pdPtr->pending + pdPtr->pendingLen, data, (size_t) n);
+	pdPtr->pendingLen += n;
+	data += n;
+	length -= n;
+	if (pdPtr->pendingLen < groupSize && flush == Z_NO_FLUSH) {
+	    return Z_OK;
+	}
+	e = DeflateBlocks(pdPtr, pdPtr->pending, pdPtr->pendingLen,
+		(length > 0 ? Z_NO_FLUSH : flush), outObj);
+	pdPtr->pendingLen = 0;
+	if (e != Z_OK || length == 0) {
+	    return e;
+	}
+    }
+
+    /*
+     * Compress whole groups (or everything, when flushing) straight out of
+     * the caller's buffer, and keep the rest for later.
+     */
+
+    n = length;
+    if (flush == Z_NO_FLUSH) {
+	n -= length % groupSize;
+    }
+    if (n > 0 || flush != Z_NO_FLUSH) {
+	e = DeflateBlocks(pdPtr, data, n, flush, outObj);
+	if (e != Z_OK) {
+	    return e;
+	}
+    }
+    if (length > n) {
+	if (pdPtr->pending == NULL) {
+	    pdPtr->pending = (Bytef *) ckalloc((unsigned) groupSize);
+	}
+	memcpy(pdPtr->pending, data + n, (size_t) (length - n));
+	pdPtr->pendingLen = length - n;
+    }
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateChecksum --
+ *
+ *	Computes the checksum of all data given to a compression done with
+ *	several threads, as zlib would report it for the format.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static uLong
+ParallelDeflateChecksum(
+    ParallelDeflate *pdPtr)
+{
+    if (pdPtr->pendingLen == 0 || pdPtr->format == TCL_ZLIB_FORMAT_RAW) {
+	return pdPtr->check;
+    } else if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	return crc32(pdPtr->check, pdPtr->pending, (uInt) pdPtr->pendingLen);
+    } else {
+	return adler32(pdPtr->check, pdPtr->pending, (uInt)pdPtr->pendingLen);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeflateBlocks --
+ *
+ *	Compresses a run of input, cut into blocks of PARALLEL_BLOCK_SIZE
+ *	bytes that are compressed numThreads at a time by TclRunTasks. The
+ *	format header is written before the first block of the stream, and
+ *	the trailer after the last.
+ *
+ * Results:
+ *	Z_OK, or a zlib error code. Compressed data is appended to outObj.
+ *
+ * Side effects:
+ *	Runs threads. Updates the checksum and dictionary.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DeflateBlocks(
+    ParallelDeflate *pdPtr,
+    const Bytef *data,		/* Data to compress. */
+    int length,			/* Length of the data. */
+    int flush,			/* How to end the last block of the run. */
+    Tcl_Obj *outObj)		/* Where to append compressed data. */
+{
+    int numBlocks = (length + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
+    int first, numTasks, numBuffers, i, n, result = Z_OK;
+    DeflateBlock *blocks;
+    ClientData *clientData;
+    unsigned char trailer[8];
+
+    if (numBlocks == 0) {
+	if (flush == Z_NO_FLUSH) {
+	    return Z_OK;
+	}
+	numBlocks = 1;
+    }
+    if (!pdPtr->started) {
+	AppendDeflateHeader(pdPtr, outObj);
+	pdPtr->started = 1;
+    }
+
+    numTasks = (numBlocks < pdPtr->numThreads) ? numBlocks:pdPtr->numThreads;
+    numBuffers = numTasks;
+    blocks = (DeflateBlock *) ckalloc(numTasks * sizeof(DeflateBlock));
+    clientData = (ClientData *) ckalloc(numTasks * sizeof(ClientData));
+    for (i=0 ; i<numBuffers ; i++) {
+	blocks[i].outSize = compressBound(PARALLEL_BLOCK_SIZE) + 16;
+	blocks[i].out = (Bytef *) ckalloc(blocks[i].outSize);
+	clientData[i] = &blocks[i];
+    }
+
+    for (first=0 ; first<numBlocks ; first+=numTasks) {
+	if (numTasks > numBlocks - first) {
+	    numTasks = numBlocks - first;
+	}
+	for (i=0 ; i<numTasks ; i++) {
+	    DeflateBlock *blockPtr = &blocks[i];
+	    int offset = (first + i) * PARALLEL_BLOCK_SIZE;
+
+	    blockPtr->data = data + offset;
+	    blockPtr->length = length - offset;
+	    if (blockPtr->length > PARALLEL_BLOCK_SIZE) {
+		blockPtr->length = PARALLEL_BLOCK_SIZE;
+	    }
+	    if (offset == 0) {
+		blockPtr->dict = pdPtr->dict;
+		blockPtr->dictLen = pdPtr->dictLen;
+	    } else {
+		blockPtr->dict = blockPtr->data - DICTIONARY_SIZE;
+		blockPtr->dictLen = DICTIONARY_SIZE;
+	    }
+	    blockPtr->format = pdPtr->format;
+	    blockPtr->level = pdPtr->level;
+	    blockPtr->flush = Z_SYNC_FLUSH;
+	    if (flush == Z_FINISH && first + i == numBlocks - 1) {
+		blockPtr->flush = Z_FINISH;
+	    }
+	}
+	TclRunTasks(numTasks, DeflateBlockProc, clientData);
+
+	/*
+	 * Collect the compressed blocks in order.
+	 */
+
+	for (i=0 ; i<numTasks ; i++) {
+	    DeflateBlock *blockPtr = &blocks[i];
+
+	    if (blockPtr->code != Z_OK) {
+		result = blockPtr->code;
+		goto done;
+	    }
+	    AppendBytes(outObj, blockPtr->out, (int) blockPtr->outLength);
+	    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+		pdPtr->check = crc32_combine(pdPtr->check, blockPtr->check,
+			(z_off_t) blockPtr->length);
+	    } else if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+		pdPtr->check = adler32_combine(pdPtr->check, blockPtr->check,
+			(z_off_t) blockPtr->length);
+	    }
+	    pdPtr->totalIn += blockPtr->length;
+	}
+    }
+
+    /*
+     * Remember the end of the input as the dictionary for what comes next,
+     * unless a full flush asks for the blocks after it to stand alone.
+     */
+
+    if (flush == Z_FULL_FLUSH) {
+	pdPtr->dictLen = 0;
+    } else if (length >= DICTIONARY_SIZE) {
+	memcpy(pdPtr->dict, data + length - DICTIONARY_SIZE, DICTIONARY_SIZE);
+	pdPtr->dictLen = DICTIONARY_SIZE;
+    } else {
+	n = DICTIONARY_SIZE - length;
+	if (n > pdPtr->dictLen) {
+	    n = pdPtr->dictLen;
+	}
+	memmove(pdPtr->dict, pdPtr->dict + pdPtr->dictLen - n, (size_t) n);
+	memcpy(pdPtr->dict + n, data, (size_t) length);
+	pdPtr->dictLen = n + length;
+    }
+
+    /*
+     * Write the trailer: the big-endian Adler-32 checksum for the zlib
+     * format, or the little-endian CRC-32 and length for gzip.
+     */
+
+    if (flush == Z_FINISH) {
+	pdPtr->finished = 1;
+	if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	    for (i=0 ; i<4 ; i++) {
+		trailer[i] = (unsigned char) (pdPtr->check >> (24 - 8*i));
+	    }
+	    AppendBytes(outObj, trailer, 4);
+	} else if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	    for (i=0 ; i<4 ; i++) {
+		trailer[i] = (unsigned char) (pdPtr->check >> (8*i));
+		trailer[i+4] = (unsigned char) (pdPtr->totalIn >> (8*i));
+	    }
+	    AppendBytes(outObj, trailer, 8);
+	}
+    }
+
+  done:
+    for (i=0 ; i<numBuffers ; i++) {
+	ckfree((char *) blocks[i].out);
+    }
+    ckfree((char *) blocks);
+    ckfree((char *) clientData);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeflateBlockProc --
+ *
+ *	Compresses one block as raw deflate data, on a thread of its own. It
+ *	must not use interpreters or Tcl_Objs.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeflateBlockProc(
+    ClientData clientData)	/* The DeflateBlock to compress. */
+{
+    DeflateBlock *blockPtr = clientData;
+    z_stream stream;
+    int e;
+
+    if (blockPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	blockPtr->check = crc32(0, blockPtr->data, blockPtr->length);
+    } else if (blockPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	blockPtr->check = adler32(1, blockPtr->data, blockPtr->length);
+    }
+
+    memset(&stream, 0, sizeof(z_stream));
+    e = deflateInit2(&stream, blockPtr->level, Z_DEFLATED, WBITS_RAW,
+	    MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (e != Z_OK) {
+	blockPtr->code = e;
+	return;
+    }
+    if (blockPtr->dictLen > 0) {
+	e = deflateSetDictionary(&stream, blockPtr->dict, blockPtr->dictLen);
+    }
+    if (e == Z_OK) {
+	stream.next_in = (Bytef *) blockPtr->data;
+	stream.avail_in = blockPtr->length;
+	stream.next_out = blockPtr->out;
+	stream.avail_out = blockPtr->outSize;
+
+	/*
+	 * The output buffer is big enough for the whole block, so a single
+	 * call must consume all input and complete the flush.
+	 */
+
+	e = deflate(&stream, blockPtr->flush);
+	if (e == Z_STREAM_END || (e == Z_OK && blockPtr->flush != Z_FINISH
+		&& stream.avail_out > 0)) {
+	    e = Z_OK;
+	} else if (e == Z_OK) {
+	    e = Z_BUF_ERROR;
+	}
+    }
+    blockPtr->outLength = blockPtr->outSize - stream.avail_out;
+    blockPtr->code = e;
+    deflateEnd(&stream);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendDeflateHeader --
+ *
+ *	Appends the header of the zlib or gzip format to a compressed
+ *	bytearray, as zlib would write it for the same level and gzip header
+ *	description.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendDeflateHeader(
+    ParallelDeflate *pdPtr,
+    Tcl_Obj *outObj)
+{
+    unsigned char buf[10];
+    gz_header *headerPtr = pdPtr->headerPtr;
+    int level = pdPtr->level, i, start, length;
+    unsigned header;
+    unsigned char *bytes;
+    uLong crc;
+
+    if (level == Z_DEFAULT_COMPRESSION) {
+	level = 6;
+    }
+
+    if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	header = (Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8;
+	header |= (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+	header += 31 - (header % 31);
+	buf[0] = (unsigned char) (header >> 8);
+	buf[1] = (unsigned char) header;
+	AppendBytes(outObj, buf, 2);
+    } else if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	(void) Tcl_GetByteArrayFromObj(outObj, &start);
+	buf[0] = 0x1f;
+	buf[1] = 0x8b;
+	buf[2] = Z_DEFLATED;
+	buf[3] = 0;
+	for (i=4 ; i<8 ; i++) {
+	    buf[i] = 0;
+	}
+	buf[8] = (level == 9 ? 2 : level < 2 ? 4 : 0);
+	buf[9] = GZIP_OS_CODE;
+	if (headerPtr != NULL) {
+	    buf[3] = (headerPtr->text ? 1 : 0) + (headerPtr->hcrc ? 2 : 0)
+		    + (headerPtr->name ? 8 : 0)
+		    + (headerPtr->comment ? 16 : 0);
+	    for (i=0 ; i<4 ; i++) {
+		buf[4+i] = (unsigned char) (headerPtr->time >> (8*i));
+	    }
+	    buf[9] = (unsigned char) headerPtr->os;
+	}
+	AppendBytes(outObj, buf, 10);
+	if (headerPtr != NULL) {
+	    if (headerPtr->name) {
+		AppendBytes(outObj, headerPtr->name,
+			(int) strlen((char *) headerPtr->name) + 1);
+	    }
+	    if (headerPtr->comment) {
+		AppendBytes(outObj, headerPtr->comment,
+			(int) strlen((char *) headerPtr->comment) + 1);
+	    }
+	    if (headerPtr->hcrc) {
+		bytes = Tcl_GetByteArrayFromObj(outObj, &length);
+		crc = crc32(0, bytes + start, (uInt) (length - start));
+		buf[0] = (unsigned char) crc;
+		buf[1] = (unsigned char) (crc >> 8);
+		AppendBytes(outObj, buf, 2);
+	    }
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendBytes --
+ *
+ *	Appends bytes to an unshared bytearray.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendBytes(
+    Tcl_Obj *objPtr,
+    const Bytef *bytes,
+    int length)
+{
+    int oldLength;
+
+    (void) Tcl_GetByteArrayFromObj(objPtr, &oldLength);
+    memcpy(Tcl_SetByteArrayLength(objPtr, oldLength + length) + oldLength,
+	    bytes, (size_t) length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibParallelDeflate --
+ *
+ *	Like Tcl_ZlibDeflate, but compresses with numThreads threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ZlibParallelDeflate(
+    Tcl_Interp *interp,
+    int format,
+    Tcl_Obj *data,
+    int level,
+    Tcl_Obj *gzipHeaderDictObj,
+    int numThreads)
+{
+    GzipHeader header;
+    gz_header *headerPtr = NULL;
+    int inLen, extraSize = 32, e;
+    Bytef *inData;
+    ParallelDeflate *pdPtr;
+    Tcl_Obj *obj;
+
+    if (format == TCL_ZLIB_FORMAT_GZIP && gzipHeaderDictObj) {
+	headerPtr = &header.header;
+	memset(headerPtr, 0, sizeof(gz_header));
+	if (GenerateHeader(interp, gzipHeaderDictObj, &header,
+		&extraSize) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    /*
+     * Reserve the space that the compressed data can take, so that the
+     * blocks are appended without reallocating.
+     */
+
+    inData = Tcl_GetByteArrayFromObj(data, &inLen);
+    TclNewObj(obj);
+    Tcl_SetByteArrayLength(obj, compressBound(inLen) + extraSize
+	    + 16 * (inLen / PARALLEL_BLOCK_SIZE + 1));
+    Tcl_SetByteArrayLength(obj, 0);
+
+    pdPtr = NewParallelDeflate(format, level, numThreads, headerPtr);
+    e = ParallelDeflateAdd(pdPtr, inData, inLen, Z_FINISH, obj);
+    FreeParallelDeflate(pdPtr);
+    if (e != Z_OK) {
+	ConvertError(interp, e);
+	TclDecrRefCount(obj);
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, obj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetThreadCount --
+ *
+ *	Parses the value of a -threads option. Zero means one thread per
+ *	processor.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetThreadCount(
+    Tcl_Interp *interp,
+    Tcl_Obj *objPtr,
+    int *countPtr)
+{
+    if (Tcl_GetIntFromObj(interp, objPtr, countPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (*countPtr < 0) {
+	Tcl_AppendResult(interp, "thread count must be at least 0", NULL);
+	return TCL_ERROR;
+    }
+    if (*countPtr == 0) {
+	*countPtr = TclpNumProcessors();
+    }
+    return TCL_OK;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -1581,7 +2270,7 @@ ZlibCmd(
     int objc,
     Tcl_Obj *const objv[])
 {
-    int command, dlen, mode, format, i, option, level = -1;
+    int command, dlen, mode, format, i, option, level = -1, threads = 1;
     unsigned start, buffersize = 0;
     Tcl_ZlibStream zh;
     Byte *data;
@@ -1683,15 +2372,15 @@ ZlibCmd(
 		NULL);
     case CMD_GZIP:			/* gzip data ?level?
 					 * -> gzippedCompressedData */
-	if (objc < 3 || objc > 7 || ((objc & 1) == 0)) {
+	if (objc < 3 || objc > 9 || ((objc & 1) == 0)) {
 	    Tcl_WrongNumArgs(interp, 2, objv,
-		    "data ?-level level? ?-header header?");
+		    "data ?-level level? ?-header header? ?-threads count?");
 	    return TCL_ERROR;
 	}
 	headerDictObj = NULL;
 	for (i=3 ; i<objc ; i+=2) {
 	    static const char *const gzipopts[] = {
-		"-header", "-level", NULL
+		"-header", "-level", "-threads", NULL
 	    };
 
 	    if (Tcl_GetIndexFromObj(interp, objv[i], gzipopts, "option", 0,
@@ -1712,8 +2401,17 @@ ZlibCmd(
 		    goto badLevel;
 		}
 		break;
+	    case 2:
+		if (GetThreadCount(interp, objv[i+1], &threads) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		break;
 	    }
 	}
+	if (threads > 1) {
+	    return ZlibParallelDeflate(interp, TCL_ZLIB_FORMAT_GZIP, objv[2],
+		    level, headerDictObj, threads);
+	}
 	return Tcl_ZlibDeflate(interp, TCL_ZLIB_FORMAT_GZIP, objv[2], level,
 		headerDictObj);
     case CMD_INFLATE:			/* inflate rawcomprdata ?bufferSize?
@@ -1799,10 +2497,11 @@ ZlibCmd(
 	}
 	return TCL_OK;
     case CMD_STREAM:			/* stream deflate/inflate/...gunzip \
-					 *    ?level?
+					 *    ?level? | ?options?
 					 *	-> handleCmd */
-	if (objc < 3 || objc > 4) {
-	    Tcl_WrongNumArgs(interp, 2, objv, "mode ?level?");
+	if (objc < 3 || objc > 7 || (objc > 4 && (objc & 1) == 0)) {
+	    Tcl_WrongNumArgs(interp, 2, objv,
+		    "mode ?-level level? ?-threads count?");
 	    return TCL_ERROR;
 	}
 	if (Tcl_GetIndexFromObj(interp, objv[2], stream_formats, "mode", 0,
@@ -1827,6 +2526,7 @@ ZlibCmd(
 	    format = TCL_ZLIB_FORMAT_GZIP;
 	    break;
 	}
+	level = Z_DEFAULT_COMPRESSION;
 	if (objc == 4) {
 	    if (Tcl_GetIntFromObj(interp, objv[3],
 		    (int *) &level) != TCL_OK) {
@@ -1835,13 +2535,42 @@ ZlibCmd(
 	    if (level < 0 || level > 9) {
 		goto badLevel;
 	    }
-	} else {
-	    level = Z_DEFAULT_COMPRESSION;
+	}
+	for (i=3 ; i<objc-1 ; i+=2) {
+	    static const char *const streamopts[] = {
+		"-level", "-threads", NULL
+	    };
+
+	    if (Tcl_GetIndexFromObj(interp, objv[i], streamopts, "option", 0,
+		    &option) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    switch (option) {
+	    case 0:
+		if (Tcl_GetIntFromObj(interp, objv[i+1],
+			&level) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		if (level < 0 || level > 9) {
+		    extraInfoStr = "\n    (in -level option)";
+		    goto badLevel;
+		}
+		break;
+	    case 1:
+		if (GetThreadCount(interp, objv[i+1], &threads) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		break;
+	    }
 	}
 	if (Tcl_ZlibStreamInit(interp, mode, format, level, NULL,
 		&zh) != TCL_OK) {
 	    return TCL_ERROR;
 	}
+	if (threads > 1 && mode == TCL_ZLIB_STREAM_DEFLATE) {
+	    ((ZlibStreamHandle *) zh)->pdPtr =
+		    NewParallelDeflate(format, level, threads, NULL);
+	}
 	Tcl_SetObjResult(interp, Tcl_ZlibStreamGetCommandName(zh));
 	return TCL_OK;
     case CMD_PUSH: {			/* push mode channel options...
@@ -1849,10 +2578,10 @@ ZlibCmd(
 	Tcl_Channel chan;
 	int chanMode;
 	static const char *const pushOptions[] = {
-	    "-header", "-level", "-limit",
+	    "-header", "-level", "-limit", "-threads",
 	    NULL
 	};
-	enum pushOptions {poHeader, poLevel, poLimit};
+	enum pushOptions {poHeader, poLevel, poLimit, poThreads};
 	Tcl_Obj *headerObj = NULL;
 	int limit = 1, dummy;
 
@@ -1971,11 +2700,22 @@ ZlibCmd(
 		    limit = 1;
 		}
 		break;
+	    case poThreads:
+		if (++i > objc-1) {
+		    Tcl_AppendResult(interp,
+			    "value missing for -threads option", NULL);
+		    return TCL_ERROR;
+		}
+		if (GetThreadCount(interp, objv[i], &threads) != TCL_OK) {
+		    Tcl_AddErrorInfo(interp, "\n    (in -threads option)");
+		    return TCL_ERROR;
+		}
+		break;
 	    }
 	}
 
-	if (ZlibStackChannelTransform(interp, mode, format, level, chan,
-		headerObj) == NULL) {
+	if (ZlibStackChannelTransform(interp, mode, format, level, threads,
+		chan, headerObj) == NULL) {
 	    return TCL_ERROR;
 	}
 	Tcl_SetObjResult(interp, objv[3]);
@@ -2256,7 +2996,23 @@ ZlibTransformClose(
     int e, result = TCL_OK;
 
     ZlibTransformTimerKill(cd);
-    if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
+    if (cd->mode == TCL_ZLIB_STREAM_DEFLATE && cd->pdPtr != NULL) {
+	e = ZlibTransformParallelWrite(cd, NULL, 0, Z_FINISH);
+	if (e != Z_OK && !TclInThreadExit()) {
+	    if (e != Z_ERRNO) {
+		ConvertError(interp, e);
+	    } else if (interp) {
+		Tcl_AppendResult(interp, "error while finalizing file: ",
+			Tcl_PosixError(interp), NULL);
+	    }
+	}
+	if (e != Z_OK) {
+	    result = TCL_ERROR;
+	}
+	FreeParallelDeflate(cd->pdPtr);
+	cd->pdPtr = NULL;
+	deflateEnd(&cd->outStream);
+    } else if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	cd->outStream.avail_in = 0;
 	do {
 	    cd->outStream.next_out = (Bytef *) cd->outBuffer;
@@ -2404,6 +3160,19 @@ ZlibTransformOutput(
 		errorCodePtr);
     }
 
+    if (cd->pdPtr != NULL) {
+	e = ZlibTransformParallelWrite(cd, buf, toWrite, Z_NO_FLUSH);
+	if (e == Z_ERRNO) {
+	    *errorCodePtr = Tcl_GetErrno();
+	    return -1;
+	} else if (e != Z_OK) {
+	    Tcl_SetChannelError(cd->parent, Tcl_NewStringObj(zError(e), -1));
+	    *errorCodePtr = EINVAL;
+	    return -1;
+	}
+	return toWrite;
+    }
+
     cd->outStream.next_in = (Bytef *) buf;
     cd->outStream.avail_in = toWrite;
     do {
@@ -2431,6 +3200,45 @@ ZlibTransformOutput(
     return toWrite - cd->outStream.avail_out;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibTransformParallelWrite --
+ *
+ *	Compresses data written to a transform that uses several threads,
+ *	writing out whatever compressed data that produces.
+ *
+ * Results:
+ *	Z_OK, a zlib error code, or Z_ERRNO if writing to the underlying
+ *	channel failed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ZlibTransformParallelWrite(
+    ZlibChannelData *cd,
+    const char *buf,		/* Data to compress. */
+    int toWrite,		/* Length of the data. */
+    int flush)			/* Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FULL_FLUSH or
+				 * Z_FINISH. */
+{
+    Tcl_Obj *outObj;
+    unsigned char *bytes;
+    int e, length;
+
+    TclNewObj(outObj);
+    e = ParallelDeflateAdd(cd->pdPtr, (const Bytef *) buf, toWrite, flush,
+	    outObj);
+    bytes = Tcl_GetByteArrayFromObj(outObj, &length);
+    if (e == Z_OK && length > 0
+	    && Tcl_WriteRaw(cd->parent, (char *) bytes, length) < 0) {
+	e = Z_ERRNO;
+    }
+    TclDecrRefCount(outObj);
+    return e;
+}
+
 static int
 ZlibTransformSetOption(			/* not used */
     ClientData instanceData,
@@ -2460,6 +3268,19 @@ ZlibTransformSetOption(			/* not used */
 	return TCL_ERROR;
 
     doFlush:
+	if (cd->pdPtr != NULL) {
+	    int e = ZlibTransformParallelWrite(cd, NULL, 0, flushType);
+
+	    if (e == Z_ERRNO) {
+		Tcl_AppendResult(interp, "problem flushing channel: ",
+			Tcl_PosixError(interp), NULL);
+		return TCL_ERROR;
+	    } else if (e != Z_OK) {
+		ConvertError(interp, e);
+		return TCL_ERROR;
+	    }
+	    return TCL_OK;
+	}
 	cd->outStream.avail_in = 0;
 	do {
 	    int e;
@@ -2515,7 +3336,9 @@ ZlibTransformGetOption(
 	uLong crc;
 	char buf[12];
 
-	if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
+	if (cd->pdPtr != NULL) {
+	    crc = ParallelDeflateChecksum(cd->pdPtr);
+	} else if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	    crc = cd->outStream.adler;
 	} else {
 	    crc = cd->inStream.adler;
@@ -2688,6 +3511,8 @@ ZlibStackChannelTransform(
 				 * decompressing transforms. */
     int level,			/* What compression level to use. Ignored for
 				 * decompressing transforms. */
+    int numThreads,		/* How many threads to compress with. Ignored
+				 * for decompressing transforms. */
     Tcl_Channel channel,	/* The channel to attach to. */
     Tcl_Obj *gzipHeaderDictPtr)	/* A description of header to use, or NULL to
 				 * use a default. Ignored if not compressing
@@ -2771,6 +3596,10 @@ ZlibStackChannelTransform(
 		goto error;
 	    }
 	}
+	if (numThreads > 1) {
+	    cd->pdPtr = NewParallelDeflate(format, level, numThreads,
+		    (cd->flags & OUT_HEADER) ? &cd->outHeader.header : NULL);
+	}
     }
 
     chan = Tcl_StackChannel(interp, &zlibChannelType, cd,
@@ -2792,6 +3621,9 @@ ZlibStackChannelTransform(
 	ckfree(cd->outBuffer);
 	deflateEnd(&cd->outStream);
     }
+    if (cd->pdPtr) {
+	FreeParallelDeflate(cd->pdPtr);
+    }
     ckfree((char *) cd);
     return NULL;
 }
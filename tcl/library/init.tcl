@@ -182,12 +182,10 @@ if {[interp issafe]} {
 
 	# Auto-loading stubs for 'clock.tcl'
 
-	foreach cmd {add format scan} {
-	    proc ::tcl::clock::$cmd args {
-		variable TclLibDir
-		source -encoding utf-8 [file join $TclLibDir clock.tcl]
-		return [uplevel 1 [info level 0]]
-	    }
+	proc ::tcl::clock::add args {
+	    variable TclLibDir
+	    source -encoding utf-8 [file join $TclLibDir clock.tcl]
+	    return [uplevel 1 [info level 0]]
 	}
 
 	return [uplevel 1 [info level 0]]
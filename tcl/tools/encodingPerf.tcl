@@ -0,0 +1,57 @@
+# encodingPerf.tcl --
+#
+#	Times conversions between UTF-8 and a few common encodings, both
+#	through [encoding] and through channels, for mostly ASCII text such as
+#	log files and for text with many non-ASCII chars. Run it from the
+#	build directory with "make encoding-perf", or with any tclsh as
+#
+#		tclsh encodingPerf.tcl ?encoding ...?
+#
+# See the file "license.terms" for information on usage and redistribution of
+# this file, and for a DISCLAIMER OF ALL WARRANTIES.
+
+set encodings {utf-8 iso8859-1 ascii cp1252 koi8-r shiftjis}
+if {$argc} {
+    set encodings $argv
+}
+
+set line "2026-10-17 12:00:00 INFO \[worker-7\] request handled in 12ms\n"
+set texts [list \
+    ascii [string repeat $line 16384] \
+    mixed [string repeat "Gr\u00fc\u00dfe, \u041f\u0440\u0438\u0432\u0435\u0442, \u3053\u3093\u306b\u3061\u306f: $line" 8192]]
+
+set file [file join [expr {
+    [info exists env(TMPDIR)] ? $env(TMPDIR) : "/tmp"
+}] encodingPerf[pid].dat]
+
+proc rate {bytes script} {
+    set usec [lindex [time {uplevel 1 $script} 5] 0]
+    return [format %.1f [expr {$bytes / ($usec + 1.0)}]]
+}
+
+puts [format "%-10s %-6s %10s %10s %10s %10s" \
+	encoding text convertto convfrom write read]
+puts "(MB/s of UTF-8 text)"
+foreach enc $encodings {
+    foreach {name text} $texts {
+	set bytes [string length [encoding convertto utf-8 $text]]
+	set external [encoding convertto $enc $text]
+	set to [rate $bytes {encoding convertto $enc $text}]
+	set from [rate $bytes {encoding convertfrom $enc $external}]
+	set write [rate $bytes {
+	    set f [open $file w]
+	    fconfigure $f -encoding $enc -translation lf
+	    puts -nonewline $f $text
+	    close $f
+	}]
+	set read [rate $bytes {
+	    set f [open $file r]
+	    fconfigure $f -encoding $enc -translation lf
+	    read $f
+	    close $f
+	}]
+	puts [format "%-10s %-6s %10s %10s %10s %10s" \
+		$enc $name $to $from $write $read]
+    }
+}
+file delete $file
@@ -0,0 +1,59 @@
+# zlibPerf.tcl --
+#
+#	Times compression with [zlib gzip], with a [zlib stream] that is
+#	flushed every 256 KiB, and through a channel with [zlib push], for
+#	each of a few thread counts. Run it from the build directory with
+#	"make zlib-perf", or with any tclsh as
+#
+#		tclsh zlibPerf.tcl ?threads ...?
+#
+# See the file "license.terms" for information on usage and redistribution of
+# this file, and for a DISCLAIMER OF ALL WARRANTIES.
+
+set threadCounts {1 2 4 0}
+if {$argc} {
+    set threadCounts $argv
+}
+
+set line "2026-10-17 12:00:00 INFO \[worker-7\] request handled in 12ms\n"
+set text [string repeat $line 65536]
+for {set i 0} {$i < 16384} {incr i} {
+    append text [format %08x [expr {int(rand() * 0x7fffffff)}]]
+}
+set data [encoding convertto utf-8 $text]
+set bytes [string length $data]
+set chunk [expr {256 * 1024}]
+
+set file [file join [expr {
+    [info exists env(TMPDIR)] ? $env(TMPDIR) : "/tmp"
+}] zlibPerf[pid].gz]
+
+proc rate {bytes script} {
+    set usec [lindex [time {uplevel 1 $script} 3] 0]
+    return [format %.1f [expr {$bytes / ($usec + 1.0)}]]
+}
+
+puts [format "%-8s %10s %10s %10s" threads gzip stream push]
+puts "(MB/s of input, [format %.1f [expr {$bytes / 1048576.0}]] MB)"
+foreach threads $threadCounts {
+    set gzip [rate $bytes {zlib gzip $data -threads $threads}]
+    set stream [rate $bytes {
+	set z [zlib stream deflate -threads $threads]
+	for {set i 0} {$i < $bytes} {incr i $chunk} {
+	    $z put -flush [string range $data $i [expr {$i + $chunk - 1}]]
+	    $z get
+	}
+	$z put -finalize {}
+	$z get
+	$z close
+    }]
+    set push [rate $bytes {
+	set f [open $file w]
+	fconfigure $f -translation binary
+	zlib push gzip $f -threads $threads
+	puts -nonewline $f $data
+	close $f
+    }]
+    puts [format "%-8s %10s %10s %10s" $threads $gzip $stream $push]
+}
+file delete $file
@@ -13,8 +13,26 @@
  * RCS: @(#) $Id$
  */
 
+#ifdef HAVE_SPLICE
+#   ifndef _GNU_SOURCE
+#	define _GNU_SOURCE	/* For splice() */
+#   endif
+#endif
+
 #include "tclInt.h"	/* Internal definitions for Tcl. */
 #include "tclIO.h"	/* To get Channel type declaration. */
+#ifdef HAVE_POLL
+#   include <poll.h>
+#endif
+#ifdef HAVE_SPLICE
+#   include <sys/sendfile.h>
+
+/*
+ * The most TclpCopyChannelData asks the kernel to move in one call.
+ */
+
+#   define KERNEL_COPY_MAX	0x40000000
+#endif
 
 #define SUPPORTS_TTY
 
@@ -1786,6 +1804,129 @@ TclpGetDefaultStdChannel(
     return channel;
 }
 
+#ifdef HAVE_SPLICE
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsDescriptorChannel --
+ *
+ *	Tells whether a channel is one of the Unix channel types whose handle
+ *	is a file descriptor that sendfile() or splice() can work on.
+ *
+ * Results:
+ *	1 if it is, 0 if not.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+IsDescriptorChannel(
+    Tcl_Channel chan)		/* Channel to check. */
+{
+    const Tcl_ChannelType *chanTypePtr = Tcl_GetChannelType(chan);
+
+    return ((chanTypePtr == &fileChannelType)
+#ifdef SUPPORTS_TTY
+	    || (chanTypePtr == &ttyChannelType)
+#endif /* SUPPORTS_TTY */
+	    || (strcmp(chanTypePtr->typeName, "tcp") == 0)
+	    || (strcmp(chanTypePtr->typeName, "pipe") == 0));
+}
+#endif /* HAVE_SPLICE */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpCopyChannelData --
+ *
+ *	Copies bytes between two channels that are file descriptors without
+ *	passing them through user space: with sendfile() when reading from a
+ *	regular file, with splice() when either end is a pipe. The caller
+ *	makes sure that neither channel is stacked or has buffered data, that
+ *	both are blocking and that the bytes need no translation.
+ *
+ * Results:
+ *	1 if the copy is complete, i.e. toCopy bytes (-1 for all) have been
+ *	copied or the input reached EOF before that. 0 if this way of copying
+ *	does not apply to the channels or failed, in which case the caller
+ *	must copy the rest itself. Either way the number of bytes copied is
+ *	left in *copiedPtr.
+ *
+ * Side effects:
+ *	Moves data between the descriptors.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpCopyChannelData(
+    Tcl_Channel inChan,		/* Channel to read from. */
+    Tcl_Channel outChan,	/* Channel to write to. */
+    Tcl_WideInt toCopy,		/* Number of bytes to copy, or -1 for all. */
+    Tcl_WideInt *copiedPtr)	/* Where to store the number of bytes
+				 * copied. */
+{
+#ifdef HAVE_SPLICE
+    ClientData data;
+    int inFd, outFd, useSendfile;
+    struct stat inStat, outStat;
+    size_t count;
+    ssize_t done;
+
+    *copiedPtr = 0;
+    if (!IsDescriptorChannel(inChan) || !IsDescriptorChannel(outChan)
+	    || Tcl_GetChannelHandle(inChan, TCL_READABLE, &data) != TCL_OK) {
+	return 0;
+    }
+    inFd = PTR2INT(data);
+    if (Tcl_GetChannelHandle(outChan, TCL_WRITABLE, &data) != TCL_OK) {
+	return 0;
+    }
+    outFd = PTR2INT(data);
+    if (fstat(inFd, &inStat) != 0 || fstat(outFd, &outStat) != 0) {
+	return 0;
+    }
+    if (S_ISREG(inStat.st_mode)) {
+	useSendfile = 1;
+    } else if (S_ISFIFO(inStat.st_mode) || S_ISFIFO(outStat.st_mode)) {
+	useSendfile = 0;
+    } else {
+	return 0;
+    }
+
+    while (toCopy != 0) {
+	count = KERNEL_COPY_MAX;
+	if ((toCopy > 0) && (toCopy < (Tcl_WideInt) count)) {
+	    count = (size_t) toCopy;
+	}
+	if (useSendfile) {
+	    done = sendfile(outFd, inFd, NULL, count);
+	} else {
+	    done = splice(inFd, NULL, outFd, NULL, count, SPLICE_F_MOVE);
+	}
+	if (done < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return 0;
+	} else if (done == 0) {
+	    break;
+	}
+	*copiedPtr += done;
+	if (toCopy > 0) {
+	    toCopy -= done;
+	}
+    }
+    return 1;
+#else
+    *copiedPtr = 0;
+    return 0;
+#endif /* HAVE_SPLICE */
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1918,8 +2059,12 @@ TclUnixWaitForFile(
 				 * forever. */
 {
     Tcl_Time abortTime = {0, 0}, now; /* silence gcc 4 warning */
-    struct timeval blockTime, *timeoutPtr;
     int numFound, result = 0;
+#ifdef HAVE_POLL
+    struct pollfd pollFd;
+    int pollTimeout = timeout;
+#else
+    struct timeval blockTime, *timeoutPtr;
     fd_set readableMask;
     fd_set writableMask;
     fd_set exceptionMask;
@@ -1934,6 +2079,7 @@ TclUnixWaitForFile(
 	/* must never get here, or select masks overrun will occur below */
     }
 #endif
+#endif /* HAVE_POLL */
 
     /*
      * If there is a non-zero finite timeout, compute the time when we give
@@ -1948,6 +2094,7 @@ TclUnixWaitForFile(
 	    abortTime.usec -= 1000000;
 	    abortTime.sec += 1;
 	}
+#ifndef HAVE_POLL
 	timeoutPtr = &blockTime;
     } else if (timeout == 0) {
 	timeoutPtr = &blockTime;
@@ -1955,8 +2102,22 @@ TclUnixWaitForFile(
 	blockTime.tv_usec = 0;
     } else {
 	timeoutPtr = NULL;
+#endif
     }
 
+#ifdef HAVE_POLL
+    pollFd.fd = fd;
+    pollFd.events = 0;
+    if (mask & TCL_READABLE) {
+	pollFd.events |= POLLIN;
+    }
+    if (mask & TCL_WRITABLE) {
+	pollFd.events |= POLLOUT;
+    }
+    if (mask & TCL_EXCEPTION) {
+	pollFd.events |= POLLPRI;
+    }
+#else
     /*
      * Initialize the select masks.
      */
@@ -1964,6 +2125,7 @@ TclUnixWaitForFile(
     FD_ZERO(&readableMask);
     FD_ZERO(&writableMask);
     FD_ZERO(&exceptionMask);
+#endif
 
     /*
      * Loop in a mini-event loop of our own, waiting for either the file to
@@ -1971,6 +2133,51 @@ TclUnixWaitForFile(
      */
 
     while (1) {
+#ifdef HAVE_POLL
+	if (timeout > 0) {
+	    /*
+	     * Round up, so as not to wake up just before the time is up.
+	     */
+
+	    pollTimeout = (int) (abortTime.sec - now.sec) * 1000
+		    + (int) (abortTime.usec - now.usec + 999) / 1000;
+	    if (pollTimeout < 0) {
+		pollTimeout = 0;
+	    }
+	}
+
+	/*
+	 * Wait for the event or a timeout.
+	 */
+
+	pollFd.revents = 0;
+	numFound = poll(&pollFd, 1, pollTimeout);
+	if (numFound == 1) {
+	    /*
+	     * An error, a hangup or a bad descriptor is reported whatever was
+	     * asked for, and would be reported again at once by the next
+	     * poll. Count it as all the conditions waited for, so that the
+	     * caller goes on to the operation and gets its error.
+	     */
+
+	    if (pollFd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+		SET_BITS(result, mask);
+	    }
+	    if (pollFd.revents & POLLIN) {
+		SET_BITS(result, TCL_READABLE);
+	    }
+	    if (pollFd.revents & POLLOUT) {
+		SET_BITS(result, TCL_WRITABLE);
+	    }
+	    if (pollFd.revents & POLLPRI) {
+		SET_BITS(result, TCL_EXCEPTION);
+	    }
+	    result &= mask;
+	    if (result) {
+		break;
+	    }
+	}
+#else
 	if (timeout > 0) {
 	    blockTime.tv_sec = abortTime.sec - now.sec;
 	    blockTime.tv_usec = abortTime.usec - now.usec;
@@ -2019,6 +2226,7 @@ TclUnixWaitForFile(
 		break;
 	    }
 	}
+#endif /* HAVE_POLL */
 	if (timeout == 0) {
 	    break;
 	}
@@ -2027,7 +2235,7 @@ TclUnixWaitForFile(
 	}
 
 	/*
-	 * The select returned early, so we need to recompute the timeout.
+	 * The wait returned early, so we need to recompute the timeout.
 	 */
 
 	Tcl_GetTime(&now);
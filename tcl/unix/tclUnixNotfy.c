@@ -1,9 +1,15 @@
 /*
  * tclUnixNotify.c --
  *
- *	This file contains the implementation of the select()-based
- *	Unix-specific notifier, which is the lowest-level part of the Tcl
- *	event loop. This file works together with generic/tclNotify.c.
+ *	This file contains the implementation of the Unix-specific notifier,
+ *	which is the lowest-level part of the Tcl event loop. This file works
+ *	together with generic/tclNotify.c.
+ *
+ *	Where epoll (Linux) or poll() is available, each thread waits for its
+ *	own files in Tcl_WaitForEvent, with no limit on descriptor numbers,
+ *	and with epoll the cost of a wait depends only on how many files are
+ *	ready. Otherwise files are watched with select(), which in a threaded
+ *	build a special notifier thread does on behalf of all threads.
  *
  * Copyright (c) 1995-1997 Sun Microsystems, Inc.
  *
@@ -18,6 +24,16 @@
 				 * in tclMacOSXNotify.c */
 #include <signal.h>
 
+#if defined(HAVE_EPOLL)
+#   define NOTIFIER_EPOLL
+#   include <sys/epoll.h>
+#elif defined(HAVE_POLL)
+#   define NOTIFIER_POLL
+#   include <poll.h>
+#else
+#   define NOTIFIER_SELECT
+#endif
+
 /*
  * This structure is used to keep track of the notifier info for a registered
  * file.
@@ -33,9 +49,44 @@ typedef struct FileHandler {
     Tcl_FileProc *proc;		/* Function to call, in the style of
 				 * Tcl_CreateFileHandler. */
     ClientData clientData;	/* Argument to pass to proc. */
-    struct FileHandler *nextPtr;/* Next in list of all files we care about. */
+    struct FileHandler *nextPtr;/* Next in list of all files we care about
+				 * (select), or of the files that epoll cannot
+				 * watch (epoll). */
+#ifdef NOTIFIER_EPOLL
+    int epollState;		/* How the file is watched: one of the
+				 * FILE_* values below. */
+#endif
+#ifdef NOTIFIER_POLL
+    int index;			/* Index of the file's entry in the pollFds
+				 * array of its thread. */
+#endif
 } FileHandler;
 
+#ifdef NOTIFIER_EPOLL
+/*
+ * Values for the epollState field of a FileHandler:
+ *
+ * FILE_UNWATCHED -	The file is not in the epoll set, because its handler
+ *			wants no events or wants none that the file reports.
+ * FILE_WATCHED -	The file is in the epoll set.
+ * FILE_REGULAR -	The file is of a kind that epoll refuses to watch,
+ *			such as a regular file. Such files are always ready,
+ *			as select() would report them, and are kept on the
+ *			firstRegularFilePtr list of the thread.
+ */
+
+#define FILE_UNWATCHED	0
+#define FILE_WATCHED	1
+#define FILE_REGULAR	2
+
+/*
+ * Initial size of the array that epoll_wait() fills in. It grows with the
+ * number of file handlers, so that a single wait can report all of them.
+ */
+
+#define INITIAL_READY_EVENTS	16
+#endif /* NOTIFIER_EPOLL */
+
 /*
  * The following structure is what is added to the Tcl event queue when file
  * handlers are ready to fire.
@@ -51,6 +102,7 @@ typedef struct FileHandlerEvent {
 				 * the event is queued). */
 } FileHandlerEvent;
 
+#ifdef NOTIFIER_SELECT
 /*
  * The following structure contains a set of select() masks to track readable,
  * writable, and exceptional conditions.
@@ -61,14 +113,40 @@ typedef struct SelectMasks {
     fd_set writable;
     fd_set exceptional;
 } SelectMasks;
+#endif /* NOTIFIER_SELECT */
 
 /*
  * The following static structure contains the state information for the
- * select based implementation of the Tcl notifier. One of these structures is
- * created for each thread that is using the notifier.
+ * Unix implementation of the Tcl notifier. One of these structures is created
+ * for each thread that is using the notifier.
  */
 
 typedef struct ThreadSpecificData {
+#ifndef NOTIFIER_SELECT
+    int initialized;		/* True once InitThreadNotifier has set up
+				 * the fields below. */
+    Tcl_HashTable fileHandlers;	/* Maps file descriptors to their
+				 * FileHandler. */
+#ifdef NOTIFIER_EPOLL
+    int epollFd;		/* The epoll set of this thread. */
+    struct epoll_event *readyEvents;
+				/* Filled in by epoll_wait(). */
+    int maxReadyEvents;		/* Number of elements in readyEvents. */
+    FileHandler *firstRegularFilePtr;
+				/* List of files that epoll cannot watch. */
+#else
+    struct pollfd *pollFds;	/* The files to watch, as passed to poll(). */
+    FileHandler **pollHandlers;	/* The file handler for each entry of
+				 * pollFds, or NULL for the trigger pipe. */
+    int numPollFds;		/* Number of entries in use in pollFds. */
+    int maxPollFds;		/* Number of entries allocated. */
+#endif
+#ifdef TCL_THREADS
+    int triggerPipe;		/* Other threads wake up this one by writing a
+				 * byte to this end of a pipe, */
+    int receivePipe;		/* ...which makes this end readable. */
+#endif
+#else /* NOTIFIER_SELECT */
     FileHandler *firstFileHandlerPtr;
 				/* Pointer to head of file handler list. */
     SelectMasks checkMasks;	/* This structure is used to build up the
@@ -81,7 +159,8 @@ typedef struct ThreadSpecificData {
     int numFdBits;		/* Number of valid bits in checkMasks (one
 				 * more than highest fd for which
 				 * Tcl_WatchFile has been called). */
-#ifdef TCL_THREADS
+#endif /* NOTIFIER_SELECT */
+#if defined(TCL_THREADS) && defined(NOTIFIER_SELECT)
     int onList;			/* True if it is in this list */
     unsigned int pollState;	/* pollState is used to implement a polling
 				 * handshake between each thread and the
@@ -104,7 +183,7 @@ typedef struct ThreadSpecificData {
 
 static Tcl_ThreadDataKey dataKey;
 
-#ifdef TCL_THREADS
+#if defined(TCL_THREADS) && defined(NOTIFIER_SELECT)
 /*
  * The following static indicates the number of threads that have initialized
  * notifiers.
@@ -178,10 +257,23 @@ static Tcl_ThreadId notifierThread;
  * Static routines defined in this file.
  */
 
-#ifdef TCL_THREADS
+#if defined(TCL_THREADS) && defined(NOTIFIER_SELECT)
 static void	NotifierThreadProc(ClientData clientData);
 #endif
 static int	FileHandlerEventProc(Tcl_Event *evPtr, int flags);
+#ifndef NOTIFIER_SELECT
+static void	FinalizeThreadNotifier(ThreadSpecificData *tsdPtr);
+static void	InitThreadNotifier(ThreadSpecificData *tsdPtr);
+static void	QueueFileEvent(ThreadSpecificData *tsdPtr,
+		    FileHandler *filePtr, int mask);
+static void	UnwatchFile(ThreadSpecificData *tsdPtr,
+		    FileHandler *filePtr);
+static void	WatchFile(ThreadSpecificData *tsdPtr, FileHandler *filePtr);
+#ifdef NOTIFIER_POLL
+static int	NewPollEntry(ThreadSpecificData *tsdPtr,
+		    FileHandler *filePtr);
+#endif
+#endif /* !NOTIFIER_SELECT */
 
 /*
  *----------------------------------------------------------------------
@@ -206,7 +298,11 @@ Tcl_InitNotifier(void)
 	return tclNotifierHooks.initNotifierProc();
     } else {
 	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
-#ifdef TCL_THREADS
+#ifndef NOTIFIER_SELECT
+	if (!tsdPtr->initialized) {
+	    InitThreadNotifier(tsdPtr);
+	}
+#elif defined(TCL_THREADS)
 	tsdPtr->eventReady = 0;
 
 	/*
@@ -262,7 +358,13 @@ Tcl_FinalizeNotifier(
 	tclNotifierHooks.finalizeNotifierProc(clientData);
 	return;
     } else {
-#ifdef TCL_THREADS
+#ifndef NOTIFIER_SELECT
+	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+	if (tsdPtr->initialized) {
+	    FinalizeThreadNotifier(tsdPtr);
+	}
+#elif defined(TCL_THREADS)
 	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
 	Tcl_MutexLock(&notifierMutex);
@@ -343,7 +445,18 @@ Tcl_AlertNotifier(
 	tclNotifierHooks.alertNotifierProc(clientData);
 	return;
     } else {
-#ifdef TCL_THREADS
+#if defined(TCL_THREADS) && !defined(NOTIFIER_SELECT)
+	ThreadSpecificData *tsdPtr = clientData;
+
+	/*
+	 * A full pipe already holds a wakeup that the thread has not seen.
+	 */
+
+	if (write(tsdPtr->triggerPipe, "", 1) != 1
+		&& errno != EAGAIN && errno != EWOULDBLOCK) {
+	    Tcl_Panic("Tcl_AlertNotifier: unable to write to trigger pipe");
+	}
+#elif defined(TCL_THREADS)
 	ThreadSpecificData *tsdPtr = clientData;
 
 	Tcl_MutexLock(&notifierMutex);
@@ -450,6 +563,51 @@ Tcl_CreateFileHandler(
     } else {
 	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 	FileHandler *filePtr;
+#ifndef NOTIFIER_SELECT
+	Tcl_HashEntry *hPtr;
+	int isNew;
+
+	if (!tsdPtr->initialized) {
+	    InitThreadNotifier(tsdPtr);
+	}
+	hPtr = Tcl_CreateHashEntry(&tsdPtr->fileHandlers, INT2PTR(fd), &isNew);
+	if (isNew) {
+	    filePtr = (FileHandler*) ckalloc(sizeof(FileHandler));
+	    filePtr->fd = fd;
+	    filePtr->mask = 0;
+	    filePtr->readyMask = 0;
+	    filePtr->nextPtr = NULL;
+#ifdef NOTIFIER_EPOLL
+	    filePtr->epollState = FILE_UNWATCHED;
+	    if (tsdPtr->fileHandlers.numEntries >= tsdPtr->maxReadyEvents) {
+		tsdPtr->maxReadyEvents *= 2;
+		tsdPtr->readyEvents = (struct epoll_event *) ckrealloc(
+			(char *) tsdPtr->readyEvents, (unsigned)
+			(tsdPtr->maxReadyEvents * sizeof(struct epoll_event)));
+	    }
+#else
+	    filePtr->index = NewPollEntry(tsdPtr, filePtr);
+#endif
+	    Tcl_SetHashValue(hPtr, filePtr);
+	} else {
+	    filePtr = Tcl_GetHashValue(hPtr);
+	}
+	filePtr->proc = proc;
+	filePtr->clientData = clientData;
+
+	/*
+	 * Only tell the system about the file when its mask changes, since
+	 * channels reinstall their handlers often.
+	 */
+
+#ifdef NOTIFIER_EPOLL
+	if (filePtr->mask == mask && filePtr->epollState != FILE_UNWATCHED) {
+	    return;
+	}
+#endif
+	filePtr->mask = mask;
+	WatchFile(tsdPtr, filePtr);
+#else /* NOTIFIER_SELECT */
 
 	for (filePtr = tsdPtr->firstFileHandlerPtr; filePtr != NULL;
 		filePtr = filePtr->nextPtr) {
@@ -490,6 +648,7 @@ Tcl_CreateFileHandler(
 	if (tsdPtr->numFdBits <= fd) {
 	    tsdPtr->numFdBits = fd+1;
 	}
+#endif /* NOTIFIER_SELECT */
     }
 }
 
@@ -518,6 +677,39 @@ Tcl_DeleteFileHandler(
 	tclNotifierHooks.deleteFileHandlerProc(fd);
 	return;
     } else {
+#ifndef NOTIFIER_SELECT
+	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+	FileHandler *filePtr;
+	Tcl_HashEntry *hPtr;
+
+	if (!tsdPtr->initialized) {
+	    return;
+	}
+	hPtr = Tcl_FindHashEntry(&tsdPtr->fileHandlers, INT2PTR(fd));
+	if (hPtr == NULL) {
+	    return;
+	}
+	filePtr = Tcl_GetHashValue(hPtr);
+	Tcl_DeleteHashEntry(hPtr);
+	UnwatchFile(tsdPtr, filePtr);
+
+#ifdef NOTIFIER_POLL
+	/*
+	 * Move the last entry of pollFds into the place of this one.
+	 */
+
+	tsdPtr->numPollFds--;
+	if (filePtr->index < tsdPtr->numPollFds) {
+	    FileHandler *lastPtr = tsdPtr->pollHandlers[tsdPtr->numPollFds];
+
+	    tsdPtr->pollFds[filePtr->index] =
+		    tsdPtr->pollFds[tsdPtr->numPollFds];
+	    tsdPtr->pollHandlers[filePtr->index] = lastPtr;
+	    lastPtr->index = filePtr->index;
+	}
+#endif
+	ckfree((char *) filePtr);
+#else /* NOTIFIER_SELECT */
 	FileHandler *filePtr, *prevPtr;
 	int i;
 	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
@@ -578,6 +770,7 @@ Tcl_DeleteFileHandler(
 	    prevPtr->nextPtr = filePtr->nextPtr;
 	}
 	ckfree((char *) filePtr);
+#endif /* NOTIFIER_SELECT */
     }
 }
 
@@ -626,12 +819,26 @@ FileHandlerEventProc(
      */
 
     tsdPtr = TCL_TSD_INIT(&dataKey);
+#ifndef NOTIFIER_SELECT
+    {
+	Tcl_HashEntry *hPtr = NULL;
+
+	if (tsdPtr->initialized) {
+	    hPtr = Tcl_FindHashEntry(&tsdPtr->fileHandlers,
+		    INT2PTR(fileEvPtr->fd));
+	}
+	filePtr = (hPtr != NULL) ? Tcl_GetHashValue(hPtr) : NULL;
+    }
+#else
     for (filePtr = tsdPtr->firstFileHandlerPtr; filePtr != NULL;
 	    filePtr = filePtr->nextPtr) {
-	if (filePtr->fd != fileEvPtr->fd) {
-	    continue;
+	if (filePtr->fd == fileEvPtr->fd) {
+	    break;
 	}
+    }
+#endif
 
+    if (filePtr != NULL) {
 	/*
 	 * The code is tricky for two reasons:
 	 * 1. The file handler's desired events could have changed since the
@@ -649,7 +856,6 @@ FileHandlerEventProc(
 	if (mask != 0) {
 	    filePtr->proc(filePtr->clientData, mask);
 	}
-	break;
     }
     return 1;
 }
@@ -664,10 +870,10 @@ FileHandlerEventProc(
  *	polls without blocking.
  *
  * Results:
- *	Returns -1 if the select would block forever, otherwise returns 0.
+ *	Returns -1 if the wait would block forever, otherwise returns 0.
  *
  * Side effects:
- *	Queues file events that are detected by the select.
+ *	Queues file events that are detected by the wait.
  *
  *----------------------------------------------------------------------
  */
@@ -679,6 +885,140 @@ Tcl_WaitForEvent(
     if (tclNotifierHooks.waitForEventProc) {
 	return tclNotifierHooks.waitForEventProc(timePtr);
     } else {
+#ifndef NOTIFIER_SELECT
+	ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+	FileHandler *filePtr;
+	Tcl_Time vTime;
+	int timeout, numFound, mask, events, i;
+#ifdef TCL_THREADS
+	char buf[64];
+#endif
+
+	if (!tsdPtr->initialized) {
+	    InitThreadNotifier(tsdPtr);
+	}
+
+	if (timePtr != NULL) {
+	    /*
+	     * TIP #233 (Virtualized Time).
+	     */
+
+	    if (timePtr->sec != 0 || timePtr->usec != 0) {
+		vTime = *timePtr;
+		tclScaleTimeProcPtr(&vTime, tclTimeClientData);
+		timePtr = &vTime;
+	    }
+
+	    /*
+	     * Round up to whole milliseconds, so as not to wake up just before
+	     * a timer is due and then spin until it is.
+	     */
+
+	    if (timePtr->sec < 0) {
+		timeout = 0;
+	    } else if (timePtr->sec >= INT_MAX/1000 - 1) {
+		timeout = INT_MAX;
+	    } else {
+		timeout = (int) timePtr->sec * 1000
+			+ (int) (timePtr->usec + 999) / 1000;
+	    }
+	} else {
+#ifndef TCL_THREADS
+	    if (tsdPtr->fileHandlers.numEntries == 0) {
+		/*
+		 * No timeout and no files, so there are no events possible
+		 * and we must avoid deadlock. As with select(), a signal is
+		 * not something we handle if we aren't using threads.
+		 */
+
+		return -1;
+	    }
+#endif
+	    timeout = -1;
+	}
+
+#ifdef NOTIFIER_EPOLL
+	for (filePtr = tsdPtr->firstRegularFilePtr; filePtr != NULL;
+		filePtr = filePtr->nextPtr) {
+	    if (filePtr->mask & (TCL_READABLE | TCL_WRITABLE)) {
+		timeout = 0;
+		break;
+	    }
+	}
+
+	numFound = epoll_wait(tsdPtr->epollFd, tsdPtr->readyEvents,
+		tsdPtr->maxReadyEvents, timeout);
+	for (i = 0; i < numFound; i++) {
+	    struct epoll_event *eventPtr = tsdPtr->readyEvents + i;
+	    Tcl_HashEntry *hPtr;
+
+#ifdef TCL_THREADS
+	    if (eventPtr->data.fd == tsdPtr->receivePipe) {
+		while (read(tsdPtr->receivePipe, buf, sizeof(buf)) > 0) {
+		    /* Empty loop body. */
+		}
+		continue;
+	    }
+#endif
+	    hPtr = Tcl_FindHashEntry(&tsdPtr->fileHandlers,
+		    INT2PTR(eventPtr->data.fd));
+	    if (hPtr == NULL) {
+		continue;
+	    }
+	    events = eventPtr->events;
+	    mask = 0;
+	    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		mask |= TCL_READABLE;
+	    }
+	    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+		mask |= TCL_WRITABLE;
+	    }
+	    if (events & EPOLLPRI) {
+		mask |= TCL_EXCEPTION;
+	    }
+	    QueueFileEvent(tsdPtr, Tcl_GetHashValue(hPtr), mask);
+	}
+
+	filePtr = tsdPtr->firstRegularFilePtr;
+	while (filePtr != NULL) {
+	    FileHandler *nextPtr = filePtr->nextPtr;
+
+	    QueueFileEvent(tsdPtr, filePtr, TCL_READABLE | TCL_WRITABLE);
+	    filePtr = nextPtr;
+	}
+#else /* NOTIFIER_POLL */
+	numFound = poll(tsdPtr->pollFds, (unsigned) tsdPtr->numPollFds,
+		timeout);
+	for (i = 0; numFound > 0 && i < tsdPtr->numPollFds; i++) {
+	    events = tsdPtr->pollFds[i].revents;
+	    if (events == 0) {
+		continue;
+	    }
+	    numFound--;
+	    filePtr = tsdPtr->pollHandlers[i];
+#ifdef TCL_THREADS
+	    if (filePtr == NULL) {
+		while (read(tsdPtr->receivePipe, buf, sizeof(buf)) > 0) {
+		    /* Empty loop body. */
+		}
+		continue;
+	    }
+#endif
+	    mask = 0;
+	    if (events & (POLLIN | POLLHUP | POLLERR)) {
+		mask |= TCL_READABLE;
+	    }
+	    if (events & (POLLOUT | POLLHUP | POLLERR)) {
+		mask |= TCL_WRITABLE;
+	    }
+	    if (events & POLLPRI) {
+		mask |= TCL_EXCEPTION;
+	    }
+	    QueueFileEvent(tsdPtr, filePtr, mask);
+	}
+#endif /* NOTIFIER_POLL */
+	return 0;
+#else /* NOTIFIER_SELECT */
 	FileHandler *filePtr;
 	FileHandlerEvent *fileEvPtr;
 	int mask;
@@ -880,10 +1220,369 @@ Tcl_WaitForEvent(
 	Tcl_MutexUnlock(&notifierMutex);
 #endif /* TCL_THREADS */
 	return 0;
+#endif /* NOTIFIER_SELECT */
     }
 }
 
+#ifndef NOTIFIER_SELECT
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitThreadNotifier --
+ *
+ *	Sets up the notifier state of a thread: its table of file handlers,
+ *	the epoll set or poll() array, and (with threads) the pipe through
+ *	which other threads wake it up.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Opens file descriptors and allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InitThreadNotifier(
+    ThreadSpecificData *tsdPtr)	/* Notifier state of the current thread. */
+{
+#ifdef TCL_THREADS
+    int fds[2];
+#endif
+
+    Tcl_InitHashTable(&tsdPtr->fileHandlers, TCL_ONE_WORD_KEYS);
+#ifdef NOTIFIER_EPOLL
+    tsdPtr->epollFd = epoll_create(INITIAL_READY_EVENTS);
+    if (tsdPtr->epollFd < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not create epoll set");
+    }
+    if (fcntl(tsdPtr->epollFd, F_SETFD, FD_CLOEXEC) < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not make epoll set close-on-exec");
+    }
+    tsdPtr->maxReadyEvents = INITIAL_READY_EVENTS;
+    tsdPtr->readyEvents = (struct epoll_event *)
+	    ckalloc(INITIAL_READY_EVENTS * sizeof(struct epoll_event));
+    tsdPtr->firstRegularFilePtr = NULL;
+#else
+    tsdPtr->pollFds = NULL;
+    tsdPtr->pollHandlers = NULL;
+    tsdPtr->numPollFds = 0;
+    tsdPtr->maxPollFds = 0;
+#endif
+
+#ifdef TCL_THREADS
+    if (pipe(fds) != 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not create trigger pipe");
+    }
+    if (TclUnixSetBlockingMode(fds[0], TCL_MODE_NONBLOCKING) < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not make receive pipe non blocking");
+    }
+    if (TclUnixSetBlockingMode(fds[1], TCL_MODE_NONBLOCKING) < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not make trigger pipe non blocking");
+    }
+    if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not make receive pipe close-on-exec");
+    }
+    if (fcntl(fds[1], F_SETFD, FD_CLOEXEC) < 0) {
+	Tcl_Panic("Tcl_InitNotifier: could not make trigger pipe close-on-exec");
+    }
+    tsdPtr->receivePipe = fds[0];
+    tsdPtr->triggerPipe = fds[1];
+#ifdef NOTIFIER_EPOLL
+    {
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = tsdPtr->receivePipe;
+	if (epoll_ctl(tsdPtr->epollFd, EPOLL_CTL_ADD, tsdPtr->receivePipe,
+		&event) < 0) {
+	    Tcl_Panic("Tcl_InitNotifier: could not watch receive pipe");
+	}
+    }
+#else
+    {
+	int index = NewPollEntry(tsdPtr, NULL);
+
+	tsdPtr->pollFds[index].fd = tsdPtr->receivePipe;
+	tsdPtr->pollFds[index].events = POLLIN;
+    }
+#endif
+#endif /* TCL_THREADS */
+
+    tsdPtr->initialized = 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FinalizeThreadNotifier --
+ *
+ *	Releases everything that InitThreadNotifier set up, along with any
+ *	file handlers that are still registered.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Closes file descriptors and frees memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FinalizeThreadNotifier(
+    ThreadSpecificData *tsdPtr)	/* Notifier state of the current thread. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (hPtr = Tcl_FirstHashEntry(&tsdPtr->fileHandlers, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	ckfree((char *) Tcl_GetHashValue(hPtr));
+    }
+    Tcl_DeleteHashTable(&tsdPtr->fileHandlers);
+#ifdef NOTIFIER_EPOLL
+    close(tsdPtr->epollFd);
+    ckfree((char *) tsdPtr->readyEvents);
+    tsdPtr->firstRegularFilePtr = NULL;
+#else
+    if (tsdPtr->pollFds != NULL) {
+	ckfree((char *) tsdPtr->pollFds);
+	ckfree((char *) tsdPtr->pollHandlers);
+    }
+#endif
 #ifdef TCL_THREADS
+    close(tsdPtr->receivePipe);
+    close(tsdPtr->triggerPipe);
+#endif
+    tsdPtr->initialized = 0;
+}
+
+#ifdef NOTIFIER_POLL
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewPollEntry --
+ *
+ *	Adds an entry to the end of the poll() array of a thread. The entry
+ *	watches nothing until WatchFile fills it in.
+ *
+ * Results:
+ *	The index of the new entry.
+ *
+ * Side effects:
+ *	The array may be reallocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+NewPollEntry(
+    ThreadSpecificData *tsdPtr,	/* Notifier state of the current thread. */
+    FileHandler *filePtr)	/* Handler of the file for the entry, or NULL
+				 * for the trigger pipe. */
+{
+    int index = tsdPtr->numPollFds++;
+
+    if (index >= tsdPtr->maxPollFds) {
+	tsdPtr->maxPollFds = (index == 0) ? 16 : 2 * index;
+	tsdPtr->pollFds = (struct pollfd *) ckrealloc(
+		(char *) tsdPtr->pollFds,
+		tsdPtr->maxPollFds * sizeof(struct pollfd));
+	tsdPtr->pollHandlers = (FileHandler **) ckrealloc(
+		(char *) tsdPtr->pollHandlers,
+		tsdPtr->maxPollFds * sizeof(FileHandler *));
+    }
+    tsdPtr->pollFds[index].fd = -1;
+    tsdPtr->pollFds[index].events = 0;
+    tsdPtr->pollFds[index].revents = 0;
+    tsdPtr->pollHandlers[index] = filePtr;
+    return index;
+}
+#endif /* NOTIFIER_POLL */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WatchFile --
+ *
+ *	Tells the system which events to report for a file, according to the
+ *	mask of its handler.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates the epoll set or poll() array of the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WatchFile(
+    ThreadSpecificData *tsdPtr,	/* Notifier state of the current thread. */
+    FileHandler *filePtr)	/* Handler of the file to watch. */
+{
+#ifdef NOTIFIER_EPOLL
+    struct epoll_event event;
+
+    if (filePtr->epollState == FILE_REGULAR) {
+	return;
+    }
+    memset(&event, 0, sizeof(event));
+    if (filePtr->mask & TCL_READABLE) {
+	event.events |= EPOLLIN;
+    }
+    if (filePtr->mask & TCL_WRITABLE) {
+	event.events |= EPOLLOUT;
+    }
+    if (filePtr->mask & TCL_EXCEPTION) {
+	event.events |= EPOLLPRI;
+    }
+    event.data.fd = filePtr->fd;
+    if (event.events == 0) {
+	UnwatchFile(tsdPtr, filePtr);
+	return;
+    }
+
+    if (filePtr->epollState == FILE_WATCHED) {
+	if (epoll_ctl(tsdPtr->epollFd, EPOLL_CTL_MOD, filePtr->fd,
+		&event) == 0) {
+	    return;
+	}
+
+	/*
+	 * The file was closed behind our back, which took it out of the
+	 * epoll set; its descriptor may since have been reused.
+	 */
+
+	filePtr->epollState = FILE_UNWATCHED;
+    }
+    if (epoll_ctl(tsdPtr->epollFd, EPOLL_CTL_ADD, filePtr->fd,
+	    &event) == 0) {
+	filePtr->epollState = FILE_WATCHED;
+    } else if (errno == EPERM) {
+	filePtr->epollState = FILE_REGULAR;
+	filePtr->nextPtr = tsdPtr->firstRegularFilePtr;
+	tsdPtr->firstRegularFilePtr = filePtr;
+    }
+#else /* NOTIFIER_POLL */
+    struct pollfd *pollPtr = &tsdPtr->pollFds[filePtr->index];
+
+    pollPtr->events = 0;
+    if (filePtr->mask & TCL_READABLE) {
+	pollPtr->events |= POLLIN;
+    }
+    if (filePtr->mask & TCL_WRITABLE) {
+	pollPtr->events |= POLLOUT;
+    }
+    if (filePtr->mask & TCL_EXCEPTION) {
+	pollPtr->events |= POLLPRI;
+    }
+
+    /*
+     * poll() ignores negative descriptors, which keeps it from reporting
+     * hangups and errors to a handler that wants no events.
+     */
+
+    pollPtr->fd = (pollPtr->events ? filePtr->fd : -1);
+    pollPtr->revents = 0;
+#endif /* NOTIFIER_POLL */
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnwatchFile --
+ *
+ *	Tells the system to stop reporting events for a file.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates the epoll set or poll() array of the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UnwatchFile(
+    ThreadSpecificData *tsdPtr,	/* Notifier state of the current thread. */
+    FileHandler *filePtr)	/* Handler of the file to stop watching. */
+{
+#ifdef NOTIFIER_EPOLL
+    if (filePtr->epollState == FILE_WATCHED) {
+	struct epoll_event event;	/* Linux before 2.6.9 wants one. */
+
+	(void) epoll_ctl(tsdPtr->epollFd, EPOLL_CTL_DEL, filePtr->fd, &event);
+    } else if (filePtr->epollState == FILE_REGULAR) {
+	FileHandler **linkPtr = &tsdPtr->firstRegularFilePtr;
+
+	while (*linkPtr != filePtr) {
+	    linkPtr = &(*linkPtr)->nextPtr;
+	}
+	*linkPtr = filePtr->nextPtr;
+	filePtr->nextPtr = NULL;
+    }
+    filePtr->epollState = FILE_UNWATCHED;
+#else
+    tsdPtr->pollFds[filePtr->index].fd = -1;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * QueueFileEvent --
+ *
+ *	Records that a file is ready, and queues an event to call its handler
+ *	unless one is already queued.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May queue an event. A file that is only ready in ways its handler does
+ *	not care about, such as a hangup of a file watched for exceptions,
+ *	would be reported at every wait, so it is no longer watched until its
+ *	handler changes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+QueueFileEvent(
+    ThreadSpecificData *tsdPtr,	/* Notifier state of the current thread. */
+    FileHandler *filePtr,	/* Handler of the file that is ready. */
+    int mask)			/* Conditions found for the file. */
+{
+    FileHandlerEvent *fileEvPtr;
+
+    mask &= filePtr->mask;
+    if (mask == 0) {
+	UnwatchFile(tsdPtr, filePtr);
+	return;
+    }
+
+    /*
+     * Don't bother to queue an event if the mask was previously non-zero
+     * since an event must still be on the queue.
+     */
+
+    if (filePtr->readyMask == 0) {
+	fileEvPtr = (FileHandlerEvent *) ckalloc(sizeof(FileHandlerEvent));
+	fileEvPtr->header.proc = FileHandlerEventProc;
+	fileEvPtr->fd = filePtr->fd;
+	Tcl_QueueEvent((Tcl_Event *) fileEvPtr, TCL_QUEUE_TAIL);
+    }
+    filePtr->readyMask = mask;
+}
+#endif /* !NOTIFIER_SELECT */
+
+#if defined(TCL_THREADS) && defined(NOTIFIER_SELECT)
 /*
  *----------------------------------------------------------------------
  *
@@ -1103,7 +1802,7 @@ NotifierThreadProc(
 
     TclpThreadExit (0);
 }
-#endif /* TCL_THREADS */
+#endif /* TCL_THREADS && NOTIFIER_SELECT */
 
 #endif /* HAVE_COREFOUNDATION */
 
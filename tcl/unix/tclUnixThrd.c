@@ -815,6 +815,36 @@ TclpThreadGetMasterTSD(
 }
 
 #endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpNumProcessors --
+ *
+ *	Returns the number of processors online, which is how many worker
+ *	threads TclRunTasks can usefully keep busy.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpNumProcessors(void)
+{
+#if defined(TCL_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (numProcessors > 1) {
+	return (int) numProcessors;
+    }
+#endif
+    return 1;
+}
 
 /*
  * Local Variables:
@@ -1280,6 +1280,36 @@ TclpGetDefaultStdChannel(
     return channel;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpCopyChannelData --
+ *
+ *	Copies bytes between two channels without passing them through user
+ *	space. Not available on Windows, so fcopy always copies through the
+ *	channel buffers.
+ *
+ * Results:
+ *	Always 0, with no bytes copied.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpCopyChannelData(
+    Tcl_Channel inChan,		/* Channel to read from. */
+    Tcl_Channel outChan,	/* Channel to write to. */
+    Tcl_WideInt toCopy,		/* Number of bytes to copy, or -1 for all. */
+    Tcl_WideInt *copiedPtr)	/* Where to store the number of bytes
+				 * copied. */
+{
+    *copiedPtr = 0;
+    return 0;
+}
+
 /*
  *----------------------------------------------------------------------
  *
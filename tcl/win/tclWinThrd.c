@@ -1023,6 +1023,37 @@ TclpThreadGetMasterTSD(
 }
 
 #endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpNumProcessors --
+ *
+ *	Returns the number of processors, which is how many worker threads
+ *	TclRunTasks can usefully keep busy.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpNumProcessors(void)
+{
+#ifdef TCL_THREADS
+    SYSTEM_INFO systemInfo;
+
+    GetSystemInfo(&systemInfo);
+    if (systemInfo.dwNumberOfProcessors > 1) {
+	return (int) systemInfo.dwNumberOfProcessors;
+    }
+#endif
+    return 1;
+}
 
 /*
  * Local Variables: